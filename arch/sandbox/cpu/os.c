@@ -13,6 +13,7 @@
 #include <string.h>
 #include <termios.h>
 #include <time.h>
+#include <ucontext.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -84,6 +85,8 @@ int os_open(const char *pathname, int os_flags)
 
 	if (os_flags & OS_O_CREAT)
 		flags |= O_CREAT;
+	if (os_flags & OS_O_TRUNC)
+		flags |= O_TRUNC;
 
 	return open(pathname, flags, 0777);
 }
@@ -557,3 +560,36 @@ void os_localtime(struct rtc_time *rt)
 	rt->tm_yday = tm->tm_yday;
 	rt->tm_isdst = tm->tm_isdst;
 }
+
+int os_context_init(void **ctxp, void *stack, size_t size,
+		    void (*entry)(void))
+{
+	ucontext_t *uc;
+
+	uc = os_malloc(sizeof(*uc));
+	if (!uc)
+		return -ENOMEM;
+	if (getcontext(uc)) {
+		os_free(uc);
+		return -errno;
+	}
+	if (stack) {
+		uc->uc_stack.ss_sp = stack;
+		uc->uc_stack.ss_size = size;
+		uc->uc_link = NULL;
+		makecontext(uc, entry, 0);
+	}
+	*ctxp = uc;
+
+	return 0;
+}
+
+void os_context_switch(void *from, void *to)
+{
+	swapcontext(from, to);
+}
+
+void os_context_free(void *ctx)
+{
+	os_free(ctx);
+}
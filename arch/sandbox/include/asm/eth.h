@@ -14,4 +14,42 @@ void sandbox_eth_disable_response(int index, bool disable);
 
 void sandbox_eth_skip_timeout(void);
 
+struct udevice;
+
+/**
+ * struct sandbox_eth_responder - Plays the far end of a sandbox eth link
+ *
+ * ARP requests and pings are answered by the driver as usual.
+ *
+ * @send:	Called with each other IP packet sent, which it may answer
+ *		with sandbox_eth_recv_packet()
+ * @poll:	Called, if not NULL, when the driver is polled with nothing
+ *		queued to be received
+ */
+struct sandbox_eth_responder {
+	void (*send)(struct udevice *dev, void *packet, int length);
+	void (*poll)(struct udevice *dev);
+};
+
+/**
+ * sandbox_eth_set_responder() - Set the responder for a device
+ *
+ * @index:	The alias index (also DM seq number)
+ * @resp:	Responder to use, or NULL for just ARP and ping
+ */
+void sandbox_eth_set_responder(int index,
+			       const struct sandbox_eth_responder *resp);
+
+/**
+ * sandbox_eth_recv_packet() - Queue a packet to be received by a device
+ *
+ * @dev:	Device to receive the packet
+ * @packet:	Packet, starting with the Ethernet header
+ * @length:	Length of @packet in bytes
+ * @return 0 if OK, -EINVAL if too long, -ENOSPC if the queue is full, in
+ * which case the packet is dropped
+ */
+int sandbox_eth_recv_packet(struct udevice *dev, const void *packet,
+			    int length);
+
 #endif /* __ETH_H */
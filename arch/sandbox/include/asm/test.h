@@ -88,4 +88,85 @@ long sandbox_i2c_rtc_get_set_base_time(struct udevice *dev, long base_time);
 
 int sandbox_usb_keyb_add_string(struct udevice *dev, const char *str);
 
+/**
+ * sandbox_usb_set_max_xfer_size() - set the largest bulk transfer reported
+ *
+ * This takes effect when USB devices are next scanned.
+ *
+ * @bus:	Sandbox USB controller to adjust
+ * @size:	Largest transfer in bytes, or 0 for no limit
+ */
+void sandbox_usb_set_max_xfer_size(struct udevice *bus, size_t size);
+
+/**
+ * struct sandbox_flash_stats - activity seen by the sandbox USB flash stick
+ *
+ * @cmds:	Number of commands received
+ * @blocks:	Number of data blocks read
+ * @busy_us:	Modelled time spent on the commands, in microseconds
+ */
+struct sandbox_flash_stats {
+	ulong cmds;
+	ulong blocks;
+	ulong busy_us;
+};
+
+/**
+ * sandbox_flash_set_latency() - set the modelled flash stick latency
+ *
+ * Each command then takes @cmd_us to complete, covering its command, data
+ * and status stages, and each block read a further @block_us.
+ *
+ * @dev:	USB flash emulator to adjust
+ * @cmd_us:	Latency per command in microseconds
+ * @block_us:	Transfer time per block in microseconds
+ */
+void sandbox_flash_set_latency(struct udevice *dev, uint cmd_us,
+			       uint block_us);
+
+/**
+ * sandbox_flash_get_stats() - read and reset the flash stick statistics
+ *
+ * @dev:	USB flash emulator to check
+ * @stats:	Returns the statistics gathered since the last call
+ */
+void sandbox_flash_get_stats(struct udevice *dev,
+			     struct sandbox_flash_stats *stats);
+
+/**
+ * struct sandbox_mmc_stats - activity seen by the sandbox MMC emulation
+ *
+ * @cmds:	Number of commands received
+ * @stops:	Number of STOP_TRANSMISSION commands received
+ * @blocks:	Number of data blocks transferred
+ * @busy_us:	Modelled time the bus was busy, in microseconds
+ */
+struct sandbox_mmc_stats {
+	ulong cmds;
+	ulong stops;
+	ulong blocks;
+	ulong busy_us;
+};
+
+/**
+ * sandbox_mmc_set_latency() - set the modelled MMC command/data latency
+ *
+ * Each command then takes @cmd_us to complete (twice that for commands
+ * with a busy response) and each data block a further @block_us.
+ *
+ * @dev:	MMC device to adjust
+ * @cmd_us:	Latency per command in microseconds
+ * @block_us:	Transfer time per block in microseconds
+ */
+void sandbox_mmc_set_latency(struct udevice *dev, uint cmd_us, uint block_us);
+
+/**
+ * sandbox_mmc_get_stats() - read and reset the MMC emulation statistics
+ *
+ * @dev:	MMC device to check
+ * @stats:	Returns the statistics gathered since the last call
+ */
+void sandbox_mmc_get_stats(struct udevice *dev,
+			   struct sandbox_mmc_stats *stats);
+
 #endif
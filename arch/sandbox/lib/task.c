@@ -0,0 +1,24 @@
+/*
+ * Task contexts for sandbox, using the host's ucontext functions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <os.h>
+#include <task.h>
+
+int arch_task_init(void **ctxp, void *stack, ulong size, void (*entry)(void))
+{
+	return os_context_init(ctxp, stack, size, entry);
+}
+
+void arch_task_switch(void *from, void *to)
+{
+	os_context_switch(from, to);
+}
+
+void arch_task_free(void *ctx)
+{
+	os_context_free(ctx);
+}
@@ -17,12 +17,20 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
+	       "partial hits: %u\n"
 	       "misses: %u\n"
+	       "read-aheads: %u\n"
+	       "device reads: %u (%lu blocks)\n"
 	       "entries: %u\n"
+	       "bytes: %lu\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache entries: %u\n"
+	       "max cache bytes: %lu\n"
+	       "read-ahead blocks: %u\n",
+	       stats.hits, stats.partial_hits, stats.misses, stats.readaheads,
+	       stats.dev_reads, stats.dev_blocks, stats.entries, stats.bytes,
+	       stats.max_blocks_per_entry, stats.max_entries, stats.max_bytes,
+	       stats.readahead);
 	return 0;
 }
 
@@ -41,9 +49,27 @@ static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 	return 0;
 }
 
+static int blkc_budget(cmd_tbl_t *cmdtp, int flag,
+		       int argc, char * const argv[])
+{
+	unsigned long max_bytes;
+	unsigned readahead;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	max_bytes = simple_strtoul(argv[1], 0, 0);
+	readahead = simple_strtoul(argv[2], 0, 0);
+	blkcache_configure_budget(max_bytes, readahead);
+	printf("changed to max of %lu bytes, read-ahead %u blocks\n",
+	       max_bytes, readahead);
+	return 0;
+}
+
 static cmd_tbl_t cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
 	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+	U_BOOT_CMD_MKENT(budget, 3, 0, blkc_budget, "", ""),
 };
 
 static __maybe_unused void blkc_reloc(void)
@@ -84,4 +110,5 @@ U_BOOT_CMD(
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
 	"blkcache configure blocks entries\n"
+	"blkcache budget bytes readahead_blocks\n"
 );
@@ -5,6 +5,11 @@
  */
 
 #include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
+#ifdef CONFIG_SANDBOX
+#include <os.h>
+#endif
 
 static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 			       char * const argv[])
@@ -58,10 +63,74 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#ifdef CONFIG_SANDBOX
+static int bootstage_export_file(const char *fname)
+{
+	char *buf;
+	int size, fd, ret = 1;
+
+	size = bootstage_export(NULL, 0);
+	buf = malloc(size);
+	if (!buf) {
+		printf("Cannot allocate %d bytes\n", size);
+		return 1;
+	}
+	bootstage_export(buf, size);
+
+	fd = os_open(fname, OS_O_WRONLY | OS_O_CREAT | OS_O_TRUNC);
+	if (fd < 0) {
+		printf("Cannot open '%s'\n", fname);
+	} else {
+		if (os_write(fd, buf, size) == size)
+			ret = 0;
+		else
+			printf("Cannot write '%s'\n", fname);
+		os_close(fd);
+	}
+	free(buf);
+	if (!ret)
+		printf("%d bytes written to '%s'\n", size, fname);
+
+	return ret;
+}
+#endif
+
+static int do_bootstage_export(cmd_tbl_t *cmdtp, int flag, int argc,
+			       char * const argv[])
+{
+	ulong base, size;
+	void *buf;
+	int len;
+
+#ifdef CONFIG_SANDBOX
+	if (argc == 3 && !strcmp(argv[1], "-f"))
+		return bootstage_export_file(argv[2]);
+#endif
+	if (argc < 2)
+		return CMD_RET_USAGE;
+	if (get_base_size(argc, argv, &base, &size))
+		return CMD_RET_USAGE;
+	if (argc == 2)
+		size = bootstage_export(NULL, 0);
+
+	buf = map_sysmem(base, size);
+	len = bootstage_export(buf, size);
+	unmap_sysmem(buf);
+	if (len > size) {
+		printf("Export needs %d bytes, only %lu available\n", len, size);
+		return 1;
+	}
+	printf("%d bytes written to %08lx\n", len, base);
+	setenv_hex("filesize", len);
+
+	return 0;
+}
+
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+	U_BOOT_CMD_MKENT(export, 4, 0, do_bootstage_export, "", ""),
 };
 
 /*
@@ -91,5 +160,9 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
-	"unstash [<start> [<size>]]  - Unstash data from memory"
+	"unstash [<start> [<size>]]  - Unstash data from memory\n"
+	"export <start> [<size>]     - Export as Chrome trace JSON to memory"
+#ifdef CONFIG_SANDBOX
+	"\nexport -f <file>             - Export as Chrome trace JSON to a host file"
+#endif
 );
@@ -18,6 +18,7 @@
 #include <g_dnl.h>
 #include <usb.h>
 #include <net.h>
+#include <task.h>
 
 static int do_dfu(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
@@ -100,6 +101,8 @@ static int do_dfu(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		}
 
 		WATCHDOG_RESET();
+		/* let a background write to the medium carry on */
+		task_yield();
 		usb_gadget_handle_interrupts(controller_index);
 	}
 exit:
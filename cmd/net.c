@@ -10,6 +10,7 @@
  */
 #include <common.h>
 #include <command.h>
+#include <dm.h>
 #include <net.h>
 
 static int netboot_common(enum proto_t, cmd_tbl_t *, int, char * const []);
@@ -110,6 +111,19 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_WGET)
+static int do_wget(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	return netboot_common(WGET, cmdtp, argc, argv);
+}
+
+U_BOOT_CMD(
+	wget,	3,	1,	do_wget,
+	"boot image via network using HTTP protocol",
+	"[loadAddress] [[hostIPaddr:]path]"
+);
+#endif
+
 static void netboot_update_env(void)
 {
 	char tmp[22];
@@ -445,3 +459,90 @@ U_BOOT_CMD(
 );
 
 #endif  /* CONFIG_CMD_LINK_LOCAL */
+
+#ifdef CONFIG_DM_ETH
+static void show_eth_stats(void)
+{
+	const struct eth_stats *stats;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (uclass_get(UCLASS_ETH, &uc))
+		return;
+	uclass_foreach_dev(dev, uc) {
+		stats = eth_get_stats(dev);
+		if (!stats)
+			continue;
+		printf("%s:\n", dev->name);
+		printf("  rx: %lu packets, %lu bytes, %lu errors",
+		       stats->rx_packets, stats->rx_bytes, stats->rx_errors);
+		if (eth_get_ops(dev)->get_rx_dropped)
+			printf(", %lu lost", stats->rx_dropped);
+		printf("\n");
+		printf("  tx: %lu packets, %lu bytes, %lu errors\n",
+		       stats->tx_packets, stats->tx_bytes, stats->tx_errors);
+	}
+}
+#endif
+
+static void show_proto_stats(const char *name,
+			     const struct net_proto_stats *stats)
+{
+	const struct net_rtt_hist *rtt = &stats->rtt;
+	ulong limit;
+	int i;
+
+	printf("%-5s %lu timeouts, %lu resends", name, stats->timeouts,
+	       stats->resends);
+	if (!rtt->count) {
+		puts("\n");
+		return;
+	}
+	printf("; round trip avg %lu us, max %lu us\n",
+	       rtt->total_us / rtt->count, rtt->max_us);
+	for (i = 0; i < NET_RTT_BUCKETS; i++) {
+		if (!rtt->bucket[i])
+			continue;
+		limit = NET_RTT_MIN_US << i;
+		if (i == NET_RTT_BUCKETS - 1)
+			printf("  >= %6lu us: ", limit >> 1);
+		else
+			printf("   < %6lu us: ", limit);
+		printf("%lu\n", rtt->bucket[i]);
+	}
+}
+
+static int do_net_stats(void)
+{
+	printf("Receive ring:       %d buffers\n", PKTBUFSRX);
+	printf("Packets received:   %lu\n", net_stats.rx_packets);
+	printf("  lost, ring full:  %lu (if the driver counts them)\n",
+	       net_stats.rx_dropped);
+	printf("  bad:              %lu\n", net_stats.rx_bad);
+	printf("Fragments dropped:  %lu\n", net_stats.rx_frag_dropped);
+	printf("Datagrams placed:   %lu (%lu bytes not copied)\n",
+	       net_stats.rx_placed, net_stats.rx_placed_bytes);
+#ifdef CONFIG_DM_ETH
+	show_eth_stats();
+#endif
+	show_proto_stats("ARP:", &net_stats.arp);
+	show_proto_stats("TFTP:", &net_stats.tftp);
+	show_proto_stats("NFS:", &net_stats.nfs);
+
+	return CMD_RET_SUCCESS;
+}
+
+static int do_net(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	if (argc == 2 && !strcmp(argv[1], "stats"))
+		return do_net_stats();
+
+	return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(
+	net,	2,	1,	do_net,
+	"network stack status",
+	"stats - show counts of packets sent, received, lost and placed,\n"
+	"    protocol timeouts and resends, and round-trip times"
+);
@@ -7,6 +7,35 @@
 
 #include <common.h>
 #include <command.h>
+#include <decomp.h>
+#include <errno.h>
+#include <mapmem.h>
+
+#ifdef CONFIG_DECOMP_STREAM
+/* Decompresses any format which decomp_detect() recognises */
+static int unzip_any(void *src, unsigned long src_len, void *dst,
+		     unsigned long *lenp)
+{
+	int comp = decomp_detect(src, 16);
+	size_t len = *lenp;
+	int ret;
+
+	if (comp == IH_COMP_NONE) {
+		puts("Error: unknown compression format\n");
+		return -EPROTONOSUPPORT;
+	}
+	/* Decompression stops at the end of the compressed data */
+	ret = decomp_buf(comp, src, src_len, dst, &len);
+	if (ret) {
+		printf("Error: decompression failed (%s, err=%d)\n",
+		       genimg_get_comp_name(comp), ret);
+		return ret;
+	}
+	*lenp = len;
+
+	return 0;
+}
+#endif
 
 static int do_unzip(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
@@ -25,11 +54,18 @@ static int do_unzip(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			return CMD_RET_USAGE;
 	}
 
+#ifdef CONFIG_DECOMP_STREAM
+	if (unzip_any(map_sysmem(src, 0), src_len, map_sysmem(dst, dst_len),
+		      &dst_len))
+		return 1;
+#else
 	if (gunzip((void *) dst, dst_len, (void *) src, &src_len) != 0)
 		return 1;
+	dst_len = src_len;
+#endif
 
-	printf("Uncompressed size: %ld = 0x%lX\n", src_len, src_len);
-	setenv_hex("filesize", src_len);
+	printf("Uncompressed size: %ld = 0x%lX\n", dst_len, dst_len);
+	setenv_hex("filesize", dst_len);
 
 	return 0;
 }
@@ -325,7 +325,13 @@ static int initr_dm(void)
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
 #endif
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+	/* The lookup tables were allocated before relocation */
+	gd->dm_bind = NULL;
+#endif
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_R, "dm_r");
 	ret = dm_init_and_scan(false);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_R);
 	if (ret)
 		return ret;
 #ifdef CONFIG_TIMER_EARLY
@@ -737,6 +743,16 @@ static int initr_kbd(void)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(INITCALL_TASKS)
+/* Finish anything left running by earlier initcalls */
+static int initr_wait_tasks(void)
+{
+	initcall_task_wait(NULL);
+
+	return 0;
+}
+#endif
+
 static int run_main_loop(void)
 {
 #ifdef CONFIG_SANDBOX
@@ -968,6 +984,9 @@ init_fnc_t init_sequence_r[] = {
 #endif
 #if defined(CONFIG_SPARC)
 	prom_init,
+#endif
+#if CONFIG_IS_ENABLED(INITCALL_TASKS)
+	initr_wait_tasks,
 #endif
 	run_main_loop,
 };
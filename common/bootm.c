@@ -408,6 +408,15 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		size_t size = unc_len;
+
+		ret = zstd_decompress(image_buf, image_len, load_buf, &size);
+		image_len = size;
+		break;
+	}
+#endif /* CONFIG_ZSTD */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return BOOTM_ERR_UNIMPLEMENTED;
@@ -604,6 +613,7 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	boot_os_fn *boot_fn;
 	ulong iflag = 0;
 	int ret = 0, need_boot_fn;
+	int span;
 
 	images->state |= states;
 
@@ -614,11 +624,16 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	if (states & BOOTM_STATE_START)
 		ret = bootm_start(cmdtp, flag, argc, argv);
 
-	if (!ret && (states & BOOTM_STATE_FINDOS))
+	if (!ret && (states & BOOTM_STATE_FINDOS)) {
+		span = bootstage_span_begin("bootm", "find_os");
 		ret = bootm_find_os(cmdtp, flag, argc, argv);
+		bootstage_span_end(span);
+	}
 
 	if (!ret && (states & BOOTM_STATE_FINDOTHER)) {
+		span = bootstage_span_begin("bootm", "find_other");
 		ret = bootm_find_other(cmdtp, flag, argc, argv);
+		bootstage_span_end(span);
 		argc = 0;	/* consume the args */
 	}
 
@@ -627,7 +642,9 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		ulong load_end;
 
 		iflag = bootm_disable_interrupts();
+		span = bootstage_span_begin("bootm", "load_os");
 		ret = bootm_load_os(images, &load_end, 0);
+		bootstage_span_end(span);
 		if (ret == 0)
 			lmb_reserve(&images->lmb, images->os.load,
 				    (load_end - images->os.load));
@@ -656,9 +673,11 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 #endif
 #if IMAGE_ENABLE_OF_LIBFDT && defined(CONFIG_LMB)
 	if (!ret && (states & BOOTM_STATE_FDT)) {
+		span = bootstage_span_begin("bootm", "relocate_fdt");
 		boot_fdt_add_mem_rsv_regions(&images->lmb, images->ft_addr);
 		ret = boot_relocate_fdt(&images->lmb, &images->ft_addr,
 					&images->ft_len);
+		bootstage_span_end(span);
 	}
 #endif
 
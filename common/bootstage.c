@@ -9,6 +9,10 @@
  * This module records the progress of boot and arbitrary commands, and
  * permits accurate timestamping of each.
  *
+ * Besides the marks, it can record nested spans (begin/end pairs) for things
+ * like initcalls, driver probes and file loads. These can be exported in
+ * the Chrome trace-event format and viewed in chrome://tracing.
+ *
  * TBD: Pass timings to kernel in the FDT
  */
 
@@ -30,6 +34,30 @@ struct bootstage_record {
 static struct bootstage_record record[BOOTSTAGE_ID_COUNT] = { {1} };
 static int next_id = BOOTSTAGE_ID_USER;
 
+struct bootstage_span {
+	ulong start_us;
+	ulong end_us;		/* 0 while the span is still open */
+	char cat[BOOTSTAGE_SPAN_CAT_LEN];
+	char name[BOOTSTAGE_SPAN_NAME_LEN];
+};
+
+/*
+ * Spans are kept here until bootstage_relocate(), then in a malloc()ed
+ * array which grows as needed, up to CONFIG_BOOTSTAGE_SPAN_COUNT records.
+ */
+static struct bootstage_span span_early[BOOTSTAGE_SPAN_EARLY] = { {1} };
+
+static struct {
+	struct bootstage_span *span;
+	int count;		/* Number of records used */
+	int max;		/* Number of records allocated */
+	int dropped;		/* Number of spans not recorded */
+	bool ready;		/* Timer is running, spans can be recorded */
+} spans = {
+	.span = span_early,
+	.max = BOOTSTAGE_SPAN_EARLY,
+};
+
 enum {
 	BOOTSTAGE_VERSION	= 0,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
@@ -55,6 +83,20 @@ int bootstage_relocate(void)
 		if (record[i].name)
 			record[i].name = strdup(record[i].name);
 
+	/* Move the spans out of the fixed-size early array */
+	if (CONFIG_BOOTSTAGE_SPAN_COUNT > BOOTSTAGE_SPAN_EARLY) {
+		struct bootstage_span *span;
+		int max;
+
+		max = min(BOOTSTAGE_SPAN_EARLY * 2, CONFIG_BOOTSTAGE_SPAN_COUNT);
+		span = malloc(max * sizeof(*span));
+		if (span) {
+			memcpy(span, span_early, spans.count * sizeof(*span));
+			spans.span = span;
+			spans.max = max;
+		}
+	}
+
 	return 0;
 }
 
@@ -63,6 +105,9 @@ ulong bootstage_add_record(enum bootstage_id id, const char *name,
 {
 	struct bootstage_record *rec;
 
+	/* The caller has read the timer, so spans can use it from now on */
+	spans.ready = true;
+
 	if (flags & BOOTSTAGEF_ALLOC)
 		id = next_id++;
 
@@ -150,6 +195,69 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+/* Make room for one more span, growing the store if possible */
+static struct bootstage_span *span_alloc(void)
+{
+	struct bootstage_span *span;
+	int max;
+
+	if (spans.count == spans.max) {
+		max = min(spans.max * 2, CONFIG_BOOTSTAGE_SPAN_COUNT);
+		if (spans.span == span_early || max <= spans.max)
+			return NULL;
+		span = realloc(spans.span, max * sizeof(*span));
+		if (!span)
+			return NULL;
+		spans.span = span;
+		spans.max = max;
+	}
+
+	return &spans.span[spans.count++];
+}
+
+int bootstage_span_begin(const char *cat, const char *name)
+{
+	struct bootstage_span *span;
+
+	if (!spans.ready)
+		return -1;
+
+	span = span_alloc();
+	if (!span) {
+		spans.dropped++;
+		return -1;
+	}
+	strlcpy(span->cat, cat ? cat : "", sizeof(span->cat));
+	strlcpy(span->name, name ? name : "", sizeof(span->name));
+	span->end_us = 0;
+	span->start_us = timer_get_boot_us();
+
+	return span - spans.span;
+}
+
+int bootstage_span_begin_addr(const char *cat, const void *addr)
+{
+	char name[2 + 2 * sizeof(addr) + 1];
+
+	if (!spans.ready)
+		return -1;
+	snprintf(name, sizeof(name), "%p", addr);
+
+	return bootstage_span_begin(cat, name);
+}
+
+void bootstage_span_end(int span)
+{
+	ulong now;
+
+	if (span < 0 || span >= spans.count)
+		return;
+
+	/* Never make a zero-length span, which would look open */
+	now = timer_get_boot_us();
+	spans.span[span].end_us = max(now, spans.span[span].start_us + 1);
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -290,6 +398,12 @@ void bootstage_report(void)
 		if (rec->start_us)
 			prev = print_time_record(id, rec, -1);
 	}
+
+	printf("\n%d spans recorded", spans.count);
+	if (spans.dropped)
+		printf(", %d dropped - please increase CONFIG_BOOTSTAGE_SPAN_COUNT",
+		       spans.dropped);
+	puts("\n");
 }
 
 ulong __timer_get_boot_us(void)
@@ -331,6 +445,91 @@ static void append_data(char **ptrp, char *end, const void *data, int size)
 	memcpy(ptr, data, size);
 }
 
+/* Append a string as a JSON string literal */
+static void append_json_string(char **ptrp, char *end, const char *str)
+{
+	char esc[7];
+
+	append_data(ptrp, end, "\"", 1);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\') {
+			esc[0] = '\\';
+			esc[1] = *str;
+			append_data(ptrp, end, esc, 2);
+		} else if ((unsigned char)*str < ' ') {
+			snprintf(esc, sizeof(esc), "\\u%04x", *str);
+			append_data(ptrp, end, esc, 6);
+		} else {
+			append_data(ptrp, end, str, 1);
+		}
+	}
+	append_data(ptrp, end, "\"", 1);
+}
+
+static void append_json_event(char **ptrp, char *end, bool *first,
+			      const char *cat, const char *name,
+			      ulong start_us, ulong end_us)
+{
+	char buf[80];
+	int len;
+
+	len = snprintf(buf, sizeof(buf), "%s\n{\"cat\":", *first ? "" : ",");
+	append_data(ptrp, end, buf, len);
+	append_json_string(ptrp, end, cat);
+	append_data(ptrp, end, ",\"name\":", 8);
+	append_json_string(ptrp, end, name);
+	if (end_us)
+		len = snprintf(buf, sizeof(buf),
+			       ",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":1,\"tid\":1}",
+			       start_us, end_us - start_us);
+	else
+		len = snprintf(buf, sizeof(buf),
+			       ",\"ph\":\"i\",\"s\":\"g\",\"ts\":%lu,\"pid\":1,\"tid\":1}",
+			       start_us);
+	append_data(ptrp, end, buf, len);
+	*first = false;
+}
+
+int bootstage_export(void *base, int size)
+{
+	static const char head[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	static const char tail[] = "\n]}\n";
+	struct bootstage_record *rec;
+	struct bootstage_span *span;
+	char *ptr = base, *end = ptr + size;
+	bool first = true;
+	char buf[20];
+	ulong now;
+	int id;
+
+	append_data(&ptr, end, head, sizeof(head) - 1);
+
+	/*
+	 * Marks are instant events. As in bootstage_report(), the first
+	 * record is a fake one for the reset.
+	 */
+	append_json_event(&ptr, end, &first, "mark", "reset", 0, 0);
+	for (rec = record, id = 0; id < BOOTSTAGE_ID_COUNT; id++, rec++) {
+		if (rec->id != 0 && rec->time_us != 0 && !rec->start_us)
+			append_json_event(&ptr, end, &first, "mark",
+					  get_record_name(buf, sizeof(buf),
+							  rec),
+					  rec->time_us, 0);
+	}
+
+	/* Spans still open (e.g. the one running this) end now */
+	now = timer_get_boot_us();
+	for (span = spans.span; span < spans.span + spans.count; span++)
+		append_json_event(&ptr, end, &first, span->cat, span->name,
+				  span->start_us,
+				  span->end_us ? span->end_us :
+				  max(now, span->start_us + 1));
+
+	append_data(&ptr, end, tail, sizeof(tail) - 1);
+
+	return ptr - (char *)base;
+}
+
 int bootstage_stash(void *base, int size)
 {
 	struct bootstage_hdr *hdr = (struct bootstage_hdr *)base;
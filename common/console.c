@@ -643,14 +643,24 @@ void clear_ctrlc(void)
 
 /** U-Boot INIT FUNCTIONS *************************************************/
 
+static struct stdio_dev *console_get_by_name(const char *name)
+{
+#if CONFIG_IS_ENABLED(DM_LAZY_PROBE)
+	/* The device may not have been probed yet */
+	stdio_probe_devices(name);
+#endif
+
+	return stdio_get_by_name(name);
+}
+
 struct stdio_dev *search_device(int flags, const char *name)
 {
 	struct stdio_dev *dev;
 
-	dev = stdio_get_by_name(name);
+	dev = console_get_by_name(name);
 #ifdef CONFIG_VIDCONSOLE_AS_LCD
 	if (!dev && !strcmp(name, "lcd"))
-		dev = stdio_get_by_name("vidconsole");
+		dev = console_get_by_name("vidconsole");
 #endif
 
 	if (dev && (dev->flags & flags))
@@ -7,6 +7,7 @@
 #include <config.h>
 #include <common.h>
 #include <blk.h>
+#include <decomp.h>
 #include <errno.h>
 #include <fastboot.h>
 #include <fb_mmc.h>
@@ -15,6 +16,7 @@
 #include <sparse_format.h>
 #include <mmc.h>
 #include <div64.h>
+#include <malloc.h>
 
 #ifndef CONFIG_FASTBOOT_GPT_NAME
 #define CONFIG_FASTBOOT_GPT_NAME GPT_ENTRY_NAME
@@ -66,6 +68,22 @@ static int fb_mmc_sparse_write(struct sparse_storage *storage,
 	return ret;
 }
 
+#ifdef CONFIG_FASTBOOT_MMC_SPARSE_ERASE
+static int fb_mmc_sparse_erase(struct sparse_storage *storage, void *priv,
+			       unsigned int offset, unsigned int size)
+{
+	struct fb_mmc_sparse *sparse = priv;
+	struct blk_desc *dev_desc = sparse->dev_desc;
+	int ret;
+
+	ret = blk_derase(dev_desc, offset, size);
+	if (ret != size)
+		return -EIO;
+
+	return ret;
+}
+#endif
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		unsigned int download_bytes)
@@ -97,6 +115,114 @@ static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 	fastboot_okay(response_str, "");
 }
 
+#ifdef CONFIG_DECOMP_STREAM
+/* Decompressed data is written out in pieces of this size */
+#define FB_MMC_DECOMP_BUF_SIZE	(1 << 20)
+
+struct fb_mmc_decomp {
+	struct blk_desc	*dev_desc;
+	disk_partition_t *info;
+	lbaint_t blk;		/* next block to write, from the partition start */
+	u8 *buf;
+	size_t len;		/* bytes waiting in @buf */
+};
+
+/* Writes out what is in the buffer, padding to a whole block at the end */
+static int fb_mmc_decomp_write(struct fb_mmc_decomp *dc)
+{
+	lbaint_t blkcnt;
+
+	if (!dc->len)
+		return 0;
+	blkcnt = DIV_ROUND_UP(dc->len, dc->info->blksz);
+	memset(dc->buf + dc->len, '\0', blkcnt * dc->info->blksz - dc->len);
+	if (dc->blk + blkcnt > dc->info->size)
+		return -EFBIG;
+	if (blk_dwrite(dc->dev_desc, dc->info->start + dc->blk, blkcnt,
+		       dc->buf) != blkcnt)
+		return -EIO;
+	dc->blk += blkcnt;
+	dc->len = 0;
+
+	return 0;
+}
+
+static int fb_mmc_decomp_out(void *priv, const void *buf, size_t len)
+{
+	struct fb_mmc_decomp *dc = priv;
+	size_t n;
+	int ret;
+
+	while (len) {
+		n = min_t(size_t, len, FB_MMC_DECOMP_BUF_SIZE - dc->len);
+		memcpy(dc->buf + dc->len, buf, n);
+		dc->len += n;
+		buf += n;
+		len -= n;
+		if (dc->len == FB_MMC_DECOMP_BUF_SIZE) {
+			ret = fb_mmc_decomp_write(dc);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Decompress an image straight to the partition, so that the decompressed
+ * image never has to fit in memory
+ */
+static void write_compressed_image(struct blk_desc *dev_desc,
+		disk_partition_t *info, const char *part_name, int comp,
+		void *buffer, unsigned int download_bytes)
+{
+	struct fb_mmc_decomp dc;
+	struct decomp_stream *ds;
+	int ret;
+
+	dc.dev_desc = dev_desc;
+	dc.info = info;
+	dc.blk = 0;
+	dc.len = 0;
+	dc.buf = memalign(ARCH_DMA_MINALIGN, FB_MMC_DECOMP_BUF_SIZE);
+	if (!dc.buf) {
+		fastboot_fail(response_str, "out of memory");
+		return;
+	}
+
+	printf("Flashing Raw Image (%s)\n", genimg_get_comp_name(comp));
+	ret = decomp_init(&ds, comp, fb_mmc_decomp_out, &dc);
+	if (!ret) {
+		ret = decomp_feed(ds, buffer, download_bytes);
+		if (!ret)
+			ret = decomp_flush(ds);
+		if (!ret)
+			ret = fb_mmc_decomp_write(&dc);
+		decomp_free(ds);
+	}
+	free(dc.buf);
+
+	if (ret == -EFBIG) {
+		error("too large for partition: '%s'\n", part_name);
+		fastboot_fail(response_str, "too large for partition");
+		return;
+	} else if (ret == -EIO) {
+		error("failed writing to device %d\n", dev_desc->devnum);
+		fastboot_fail(response_str, "failed writing to device");
+		return;
+	} else if (ret) {
+		error("decompression failed (err=%d)\n", ret);
+		fastboot_fail(response_str, "decompression failed");
+		return;
+	}
+
+	printf("........ wrote " LBAFU " bytes to '%s'\n",
+	       dc.blk * info->blksz, part_name);
+	fastboot_okay(response_str, "");
+}
+#endif
+
 void fb_mmc_flash_write(const char *cmd, unsigned int session_id,
 			void *download_buffer, unsigned int download_bytes,
 			char *response)
@@ -141,14 +267,29 @@ void fb_mmc_flash_write(const char *cmd, unsigned int session_id,
 	if (is_sparse_image(download_buffer)) {
 		struct fb_mmc_sparse sparse_priv;
 		sparse_storage_t sparse;
+#ifdef CONFIG_FASTBOOT_MMC_SPARSE_ERASE
+		struct mmc *mmc = find_mmc_device(CONFIG_FASTBOOT_FLASH_MMC_DEV);
+#endif
 
 		sparse_priv.dev_desc = dev_desc;
 
+		memset(&sparse, '\0', sizeof(sparse));
 		sparse.block_sz = info.blksz;
 		sparse.start = info.start;
 		sparse.size = info.size;
 		sparse.name = cmd;
 		sparse.write = fb_mmc_sparse_write;
+#ifdef CONFIG_FASTBOOT_MMC_SPARSE_ERASE
+		/*
+		 * mmc_berase() sends a whole erase sequence per erase group,
+		 * which only beats writing zeroes for large groups. SD cards
+		 * use one-sector groups here, so they always write.
+		 */
+		if (mmc && !IS_SD(mmc) && mmc->erase_grp_size > 1) {
+			sparse.erase = fb_mmc_sparse_erase;
+			sparse.erase_sz = mmc->erase_grp_size;
+		}
+#endif
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       info.start);
@@ -156,6 +297,18 @@ void fb_mmc_flash_write(const char *cmd, unsigned int session_id,
 		store_sparse_image(&sparse, &sparse_priv, session_id,
 				   download_buffer);
 	} else {
+#ifdef CONFIG_DECOMP_STREAM
+		int comp = IH_COMP_NONE;
+
+		/* Images may be meant to be stored compressed, so only if asked */
+		if (getenv_yesno("fastboot_decompress") == 1)
+			comp = decomp_detect(download_buffer, download_bytes);
+		if (comp != IH_COMP_NONE) {
+			write_compressed_image(dev_desc, &info, cmd, comp,
+					       download_buffer, download_bytes);
+			return;
+		}
+#endif
 		write_raw_image(dev_desc, &info, cmd, download_buffer,
 				download_bytes);
 	}
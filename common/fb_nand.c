@@ -152,6 +152,7 @@ void fb_nand_flash_write(const char *partname, unsigned int session_id,
 		struct fb_nand_sparse sparse_priv;
 		sparse_storage_t sparse;
 
+		memset(&sparse, '\0', sizeof(sparse));
 		sparse_priv.nand = nand;
 		sparse_priv.part = part;
 
@@ -13,6 +13,7 @@
 #ifndef USE_HOSTCC
 #include <common.h>
 #include <command.h>
+#include <div64.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include <hw_sha.h>
@@ -473,5 +474,46 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 
 	return 0;
 }
+
+#ifdef CONFIG_CMD_HASH
+/* Amount of data hashed by each algorithm in hash_bench() */
+#define HASH_BENCH_BYTES	(16 << 20)
+
+int hash_bench(ulong size)
+{
+	struct hash_algo *algo;
+	uint8_t output[HASH_MAX_DIGEST_SIZE];
+	ulong start, us, iter, i;
+	uint8_t *buf;
+	int a;
+
+	if (!size)
+		return CMD_RET_USAGE;
+
+	buf = malloc(size);
+	if (!buf) {
+		printf("Cannot allocate %#lx bytes\n", size);
+		return CMD_RET_FAILURE;
+	}
+	for (i = 0; i < size; i++)
+		buf[i] = i * 7 + (i >> 8);
+
+	iter = size < HASH_BENCH_BYTES ? HASH_BENCH_BYTES / size : 1;
+	printf("Hashing %lu x %#lx bytes\n", iter, size);
+	for (a = 0; a < ARRAY_SIZE(hash_algo); a++) {
+		algo = &hash_algo[a];
+		start = timer_get_us();
+		for (i = 0; i < iter; i++)
+			algo->hash_func_ws(buf, size, output,
+					   algo->chunk_size);
+		us = timer_get_us() - start;
+		printf("%-10s %8lu MB/s\n", algo->name,
+		       us ? (ulong)lldiv((u64)iter * size, us) : 0);
+	}
+	free(buf);
+
+	return 0;
+}
+#endif
 #endif
 #endif
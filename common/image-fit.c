@@ -17,6 +17,7 @@
 #include <common.h>
 #include <errno.h>
 #include <mapmem.h>
+#include <watchdog.h>
 #include <asm/io.h>
 DECLARE_GLOBAL_DATA_PTR;
 #endif /* !USE_HOSTCC*/
@@ -988,26 +989,174 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	return 0;
 }
 
-/**
- * fit_image_verify - verify data intergity
- * @fit: pointer to the FIT format image header
- * @image_noffset: component image node offset
+/* Maximum number of hash nodes computed in a single pass over the data */
+#define FIT_MAX_HASH_NODES	4
+
+struct fit_hash_stream {
+	int noffset;
+	char *algo;
+	int ignore;
+	struct hash_algo *hash;
+	void *ctx;
+	uint8_t value[FIT_MAX_HASH_LEN];
+};
+
+/*
+ * Collect the hash nodes of a component image. Returns the number of nodes,
+ * or -1 if they cannot all be computed progressively, in which case the
+ * caller falls back to checking them one by one.
+ */
+static int fit_image_hash_collect(const void *fit, int image_noffset,
+				  struct fit_hash_stream *st)
+{
+	int noffset;
+	int count = 0;
+
+	fdt_for_each_subnode(fit, noffset, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (count == FIT_MAX_HASH_NODES)
+			return -1;
+		st[count].noffset = noffset;
+		st[count].ignore = 0;
+		if (fit_image_hash_get_algo(fit, noffset, &st[count].algo))
+			return -1;
+		if (IMAGE_ENABLE_IGNORE)
+			fit_image_hash_get_ignore(fit, noffset,
+						  &st[count].ignore);
+		if (!st[count].ignore &&
+		    hash_progressive_lookup_algo(st[count].algo,
+						 &st[count].hash))
+			return -1;
+		count++;
+	}
+
+	if (noffset == -FDT_ERR_TRUNCATED || noffset == -FDT_ERR_BADSTRUCTURE)
+		return -1;
+
+	return count;
+}
+
+/*
+ * fit_image_hash_stream - check all hash nodes in one pass over the data
  *
- * fit_image_verify() goes over component image hash nodes,
- * re-calculates each data hash and compares with the value stored in hash
- * node.
+ * Rather than walking the image data once per hash node, feed each chunk
+ * to every hash algorithm in turn. If @dst is not NULL the data is also
+ * copied there, each chunk being hashed right after it was copied while
+ * it is still in the cache, so that placing an image at its load address
+ * and checking it costs a single pass over memory.
  *
  * returns:
- *     1, if all hashes are valid
- *     0, otherwise (or on error)
+ *     0, if all hashes are valid
+ *     1, if the hash nodes cannot be handled in a single pass (nothing
+ *        has been copied or printed)
+ *    -1, on error, with *err_noffsetp and *err_msgp set
  */
-int fit_image_verify(const void *fit, int image_noffset)
+static int fit_image_hash_stream(const void *fit, int image_noffset,
+				 const void *data, size_t size, void *dst,
+				 int *err_noffsetp, char **err_msgp)
+{
+	struct fit_hash_stream st[FIT_MAX_HASH_NODES];
+	const char *src = data;
+	const char *p;
+	uint8_t *fit_value;
+	int fit_value_len;
+	size_t done, chunk;
+	int count, i;
+
+	count = fit_image_hash_collect(fit, image_noffset, st);
+	if (count < 0)
+		return 1;
+
+	for (i = 0; i < count; i++) {
+		if (st[i].ignore ||
+		    !st[i].hash->hash_init(st[i].hash, &st[i].ctx))
+			continue;
+		/* release the contexts created so far */
+		while (i--) {
+			if (!st[i].ignore)
+				st[i].hash->hash_finish(st[i].hash, st[i].ctx,
+							st[i].value,
+							sizeof(st[i].value));
+		}
+		return 1;
+	}
+
+	for (done = 0; done < size; done += chunk) {
+		chunk = size - done < CHUNKSZ ? size - done : CHUNKSZ;
+		p = src + done;
+		if (dst) {
+			memcpy((char *)dst + done, p, chunk);
+			p = (char *)dst + done;
+		}
+		for (i = 0; i < count; i++) {
+			if (!st[i].ignore)
+				st[i].hash->hash_update(st[i].hash, st[i].ctx,
+							p, chunk,
+							done + chunk == size);
+		}
+#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
+		WATCHDOG_RESET();
+#endif
+	}
+
+	for (i = 0; i < count; i++) {
+		if (st[i].ignore)
+			continue;
+		st[i].hash->hash_finish(st[i].hash, st[i].ctx, st[i].value,
+					sizeof(st[i].value));
+		/* FIT stores crc32 in image byte order, see calculate_hash() */
+		if (!strcmp(st[i].algo, "crc32"))
+			*(uint32_t *)st[i].value =
+				cpu_to_uimage(*(uint32_t *)st[i].value);
+	}
+
+	for (i = 0; i < count; i++) {
+		printf("%s", st[i].algo);
+		if (st[i].ignore) {
+			printf("-skipped ");
+			puts("+ ");
+			continue;
+		}
+
+		*err_noffsetp = st[i].noffset;
+		if (fit_image_hash_get_value(fit, st[i].noffset, &fit_value,
+					     &fit_value_len)) {
+			*err_msgp = "Can't get hash value property";
+			return -1;
+		}
+		if (st[i].hash->digest_size != fit_value_len) {
+			*err_msgp = "Bad hash value len";
+			return -1;
+		} else if (memcmp(st[i].value, fit_value, fit_value_len) != 0) {
+			*err_msgp = "Bad hash value";
+			return -1;
+		}
+		puts("+ ");
+	}
+
+	return 0;
+}
+
+/*
+ * fit_image_verify_copy - verify data intergity, optionally copying it
+ *
+ * As fit_image_verify(), but if @dst is not NULL the image data is also
+ * copied there. @dst must not overlap the image data. The copy happens as
+ * the data is hashed, so @dst is written even if the image is bad.
+ */
+static int fit_image_verify_copy(const void *fit, int image_noffset,
+				 void *dst)
 {
 	const void	*data;
 	size_t		size;
 	int		noffset = 0;
 	char		*err_msg = "";
 	int verify_all = 1;
+	int fallback;
 	int ret;
 
 	/* Get image data and data length */
@@ -1024,6 +1173,14 @@ int fit_image_verify(const void *fit, int image_noffset)
 		goto error;
 	}
 
+	/* Check all hash nodes in a single pass if we can */
+	fallback = fit_image_hash_stream(fit, image_noffset, data, size, dst,
+					 &noffset, &err_msg);
+	if (fallback < 0)
+		goto error;
+	if (fallback && dst)
+		memcpy(dst, data, size);
+
 	/* Process all hash subnodes of the component image node */
 	fdt_for_each_subnode(fit, noffset, image_noffset) {
 		const char *name = fit_get_name(fit, noffset, NULL);
@@ -1035,6 +1192,8 @@ int fit_image_verify(const void *fit, int image_noffset)
 		 */
 		if (!strncmp(name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
+			if (!fallback)
+				continue;
 			if (fit_image_check_hash(fit, noffset, data, size,
 						 &err_msg))
 				goto error;
@@ -1072,6 +1231,25 @@ error:
 	return 0;
 }
 
+/**
+ * fit_image_verify - verify data intergity
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ *
+ * fit_image_verify() goes over component image hash nodes,
+ * re-calculates each data hash and compares with the value stored in hash
+ * node. The hashes are computed together in a single pass over the data
+ * when all of their algorithms support progressive hashing.
+ *
+ * returns:
+ *     1, if all hashes are valid
+ *     0, otherwise (or on error)
+ */
+int fit_image_verify(const void *fit, int image_noffset)
+{
+	return fit_image_verify_copy(fit, image_noffset, NULL);
+}
+
 /**
  * fit_all_image_verify - verify data intergity for all images
  * @fit: pointer to the FIT format image header
@@ -1505,18 +1683,24 @@ void fit_conf_print(const void *fit, int noffset, const char *p)
 	}
 }
 
+static int fit_image_check_integrity(const void *fit, int noffset, void *dst)
+{
+	puts("   Verifying Hash Integrity ... ");
+	if (!fit_image_verify_copy(fit, noffset, dst)) {
+		puts("Bad Data Hash\n");
+		return -EACCES;
+	}
+	puts("OK\n");
+
+	return 0;
+}
+
 static int fit_image_select(const void *fit, int rd_noffset, int verify)
 {
 	fit_image_print(fit, rd_noffset, "   ");
 
-	if (verify) {
-		puts("   Verifying Hash Integrity ... ");
-		if (!fit_image_verify(fit, rd_noffset)) {
-			puts("Bad Data Hash\n");
-			return -EACCES;
-		}
-		puts("OK\n");
-	}
+	if (verify)
+		return fit_image_check_integrity(fit, rd_noffset, NULL);
 
 	return 0;
 }
@@ -1594,6 +1778,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	ulong load, data, len;
 	uint8_t os;
 	const char *prop_name;
+	int verify_on_load;
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -1662,7 +1847,17 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	/*
+	 * An image that is going to be copied to its load address can be
+	 * verified while it is copied, in a single pass over the data. If
+	 * it is bad, its load address has been overwritten by then.
+	 */
+	verify_on_load = IMAGE_ENABLE_VERIFY_ON_LOAD &&
+		images->verify && load_op != FIT_LOAD_IGNORED &&
+		!fit_image_get_load(fit, noffset, &load) &&
+		(load_op != FIT_LOAD_OPTIONAL_NON_ZERO || load);
+	ret = fit_image_select(fit, noffset,
+			       images->verify && !verify_on_load);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
@@ -1768,7 +1963,21 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		       prop_name, data, load);
 
 		dst = map_sysmem(load, len);
-		memmove(dst, buf, len);
+		if (verify_on_load &&
+		    ((char *)dst + len <= (char *)buf ||
+		     (char *)dst >= (char *)buf + len)) {
+			ret = fit_image_check_integrity(fit, noffset, dst);
+		} else {
+			ret = verify_on_load ?
+				fit_image_check_integrity(fit, noffset, NULL) :
+				0;
+			if (!ret)
+				memmove(dst, buf, len);
+		}
+		if (ret) {
+			bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
+			return ret;
+		}
 		data = load;
 	}
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_LOAD);
@@ -45,12 +45,37 @@
 
 #include <linux/math64.h>
 
-typedef struct sparse_buffer {
-	void	*data;
-	u32	length;
-	u32	repeat;
-	u16	type;
-} sparse_buffer_t;
+/* Largest buffer used to write FILL chunks */
+#define SPARSE_FILL_BUF_SIZE	(1 << 20)
+
+/**
+ * struct sparse_writer - State while storing a sparse image
+ *
+ * @storage:	Where the image goes
+ * @priv:	Private data for @storage
+ * @blk:	Block where the next chunk goes
+ * @run:	RAW data not written yet, or NULL if none
+ * @run_blk:	Block where @run goes
+ * @run_cnt:	Number of blocks in @run
+ * @fill:	Buffer holding a FILL pattern, or NULL if not allocated yet
+ * @fill_cnt:	Number of blocks in @fill
+ * @fill_val:	Pattern in @fill
+ * @writes:	Number of write calls made
+ * @erases:	Number of erase calls made
+ */
+struct sparse_writer {
+	sparse_storage_t *storage;
+	void *priv;
+	uint32_t blk;
+	char *run;
+	uint32_t run_blk;
+	uint32_t run_cnt;
+	uint32_t *fill;
+	uint32_t fill_cnt;
+	uint32_t fill_val;
+	unsigned int writes;
+	unsigned int erases;
+};
 
 static uint32_t last_offset;
 
@@ -68,18 +93,6 @@ static unsigned int sparse_block_size_to_storage(unsigned int size,
 				   storage->block_sz);
 }
 
-static bool sparse_chunk_has_buffer(chunk_header_t *chunk)
-{
-	switch (chunk->chunk_type) {
-	case CHUNK_TYPE_RAW:
-	case CHUNK_TYPE_FILL:
-		return true;
-
-	default:
-		return false;
-	}
-}
-
 static sparse_header_t *sparse_parse_header(void **data)
 {
 	/* Read and skip over sparse image header */
@@ -167,116 +180,169 @@ static chunk_header_t *sparse_parse_chunk(sparse_header_t *sparse,
 	return chunk;
 }
 
-static int sparse_get_fill_buffer(sparse_header_t *sparse,
-				  chunk_header_t *chunk,
-				  sparse_buffer_t *buffer,
-				  unsigned int blk_sz,
-				  void *data)
+/* Writes blocks, moving the position on by the number the storage used */
+static int sparse_write(struct sparse_writer *w, uint32_t cnt, char *data)
 {
-	int i;
+	sparse_storage_t *storage = w->storage;
+	int ret;
 
-	buffer->type = CHUNK_TYPE_FILL;
+	if (w->blk + cnt > storage->start + storage->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		return -EINVAL;
+	}
+	ret = storage->write(storage, w->priv, w->blk, cnt, data);
+	w->writes++;
+	if (ret < 0) {
+		printf("%s: Write of %u blocks at 0x%x failed %d\n", __func__,
+		       cnt, w->blk, ret);
+		return ret;
+	}
+	w->blk += ret;
 
-	/*
-	 * We create a buffer of one block, and ask it to be
-	 * repeated as many times as needed.
-	 */
-	buffer->length = blk_sz;
-	buffer->repeat = (chunk->chunk_sz * sparse->blk_sz) / blk_sz;
+	return 0;
+}
 
-	buffer->data = memalign(ARCH_DMA_MINALIGN,
-				ROUNDUP(blk_sz,
-					ARCH_DMA_MINALIGN));
-	if (!buffer->data)
-		return -ENOMEM;
+static int sparse_flush_raw(struct sparse_writer *w)
+{
+	uint32_t blk = w->blk;
+	int ret;
 
-	for (i = 0; i < (buffer->length / sizeof(uint32_t)); i++)
-		((uint32_t *)buffer->data)[i] = *(uint32_t *)(data);
+	if (!w->run)
+		return 0;
+	w->blk = w->run_blk;
+	ret = sparse_write(w, w->run_cnt, w->run);
+	if (!ret && w->blk != blk)
+		debug("%s: %u blocks used for %u\n", __func__,
+		      w->blk - w->run_blk, w->run_cnt);
+	w->run = NULL;
 
-	return 0;
+	return ret;
 }
 
-static int sparse_get_raw_buffer(sparse_header_t *sparse,
-				 chunk_header_t *chunk,
-				 sparse_buffer_t *buffer,
-				 unsigned int blk_sz,
-				 void *data)
+/*
+ * Adds a RAW chunk to the pending write. The data of adjacent chunks is
+ * moved down over the chunk headers between them, so that it can be
+ * written in one go.
+ */
+static int sparse_add_raw(struct sparse_writer *w, char *data, uint32_t cnt)
 {
-	unsigned int chunk_data_sz = sparse_get_chunk_data_size(sparse, chunk);
+	unsigned int blk_sz = w->storage->block_sz;
 
-	buffer->type = CHUNK_TYPE_RAW;
-	buffer->length = chunk_data_sz;
-	buffer->data = data;
-	buffer->repeat = 1;
+	if (w->blk + cnt > w->storage->start + w->storage->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		return -EINVAL;
+	}
+	if (w->run) {
+		memmove(w->run + w->run_cnt * blk_sz, data, cnt * blk_sz);
+		w->run_cnt += cnt;
+	} else {
+		w->run = data;
+		w->run_blk = w->blk;
+		w->run_cnt = cnt;
+	}
+	w->blk += cnt;
 
 	return 0;
 }
 
-static sparse_buffer_t *sparse_get_data_buffer(sparse_header_t *sparse,
-					       chunk_header_t *chunk,
-					       unsigned int blk_sz,
-					       void **image)
+static int sparse_write_fill(struct sparse_writer *w, uint32_t cnt,
+			     uint32_t val)
 {
-	unsigned int chunk_data_sz = sparse_get_chunk_data_size(sparse, chunk);
-	sparse_buffer_t *buffer;
-	void *data = *image;
+	unsigned int blk_sz = w->storage->block_sz;
+	uint32_t i, n;
 	int ret;
 
-	*image += chunk_data_sz;
-
-	if (!sparse_chunk_has_buffer(chunk))
-		return NULL;
-
-	buffer = calloc(sizeof(sparse_buffer_t), 1);
-	if (!buffer)
-		return NULL;
+	if (!w->fill) {
+		w->fill_cnt = max(SPARSE_FILL_BUF_SIZE / blk_sz, 1U);
+		w->fill = memalign(ARCH_DMA_MINALIGN,
+				   ROUNDUP(w->fill_cnt * blk_sz,
+					   ARCH_DMA_MINALIGN));
+		if (!w->fill)
+			return -ENOMEM;
+		w->fill_val = ~val;
+	}
+	if (w->fill_val != val) {
+		for (i = 0; i < w->fill_cnt * blk_sz / sizeof(val); i++)
+			w->fill[i] = val;
+		w->fill_val = val;
+	}
 
-	switch (chunk->chunk_type) {
-	case CHUNK_TYPE_RAW:
-		ret = sparse_get_raw_buffer(sparse, chunk, buffer, blk_sz,
-					    data);
+	while (cnt) {
+		n = min(cnt, w->fill_cnt);
+		ret = sparse_write(w, n, (char *)w->fill);
 		if (ret)
-			return NULL;
-		break;
+			return ret;
+		cnt -= n;
+	}
 
-	case CHUNK_TYPE_FILL:
-		ret = sparse_get_fill_buffer(sparse, chunk, buffer, blk_sz,
-					     data);
-		if (ret)
-			return NULL;
-		break;
+	return 0;
+}
 
-	default:
-		return NULL;
-	}
+/*
+ * Erases whole erase units within the next @cnt blocks, if the storage can.
+ * Sets *@headp and *@tailp to the number of blocks before and after the
+ * erased part, and returns the number of blocks erased.
+ */
+static uint32_t sparse_erase(struct sparse_writer *w, uint32_t cnt,
+			     uint32_t *headp, uint32_t *tailp)
+{
+	sparse_storage_t *storage = w->storage;
+	uint32_t grp = max(storage->erase_sz, 1U);
+	uint32_t end = min(w->blk + cnt, storage->start + storage->size);
+	uint32_t first, last;
+	int ret;
 
-	debug("=== Buffer ===\n");
-	debug("length: 0x%x\n", buffer->length);
-	debug("repeat: 0x%x\n", buffer->repeat);
-	debug("type: 0x%x\n", buffer->type);
-	debug("data: 0x%p\n", buffer->data);
+	*headp = cnt;
+	*tailp = 0;
+	if (!storage->erase || end <= w->blk)
+		return 0;
+	first = roundup(w->blk, grp);
+	last = rounddown(end, grp);
+	if (last <= first)
+		return 0;
+
+	ret = storage->erase(storage, w->priv, first, last - first);
+	w->erases++;
+	if (ret != last - first) {
+		debug("%s: Erase of %u blocks at 0x%x failed %d\n", __func__,
+		      last - first, first, ret);
+		return 0;
+	}
+	*headp = first - w->blk;
+	*tailp = w->blk + cnt - last;
 
-	return buffer;
+	return last - first;
 }
 
-static void sparse_put_data_buffer(sparse_buffer_t *buffer)
+static int sparse_fill(struct sparse_writer *w, uint32_t cnt, uint32_t val)
 {
-	if (buffer->type == CHUNK_TYPE_FILL)
-		free(buffer->data);
+	uint32_t head, tail, erased = 0;
+	int ret;
+
+	/* Erasing large units is quicker than writing zeroes */
+	if (!val)
+		erased = sparse_erase(w, cnt, &head, &tail);
+	if (!erased)
+		return sparse_write_fill(w, cnt, val);
 
-	free(buffer);
+	ret = sparse_write_fill(w, head, val);
+	if (ret)
+		return ret;
+	w->blk += erased;
+
+	return sparse_write_fill(w, tail, val);
 }
 
 int store_sparse_image(sparse_storage_t *storage, void *storage_priv,
 		       unsigned int session_id, void *data)
 {
-	unsigned int chunk, offset;
+	unsigned int chunk, offset, data_sz;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
-	sparse_buffer_t *buffer;
-	uint32_t start;
-	uint32_t total_blocks = 0;
-	int i;
+	struct sparse_writer w;
+	uint32_t start, blkcnt, fill_val;
+	uint32_t total_blocks;
+	int ret = 0;
 
 	debug("=== Storage ===\n");
 	debug("name: %s\n", storage->name);
@@ -284,6 +350,8 @@ int store_sparse_image(sparse_storage_t *storage, void *storage_priv,
 	debug("start: 0x%x\n", storage->start);
 	debug("size: 0x%x\n", storage->size);
 	debug("write: 0x%p\n", storage->write);
+	debug("erase: 0x%p, erase_sz: 0x%x\n", storage->erase,
+	      storage->erase_sz);
 	debug("priv: 0x%p\n", storage_priv);
 
 	sparse_header = sparse_parse_header(&data);
@@ -315,73 +383,73 @@ int store_sparse_image(sparse_storage_t *storage, void *storage_priv,
 	printf("Flashing sparse image on partition %s at offset 0x%x (ID: %d)\n",
 	       storage->name, start * storage->block_sz, session_id);
 
+	memset(&w, '\0', sizeof(w));
+	w.storage = storage;
+	w.priv = storage_priv;
+	w.blk = start;
+
 	/* Start processing chunks */
 	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
-		uint32_t blkcnt;
-
 		chunk_header = sparse_parse_chunk(sparse_header, &data);
 		if (!chunk_header) {
 			printf("Unknown chunk type");
-			return -EINVAL;
+			ret = -EINVAL;
+			break;
 		}
-
-		/*
-		 * If we have a DONT_CARE type, just skip the blocks
-		 * and go on parsing the rest of the chunks
-		 */
-		if (chunk_header->chunk_type == CHUNK_TYPE_DONT_CARE) {
-			blkcnt = sparse_block_size_to_storage(chunk_header->chunk_sz,
-							      storage,
-							      sparse_header);
-#ifdef CONFIG_FASTBOOT_FLASH_MMC_DEV
-			total_blocks += blkcnt;
-#endif
+		data_sz = sparse_get_chunk_data_size(sparse_header,
+						     chunk_header);
+		blkcnt = sparse_block_size_to_storage(chunk_header->chunk_sz,
+						      storage, sparse_header);
+
+		/* RAW data may be moved over this chunk's header */
+		if (chunk_header->chunk_type == CHUNK_TYPE_RAW) {
+			ret = sparse_add_raw(&w, data, blkcnt);
+			data += data_sz;
+			if (ret)
+				break;
 			continue;
-		}
-
-		/* Retrieve the buffer we're going to write */
-		buffer = sparse_get_data_buffer(sparse_header, chunk_header,
-						storage->block_sz, &data);
-		if (!buffer)
+		} else if (chunk_header->chunk_type == CHUNK_TYPE_CRC32) {
+			data += data_sz;
 			continue;
-
-		blkcnt = (buffer->length / storage->block_sz) * buffer->repeat;
-
-		if ((start + total_blocks + blkcnt) >
-		    (storage->start + storage->size)) {
-			printf("%s: Request would exceed partition size!\n",
-			       __func__);
-			return -EINVAL;
 		}
+		ret = sparse_flush_raw(&w);
+		if (ret)
+			break;
 
-		for (i = 0; i < buffer->repeat; i++) {
-			unsigned long buffer_blk_cnt;
-			int ret;
-
-			buffer_blk_cnt = buffer->length / storage->block_sz;
-
-			ret = storage->write(storage, storage_priv,
-					     start + total_blocks,
-					     buffer_blk_cnt,
-					     buffer->data);
-			if (ret < 0) {
-				printf("%s: Write %d failed %d\n",
-				       __func__, i, ret);
-				return ret;
-			}
+		switch (chunk_header->chunk_type) {
+		case CHUNK_TYPE_FILL:
+			fill_val = *(uint32_t *)data;
+			ret = sparse_fill(&w, blkcnt, fill_val);
+			break;
 
-			total_blocks += ret;
+		/*
+		 * NAND skips bad blocks as it writes, so there DONT_CARE
+		 * chunks do not move the write position
+		 */
+		case CHUNK_TYPE_DONT_CARE:
+#if defined(CONFIG_FASTBOOT_FLASH_MMC_DEV) || \
+	!defined(CONFIG_FASTBOOT_FLASH_NAND_DEV)
+			w.blk += blkcnt;
+#endif
+			break;
 		}
-
-		sparse_put_data_buffer(buffer);
+		data += data_sz;
+		if (ret)
+			break;
 	}
+	if (!ret)
+		ret = sparse_flush_raw(&w);
+	free(w.fill);
+	if (ret)
+		return ret;
 
+	total_blocks = w.blk - start;
 	debug("Wrote %d blocks, expected to write %d blocks\n",
 	      total_blocks,
 	      sparse_block_size_to_storage(sparse_header->total_blks,
 					   storage, sparse_header));
-	printf("........ wrote %d blocks to '%s'\n", total_blocks,
-	       storage->name);
+	printf("........ wrote %d blocks to '%s' in %u writes, %u erases\n",
+	       total_blocks, storage->name, w.writes, w.erases);
 
 	if (total_blocks !=
 	    sparse_block_size_to_storage(sparse_header->total_blks,
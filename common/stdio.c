@@ -246,6 +246,42 @@ int stdio_init_tables(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(DM_LAZY_PROBE)
+void stdio_probe_devices(const char *name)
+{
+	struct udevice *dev;
+	struct uclass *uc __maybe_unused;
+	int ret;
+
+#ifdef CONFIG_DM_VIDEO
+	/* Probing the display registers its console; nothing to do if it is */
+	if (!strncmp(name, "vidconsole", 10)) {
+		for (ret = uclass_first_device(UCLASS_VIDEO, &dev);
+		     dev;
+		     ret = uclass_next_device(&dev))
+			;
+		if (ret)
+			printf("%s: Video device failed (ret=%d)\n", __func__,
+			       ret);
+		return;
+	}
+#endif
+#ifdef CONFIG_DM_KEYBOARD
+	/*
+	 * Keyboards pick their own stdio names, so there is no telling which
+	 * one provides @name. Probe them all if it is not registered yet.
+	 */
+	if (stdio_get_by_name(name) || uclass_get(UCLASS_KEYBOARD, &uc))
+		return;
+	uclass_foreach_dev(dev, uc) {
+		ret = device_probe(dev);
+		if (ret)
+			printf("Failed to probe keyboard '%s'\n", dev->name);
+	}
+#endif
+}
+#endif
+
 int stdio_add_devices(void)
 {
 #ifdef CONFIG_DM_KEYBOARD
@@ -267,11 +303,18 @@ int stdio_add_devices(void)
 	if (ret)
 		return ret;
 
-	/* Don't report errors to the caller - assume that they are non-fatal */
-	uclass_foreach_dev(dev, uc) {
-		ret = device_probe(dev);
-		if (ret)
-			printf("Failed to probe keyboard '%s'\n", dev->name);
+	/*
+	 * With lazy probing, keyboards are left until a console asks for
+	 * them, see stdio_probe_devices(). Don't report errors to the
+	 * caller - assume that they are non-fatal
+	 */
+	if (!CONFIG_IS_ENABLED(DM_LAZY_PROBE)) {
+		uclass_foreach_dev(dev, uc) {
+			ret = device_probe(dev);
+			if (ret)
+				printf("Failed to probe keyboard '%s'\n",
+				       dev->name);
+		}
 	}
 #endif
 #ifdef CONFIG_SYS_I2C
@@ -287,10 +330,14 @@ int stdio_add_devices(void)
 	int ret;
 # endif
 
-	for (ret = uclass_first_device(UCLASS_VIDEO, &vdev);
-	     vdev;
-	     ret = uclass_next_device(&vdev))
-		;
+	/* With lazy probing, the display waits until a console uses it */
+	ret = 0;
+	if (!CONFIG_IS_ENABLED(DM_LAZY_PROBE)) {
+		for (ret = uclass_first_device(UCLASS_VIDEO, &vdev);
+		     vdev;
+		     ret = uclass_next_device(&vdev))
+			;
+	}
 	if (ret)
 		printf("%s: Video device failed (ret=%d)\n", __func__, ret);
 #else
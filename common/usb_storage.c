@@ -98,15 +98,28 @@ struct us_data {
 	ccb		*srb;			/* current srb */
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
+	size_t		max_xfer_size;		/* host limit, 0 if unknown */
 };
 
+/* The SCSI READ(10) and WRITE(10) commands are limited to 65535 blocks */
+#define USB_READ10_MAX_BLK	65535
+
+/*
+ * How much to move with each command if the host controller does not say
+ * what it can transfer at once.
+ */
 #ifdef CONFIG_USB_EHCI
 /*
  * The U-Boot EHCI driver can handle any transfer length as long as there is
- * enough free heap space left, but the SCSI READ(10) and WRITE(10) commands are
- * limited to 65535 blocks.
+ * enough free heap space left.
+ */
+#define USB_MAX_XFER_BLK	USB_READ10_MAX_BLK
+#elif defined(CONFIG_USB_XHCI)
+/*
+ * 62 TRBs of 64KB fit on the transfer ring, see xhci_get_max_xfer_size().
+ * This is a size in bytes, since it does not depend on the block size.
  */
-#define USB_MAX_XFER_BLK	65535
+#define USB_MAX_XFER_SIZE	(62 * 65536)
 #else
 #define USB_MAX_XFER_BLK	20
 #endif
@@ -1104,6 +1117,25 @@ static void usb_bin_fixup(struct usb_device_descriptor descriptor,
 }
 #endif /* CONFIG_USB_BIN_FIXUP */
 
+/* Works out how many blocks to read or write with each command */
+static unsigned short usb_stor_max_blks(struct us_data *ss,
+					struct blk_desc *block_dev)
+{
+	size_t size = ss->max_xfer_size;
+	size_t blks;
+
+#ifdef USB_MAX_XFER_SIZE
+	if (!size)
+		size = USB_MAX_XFER_SIZE;
+#else
+	if (!size)
+		return USB_MAX_XFER_BLK;
+#endif
+	blks = size / block_dev->blksz;
+
+	return clamp_t(size_t, blks, 1, USB_READ10_MAX_BLK);
+}
+
 #ifdef CONFIG_BLK
 static unsigned long usb_stor_read(struct udevice *dev, lbaint_t blknr,
 				   lbaint_t blkcnt, void *buffer)
@@ -1114,7 +1146,7 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned short smallblks, max_blks;
 	struct usb_device *udev;
 	struct us_data *ss;
 	int retry;
@@ -1139,6 +1171,7 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+	max_blks = usb_stor_max_blks(ss, block_dev);
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	srb->lun = block_dev->lun;
@@ -1153,12 +1186,12 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 		/* XXX need some comment here */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > USB_MAX_XFER_BLK)
-			smallblks = USB_MAX_XFER_BLK;
+		if (blks > max_blks)
+			smallblks = max_blks;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == USB_MAX_XFER_BLK)
+		if (smallblks == max_blks)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1181,7 +1214,7 @@ retry_it:
 	      start, smallblks, buf_addr);
 
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= USB_MAX_XFER_BLK)
+	if (blkcnt >= max_blks)
 		debug("\n");
 	return blkcnt;
 }
@@ -1196,7 +1229,7 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned short smallblks, max_blks;
 	struct usb_device *udev;
 	struct us_data *ss;
 	int retry;
@@ -1222,6 +1255,7 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+	max_blks = usb_stor_max_blks(ss, block_dev);
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 
@@ -1239,12 +1273,12 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 		 */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > USB_MAX_XFER_BLK)
-			smallblks = USB_MAX_XFER_BLK;
+		if (blks > max_blks)
+			smallblks = max_blks;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == USB_MAX_XFER_BLK)
+		if (smallblks == max_blks)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1266,7 +1300,7 @@ retry_it:
 	      PRIxPTR "\n", start, smallblks, buf_addr);
 
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= USB_MAX_XFER_BLK)
+	if (blkcnt >= max_blks)
 		debug("\n");
 	return blkcnt;
 
@@ -1324,6 +1358,14 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 		debug("Bulk/Bulk/Bulk\n");
 		ss->transport = usb_stor_BBB_transport;
 		ss->transport_reset = usb_stor_BBB_reset;
+#ifdef CONFIG_DM_USB
+		/*
+		 * Each command moves its data in one bulk transfer, so use
+		 * as large a one as the host controller can manage
+		 */
+		if (usb_get_max_xfer_size(dev, &ss->max_xfer_size))
+			ss->max_xfer_size = 0;
+#endif
 		break;
 	default:
 		printf("USB Storage Transport unknown / not yet implemented\n");
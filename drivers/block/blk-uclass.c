@@ -10,6 +10,7 @@
 #include <dm.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <task.h>
 
 static const char *if_typename_str[IF_TYPE_COUNT] = {
 	[IF_TYPE_IDE]		= "ide",
@@ -384,25 +385,94 @@ int blk_get_device(int if_type, int devnum, struct udevice **devp)
 	return -ENODEV;
 }
 
+static unsigned long blk_read_dev(struct blk_desc *block_dev, lbaint_t start,
+				  lbaint_t blkcnt, void *buffer)
+{
+	struct udevice *dev = block_dev->bdev;
+	ulong n;
+
+	n = blk_get_ops(dev)->read(dev, start, blkcnt, buffer);
+	task_yield();
+
+	return n;
+}
+
+static unsigned long blk_read_queued(struct blk_desc *block_dev,
+				     lbaint_t start, lbaint_t blkcnt,
+				     void *buffer)
+{
+	struct blk_req req = {
+		.start = start,
+		.blkcnt = blkcnt,
+		.buffer = buffer,
+	};
+
+	/* Like a driver's read(), report a failure as a short count */
+	if (!blk_submit(block_dev, &req))
+		blk_wait(block_dev, &req);
+
+	return req.actual;
+}
+
 unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			lbaint_t blkcnt, void *buffer)
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
-	ulong blks_read;
 
+	if (ops->submit)
+		return blkcache_read(block_dev, start, blkcnt, buffer,
+				     blk_read_queued);
 	if (!ops->read)
 		return -ENOSYS;
 
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
-		return blkcnt;
-	blks_read = ops->read(dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
+	return blkcache_read(block_dev, start, blkcnt, buffer, blk_read_dev);
+}
+
+int blk_submit(struct blk_desc *block_dev, struct blk_req *req)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+	ulong n;
+
+	req->actual = 0;
+	if (ops->submit)
+		return ops->submit(dev, req);
+
+	n = blk_dread(block_dev, req->start, req->blkcnt, req->buffer);
+	if (IS_ERR_VALUE(n)) {
+		req->status = n;
+	} else {
+		req->actual = n;
+		req->status = n == req->blkcnt ? 0 : -EIO;
+	}
+
+	return 0;
+}
+
+int blk_poll(struct blk_desc *block_dev)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+
+	if (!ops->poll)
+		return 0;
+
+	return ops->poll(dev);
+}
+
+int blk_wait(struct blk_desc *block_dev, struct blk_req *req)
+{
+	int ret;
+
+	while (req->status == -EINPROGRESS) {
+		ret = blk_poll(block_dev);
+		if (ret < 0)
+			return ret;
+		task_yield();
+	}
 
-	return blks_read;
+	return req->status;
 }
 
 unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
@@ -414,7 +484,10 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->write)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	/* let queued reads finish before the medium changes under them */
+	while (blk_poll(block_dev) > 0)
+		;
+	blk_invalidate(block_dev);
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -427,7 +500,10 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->erase)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	/* let queued reads finish before the medium changes under them */
+	while (blk_poll(block_dev) > 0)
+		;
+	blk_invalidate(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
@@ -8,14 +8,28 @@
 #include <config.h>
 #include <common.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <linux/ctype.h>
+#include <linux/err.h>
 #include <linux/list.h>
 
+/*
+ * The cache is made of fixed-size, aligned extents ("lines") of
+ * max_blocks_per_entry blocks each. Lines are kept on an LRU list for
+ * eviction and in a small hash table keyed by device and line number,
+ * so that a lookup costs one hash probe per line touched by a request,
+ * regardless of how many lines are cached.
+ */
+#define BLKCACHE_HASH_BITS	6
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
+
 struct block_cache_node {
 	struct list_head lh;
+	struct hlist_node hn;
 	int iftype;
 	int devnum;
+	int hwpart;
 	lbaint_t start;
 	lbaint_t blkcnt;
 	unsigned long blksz;
@@ -23,24 +37,64 @@ struct block_cache_node {
 };
 
 static LIST_HEAD(block_cache);
+static struct hlist_head block_cache_hash[BLKCACHE_HASH_SIZE];
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 2,
-	.max_entries = 32
+	.max_blocks_per_entry = 8,
+	.max_entries = 256,
+	.max_bytes = CONFIG_BLOCK_CACHE_SIZE,
+	.readahead = CONFIG_BLOCK_CACHE_READAHEAD,
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+/* log2 of max_blocks_per_entry */
+static int line_shift = 3;
+
+/* bounce buffer for reads widened to whole lines */
+static char *scratch;
+static size_t scratch_size;
+
+/* end of the last missed read, used to detect sequential access */
+static struct {
+	int iftype;
+	int devnum;
+	int hwpart;
+	lbaint_t end;
+} last_miss = { .iftype = -1 };
+
+static inline lbaint_t line_of(lbaint_t blk)
+{
+	return blk >> line_shift;
+}
+
+static inline struct hlist_head *cache_bucket(int iftype, int devnum,
+					      lbaint_t line)
+{
+	u32 key = (u32)line ^ ((u32)iftype << 24) ^ ((u32)devnum << 16);
+
+	return &block_cache_hash[(key * 0x9e3779b1) >>
+				 (32 - BLKCACHE_HASH_BITS)];
+}
+
+static inline bool node_matches(struct block_cache_node *node,
+				struct blk_desc *desc, lbaint_t start)
+{
+	return (node->iftype == desc->if_type) &&
+	       (node->devnum == desc->devnum) &&
+	       (node->hwpart == desc->hwpart) &&
+	       (node->blksz == desc->blksz) &&
+	       (node->start == start);
+}
+
+static struct block_cache_node *cache_find(struct blk_desc *desc,
+					   lbaint_t line)
 {
 	struct block_cache_node *node;
+	struct hlist_node *pos;
+	lbaint_t start = line << line_shift;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
+	hlist_for_each_entry(node, pos, cache_bucket(desc->if_type,
+						     desc->devnum, line), hn)
+		if (node_matches(node, desc, start)) {
 			if (block_cache.next != &node->lh) {
 				/* maintain MRU ordering */
 				list_del(&node->lh);
@@ -48,126 +102,332 @@ static struct block_cache_node *cache_find(int iftype, int devnum,
 			}
 			return node;
 		}
-	return 0;
+	return NULL;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+static void cache_drop(struct block_cache_node *node)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
-	}
+	debug("drop: start " LBAF ", count " LBAFU "\n",
+	      node->start, node->blkcnt);
+	list_del(&node->lh);
+	hlist_del(&node->hn);
+	_stats.entries--;
+	_stats.bytes -= node->blkcnt * node->blksz;
+}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+static void cache_free(struct block_cache_node *node)
+{
+	free(node->cache);
+	free(node);
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+static void cache_flush(void)
 {
-	lbaint_t bytes;
 	struct block_cache_node *node;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+	while (!list_empty(&block_cache)) {
+		node = list_first_entry(&block_cache, struct block_cache_node,
+					lh);
+		cache_drop(node);
+		cache_free(node);
+	}
+	last_miss.iftype = -1;
+}
 
-	if (_stats.max_entries == 0)
-		return;
+/*
+ * Copy as many leading blocks of the request as are present in the cache.
+ * Returns the number of blocks copied.
+ */
+static lbaint_t cache_copy_prefix(struct blk_desc *desc, lbaint_t start,
+				  lbaint_t blkcnt, char *buffer)
+{
+	struct block_cache_node *node;
+	lbaint_t done = 0, offset, count;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
+	while (done < blkcnt) {
+		node = cache_find(desc, line_of(start + done));
 		if (!node)
-			return;
-		node->cache = 0;
+			break;
+		offset = start + done - node->start;
+		if (offset >= node->blkcnt)
+			break;
+		count = min(node->blkcnt - offset, blkcnt - done);
+		memcpy(buffer + done * desc->blksz,
+		       node->cache + offset * desc->blksz,
+		       count * desc->blksz);
+		done += count;
 	}
 
+	return done;
+}
+
+static struct block_cache_node *cache_alloc(lbaint_t blkcnt,
+					    unsigned long blksz)
+{
+	struct block_cache_node *node = NULL;
+	unsigned long bytes = blkcnt * blksz;
+
+	while (_stats.entries &&
+	       (_stats.entries >= _stats.max_entries ||
+		_stats.bytes + bytes > _stats.max_bytes)) {
+		/* pop LRU, keeping the first victim around for reuse */
+		struct block_cache_node *lru;
+
+		lru = list_entry(block_cache.prev, struct block_cache_node, lh);
+		cache_drop(lru);
+		if (!node && lru->blkcnt * lru->blksz == bytes) {
+			node = lru;
+			continue;
+		}
+		cache_free(lru);
+	}
+
+	if (node)
+		return node;
+
+	node = malloc(sizeof(*node));
+	if (!node)
+		return NULL;
+	node->cache = malloc(bytes);
 	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
+		free(node);
+		return NULL;
+	}
+
+	return node;
+}
+
+static void cache_fill_line(struct blk_desc *desc, lbaint_t start,
+			    lbaint_t blkcnt, const char *buffer)
+{
+	struct block_cache_node *node;
+
+	node = cache_find(desc, line_of(start));
+	if (node) {
+		if (node->blkcnt == blkcnt) {
+			memcpy(node->cache, buffer, blkcnt * desc->blksz);
 			return;
 		}
+		cache_drop(node);
+		cache_free(node);
 	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+	node = cache_alloc(blkcnt, desc->blksz);
+	if (!node)
+		return;
 
-	node->iftype = iftype;
-	node->devnum = devnum;
+	debug("fill: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+
+	node->iftype = desc->if_type;
+	node->devnum = desc->devnum;
+	node->hwpart = desc->hwpart;
 	node->start = start;
 	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
+	node->blksz = desc->blksz;
+	memcpy(node->cache, buffer, blkcnt * desc->blksz);
 	list_add(&node->lh, &block_cache);
+	hlist_add_head(&node->hn, cache_bucket(desc->if_type, desc->devnum,
+					       line_of(start)));
 	_stats.entries++;
+	_stats.bytes += blkcnt * desc->blksz;
+}
+
+/*
+ * Add every whole line contained in a range of data just read from the
+ * device. A short final line is only cached when it ends the device.
+ */
+static void cache_fill(struct blk_desc *desc, lbaint_t start,
+		       lbaint_t blkcnt, const char *buffer)
+{
+	lbaint_t line_blks = 1 << line_shift;
+	lbaint_t end = start + blkcnt;
+	lbaint_t blk = ALIGN(start, line_blks);
+
+	while (blk < end) {
+		lbaint_t count = min(line_blks, end - blk);
+
+		if (count < line_blks && end != desc->lba)
+			break;
+		cache_fill_line(desc, blk, count,
+				buffer + (blk - start) * desc->blksz);
+		blk += count;
+	}
+}
+
+static char *scratch_get(size_t size)
+{
+	if (size > scratch_size) {
+		free(scratch);
+		scratch = memalign(ARCH_DMA_MINALIGN, size);
+		scratch_size = scratch ? size : 0;
+	}
+
+	return scratch;
+}
+
+static unsigned long cache_read_dev(struct blk_desc *desc, lbaint_t start,
+				    lbaint_t blkcnt, void *buffer,
+				    blkcache_read_fn read)
+{
+	_stats.dev_reads++;
+	_stats.dev_blocks += blkcnt;
+
+	return read(desc, start, blkcnt, buffer);
+}
+
+/* Read a missed range, widened to whole lines plus any read-ahead */
+static unsigned long cache_read_miss(struct blk_desc *desc, lbaint_t start,
+				     lbaint_t blkcnt, char *buffer,
+				     blkcache_read_fn read)
+{
+	lbaint_t line_blks = 1 << line_shift;
+	lbaint_t limit = desc->lba ? desc->lba : start + blkcnt;
+	lbaint_t wstart, wend;
+	unsigned long n;
+	bool sequential;
+	char *buf;
+
+	sequential = last_miss.iftype == desc->if_type &&
+		     last_miss.devnum == desc->devnum &&
+		     last_miss.hwpart == desc->hwpart &&
+		     last_miss.end == start;
+
+	/* big reads (e.g. file data) go straight to the caller's buffer */
+	if (blkcnt * desc->blksz > _stats.max_bytes / 4) {
+		n = cache_read_dev(desc, start, blkcnt, buffer, read);
+		last_miss.iftype = -1;
+		return n;
+	}
+
+	wstart = start & ~(line_blks - 1);
+	wend = ALIGN(start + blkcnt, line_blks);
+	if (sequential) {
+		wend = ALIGN(wend + _stats.readahead, line_blks);
+		_stats.readaheads++;
+	}
+	if (wend > limit)
+		wend = max(limit, start + blkcnt);
+
+	buf = scratch_get((wend - wstart) * desc->blksz);
+	if (buf && cache_read_dev(desc, wstart, wend - wstart, buf,
+				  read) == wend - wstart) {
+		cache_fill(desc, wstart, wend - wstart, buf);
+		memcpy(buffer, buf + (start - wstart) * desc->blksz,
+		       blkcnt * desc->blksz);
+		n = blkcnt;
+	} else {
+		wend = start + blkcnt;
+		/* widened read failed, e.g. past the end of a partition */
+		n = cache_read_dev(desc, start, blkcnt, buffer, read);
+		if (n == blkcnt)
+			cache_fill(desc, start, blkcnt, buffer);
+	}
+
+	last_miss.iftype = desc->if_type;
+	last_miss.devnum = desc->devnum;
+	last_miss.hwpart = desc->hwpart;
+	last_miss.end = wend;
+
+	return n;
+}
+
+unsigned long blkcache_read(struct blk_desc *block_dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer,
+			    blkcache_read_fn read)
+{
+	char *buf = buffer;
+	lbaint_t done;
+	unsigned long n;
+
+	if (!_stats.max_entries || !blkcnt)
+		return read(block_dev, start, blkcnt, buffer);
+
+	done = cache_copy_prefix(block_dev, start, blkcnt, buf);
+	if (done == blkcnt) {
+		debug("hit: start " LBAF ", count " LBAFU "\n",
+		      start, blkcnt);
+		++_stats.hits;
+		return blkcnt;
+	}
+
+	if (done) {
+		debug("partial: start " LBAF ", count " LBAFU "/" LBAFU "\n",
+		      start, done, blkcnt);
+		++_stats.partial_hits;
+	} else {
+		debug("miss: start " LBAF ", count " LBAFU "\n",
+		      start, blkcnt);
+		++_stats.misses;
+	}
+
+	n = cache_read_miss(block_dev, start + done, blkcnt - done,
+			    buf + done * block_dev->blksz, read);
+	if (IS_ERR_VALUE(n))
+		return n;
+
+	return done + n;
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_node *node, *n;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
+	list_for_each_entry_safe(node, n, &block_cache, lh) {
 		if ((node->iftype == iftype) &&
 		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+			cache_drop(node);
+			cache_free(node);
 		}
 	}
+	if (last_miss.iftype == iftype && last_miss.devnum == devnum)
+		last_miss.iftype = -1;
 }
 
 void blkcache_configure(unsigned blocks, unsigned entries)
 {
-	struct block_cache_node *node;
+	/* round down to a power of two, so a line is found with a shift */
+	if (blocks)
+		blocks = 1U << (fls(blocks) - 1);
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries)) {
-		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
-		}
-		_stats.entries = 0;
-	}
+	    (entries != _stats.max_entries))
+		cache_flush();
 
-	_stats.max_blocks_per_entry = blocks;
+	if (blocks) {
+		_stats.max_blocks_per_entry = blocks;
+		line_shift = ffs(blocks) - 1;
+	} else {
+		/* a cache without lines is a disabled cache */
+		entries = 0;
+	}
 	_stats.max_entries = entries;
 
 	_stats.hits = 0;
 	_stats.misses = 0;
 }
 
+void blkcache_configure_budget(unsigned long max_bytes, unsigned readahead)
+{
+	struct block_cache_node *node;
+
+	_stats.max_bytes = max_bytes;
+	_stats.readahead = readahead;
+
+	while (_stats.bytes > _stats.max_bytes) {
+		node = list_entry(block_cache.prev, struct block_cache_node,
+				  lh);
+		cache_drop(node);
+		cache_free(node);
+	}
+}
+
 void blkcache_stats(struct block_cache_stats *stats)
 {
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.partial_hits = 0;
+	_stats.readaheads = 0;
+	_stats.dev_reads = 0;
+	_stats.dev_blocks = 0;
 }
@@ -190,7 +190,11 @@ int device_remove(struct udevice *dev)
 	device_free(dev);
 
 	dev->seq = -1;
+	uclass_index_device(dev);
 	dev->flags &= ~DM_FLAG_ACTIVATED;
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	dev->probe_order = 0;
+#endif
 
 	return ret;
 
@@ -143,6 +143,9 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 			goto fail_uclass_post_bind;
 	}
 
+	/* bind() and post_bind() may have set req_seq or of_offset */
+	uclass_index_device(dev);
+
 	if (parent)
 		dm_dbg("Bound device %s to %s\n", dev->name, parent->name);
 	if (devp)
@@ -242,12 +245,69 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+static ulong device_probe_time(void)
+{
+#if defined(CONFIG_TIMER) && !defined(CONFIG_TIMER_EARLY)
+	/* Don't probe the timer from inside another probe just to time it */
+	if (!gd->timer)
+		return 0;
+#endif
+	return timer_get_us();
+}
+#endif
+
+#if CONFIG_IS_ENABLED(DM_LAZY_PROBE)
+/**
+ * device_probe_deps() - Probe the providers that a device's node refers to
+ *
+ * With lazy probing nothing else has brought these up, so probe the clocks
+ * and regulators that the device uses before the device itself. Errors are
+ * ignored: the driver sees them when it requests the clock or regulator.
+ *
+ * @dev:	Device about to be probed
+ */
+static void device_probe_deps(struct udevice *dev)
+{
+	const void *blob = gd->fdt_blob;
+	struct fdtdec_phandle_args args;
+	struct udevice *dep;
+	const fdt32_t *cell;
+	const char *name;
+	int offset, node, len, i;
+
+	if (dev->of_offset < 0)
+		return;
+	for (i = 0; !fdtdec_parse_phandle_with_args(blob, dev->of_offset,
+						    "clocks", "#clock-cells",
+						    0, i, &args); i++)
+		uclass_get_device_by_of_offset(UCLASS_CLK, args.node, &dep);
+
+	for (offset = fdt_first_property_offset(blob, dev->of_offset);
+	     offset >= 0;
+	     offset = fdt_next_property_offset(blob, offset)) {
+		cell = fdt_getprop_by_offset(blob, offset, &name, &len);
+		if (len != sizeof(*cell) || strlen(name) < 7 ||
+		    strcmp(name + strlen(name) - 7, "-supply"))
+			continue;
+		node = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*cell));
+		if (node >= 0)
+			uclass_get_device_by_of_offset(UCLASS_REGULATOR, node,
+						       &dep);
+	}
+}
+#endif
+
 int device_probe(struct udevice *dev)
 {
 	const struct driver *drv;
 	int size = 0;
+	int span = -1;
 	int ret;
 	int seq;
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	ulong start;
+#endif
 
 	if (!dev)
 		return -EINVAL;
@@ -255,6 +315,10 @@ int device_probe(struct udevice *dev)
 	if (dev->flags & DM_FLAG_ACTIVATED)
 		return 0;
 
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	start = device_probe_time();
+#endif
+
 	drv = dev->driver;
 	assert(drv);
 
@@ -305,15 +369,23 @@ int device_probe(struct udevice *dev)
 			return 0;
 	}
 
+	span = bootstage_span_begin(dev->uclass->uc_drv->name, dev->name);
+
 	seq = uclass_resolve_seq(dev);
 	if (seq < 0) {
 		ret = seq;
 		goto fail;
 	}
 	dev->seq = seq;
+	uclass_index_device(dev);
 
 	dev->flags |= DM_FLAG_ACTIVATED;
 
+#if CONFIG_IS_ENABLED(DM_LAZY_PROBE)
+	/* This is after activation so that a dependency loop ends here */
+	device_probe_deps(dev);
+#endif
+
 	/*
 	 * Process pinctrl for everything except the root device, and
 	 * continue regardless of the result of pinctrl. Don't process pinctrl
@@ -354,6 +426,14 @@ int device_probe(struct udevice *dev)
 	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
 		pinctrl_select_state(dev, "default");
 
+	/* Some drivers move the device to another node in probe() */
+	uclass_index_device(dev);
+	bootstage_span_end(span);
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	dev->probe_order = ++gd->dm_probe_count;
+	dev->probe_us = device_probe_time() - start;
+#endif
+
 	return 0;
 fail_uclass:
 	if (device_remove(dev)) {
@@ -364,7 +444,9 @@ fail:
 	dev->flags &= ~DM_FLAG_ACTIVATED;
 
 	dev->seq = -1;
+	uclass_index_device(dev);
 	device_free(dev);
+	bootstage_span_end(span);
 
 	return ret;
 }
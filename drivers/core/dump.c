@@ -6,9 +6,12 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <dm/root.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static void show_devices(struct udevice *dev, int depth, int last_flag)
 {
 	int i, is_last;
@@ -94,3 +97,48 @@ void dm_dump_uclass(void)
 		puts("\n");
 	}
 }
+
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+/* Put each probed device below @dev into @list at its probe order */
+static void dm_collect_probed(struct udevice *dev, struct udevice **list,
+			      uint count, int *totalp)
+{
+	struct udevice *child;
+
+	(*totalp)++;
+	if (dev->probe_order && dev->probe_order <= count)
+		list[dev->probe_order - 1] = dev;
+	list_for_each_entry(child, &dev->child_head, sibling_node)
+		dm_collect_probed(child, list, count, totalp);
+}
+
+void dm_dump_probe_stats(void)
+{
+	uint count = gd->dm_probe_count;
+	struct udevice **list, *dev;
+	int total = 0, probed = 0;
+	uint i;
+
+	if (!dm_root())
+		return;
+	list = calloc(count + 1, sizeof(*list));
+	if (!list) {
+		printf("Out of memory\n");
+		return;
+	}
+	dm_collect_probed(dm_root(), list, count, &total);
+
+	printf(" Order  Time(us)  Class       Name\n");
+	printf("----------------------------------------\n");
+	for (i = 0; i < count; i++) {
+		dev = list[i];
+		if (!dev)
+			continue;
+		printf("%6u  %8lu  %-11.11s %s\n", dev->probe_order,
+		       dev->probe_us, dev->uclass->uc_drv->name, dev->name);
+		probed++;
+	}
+	printf("%d of %d devices probed\n", probed, total);
+	free(list);
+}
+#endif
@@ -9,6 +9,7 @@
 
 #include <common.h>
 #include <errno.h>
+#include <dm/bind-table.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -17,6 +18,9 @@
 #include <dm/util.h>
 #include <fdtdec.h>
 #include <linux/compiler.h>
+#include <u-boot/crc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -138,6 +142,296 @@ static int driver_check_compatible(const void *blob, int offset,
 	return -ENOENT;
 }
 
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+/* Most compatible strings looked at in a node */
+#define LISTS_MAX_COMPAT	16
+
+/**
+ * struct lists_compat - A compatible string supported by a driver
+ *
+ * @crc: CRC32 of the string
+ * @driver: Index of the driver in the driver linker list
+ * @match: Index of the string in the driver's of_match table
+ * @next: Index of the next entry in the same hash chain, or -1
+ */
+struct lists_compat {
+	u32 crc;
+	u16 driver;
+	u16 match;
+	int next;
+};
+
+/**
+ * struct dm_bind_state - Lookup tables used to bind devices
+ *
+ * This is set up on first use, and again after relocation.
+ *
+ * @blob: Device tree last checked against dm_bind_table, or NULL if none
+ * @table_ok: true if @blob matches dm_bind_table
+ * @driver: Start of the driver linker list
+ * @hash_mask: Number of hash buckets, minus 1
+ * @bucket: First entry in each hash chain, or -1 if none
+ * @compat: Compatible strings of all drivers, or NULL if they are not
+ *	hashed
+ */
+struct dm_bind_state {
+	const void *blob;
+	bool table_ok;
+	struct driver *driver;
+	uint hash_mask;
+	int *bucket;
+	struct lists_compat *compat;
+};
+
+/*
+ * Hash all the compatible strings of all the drivers
+ *
+ * This is done at run time rather than by fdtbind: the drivers are only
+ * known once U-Boot is linked, and the linker list cannot be read back
+ * without a post-link step for every board. It is one CRC32 of each short
+ * string, done once before and once after relocation, which costs much
+ * less than the string compares it replaces.
+ *
+ * The hash takes 12 bytes for each string, plus 4 for each bucket. Before
+ * relocation it is only built if it needs no more than a quarter of the
+ * free early malloc() pool, which on boards with a small
+ * CONFIG_SYS_MALLOC_F_LEN (such as 0x400) it usually does not. The binding
+ * table is then still walked, but each enabled node is bound by searching
+ * the driver list.
+ */
+static struct dm_bind_state *lists_bind_state(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match;
+	struct dm_bind_state *state;
+	struct lists_compat *compat;
+	struct driver *entry;
+	int count, size, bytes, i, j;
+	uint hash;
+
+	if (gd->dm_bind)
+		return gd->dm_bind;
+
+	count = 0;
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++)
+			count++;
+	}
+	for (size = 1; size < count; size <<= 1)
+		;
+	bytes = sizeof(*state) + size * sizeof(int) + count * sizeof(*compat);
+#ifdef CONFIG_SYS_MALLOC_F_LEN
+	/* Leave most of the early malloc() pool for the devices */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    bytes > (gd->malloc_limit - gd->malloc_ptr) / 4) {
+		dm_dbg("No space for driver hash (%d bytes)\n", bytes);
+		state = calloc(1, sizeof(*state));
+		if (state)
+			state->driver = driver;
+		gd->dm_bind = state;
+
+		return state;
+	}
+#endif
+	state = calloc(1, bytes);
+	if (!state)
+		return NULL;
+	state->driver = driver;
+	state->hash_mask = size - 1;
+	state->bucket = (int *)(state + 1);
+	state->compat = (struct lists_compat *)(state->bucket + size);
+	for (i = 0; i < size; i++)
+		state->bucket[i] = -1;
+
+	compat = state->compat;
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		of_match = entry->of_match;
+		for (j = 0; of_match && of_match[j].compatible; j++) {
+			const char *str = of_match[j].compatible;
+
+			compat->crc = crc32(0, (const uchar *)str, strlen(str));
+			compat->driver = entry - driver;
+			compat->match = j;
+			hash = compat->crc & state->hash_mask;
+			compat->next = state->bucket[hash];
+			state->bucket[hash] = compat - state->compat;
+			compat++;
+		}
+	}
+	gd->dm_bind = state;
+
+	return state;
+}
+
+/**
+ * lists_bind_fdt_crc() - Bind a node using the CRCs of its compatible strings
+ *
+ * This picks the same driver as a search of the whole driver list would:
+ * the first one in the list with a matching compatible string. If that
+ * driver refuses to bind, the next one is tried.
+ *
+ * @state: Lookup tables
+ * @parent: Parent device
+ * @blob: Device tree
+ * @offset: Offset of node to bind
+ * @crc: CRC32 of each compatible string in the node
+ * @count: Number of compatible strings
+ * @devp: If non-NULL, returns the bound device
+ * @return 0 if OK (whether or not a driver was found), -ve on error
+ */
+static int lists_bind_fdt_crc(struct dm_bind_state *state,
+			      struct udevice *parent, const void *blob,
+			      int offset, const u32 *crc, int count,
+			      struct udevice **devp)
+{
+	struct lists_compat *compat, *best;
+	struct driver *entry;
+	struct udevice *dev;
+	const char *name;
+	int last = -1;
+	int ret, i, idx;
+
+	if (devp)
+		*devp = NULL;
+	name = fdt_get_name(blob, offset, NULL);
+	dm_dbg("bind node %s\n", name);
+	while (1) {
+		best = NULL;
+		for (i = 0; i < count; i++) {
+			idx = state->bucket[crc[i] & state->hash_mask];
+			for (; idx != -1; idx = compat->next) {
+				compat = &state->compat[idx];
+				if (compat->crc != crc[i] ||
+				    compat->driver <= last)
+					continue;
+				if (best && (compat->driver > best->driver ||
+					     (compat->driver == best->driver &&
+					      compat->match > best->match)))
+					continue;
+				entry = state->driver + compat->driver;
+				/* Make sure this is not a CRC collision */
+				if (fdt_node_check_compatible(blob, offset,
+						entry->of_match[compat->match].
+						compatible))
+					continue;
+				best = compat;
+			}
+		}
+		if (!best)
+			break;
+
+		entry = state->driver + best->driver;
+		dm_dbg("   - found match at '%s'\n", entry->name);
+		ret = device_bind_with_driver_data(parent, entry, name,
+				entry->of_match[best->match].data, offset,
+				&dev);
+		if (ret == -ENODEV) {
+			dm_dbg("Driver '%s' refuses to bind\n", entry->name);
+			last = best->driver;
+			continue;
+		}
+		if (ret) {
+			dm_warn("Error binding driver '%s': %d\n", entry->name,
+				ret);
+			return ret;
+		}
+		if (devp)
+			*devp = dev;
+		return 0;
+	}
+	dm_dbg("No match for node '%s'\n", name);
+
+	return 0;
+}
+
+const struct dm_bind_table *lists_bind_table(const void *blob)
+{
+	const struct dm_bind_table *table = &dm_bind_table;
+	struct dm_bind_state *state;
+	u32 crc;
+
+	state = lists_bind_state();
+	if (!state)
+		return NULL;
+	if (state->blob != blob) {
+		/*
+		 * Check once for each device tree, since it may move. The
+		 * table holds node offsets, so any change to the structure
+		 * makes it wrong, and a size check alone would not see one.
+		 * One CRC32 pass over the tree is still far cheaper than
+		 * binding from it.
+		 */
+		state->blob = blob;
+		state->table_ok = false;
+		if (fdt_totalsize(blob) == table->fdt_size) {
+			crc = crc32(0, blob + fdt_off_dt_struct(blob),
+				    fdt_size_dt_struct(blob));
+			crc = crc32(crc, blob + fdt_off_dt_strings(blob),
+				    fdt_size_dt_strings(blob));
+			state->table_ok = crc == table->fdt_crc;
+		}
+		if (!state->table_ok)
+			dm_dbg("Device tree does not match binding table\n");
+	}
+
+	return state->table_ok ? table : NULL;
+}
+
+int lists_bind_table_node(struct udevice *parent, const void *blob,
+			  const struct dm_bind_table *table, int idx,
+			  struct udevice **devp)
+{
+	const struct dm_bind_node *node = &table->node[idx];
+	struct dm_bind_state *state = gd->dm_bind;
+
+	if (!state->compat)
+		return lists_bind_fdt(parent, blob, node->offset, devp);
+
+	return lists_bind_fdt_crc(state, parent, blob, node->offset,
+				  table->compat + node->compat_start,
+				  node->compat_count, devp);
+}
+
+/*
+ * Bind a node whose compatible strings have not been hashed already
+ *
+ * Returns 1 if the node has too many compatible strings for this, in
+ * which case the caller should search the driver list instead.
+ */
+static int lists_bind_fdt_hashed(struct dm_bind_state *state,
+				 struct udevice *parent, const void *blob,
+				 int offset, struct udevice **devp)
+{
+	u32 crc[LISTS_MAX_COMPAT];
+	const char *prop, *end;
+	int count, len;
+
+	prop = fdt_getprop(blob, offset, "compatible", &len);
+	if (!prop) {
+		if (devp)
+			*devp = NULL;
+		dm_dbg("Device '%s' has no compatible string\n",
+		       fdt_get_name(blob, offset, NULL));
+		return 0;
+	}
+	count = 0;
+	for (end = prop + len; prop < end; prop += strlen(prop) + 1) {
+		if (count == LISTS_MAX_COMPAT) {
+			dm_warn("Node '%s' has more than %d compatible strings\n",
+				fdt_get_name(blob, offset, NULL),
+				LISTS_MAX_COMPAT);
+			return 1;
+		}
+		crc[count++] = crc32(0, (const uchar *)prop, strlen(prop));
+	}
+
+	return lists_bind_fdt_crc(state, parent, blob, offset, crc, count,
+				  devp);
+}
+#endif
+
 int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
 		   struct udevice **devp)
 {
@@ -151,6 +445,16 @@ int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
 	int result = 0;
 	int ret = 0;
 
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+	struct dm_bind_state *state = lists_bind_state();
+
+	if (state && state->compat) {
+		ret = lists_bind_fdt_hashed(state, parent, blob, offset, devp);
+		if (ret != 1)
+			return ret;
+		ret = 0;
+	}
+#endif
 	dm_dbg("bind node %s\n", fdt_get_name(blob, offset, NULL));
 	if (devp)
 		*devp = NULL;
@@ -12,12 +12,14 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <libfdt.h>
+#include <dm/bind-table.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/platdata.h>
 #include <dm/root.h>
 #include <dm/uclass.h>
+#include <dm/uclass-internal.h>
 #include <dm/util.h>
 #include <linux/list.h>
 
@@ -133,6 +135,12 @@ int dm_init(void)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+	ret = dm_index_init();
+	if (ret)
+		return ret;
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	gd->dm_probe_count = 0;
+#endif
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
@@ -156,6 +164,7 @@ int dm_uninit(void)
 {
 	device_remove(dm_root());
 	device_unbind(dm_root());
+	dm_index_free();
 
 	return 0;
 }
@@ -174,11 +183,71 @@ int dm_scan_platdata(bool pre_reloc_only)
 }
 
 #if CONFIG_IS_ENABLED(OF_CONTROL)
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+/* Find a node in the binding table, which is in order of offset */
+static int dm_bind_table_find(const struct dm_bind_table *table, int offset)
+{
+	int low = 0, high = table->node_count - 1;
+	int mid;
+
+	while (low <= high) {
+		mid = (low + high) / 2;
+		if (table->node[mid].offset == offset)
+			return mid;
+		if (table->node[mid].offset < offset)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return -ENOENT;
+}
+
+/* Bind the subnodes of table->node[idx] */
+static int dm_scan_bind_table(struct udevice *parent, const void *blob,
+			      const struct dm_bind_table *table, int idx,
+			      bool pre_reloc_only)
+{
+	const struct dm_bind_node *node;
+	int ret = 0, err;
+
+	for (idx = table->node[idx].first_child; idx != -1;
+	     idx = node->next_sibling) {
+		node = &table->node[idx];
+		if (pre_reloc_only && !(node->flags & DM_BIND_PRE_RELOC))
+			continue;
+		if (!(node->flags & DM_BIND_ENABLED)) {
+			dm_dbg("   - ignoring disabled device\n");
+			continue;
+		}
+		err = lists_bind_table_node(parent, blob, table, idx, NULL);
+		if (err && !ret) {
+			ret = err;
+			debug("%s: ret=%d\n",
+			      fdt_get_name(blob, node->offset, NULL), ret);
+		}
+	}
+
+	if (ret)
+		dm_warn("Some drivers failed to bind\n");
+
+	return ret;
+}
+#endif
+
 int dm_scan_fdt_node(struct udevice *parent, const void *blob, int offset,
 		     bool pre_reloc_only)
 {
 	int ret = 0, err;
 
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+	const struct dm_bind_table *table = lists_bind_table(blob);
+	int idx = table ? dm_bind_table_find(table, offset) : -ENOENT;
+
+	if (idx >= 0)
+		return dm_scan_bind_table(parent, blob, table, idx,
+					  pre_reloc_only);
+#endif
 	for (offset = fdt_first_subnode(blob, offset);
 	     offset > 0;
 	     offset = fdt_next_subnode(blob, offset)) {
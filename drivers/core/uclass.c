@@ -19,18 +19,192 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+#define dm_index_count(_field, _n)				\
+	do {							\
+		if (gd->dm_index)				\
+			gd->dm_index->stats._field += (_n);	\
+	} while (0)
+
+/* Returns the lookup tables, or NULL if the lists must be walked */
+static struct dm_index *dm_index_get(void)
+{
+	struct dm_index *idx = gd->dm_index;
+
+	return idx && !idx->disabled ? idx : NULL;
+}
+
+static void dm_index_set_uclass(enum uclass_id id, struct uclass *uc)
+{
+	if (gd->dm_index)
+		gd->dm_index->uclass[id] = uc;
+}
+
+int dm_index_init(void)
+{
+	/* Before relocation the tables would only be thrown away */
+	if (!(gd->flags & GD_FLG_RELOC))
+		return 0;
+	if (!gd->dm_index) {
+		gd->dm_index = malloc(sizeof(*gd->dm_index));
+		if (!gd->dm_index)
+			return -ENOMEM;
+	}
+	memset(gd->dm_index, '\0', sizeof(*gd->dm_index));
+
+	return 0;
+}
+
+void dm_index_free(void)
+{
+	free(gd->dm_index);
+	gd->dm_index = NULL;
+}
+
+static struct hlist_head *dm_index_bucket(struct hlist_head *table,
+					  enum uclass_id id, int key)
+{
+	u32 hash = ((u32)key + ((u32)id << 16)) * 0x9e3779b1;
+
+	return &table[hash >> (32 - DM_INDEX_HASH_BITS)];
+}
+
+static void dm_index_add(struct hlist_head *table, struct hlist_node *node,
+			 enum uclass_id id, int key, bool valid)
+{
+	hlist_del_init(node);
+	if (valid)
+		hlist_add_head(node, dm_index_bucket(table, id, key));
+}
+
+static int dm_index_seq(struct udevice *dev)
+{
+	return dev->seq;
+}
+
+static int dm_index_req_seq(struct udevice *dev)
+{
+	return dev->req_seq;
+}
+
+static int dm_index_of_offset(struct udevice *dev)
+{
+	return dev->of_offset;
+}
+
+static int dm_index_phandle(struct udevice *dev)
+{
+	if (!CONFIG_IS_ENABLED(OF_CONTROL) || !gd->fdt_blob ||
+	    dev->of_offset < 0)
+		return 0;
+
+	return fdt_get_phandle(gd->fdt_blob, dev->of_offset);
+}
+
+/**
+ * dm_index_find() - Look up a device in one of the tables
+ *
+ * @table: Table to search
+ * @member: Offset of the table's hlist_node within struct udevice
+ * @id: Uclass ID to find
+ * @key: Key to find
+ * @get_key: Returns the key of a device
+ * @return the matching device bound first, or NULL if none
+ */
+static struct udevice *dm_index_find(struct hlist_head *table, ulong member,
+				     enum uclass_id id, int key,
+				     int (*get_key)(struct udevice *dev))
+{
+	struct udevice *dev, *found = NULL;
+	struct hlist_node *node;
+
+	hlist_for_each(node, dm_index_bucket(table, id, key)) {
+		dev = (struct udevice *)((char *)node - member);
+		dm_index_count(dev_steps, 1);
+		if (dev->uclass->uc_drv->id != id || get_key(dev) != key)
+			continue;
+		if (!found || dev->index_order < found->index_order)
+			found = dev;
+	}
+
+	return found;
+}
+
+void uclass_index_device(struct udevice *dev)
+{
+	struct dm_index *idx = gd->dm_index;
+	enum uclass_id id;
+	int phandle;
+
+	if (!idx)
+		return;
+	id = dev->uclass->uc_drv->id;
+	dm_index_add(idx->seq, &dev->seq_node, id, dev->seq, dev->seq != -1);
+	dm_index_add(idx->req_seq, &dev->req_seq_node, id, dev->req_seq,
+		     dev->req_seq != -1);
+	dm_index_add(idx->of_offset, &dev->of_offset_node, id, dev->of_offset,
+		     dev->of_offset >= 0);
+	phandle = dm_index_phandle(dev);
+	dm_index_add(idx->phandle, &dev->phandle_node, id, phandle,
+		     phandle > 0);
+}
+
+void uclass_unindex_device(struct udevice *dev)
+{
+	hlist_del_init(&dev->seq_node);
+	hlist_del_init(&dev->req_seq_node);
+	hlist_del_init(&dev->of_offset_node);
+	hlist_del_init(&dev->phandle_node);
+}
+
+static void uclass_index_new_device(struct udevice *dev)
+{
+	if (gd->dm_index)
+		dev->index_order = gd->dm_index->order++;
+	uclass_index_device(dev);
+}
+#else
+#define dm_index_count(_field, _n)
+
+static inline struct dm_index *dm_index_get(void)
+{
+	return NULL;
+}
+
+static inline void dm_index_set_uclass(enum uclass_id id, struct uclass *uc)
+{
+}
+
+static inline struct udevice *dm_index_find(struct hlist_head *table,
+					    ulong member, enum uclass_id id,
+					    int key,
+					    int (*get_key)(struct udevice *dev))
+{
+	return NULL;
+}
+
+static inline void uclass_index_new_device(struct udevice *dev)
+{
+}
+#endif
+
 struct uclass *uclass_find(enum uclass_id key)
 {
+	struct dm_index *idx;
 	struct uclass *uc;
 
 	if (!gd->dm_root)
 		return NULL;
-	/*
-	 * TODO(sjg@chromium.org): Optimise this, perhaps moving the found
-	 * node to the start of the list, or creating a linear array mapping
-	 * id to node.
-	 */
+	dm_index_count(uclass_finds, 1);
+	idx = dm_index_get();
+	if (idx) {
+		dm_index_count(uclass_steps, 1);
+		if (key < 0 || key >= UCLASS_COUNT)
+			return NULL;
+		return idx->uclass[key];
+	}
 	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		dm_index_count(uclass_steps, 1);
 		if (uc->uc_drv->id == key)
 			return uc;
 	}
@@ -79,6 +253,7 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
 	list_add(&uc->sibling_node, &DM_UCLASS_ROOT_NON_CONST);
+	dm_index_set_uclass(id, uc);
 
 	if (uc_drv->init) {
 		ret = uc_drv->init(uc);
@@ -94,6 +269,7 @@ fail:
 		free(uc->priv);
 		uc->priv = NULL;
 	}
+	dm_index_set_uclass(id, NULL);
 	list_del(&uc->sibling_node);
 fail_mem:
 	free(uc);
@@ -127,6 +303,7 @@ int uclass_destroy(struct uclass *uc)
 	uc_drv = uc->uc_drv;
 	if (uc_drv->destroy)
 		uc_drv->destroy(uc);
+	dm_index_set_uclass(uc_drv->id, NULL);
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
 		free(uc->priv);
@@ -228,6 +405,7 @@ int uclass_find_device_by_name(enum uclass_id id, const char *name,
 int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 			      bool find_req_seq, struct udevice **devp)
 {
+	struct dm_index *idx;
 	struct uclass *uc;
 	struct udevice *dev;
 	int ret;
@@ -240,7 +418,27 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	if (ret)
 		return ret;
 
+	dm_index_count(dev_finds, 1);
+	idx = dm_index_get();
+	if (idx) {
+		if (find_req_seq)
+			dev = dm_index_find(idx->req_seq,
+					    offsetof(struct udevice,
+						     req_seq_node),
+					    id, seq_or_req_seq,
+					    dm_index_req_seq);
+		else
+			dev = dm_index_find(idx->seq,
+					    offsetof(struct udevice, seq_node),
+					    id, seq_or_req_seq, dm_index_seq);
+		if (!dev)
+			return -ENODEV;
+		*devp = dev;
+		return 0;
+	}
+
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
+		dm_index_count(dev_steps, 1);
 		debug("   - %d %d\n", dev->req_seq, dev->seq);
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
 				seq_or_req_seq) {
@@ -257,6 +455,7 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 				    struct udevice **devp)
 {
+	struct dm_index *idx;
 	struct uclass *uc;
 	struct udevice *dev;
 	int ret;
@@ -268,8 +467,24 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	if (ret)
 		return ret;
 
+	dm_index_count(dev_finds, 1);
+	idx = dm_index_get();
+	if (idx) {
+		dev = dm_index_find(idx->of_offset,
+				    offsetof(struct udevice, of_offset_node),
+				    id, node, dm_index_of_offset);
+		if (dev) {
+			*devp = dev;
+			return 0;
+		}
+	}
+
+	/* The offset may have been changed since the device was hashed */
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
+		dm_index_count(dev_steps, 1);
 		if (dev->of_offset == node) {
+			if (idx)
+				uclass_index_device(dev);
 			*devp = dev;
 			return 0;
 		}
@@ -284,6 +499,7 @@ static int uclass_find_device_by_phandle(enum uclass_id id,
 					 const char *name,
 					 struct udevice **devp)
 {
+	struct dm_index *idx;
 	struct udevice *dev;
 	struct uclass *uc;
 	int find_phandle;
@@ -298,10 +514,25 @@ static int uclass_find_device_by_phandle(enum uclass_id id,
 	if (ret)
 		return ret;
 
+	dm_index_count(dev_finds, 1);
+	idx = dm_index_get();
+	if (idx) {
+		dev = dm_index_find(idx->phandle,
+				    offsetof(struct udevice, phandle_node),
+				    id, find_phandle, dm_index_phandle);
+		if (dev) {
+			*devp = dev;
+			return 0;
+		}
+	}
+
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		uint phandle = fdt_get_phandle(gd->fdt_blob, dev->of_offset);
 
+		dm_index_count(dev_steps, 1);
 		if (phandle == find_phandle) {
+			if (idx)
+				uclass_index_device(dev);
 			*devp = dev;
 			return 0;
 		}
@@ -433,6 +664,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_index_new_device(dev);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -447,6 +679,7 @@ int uclass_bind_device(struct udevice *dev)
 	return 0;
 err:
 	/* There is no need to undo the parent's post_bind call */
+	uclass_unindex_device(dev);
 	list_del(&dev->uclass_node);
 
 	return ret;
@@ -465,6 +698,7 @@ int uclass_unbind_device(struct udevice *dev)
 			return ret;
 	}
 
+	uclass_unindex_device(dev);
 	list_del(&dev->uclass_node);
 	return 0;
 }
@@ -8,12 +8,14 @@
  */
 
 #include <common.h>
+#include <decomp.h>
 #include <errno.h>
 #include <malloc.h>
 #include <mmc.h>
 #include <fat.h>
 #include <dfu.h>
 #include <hash.h>
+#include <task.h>
 #include <linux/list.h>
 #include <linux/compiler.h>
 
@@ -77,9 +79,45 @@ int dfu_init_env_entities(char *interface, char *devstr)
 
 static unsigned char *dfu_buf;
 static unsigned long dfu_buf_size;
+/* decompressed data waiting to be written, when decompressing */
+static unsigned char *dfu_decomp_buf;
+
+#ifdef CONFIG_DFU_WRITE_ASYNC
+/* The second buffer, and the one being written by dfu_wtask */
+static unsigned char *dfu_buf2;
+static unsigned char *dfu_wbuf;
+static long dfu_wlen;
+static struct task *dfu_wtask;
+
+/* Waits for the background write, if any, returning its result */
+static int dfu_write_wait(void)
+{
+	int ret;
+
+	if (!dfu_wtask)
+		return 0;
+	ret = task_join(dfu_wtask, 0);
+	task_free(dfu_wtask);
+	dfu_wtask = NULL;
+
+	return ret;
+}
+#else
+static inline int dfu_write_wait(void)
+{
+	return 0;
+}
+#endif
 
 unsigned char *dfu_free_buf(void)
 {
+	dfu_write_wait();
+#ifdef CONFIG_DFU_WRITE_ASYNC
+	free(dfu_buf2);
+	dfu_buf2 = NULL;
+#endif
+	free(dfu_decomp_buf);
+	dfu_decomp_buf = NULL;
 	free(dfu_buf);
 	dfu_buf = NULL;
 	return dfu_buf;
@@ -132,26 +170,125 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
-static int dfu_write_buffer_drain(struct dfu_entity *dfu)
+#ifdef CONFIG_DECOMP_STREAM
+static int dfu_decomp_write(struct dfu_entity *dfu)
 {
-	long w_size;
+	long w_size = dfu->d_len;
 	int ret;
 
-	/* flush size? */
-	w_size = dfu->i_buf - dfu->i_buf_start;
 	if (w_size == 0)
 		return 0;
 
-	if (dfu_hash_algo)
-		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
-					   dfu->i_buf_start, w_size, 0);
+	ret = dfu->write_medium(dfu, dfu->offset, dfu_decomp_buf, &w_size);
+	if (ret) {
+		debug("%s: Write error!\n", __func__);
+		return ret;
+	}
+	dfu->offset += w_size;
+	dfu->d_len = 0;
+
+	puts("#");
 
-	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
+	return 0;
+}
+
+/* Collects decompressed data, writing it out a buffer at a time */
+static int dfu_decomp_out(void *priv, const void *buf, size_t len)
+{
+	struct dfu_entity *dfu = priv;
+	size_t n;
+	int ret;
+
+	while (len) {
+		n = min_t(size_t, len, dfu_buf_size - dfu->d_len);
+		memcpy(dfu_decomp_buf + dfu->d_len, buf, n);
+		dfu->d_len += n;
+		buf += n;
+		len -= n;
+		if (dfu->d_len == dfu_buf_size) {
+			ret = dfu_decomp_write(dfu);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * If "dfu_decompress" is set, look at the start of the image and start
+ * decompressing it if it is compressed
+ */
+static int dfu_decomp_start(struct dfu_entity *dfu, const void *buf,
+			    long len)
+{
+	int comp, ret;
+
+	if (getenv_yesno("dfu_decompress") != 1)
+		return 0;
+	comp = decomp_detect(buf, len);
+	if (comp == IH_COMP_NONE)
+		return 0;
+
+	if (!dfu_decomp_buf) {
+		dfu_decomp_buf = memalign(CONFIG_SYS_CACHELINE_SIZE,
+					  dfu_buf_size);
+		if (!dfu_decomp_buf)
+			return -ENOMEM;
+	}
+	ret = decomp_init(&dfu->decomp, comp, dfu_decomp_out, dfu);
 	if (ret)
-		debug("%s: Write error!\n", __func__);
+		return ret;
+	dfu->d_len = 0;
+	printf("DFU: image is %s\n", genimg_get_comp_name(comp));
 
-	/* point back */
-	dfu->i_buf = dfu->i_buf_start;
+	return 0;
+}
+
+static int dfu_decomp_finish(struct dfu_entity *dfu)
+{
+	int ret;
+
+	ret = decomp_flush(dfu->decomp);
+	if (ret) {
+		error("DFU: decompression failed (err=%d)\n", ret);
+		return ret;
+	}
+	ret = dfu_decomp_write(dfu);
+	if (ret)
+		return ret;
+	printf("\nDFU: %llu bytes decompressed to %llu, %zu KB used\n",
+	       dfu->decomp->total_in, dfu->decomp->total_out,
+	       dfu->decomp->peak_mem >> 10);
+
+	return 0;
+}
+#endif
+
+/* Writes a buffer of the image to the medium, decompressing if needed */
+static int dfu_write_buf(struct dfu_entity *dfu, void *buf, long w_size)
+{
+	int ret;
+
+#ifdef CONFIG_DECOMP_STREAM
+	/* the first buffer shows whether the image is compressed */
+	if (!dfu->offset && !dfu->decomp) {
+		ret = dfu_decomp_start(dfu, buf, w_size);
+		if (ret)
+			return ret;
+	}
+	if (dfu->decomp) {
+		ret = decomp_feed(dfu->decomp, buf, w_size);
+		if (ret)
+			error("DFU: decompression failed (err=%d)\n", ret);
+
+		return ret;
+	}
+#endif
+
+	ret = dfu->write_medium(dfu, dfu->offset, buf, &w_size);
+	if (ret)
+		debug("%s: Write error!\n", __func__);
 
 	/* update offset */
 	dfu->offset += w_size;
@@ -161,8 +298,75 @@ static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 	return ret;
 }
 
+#ifdef CONFIG_DFU_WRITE_ASYNC
+static int dfu_write_task(void *arg)
+{
+	struct dfu_entity *dfu = arg;
+
+	return dfu_write_buf(dfu, dfu_wbuf, dfu_wlen);
+}
+
+/*
+ * Hands the full buffer to a task to write and switches to the other
+ * buffer, so that the next data can arrive while the medium is busy.
+ * Returns false if this is not possible, e.g. before relocation.
+ */
+static bool dfu_write_async(struct dfu_entity *dfu, long w_size)
+{
+	unsigned char *next;
+
+	if (!dfu_buf2) {
+		dfu_buf2 = memalign(CONFIG_SYS_CACHELINE_SIZE, dfu_buf_size);
+		if (!dfu_buf2)
+			return false;
+	}
+	next = dfu->i_buf_start == dfu_buf ? dfu_buf2 : dfu_buf;
+	dfu_wbuf = dfu->i_buf_start;
+	dfu_wlen = w_size;
+	if (task_create("dfu_write", dfu_write_task, dfu, &dfu_wtask)) {
+		dfu_wtask = NULL;
+		return false;
+	}
+	dfu->i_buf_start = next;
+	dfu->i_buf_end = next + dfu_buf_size;
+	dfu->i_buf = next;
+
+	return true;
+}
+#endif
+
+static int dfu_write_buffer_drain(struct dfu_entity *dfu)
+{
+	long w_size;
+	int ret;
+
+	/* flush size? */
+	w_size = dfu->i_buf - dfu->i_buf_start;
+	if (w_size == 0)
+		return 0;
+
+	/* only one buffer is written at a time */
+	ret = dfu_write_wait();
+	if (ret)
+		return ret;
+#ifdef CONFIG_DFU_WRITE_ASYNC
+	if (dfu_write_async(dfu, w_size))
+		return 0;
+#endif
+
+	ret = dfu_write_buf(dfu, dfu->i_buf_start, w_size);
+
+	/* point back */
+	dfu->i_buf = dfu->i_buf_start;
+
+	return ret;
+}
+
 void dfu_write_transaction_cleanup(struct dfu_entity *dfu)
 {
+	/* the background write must not outlive the buffers */
+	dfu_write_wait();
+
 	/* clear everything */
 	dfu->crc = 0;
 	dfu->offset = 0;
@@ -171,6 +375,11 @@ void dfu_write_transaction_cleanup(struct dfu_entity *dfu)
 	dfu->i_buf_end = dfu_buf;
 	dfu->i_buf = dfu->i_buf_start;
 	dfu->inited = 0;
+#ifdef CONFIG_DECOMP_STREAM
+	decomp_free(dfu->decomp);
+	dfu->decomp = NULL;
+	dfu->d_len = 0;
+#endif
 }
 
 int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
@@ -178,9 +387,21 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	int ret = 0;
 
 	ret = dfu_write_buffer_drain(dfu);
+	if (!ret)
+		ret = dfu_write_wait();
 	if (ret)
 		return ret;
 
+#ifdef CONFIG_DECOMP_STREAM
+	if (dfu->decomp) {
+		ret = dfu_decomp_finish(dfu);
+		if (ret) {
+			dfu_write_transaction_cleanup(dfu);
+			return ret;
+		}
+	}
+#endif
+
 	if (dfu->flush_medium)
 		ret = dfu->flush_medium(dfu);
 
@@ -257,6 +478,10 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	}
 
 	memcpy(dfu->i_buf, buf, size);
+	/* hash while the data is still in the cache */
+	if (dfu_hash_algo)
+		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
+					   dfu->i_buf, size, 0);
 	dfu->i_buf += size;
 
 	/* if end or if buffer full flush */
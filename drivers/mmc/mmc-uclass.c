@@ -6,10 +6,13 @@
  */
 
 #include <common.h>
+#include <errno.h>
 #include <mmc.h>
 #include <dm.h>
+#include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/root.h>
+#include <dm/uclass-internal.h>
 
 struct mmc *mmc_get_mmc_dev(struct udevice *dev)
 {
@@ -80,18 +83,45 @@ void mmc_do_preinit(void)
 	if (ret)
 		return;
 	uclass_foreach_dev(dev, uc) {
-		struct mmc *m = mmc_get_mmc_dev(dev);
+		struct mmc *m;
 
+		/* Lazy probing leaves devices alone until they are used */
+		if (CONFIG_IS_ENABLED(MMC_PREINIT_ALL) && device_probe(dev))
+			continue;
+		m = mmc_get_mmc_dev(dev);
 		if (!m)
 			continue;
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 		mmc_set_preinit(m, 1);
 #endif
+		if (CONFIG_IS_ENABLED(MMC_PREINIT_ALL))
+			mmc_set_preinit(m, 1);
+		/* With INITCALL_TASKS the init task finishes this */
 		if (m->preinit)
 			mmc_start_init(m);
 	}
 }
 
+int mmc_poll_preinit(void)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	int busy = 0;
+	int ret;
+
+	ret = uclass_get(UCLASS_MMC, &uc);
+	if (ret)
+		return ret;
+	uclass_foreach_dev(dev, uc) {
+		struct mmc *m = mmc_get_mmc_dev(dev);
+
+		if (m && m->init_in_progress && mmc_poll_init(m) == -EAGAIN)
+			busy++;
+	}
+
+	return busy ? -EAGAIN : 0;
+}
+
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
 void print_mmc_devices(char separator)
 {
@@ -99,16 +129,25 @@ void print_mmc_devices(char separator)
 	char *mmc_type;
 	bool first = true;
 
-	for (uclass_first_device(UCLASS_MMC, &dev);
+	for (uclass_find_first_device(UCLASS_MMC, &dev);
 	     dev;
-	     uclass_next_device(&dev)) {
+	     uclass_find_next_device(&dev)) {
 		struct mmc *m = mmc_get_mmc_dev(dev);
+		struct blk_desc *desc;
+		struct udevice *bdev;
 
 		if (!first) {
 			printf("%c", separator);
 			if (separator != '\n')
 				puts(" ");
 		}
+		if (!m) {
+			/* Not probed yet, so only the block device is known */
+			device_find_first_child(dev, &bdev);
+			desc = bdev ? dev_get_uclass_platdata(bdev) : NULL;
+			printf("%s: %d", dev->name, desc ? desc->devnum : -1);
+			continue;
+		}
 		if (m->has_init)
 			mmc_type = IS_SD(m) ? "SD" : "eMMC";
 		else
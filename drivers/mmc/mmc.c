@@ -13,6 +13,7 @@
 #include <dm.h>
 #include <dm/device-internal.h>
 #include <errno.h>
+#include <initcall.h>
 #include <mmc.h>
 #include <part.h>
 #include <malloc.h>
@@ -175,33 +176,75 @@ int mmc_set_blocklen(struct mmc *mmc, int len)
 	return mmc_send_cmd(mmc, &cmd, NULL);
 }
 
-static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
-			   lbaint_t blkcnt)
+static int mmc_send_cmd_start(struct mmc *mmc, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
 {
-	struct mmc_cmd cmd;
-	struct mmc_data data;
+	if (!mmc->cfg->ops->send_cmd_start)
+		return mmc_send_cmd(mmc, cmd, data);
+
+	return mmc->cfg->ops->send_cmd_start(mmc, cmd, data);
+}
+
+static int mmc_send_cmd_poll(struct mmc *mmc, struct mmc_cmd *cmd,
+			     struct mmc_data *data)
+{
+	if (!mmc->cfg->ops->send_cmd_poll)
+		return 0;
+
+	return mmc->cfg->ops->send_cmd_poll(mmc, cmd, data);
+}
+
+/* Largest number of blocks to read with a single command */
+static lbaint_t mmc_read_max_blocks(struct mmc *mmc)
+{
+	/* SET_BLOCK_COUNT has a 16-bit block count */
+	if (mmc->card_caps & MMC_MODE_CMD23)
+		return min_t(lbaint_t, mmc->cfg->b_max, 0xffff);
+
+	return mmc->cfg->b_max;
+}
+
+/*
+ * Set up the command for a block read. Where the card and host support it,
+ * the block count is sent ahead so no stop command is needed afterwards.
+ */
+static int mmc_read_setup(struct mmc *mmc, struct mmc_cmd *cmd,
+			  struct mmc_data *data, void *dst, lbaint_t start,
+			  lbaint_t blkcnt)
+{
+	if (blkcnt > 1 && (mmc->card_caps & MMC_MODE_CMD23)) {
+		cmd->cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+		cmd->cmdarg = blkcnt & 0xffff;
+		cmd->resp_type = MMC_RSP_R1;
+		if (mmc_send_cmd(mmc, cmd, NULL))
+			return -EIO;
+	}
 
 	if (blkcnt > 1)
-		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
+		cmd->cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
 	else
-		cmd.cmdidx = MMC_CMD_READ_SINGLE_BLOCK;
+		cmd->cmdidx = MMC_CMD_READ_SINGLE_BLOCK;
 
 	if (mmc->high_capacity)
-		cmd.cmdarg = start;
+		cmd->cmdarg = start;
 	else
-		cmd.cmdarg = start * mmc->read_bl_len;
+		cmd->cmdarg = start * mmc->read_bl_len;
 
-	cmd.resp_type = MMC_RSP_R1;
+	cmd->resp_type = MMC_RSP_R1;
 
-	data.dest = dst;
-	data.blocks = blkcnt;
-	data.blocksize = mmc->read_bl_len;
-	data.flags = MMC_DATA_READ;
+	data->dest = dst;
+	data->blocks = blkcnt;
+	data->blocksize = mmc->read_bl_len;
+	data->flags = MMC_DATA_READ;
 
-	if (mmc_send_cmd(mmc, &cmd, &data))
-		return 0;
+	return 0;
+}
 
-	if (blkcnt > 1) {
+static int mmc_read_finish(struct mmc *mmc, lbaint_t blkcnt)
+{
+	struct mmc_cmd cmd;
+
+	if (blkcnt > 1 && !(mmc->card_caps & MMC_MODE_CMD23)) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -209,10 +252,28 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
 			printf("mmc fail to send stop cmd\n");
 #endif
-			return 0;
+			return -EIO;
 		}
 	}
 
+	return 0;
+}
+
+static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
+			   lbaint_t blkcnt)
+{
+	struct mmc_cmd cmd;
+	struct mmc_data data;
+
+	if (mmc_read_setup(mmc, &cmd, &data, dst, start, blkcnt))
+		return 0;
+
+	if (mmc_send_cmd(mmc, &cmd, &data))
+		return 0;
+
+	if (mmc_read_finish(mmc, blkcnt))
+		return 0;
+
 	return blkcnt;
 }
 
@@ -256,8 +317,7 @@ static ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start,
 	}
 
 	do {
-		cur = (blocks_todo > mmc->cfg->b_max) ?
-			mmc->cfg->b_max : blocks_todo;
+		cur = min(blocks_todo, mmc_read_max_blocks(mmc));
 		if (mmc_read_blocks(mmc, dst, start, cur) != cur) {
 			debug("%s: Failed to read blocks\n", __func__);
 			return 0;
@@ -270,6 +330,118 @@ static ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start,
 	return blkcnt;
 }
 
+#ifdef CONFIG_BLK
+static void mmc_req_done(struct blk_req *req, int status)
+{
+	list_del(&req->node);
+	req->status = status;
+}
+
+/* Start the next transfer of the request at the head of the queue */
+static int mmc_req_start(struct mmc *mmc, struct blk_desc *block_dev)
+{
+	struct blk_req *req;
+	lbaint_t cur;
+	int ret;
+
+	req = list_first_entry(&mmc->req_queue, struct blk_req, node);
+	if (!req->actual) {
+		ret = blk_dselect_hwpart(block_dev, block_dev->hwpart);
+		if (ret < 0)
+			return ret;
+		if (mmc_set_blocklen(mmc, mmc->read_bl_len))
+			return -EIO;
+	}
+
+	cur = min(req->blkcnt - req->actual, mmc_read_max_blocks(mmc));
+	ret = mmc_read_setup(mmc, &mmc->req_cmd, &mmc->req_data,
+			     req->buffer + req->actual * mmc->read_bl_len,
+			     req->start + req->actual, cur);
+	if (!ret)
+		ret = mmc_send_cmd_start(mmc, &mmc->req_cmd, &mmc->req_data);
+	if (ret)
+		return -EIO;
+	mmc->req_cur = cur;
+	mmc->req_active = true;
+
+	return 0;
+}
+
+static int mmc_bpoll(struct udevice *dev)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+	struct blk_req *req;
+	int ret, count = 0;
+
+	if (!mmc)
+		return -ENODEV;
+
+	while (!list_empty(&mmc->req_queue)) {
+		req = list_first_entry(&mmc->req_queue, struct blk_req, node);
+		if (mmc->req_active) {
+			ret = mmc_send_cmd_poll(mmc, &mmc->req_cmd,
+						&mmc->req_data);
+			if (ret == -EBUSY)
+				break;
+			mmc->req_active = false;
+			if (!ret)
+				ret = mmc_read_finish(mmc, mmc->req_cur);
+			if (ret) {
+				debug("%s: Failed to read blocks\n", __func__);
+				mmc_req_done(req, -EIO);
+				continue;
+			}
+			req->actual += mmc->req_cur;
+			if (req->actual == req->blkcnt) {
+				mmc_req_done(req, 0);
+				continue;
+			}
+		}
+
+		/* Keep the host busy by starting the next transfer at once */
+		ret = mmc_req_start(mmc, block_dev);
+		if (ret)
+			mmc_req_done(req, ret);
+	}
+
+	list_for_each_entry(req, &mmc->req_queue, node)
+		count++;
+
+	return count;
+}
+
+static int mmc_bsubmit(struct udevice *dev, struct blk_req *req)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+
+	if (!mmc)
+		return -ENODEV;
+
+	req->actual = 0;
+	if (!req->blkcnt) {
+		req->status = 0;
+		return 0;
+	}
+
+	if ((req->start + req->blkcnt) > block_dev->lba) {
+#if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
+		printf("MMC: block number 0x" LBAF " exceeds max(0x" LBAF ")\n",
+		       req->start + req->blkcnt, block_dev->lba);
+#endif
+		return -EINVAL;
+	}
+
+	req->status = -EINPROGRESS;
+	list_add_tail(&req->node, &mmc->req_queue);
+	if (!mmc->req_active)
+		mmc_bpoll(dev);
+
+	return 0;
+}
+#endif
+
 static int mmc_go_idle(struct mmc *mmc)
 {
 	struct mmc_cmd cmd;
@@ -398,6 +570,7 @@ static int mmc_send_op_cond(struct mmc *mmc)
 			break;
 	}
 	mmc->op_cond_pending = 1;
+	mmc->op_cond_start = get_timer(0);
 	return 0;
 }
 
@@ -504,7 +677,7 @@ static int mmc_change_freq(struct mmc *mmc)
 	if (mmc->version < MMC_VERSION_4)
 		return 0;
 
-	mmc->card_caps |= MMC_MODE_4BIT | MMC_MODE_8BIT;
+	mmc->card_caps |= MMC_MODE_4BIT | MMC_MODE_8BIT | MMC_MODE_CMD23;
 
 	err = mmc_send_ext_csd(mmc, ext_csd);
 
@@ -930,6 +1103,9 @@ retry_scr:
 	if (mmc->scr[0] & SD_DATA_4BIT)
 		mmc->card_caps |= MMC_MODE_4BIT;
 
+	if (mmc->scr[0] & SD_SCR_CMD23)
+		mmc->card_caps |= MMC_MODE_CMD23;
+
 	/* Version 1.0 doesn't support switching */
 	if (mmc->version == SD_VERSION_1_0)
 		return 0;
@@ -1547,6 +1723,7 @@ int mmc_bind(struct udevice *dev, struct mmc *mmc, const struct mmc_config *cfg)
 	bdesc = dev_get_uclass_platdata(bdev);
 	mmc->cfg = cfg;
 	mmc->priv = dev;
+	INIT_LIST_HEAD(&mmc->req_queue);
 
 	/* the following chunk was from mmc_register() */
 
@@ -1726,6 +1903,33 @@ static int mmc_complete_init(struct mmc *mmc)
 	return err;
 }
 
+int mmc_poll_init(struct mmc *mmc)
+{
+	int err;
+
+	if (mmc->has_init)
+		return 0;
+	if (!mmc->init_in_progress)
+		return mmc_init(mmc);
+
+	/* Ask the card once whether it is ready, as mmc_complete_op_cond() */
+	if (mmc->op_cond_pending && !(mmc->ocr & OCR_BUSY)) {
+		err = mmc_send_op_cond_iter(mmc, 1);
+		if (!err && !(mmc->ocr & OCR_BUSY)) {
+			if (get_timer(mmc->op_cond_start) <= 1000)
+				return -EAGAIN;
+			err = UNUSABLE_ERR;
+		}
+		if (err) {
+			mmc->op_cond_pending = 0;
+			mmc->init_in_progress = 0;
+			return err;
+		}
+	}
+
+	return mmc_complete_init(mmc);
+}
+
 int mmc_init(struct mmc *mmc)
 {
 	int err = 0;
@@ -1788,6 +1992,10 @@ static int mmc_probe(bd_t *bis)
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(DM_LAZY_PROBE) && defined(CONFIG_BLK)
+	/* Each device is probed when its block device is first used */
+	return 0;
+#endif
 	/*
 	 * Try to add them in sequence order. Really with driver model we
 	 * should allow holes, but the current MMC list does not allow that.
@@ -1816,6 +2024,14 @@ static int mmc_probe(bd_t *bis)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(INITCALL_TASKS)
+/* Cards powering up after mmc_do_preinit() are polled until they are ready */
+static struct initcall_task mmc_init_task = {
+	.name	= "mmc_init",
+	.poll	= mmc_poll_preinit,
+};
+#endif
+
 int mmc_initialize(bd_t *bis)
 {
 	static int initialized = 0;
@@ -1836,6 +2052,9 @@ int mmc_initialize(bd_t *bis)
 #endif
 
 	mmc_do_preinit();
+#if CONFIG_IS_ENABLED(INITCALL_TASKS)
+	initcall_task_start(&mmc_init_task);
+#endif
 	return 0;
 }
 
@@ -1967,6 +2186,8 @@ static const struct blk_ops mmc_blk_ops = {
 	.read	= mmc_bread,
 	.write	= mmc_bwrite,
 	.select_hwpart	= mmc_select_hwpart,
+	.submit	= mmc_bsubmit,
+	.poll	= mmc_bpoll,
 };
 
 U_BOOT_DRIVER(mmc_blk) = {
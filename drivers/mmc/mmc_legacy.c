@@ -6,6 +6,7 @@
  */
 
 #include <common.h>
+#include <errno.h>
 #include <mmc.h>
 
 static struct list_head mmc_devices;
@@ -56,11 +57,30 @@ void mmc_do_preinit(void)
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 		mmc_set_preinit(m, 1);
 #endif
+		if (CONFIG_IS_ENABLED(MMC_PREINIT_ALL))
+			mmc_set_preinit(m, 1);
+		/* With INITCALL_TASKS the init task finishes this */
 		if (m->preinit)
 			mmc_start_init(m);
 	}
 }
 
+int mmc_poll_preinit(void)
+{
+	struct mmc *m;
+	struct list_head *entry;
+	int busy = 0;
+
+	list_for_each(entry, &mmc_devices) {
+		m = list_entry(entry, struct mmc, link);
+
+		if (m->init_in_progress && mmc_poll_init(m) == -EAGAIN)
+			busy++;
+	}
+
+	return busy ? -EAGAIN : 0;
+}
+
 void mmc_list_init(void)
 {
 	INIT_LIST_HEAD(&mmc_devices);
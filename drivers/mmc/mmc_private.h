@@ -72,11 +72,6 @@ static inline ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start,
  */
 int mmc_get_next_devnum(void);
 
-/**
- * mmc_do_preinit() - Get an MMC device ready for use
- */
-void mmc_do_preinit(void);
-
 /**
  * mmc_list_init() - Set up the list of MMC devices
  */
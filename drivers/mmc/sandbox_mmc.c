@@ -17,16 +17,45 @@ DECLARE_GLOBAL_DATA_PTR;
 struct sandbox_mmc_plat {
 	struct mmc_config cfg;
 	struct mmc mmc;
+	uint cmd_us;		/* modelled latency per command */
+	uint block_us;		/* modelled transfer time per block */
 };
 
+struct sandbox_mmc_priv {
+	struct sandbox_mmc_stats stats;
+	ulong busy_until;	/* timer_get_us() when the bus becomes idle */
+};
+
+/* Work out how long a command keeps the bus busy and account for it */
+static ulong sandbox_mmc_cost(struct mmc *mmc, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
+{
+	struct sandbox_mmc_plat *plat = dev_get_platdata(mmc->dev);
+	struct sandbox_mmc_priv *priv = dev_get_priv(mmc->dev);
+	ulong us = plat->cmd_us;
+
+	priv->stats.cmds++;
+	if (cmd->cmdidx == MMC_CMD_STOP_TRANSMISSION)
+		priv->stats.stops++;
+	if (cmd->resp_type == MMC_RSP_R1b)
+		us += plat->cmd_us;
+	if (data) {
+		priv->stats.blocks += data->blocks;
+		us += data->blocks * plat->block_us;
+	}
+	priv->stats.busy_us += us;
+
+	return us;
+}
+
 /**
- * sandbox_mmc_send_cmd() - Emulate SD commands
+ * sandbox_mmc_do_cmd() - Emulate SD commands
  *
  * This emulate an SD card version 2. Single-block reads result in zero data.
  * Multiple-block reads return a test string.
  */
-static int sandbox_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
-				struct mmc_data *data)
+static int sandbox_mmc_do_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
 {
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
@@ -60,6 +89,7 @@ static int sandbox_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 		strcpy(data->dest, "this is a test");
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
+	case MMC_CMD_SET_BLOCK_COUNT:
 		break;
 	case SD_CMD_APP_SEND_OP_COND:
 		cmd->response[0] = OCR_BUSY | OCR_HCS;
@@ -74,7 +104,8 @@ static int sandbox_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3, with SET_BLOCK_COUNT */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_SCR_CMD23);
 		break;
 	}
 	default:
@@ -85,6 +116,43 @@ static int sandbox_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 	return 0;
 }
 
+static int sandbox_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
+				struct mmc_data *data)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(mmc->dev);
+
+	priv->busy_until = timer_get_us() + sandbox_mmc_cost(mmc, cmd, data);
+	while ((long)(timer_get_us() - priv->busy_until) < 0)
+		;
+
+	return sandbox_mmc_do_cmd(mmc, cmd, data);
+}
+
+static int sandbox_mmc_send_cmd_start(struct mmc *mmc, struct mmc_cmd *cmd,
+				      struct mmc_data *data)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(mmc->dev);
+
+	if (!data)
+		return sandbox_mmc_send_cmd(mmc, cmd, data);
+
+	/* The data arrives when the modelled transfer time has passed */
+	priv->busy_until = timer_get_us() + sandbox_mmc_cost(mmc, cmd, data);
+
+	return sandbox_mmc_do_cmd(mmc, cmd, data);
+}
+
+static int sandbox_mmc_send_cmd_poll(struct mmc *mmc, struct mmc_cmd *cmd,
+				     struct mmc_data *data)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(mmc->dev);
+
+	if ((long)(timer_get_us() - priv->busy_until) < 0)
+		return -EBUSY;
+
+	return 0;
+}
+
 static void sandbox_mmc_set_ios(struct mmc *mmc)
 {
 }
@@ -101,6 +169,8 @@ static int sandbox_mmc_getcd(struct mmc *mmc)
 
 static const struct mmc_ops sandbox_mmc_ops = {
 	.send_cmd = sandbox_mmc_send_cmd,
+	.send_cmd_start = sandbox_mmc_send_cmd_start,
+	.send_cmd_poll = sandbox_mmc_send_cmd_poll,
 	.set_ios = sandbox_mmc_set_ios,
 	.init = sandbox_mmc_init,
 	.getcd = sandbox_mmc_getcd,
@@ -121,11 +191,16 @@ int sandbox_mmc_bind(struct udevice *dev)
 
 	cfg->name = dev->name;
 	cfg->ops = &sandbox_mmc_ops;
-	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
+	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT |
+			 MMC_MODE_CMD23;
 	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
 	cfg->b_max = U32_MAX;
+	plat->cmd_us = fdtdec_get_int(gd->fdt_blob, dev->of_offset,
+				      "sandbox,cmd-latency-us", 0);
+	plat->block_us = fdtdec_get_int(gd->fdt_blob, dev->of_offset,
+					"sandbox,block-latency-us", 0);
 
 	ret = mmc_bind(dev, &plat->mmc, cfg);
 	if (ret)
@@ -134,6 +209,23 @@ int sandbox_mmc_bind(struct udevice *dev)
 	return 0;
 }
 
+void sandbox_mmc_set_latency(struct udevice *dev, uint cmd_us, uint block_us)
+{
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+
+	plat->cmd_us = cmd_us;
+	plat->block_us = block_us;
+}
+
+void sandbox_mmc_get_stats(struct udevice *dev,
+			   struct sandbox_mmc_stats *stats)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	*stats = priv->stats;
+	memset(&priv->stats, '\0', sizeof(priv->stats));
+}
+
 int sandbox_mmc_unbind(struct udevice *dev)
 {
 	mmc_unbind(dev);
@@ -154,4 +246,5 @@ U_BOOT_DRIVER(mmc_sandbox) = {
 	.unbind		= sandbox_mmc_unbind,
 	.probe		= sandbox_mmc_probe,
 	.platdata_auto_alloc_size = sizeof(struct sandbox_mmc_plat),
+	.priv_auto_alloc_size = sizeof(struct sandbox_mmc_priv),
 };
@@ -612,6 +612,24 @@ static int designware_eth_write_hwaddr(struct udevice *dev)
 	return _dw_write_hwaddr(priv, pdata->enetaddr);
 }
 
+static int designware_eth_get_rx_dropped(struct udevice *dev)
+{
+	struct dw_eth_dev *priv = dev_get_priv(dev);
+	u32 missed = readl(&priv->dma_regs_p->missedframes);
+	int dropped;
+
+	/* A counter which overflowed has stopped at its maximum */
+	dropped = missed & MISSED_NODESC_MASK;
+	if (missed & MISSED_NODESC_OVF)
+		dropped = MISSED_NODESC_MASK;
+	if (missed & MISSED_FIFO_OVF)
+		dropped += MISSED_FIFO_MASK >> MISSED_FIFO_SHIFT;
+	else
+		dropped += (missed & MISSED_FIFO_MASK) >> MISSED_FIFO_SHIFT;
+
+	return dropped;
+}
+
 static int designware_eth_bind(struct udevice *dev)
 {
 #ifdef CONFIG_DM_PCI
@@ -685,6 +703,7 @@ static const struct eth_ops designware_eth_ops = {
 	.free_pkt		= designware_eth_free_pkt,
 	.stop			= designware_eth_stop,
 	.write_hwaddr		= designware_eth_write_hwaddr,
+	.get_rx_dropped		= designware_eth_get_rx_dropped,
 };
 
 static int designware_eth_ofdata_to_platdata(struct udevice *dev)
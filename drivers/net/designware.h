@@ -70,7 +70,8 @@ struct eth_dma_regs {
 	u32 status;		/* 0x14 */
 	u32 opmode;		/* 0x18 */
 	u32 intenable;		/* 0x1c */
-	u32 reserved1[2];
+	u32 missedframes;	/* 0x20 */
+	u32 reserved1;
 	u32 axibus;		/* 0x28 */
 	u32 reserved2[7];
 	u32 currhosttxdesc;	/* 0x48 */
@@ -106,6 +107,13 @@ struct eth_dma_regs {
 #define TXSECONDFRAME		(1 << 2)
 #define RXSTART			(1 << 1)
 
+/* Missed frame counter definitions, cleared on read */
+#define MISSED_NODESC_MASK	(0xFFFF << 0)	/* No free receive descriptor */
+#define MISSED_NODESC_OVF	(1 << 16)
+#define MISSED_FIFO_SHIFT	17
+#define MISSED_FIFO_MASK	(0x7FF << MISSED_FIFO_SHIFT) /* FIFO overflow */
+#define MISSED_FIFO_OVF		(1 << 28)
+
 /* Descriptior related definitions */
 #define MAC_MAX_FRAME_SZ	(1600)
 
@@ -11,26 +11,37 @@
 #include <dm.h>
 #include <malloc.h>
 #include <net.h>
+#include <asm/eth.h>
 #include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Number of packets which can be queued to be received, like a real ring */
+#define SB_ETH_RECV_QLEN	PKTBUFSRX
+
 /**
  * struct eth_sandbox_priv - memory for sandbox mock driver
  *
  * fake_host_hwaddr: MAC address of mocked machine
  * fake_host_ipaddr: IP address of mocked machine
- * recv_packet_buffer: buffer of the packet returned as received
- * recv_packet_length: length of the packet returned as received
+ * recv_packets: SB_ETH_RECV_QLEN buffers of packets queued to be received
+ * recv_packet_length: length of each packet queued to be received
+ * recv_head: index of the next packet to return as received
+ * recv_count: number of packets queued
+ * recv_dropped: number of packets lost because the queue was full
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
 	struct in_addr fake_host_ipaddr;
-	uchar *recv_packet_buffer;
-	int recv_packet_length;
+	uchar *recv_packets;
+	int recv_packet_length[SB_ETH_RECV_QLEN];
+	int recv_head;
+	int recv_count;
+	int recv_dropped;
 };
 
 static bool disabled[8] = {false};
+static const struct sandbox_eth_responder *responder[8];
 static bool skip_timeout;
 
 /*
@@ -54,6 +65,63 @@ void sandbox_eth_skip_timeout(void)
 	skip_timeout = true;
 }
 
+/*
+ * sandbox_eth_set_responder()
+ *
+ * index - The alias index (also DM seq number)
+ * resp - Responder for packets sent, or NULL for just ARP and ping
+ */
+void sandbox_eth_set_responder(int index,
+			       const struct sandbox_eth_responder *resp)
+{
+	responder[index] = resp;
+}
+
+static const struct sandbox_eth_responder *sb_eth_responder(
+	struct udevice *dev)
+{
+	if (dev->seq < 0 || dev->seq >= ARRAY_SIZE(responder))
+		return NULL;
+
+	return responder[dev->seq];
+}
+
+/* Returns the buffer for the next packet to queue, NULL if the queue is full */
+static uchar *sb_eth_recv_slot(struct eth_sandbox_priv *priv)
+{
+	if (priv->recv_count == SB_ETH_RECV_QLEN)
+		return NULL;
+
+	return priv->recv_packets + PKTSIZE_ALIGN *
+		((priv->recv_head + priv->recv_count) % SB_ETH_RECV_QLEN);
+}
+
+static void sb_eth_recv_queue(struct eth_sandbox_priv *priv, int length)
+{
+	priv->recv_packet_length[(priv->recv_head + priv->recv_count) %
+				 SB_ETH_RECV_QLEN] = length;
+	priv->recv_count++;
+}
+
+int sandbox_eth_recv_packet(struct udevice *dev, const void *packet,
+			    int length)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	uchar *buf;
+
+	if (length > PKTSIZE)
+		return -EINVAL;
+	buf = sb_eth_recv_slot(priv);
+	if (!buf) {
+		priv->recv_dropped++;
+		return -ENOSPC;
+	}
+	memcpy(buf, packet, length);
+	sb_eth_recv_queue(priv, length);
+
+	return 0;
+}
+
 static int sb_eth_start(struct udevice *dev)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -62,14 +130,22 @@ static int sb_eth_start(struct udevice *dev)
 
 	fdtdec_get_byte_array(gd->fdt_blob, dev->of_offset, "fake-host-hwaddr",
 			      priv->fake_host_hwaddr, ARP_HLEN);
-	priv->recv_packet_buffer = net_rx_packets[0];
+	if (!priv->recv_packets) {
+		priv->recv_packets = malloc(SB_ETH_RECV_QLEN * PKTSIZE_ALIGN);
+		if (!priv->recv_packets)
+			return -ENOMEM;
+	}
+	priv->recv_head = 0;
+	priv->recv_count = 0;
 	return 0;
 }
 
 static int sb_eth_send(struct udevice *dev, void *packet, int length)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	const struct sandbox_eth_responder *resp = sb_eth_responder(dev);
 	struct ethernet_hdr *eth = packet;
+	uchar *recv_packet_buffer = sb_eth_recv_slot(priv);
 
 	debug("eth_sandbox: Send packet %d\n", length);
 
@@ -80,20 +156,21 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	if (ntohs(eth->et_protlen) == PROT_ARP) {
 		struct arp_hdr *arp = packet + ETHER_HDR_SIZE;
 
-		if (ntohs(arp->ar_op) == ARPOP_REQUEST) {
+		/* With the receive queue full, the reply is dropped */
+		if (ntohs(arp->ar_op) == ARPOP_REQUEST && recv_packet_buffer) {
 			struct ethernet_hdr *eth_recv;
 			struct arp_hdr *arp_recv;
 
 			/* store this as the assumed IP of the fake host */
 			priv->fake_host_ipaddr = net_read_ip(&arp->ar_tpa);
 			/* Formulate a fake response */
-			eth_recv = (void *)priv->recv_packet_buffer;
+			eth_recv = (void *)recv_packet_buffer;
 			memcpy(eth_recv->et_dest, eth->et_src, ARP_HLEN);
 			memcpy(eth_recv->et_src, priv->fake_host_hwaddr,
 			       ARP_HLEN);
 			eth_recv->et_protlen = htons(PROT_ARP);
 
-			arp_recv = (void *)priv->recv_packet_buffer +
+			arp_recv = (void *)recv_packet_buffer +
 				ETHER_HDR_SIZE;
 			arp_recv->ar_hrd = htons(ARP_ETHER);
 			arp_recv->ar_pro = htons(PROT_IP);
@@ -106,8 +183,7 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 			memcpy(&arp_recv->ar_tha, &arp->ar_sha, ARP_HLEN);
 			net_copy_ip(&arp_recv->ar_tpa, &arp->ar_spa);
 
-			priv->recv_packet_length = ETHER_HDR_SIZE +
-				ARP_HDR_SIZE;
+			sb_eth_recv_queue(priv, ETHER_HDR_SIZE + ARP_HDR_SIZE);
 		}
 	} else if (ntohs(eth->et_protlen) == PROT_IP) {
 		struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
@@ -115,16 +191,17 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			struct icmp_hdr *icmp = (struct icmp_hdr *)&ip->udp_src;
 
-			if (icmp->type == ICMP_ECHO_REQUEST) {
+			if (icmp->type == ICMP_ECHO_REQUEST &&
+			    recv_packet_buffer) {
 				struct ethernet_hdr *eth_recv;
 				struct ip_udp_hdr *ipr;
 				struct icmp_hdr *icmpr;
 
 				/* reply to the ping */
-				memcpy(priv->recv_packet_buffer, packet,
+				memcpy(recv_packet_buffer, packet,
 				       length);
-				eth_recv = (void *)priv->recv_packet_buffer;
-				ipr = (void *)priv->recv_packet_buffer +
+				eth_recv = (void *)recv_packet_buffer;
+				ipr = (void *)recv_packet_buffer +
 					ETHER_HDR_SIZE;
 				icmpr = (struct icmp_hdr *)&ipr->udp_src;
 				memcpy(eth_recv->et_dest, eth->et_src,
@@ -144,9 +221,12 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 				icmpr->checksum = compute_ip_checksum(icmpr,
 					ICMP_HDR_SIZE);
 
-				priv->recv_packet_length = length;
+				sb_eth_recv_queue(priv, length);
+				return 0;
 			}
 		}
+		if (resp)
+			resp->send(dev, packet, length);
 	}
 
 	return 0;
@@ -161,15 +241,38 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		skip_timeout = false;
 	}
 
-	if (priv->recv_packet_length) {
-		int lcl_recv_packet_length = priv->recv_packet_length;
+	if (!priv->recv_count) {
+		const struct sandbox_eth_responder *resp = sb_eth_responder(dev);
+
+		if (resp && resp->poll)
+			resp->poll(dev);
+	}
+
+	if (priv->recv_count) {
+		int lcl_recv_packet_length =
+			priv->recv_packet_length[priv->recv_head];
 
 		debug("eth_sandbox: received packet %d\n",
-		      priv->recv_packet_length);
-		priv->recv_packet_length = 0;
-		*packetp = priv->recv_packet_buffer;
+		      lcl_recv_packet_length);
+		*packetp = priv->recv_packets +
+			priv->recv_head * PKTSIZE_ALIGN;
 		return lcl_recv_packet_length;
 	}
+
+	/* As many real drivers do when their receive ring is empty */
+	return -EAGAIN;
+}
+
+/* The packet stays queued until it is processed, so replies cannot reuse it */
+static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	if (priv->recv_count) {
+		priv->recv_head = (priv->recv_head + 1) % SB_ETH_RECV_QLEN;
+		priv->recv_count--;
+	}
+
 	return 0;
 }
 
@@ -187,16 +290,33 @@ static int sb_eth_write_hwaddr(struct udevice *dev)
 	return 0;
 }
 
+static int sb_eth_get_rx_dropped(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int dropped = priv->recv_dropped;
+
+	priv->recv_dropped = 0;
+
+	return dropped;
+}
+
 static const struct eth_ops sb_eth_ops = {
 	.start			= sb_eth_start,
 	.send			= sb_eth_send,
 	.recv			= sb_eth_recv,
+	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
+	.get_rx_dropped		= sb_eth_get_rx_dropped,
 };
 
 static int sb_eth_remove(struct udevice *dev)
 {
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	free(priv->recv_packets);
+	priv->recv_packets = NULL;
+
 	return 0;
 }
 
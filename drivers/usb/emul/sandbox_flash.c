@@ -10,6 +10,7 @@
 #include <os.h>
 #include <scsi.h>
 #include <usb.h>
+#include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -52,6 +53,9 @@ enum {
  * @status_buff:	Data buffer for outgoing status
  * @buff_used:	Number of bytes ready to transfer back to host
  * @buff:	Data buffer for outgoing data
+ * @cmd_us:	Modelled latency per command
+ * @block_us:	Modelled transfer time per block
+ * @stats:	Activity since the statistics were last read
  */
 struct sandbox_flash_priv {
 	bool error;
@@ -65,6 +69,9 @@ struct sandbox_flash_priv {
 	struct umass_bbb_csw status;
 	int buff_used;
 	u8 buff[512];
+	uint cmd_us;
+	uint block_us;
+	struct sandbox_flash_stats stats;
 };
 
 struct sandbox_flash_plat {
@@ -322,6 +329,8 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 				goto err;
 			priv->transfer_len = cbw->dCBWDataTransferLength;
 			priv->tag = cbw->dCBWTag;
+			priv->stats.cmds++;
+			priv->stats.busy_us += priv->cmd_us;
 			return handle_ufi_command(plat, priv, cbw->CBWCDB,
 						  cbw->bCDBLength);
 		case PHASE_DATA:
@@ -336,12 +345,15 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 			debug("data in, len=%x, alloc_len=%x, priv->read_len=%x\n",
 			      len, priv->alloc_len, priv->read_len);
 			if (priv->read_len) {
-				ulong bytes_read;
+				ulong bytes_read, blocks;
 
 				bytes_read = os_read(priv->fd, buff, len);
 				if (bytes_read != len)
 					return -EIO;
-				priv->read_len -= len / SANDBOX_FLASH_BLOCK_LEN;
+				blocks = len / SANDBOX_FLASH_BLOCK_LEN;
+				priv->read_len -= blocks;
+				priv->stats.blocks += blocks;
+				priv->stats.busy_us += blocks * priv->block_us;
 				if (!priv->read_len)
 					priv->phase = PHASE_STATUS;
 			} else {
@@ -368,6 +380,24 @@ err:
 	return 0;
 }
 
+void sandbox_flash_set_latency(struct udevice *dev, uint cmd_us,
+			       uint block_us)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	priv->cmd_us = cmd_us;
+	priv->block_us = block_us;
+}
+
+void sandbox_flash_get_stats(struct udevice *dev,
+			     struct sandbox_flash_stats *stats)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	*stats = priv->stats;
+	memset(&priv->stats, '\0', sizeof(priv->stats));
+}
+
 static int sandbox_flash_ofdata_to_platdata(struct udevice *dev)
 {
 	struct sandbox_flash_plat *plat = dev_get_platdata(dev);
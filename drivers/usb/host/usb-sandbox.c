@@ -8,10 +8,20 @@
 #include <common.h>
 #include <dm.h>
 #include <usb.h>
+#include <asm/test.h>
 #include <dm/root.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/**
+ * struct sandbox_usb_plat - Platform data for the sandbox USB controller
+ *
+ * @max_xfer_size:	Largest bulk transfer reported, 0 for no limit
+ */
+struct sandbox_usb_plat {
+	size_t max_xfer_size;
+};
+
 static void usbmon_trace(struct udevice *bus, ulong pipe,
 			 struct devrequest *setup, struct udevice *emul)
 {
@@ -110,6 +120,22 @@ static int sandbox_alloc_device(struct udevice *dev, struct usb_device *udev)
 	return 0;
 }
 
+static int sandbox_get_max_xfer_size(struct udevice *dev, size_t *size)
+{
+	struct sandbox_usb_plat *plat = dev_get_platdata(dev);
+
+	*size = plat->max_xfer_size ? plat->max_xfer_size : SIZE_MAX;
+
+	return 0;
+}
+
+void sandbox_usb_set_max_xfer_size(struct udevice *bus, size_t size)
+{
+	struct sandbox_usb_plat *plat = dev_get_platdata(bus);
+
+	plat->max_xfer_size = size;
+}
+
 static int sandbox_usb_probe(struct udevice *dev)
 {
 	return 0;
@@ -120,6 +146,7 @@ static const struct dm_usb_ops sandbox_usb_ops = {
 	.bulk		= sandbox_submit_bulk,
 	.interrupt	= sandbox_submit_int,
 	.alloc_device	= sandbox_alloc_device,
+	.get_max_xfer_size = sandbox_get_max_xfer_size,
 };
 
 static const struct udevice_id sandbox_usb_ids[] = {
@@ -133,4 +160,5 @@ U_BOOT_DRIVER(usb_sandbox) = {
 	.of_match = sandbox_usb_ids,
 	.probe = sandbox_usb_probe,
 	.ops	= &sandbox_usb_ops,
+	.platdata_auto_alloc_size = sizeof(struct sandbox_usb_plat),
 };
@@ -46,6 +46,24 @@ int ext4fs_indir3_blkno = -1;
 struct ext2_inode *g_parent_inode;
 static int symlinknest;
 
+/*
+ * Extent tree blocks last read at each level below the inode. Files are
+ * read in order, so the path to the wanted leaf is nearly always here
+ * already and the tree is not read again for every block. The cache is
+ * dropped on mount and close, and when the device is written to or its
+ * medium changes (see blk_invalidate()).
+ */
+#define EXT4_EXT_MAX_DEPTH	5
+
+static struct {
+	unsigned long long blkno;	/* Filesystem block, 0 if unused */
+	char *buf;
+} ext4fs_ext_cache[EXT4_EXT_MAX_DEPTH];
+static int ext4fs_ext_cache_size;
+static struct blk_desc *ext4fs_ext_cache_dev;
+static unsigned long ext4fs_ext_cache_change_count;
+static int ext4fs_ext_cache_hwpart;
+
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n)
 {
@@ -1406,16 +1424,76 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 
 #endif
 
+static void ext4fs_ext_cache_free(void)
+{
+	int i;
+
+	for (i = 0; i < EXT4_EXT_MAX_DEPTH; i++) {
+		free(ext4fs_ext_cache[i].buf);
+		ext4fs_ext_cache[i].buf = NULL;
+		ext4fs_ext_cache[i].blkno = 0;
+	}
+	ext4fs_ext_cache_size = 0;
+	ext4fs_ext_cache_dev = NULL;
+}
+
+/* Return extent tree block 'block', found at tree level 'level' */
+static char *ext4fs_get_ext_cache(int level, unsigned long long block,
+				  int blksz, int log2_blksz)
+{
+	struct blk_desc *dev = get_fs()->dev_desc;
+	int i;
+
+	if (dev != ext4fs_ext_cache_dev ||
+	    dev->change_count != ext4fs_ext_cache_change_count ||
+	    dev->hwpart != ext4fs_ext_cache_hwpart)
+		ext4fs_ext_cache_free();
+
+	if (blksz != ext4fs_ext_cache_size) {
+		ext4fs_ext_cache_free();
+		for (i = 0; i < EXT4_EXT_MAX_DEPTH; i++) {
+			ext4fs_ext_cache[i].buf = zalloc(blksz);
+			if (!ext4fs_ext_cache[i].buf) {
+				ext4fs_ext_cache_free();
+				return NULL;
+			}
+		}
+		ext4fs_ext_cache_size = blksz;
+	}
+	ext4fs_ext_cache_dev = dev;
+	ext4fs_ext_cache_change_count = dev->change_count;
+	ext4fs_ext_cache_hwpart = dev->hwpart;
+
+	if (ext4fs_ext_cache[level].blkno != block) {
+		ext4fs_ext_cache[level].blkno = 0;
+		if (!ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
+				    ext4fs_ext_cache[level].buf))
+			return NULL;
+		ext4fs_ext_cache[level].blkno = block;
+	}
+
+	return ext4fs_ext_cache[level].buf;
+}
+
+/*
+ * Find the extent tree leaf covering 'fileblock'. If 'next' is not NULL,
+ * it is set to the first file block covered by the following leaf, or to
+ * ~0 if this is the last one.
+ */
 static struct ext4_extent_header *ext4fs_get_extent_block
-	(struct ext2_data *data, char *buf,
-		struct ext4_extent_header *ext_block,
-		uint32_t fileblock, int log2_blksz)
+	(struct ext2_data *data, struct ext4_extent_header *ext_block,
+		uint32_t fileblock, int log2_blksz, uint32_t *next)
 {
 	struct ext4_extent_idx *index;
 	unsigned long long block;
 	int blksz = EXT2_BLOCK_SIZE(data);
+	int level = 0;
+	char *buf;
 	int i;
 
+	if (next)
+		*next = ~0;
+
 	while (1) {
 		index = (struct ext4_extent_idx *)(ext_block + 1);
 
@@ -1431,18 +1509,83 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 				break;
 		} while (fileblock >= le32_to_cpu(index[i].ei_block));
 
-		if (--i < 0)
+		if (next && i < le16_to_cpu(ext_block->eh_entries))
+			*next = min(*next, le32_to_cpu(index[i].ei_block));
+
+		if (--i < 0 || level >= EXT4_EXT_MAX_DEPTH)
 			return 0;
 
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
 
-		if (ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
-				   buf))
-			ext_block = (struct ext4_extent_header *)buf;
-		else
+		buf = ext4fs_get_ext_cache(level++, block, blksz, log2_blksz);
+		if (!buf)
 			return 0;
+		ext_block = (struct ext4_extent_header *)buf;
+	}
+}
+
+/**
+ * ext4fs_get_extent() - map a run of blocks of a file using extents
+ *
+ * Blocks of uninitialized extents and blocks not covered by any extent
+ * read as zeros; they are returned as a run starting at block 0.
+ *
+ * @inode:	Inode of the file
+ * @fileblock:	First file block of the run
+ * @start:	Returns the filesystem block 'fileblock' is stored in, or 0
+ * @return number of blocks in the run, or -ve on error
+ */
+long int ext4fs_get_extent(struct ext2_inode *inode, uint32_t fileblock,
+			   unsigned long long *start)
+{
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	uint32_t first, len, next;
+	int log2_blksz;
+	int i = -1;
+
+	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
+		- get_fs()->dev_desc->log2blksz;
+	ext_block = ext4fs_get_extent_block(ext4fs_root,
+					    (struct ext4_extent_header *)
+					    inode->b.blocks.dir_blocks,
+					    fileblock, log2_blksz, &next);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		return -EINVAL;
+	}
+
+	extent = (struct ext4_extent *)(ext_block + 1);
+
+	do {
+		i++;
+		if (i >= le16_to_cpu(ext_block->eh_entries))
+			break;
+	} while (fileblock >= le32_to_cpu(extent[i].ee_block));
+
+	/* a hole, up to the next extent */
+	*start = 0;
+	if (i < le16_to_cpu(ext_block->eh_entries))
+		next = le32_to_cpu(extent[i].ee_block);
+
+	if (--i >= 0) {
+		first = le32_to_cpu(extent[i].ee_block);
+		len = le16_to_cpu(extent[i].ee_len);
+		if (len > EXT_INIT_MAX_LEN) {
+			len -= EXT_INIT_MAX_LEN;
+			if (fileblock - first < len)
+				return first + len - fileblock;
+		} else if (fileblock - first < len) {
+			*start = le16_to_cpu(extent[i].ee_start_hi);
+			*start = (*start << 32) +
+				 le32_to_cpu(extent[i].ee_start_lo) +
+				 fileblock - first;
+			return first + len - fileblock;
+		}
 	}
+
+	return min_t(uint32_t, next - fileblock, INT_MAX);
 }
 
 static int ext4fs_blockgroup
@@ -1514,20 +1657,16 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		char *buf = zalloc(blksz);
-		if (!buf)
-			return -ENOMEM;
 		struct ext4_extent_header *ext_block;
 		struct ext4_extent *extent;
 		int i = -1;
 		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, buf,
+			ext4fs_get_extent_block(ext4fs_root,
 						(struct ext4_extent_header *)
 						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
+						fileblock, log2_blksz, NULL);
 		if (!ext_block) {
 			printf("invalid extent block\n");
-			free(buf);
 			return -EINVAL;
 		}
 
@@ -1540,20 +1679,16 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 		} while (fileblock >= le32_to_cpu(extent[i].ee_block));
 		if (--i >= 0) {
 			fileblock -= le32_to_cpu(extent[i].ee_block);
-			if (fileblock >= le16_to_cpu(extent[i].ee_len)) {
-				free(buf);
+			if (fileblock >= le16_to_cpu(extent[i].ee_len))
 				return 0;
-			}
 
 			start = le16_to_cpu(extent[i].ee_start_hi);
 			start = (start << 32) +
 					le32_to_cpu(extent[i].ee_start_lo);
-			free(buf);
 			return fileblock + start;
 		}
 
 		printf("Extent Error\n");
-		free(buf);
 		return -1;
 	}
 
@@ -1874,6 +2009,7 @@ void ext4fs_reinit_global(void)
 		ext4fs_indir3_size = 0;
 		ext4fs_indir3_blkno = -1;
 	}
+	ext4fs_ext_cache_free();
 }
 void ext4fs_close(void)
 {
@@ -2215,6 +2351,10 @@ int ext4fs_mount(unsigned part_length)
 	struct ext2_data *data;
 	int status;
 	struct ext_filesystem *fs = get_fs();
+
+	/* The partition may have changed since the cache was filled */
+	ext4fs_ext_cache_free();
+
 	data = zalloc(SUPERBLOCK_SIZE);
 	if (!data)
 		return 0;
@@ -41,6 +41,56 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/*
+ * Largest read passed to ext4fs_devread() at once, which takes an int
+ * length
+ */
+#define EXT4_MAX_READ	(1 << 30)
+
+/*
+ * Read a file using extents: each extent (or hole) is mapped once and read
+ * with a single device request, straight into 'buf'.
+ */
+static int ext4fs_read_extents(struct ext2fs_node *node, loff_t pos,
+			       loff_t len, char *buf)
+{
+	int log2blksz = get_fs()->dev_desc->log2blksz;
+	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
+	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
+	unsigned long long start;
+	loff_t end = pos + len;
+	loff_t bytes;
+	long int count;
+	uint32_t fileblock;
+	int skip;
+
+	while (pos < end) {
+		fileblock = lldiv(pos, blocksize);
+		skip = pos - (loff_t)fileblock * blocksize;
+
+		count = ext4fs_get_extent(&node->inode, fileblock, &start);
+		if (count <= 0)
+			return -1;
+
+		bytes = (loff_t)count * blocksize - skip;
+		bytes = min(bytes, end - pos);
+		bytes = min(bytes, (loff_t)EXT4_MAX_READ);
+
+		if (start) {
+			if (!ext4fs_devread((lbaint_t)start <<
+					    log2_fs_blocksize, skip, bytes,
+					    buf))
+				return -1;
+		} else {
+			memset(buf, 0, bytes);
+		}
+		buf += bytes;
+		pos += bytes;
+	}
+
+	return 0;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
@@ -68,6 +118,13 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 	if (len > filesize)
 		len = filesize;
 
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		if (ext4fs_read_extents(node, pos, len, buf))
+			return -1;
+		*actread = len;
+		return 0;
+	}
+
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
 	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
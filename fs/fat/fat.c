@@ -12,6 +12,7 @@
 #include <common.h>
 #include <blk.h>
 #include <config.h>
+#include <div64.h>
 #include <exports.h>
 #include <fat.h>
 #include <asm/byteorder.h>
@@ -168,23 +169,19 @@ static void get_name(dir_entry *dirent, char *s_name)
  */
 static __u32 get_fatent(fsdata *mydata, __u32 entry)
 {
-	__u32 bufnum;
+	__u32 bufnum, bufentries;
 	__u32 off16, offset;
 	__u32 ret = 0x00;
 	__u16 val1, val2;
 
 	switch (mydata->fatsize) {
 	case 32:
-		bufnum = entry / FAT32BUFSIZE;
-		offset = entry - bufnum * FAT32BUFSIZE;
-		break;
 	case 16:
-		bufnum = entry / FAT16BUFSIZE;
-		offset = entry - bufnum * FAT16BUFSIZE;
-		break;
 	case 12:
-		bufnum = entry / FAT12BUFSIZE;
-		offset = entry - bufnum * FAT12BUFSIZE;
+		/* number of entries held by the FAT window */
+		bufentries = FATREADBUFSIZE * 8 / mydata->fatsize;
+		bufnum = entry / bufentries;
+		offset = entry - bufnum * bufentries;
 		break;
 
 	default:
@@ -197,10 +194,10 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 
 	/* Read a new block of FAT entries into the cache. */
 	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
+		__u32 getsize = FATREADBUFBLOCKS;
 		__u8 *bufptr = mydata->fatbuf;
 		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
+		__u32 startblock = bufnum * FATREADBUFBLOCKS;
 
 		if (startblock + getsize > fatlength)
 			getsize = fatlength - startblock;
@@ -322,6 +319,117 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Cluster chain of the last file read, as runs of consecutive clusters.
+ * It is built once per file and kept across reads (fs_read() closes the
+ * filesystem after each call), so that reading a file in several pieces
+ * does not walk the FAT again each time. It is dropped once anything is
+ * written to the device, or the medium changes (see blk_invalidate()).
+ */
+struct fat_extent {
+	__u32 clust;		/* First cluster of the run */
+	__u32 count;		/* Number of clusters in the run */
+};
+
+static struct {
+	struct blk_desc *dev;	/* Device and partition of the file */
+	unsigned long change_count;	/* dev->change_count when built */
+	unsigned char hwpart;
+	lbaint_t part_start;
+	__u8 volume_id[4];	/* Serial number of the volume */
+	__u32 start;		/* First cluster of the file */
+	__u32 size;		/* Size of the file in bytes */
+	int nr;			/* Number of runs */
+	int max;		/* Number of runs allocated */
+	struct fat_extent *ext;
+} fat_extents;
+
+static void fat_extents_invalidate(void)
+{
+	fat_extents.dev = NULL;
+	fat_extents.nr = 0;
+}
+
+static int fat_extents_add(__u32 clust)
+{
+	struct fat_extent *ext;
+
+	if (fat_extents.nr) {
+		ext = &fat_extents.ext[fat_extents.nr - 1];
+		if (ext->clust + ext->count == clust) {
+			ext->count++;
+			return 0;
+		}
+	}
+
+	if (fat_extents.nr == fat_extents.max) {
+		int max = fat_extents.max ? fat_extents.max * 2 : 16;
+
+		ext = realloc(fat_extents.ext, max * sizeof(*ext));
+		if (!ext)
+			return -1;
+		fat_extents.ext = ext;
+		fat_extents.max = max;
+	}
+	ext = &fat_extents.ext[fat_extents.nr++];
+	ext->clust = clust;
+	ext->count = 1;
+
+	return 0;
+}
+
+/*
+ * Build the run list for the file associated with 'dentptr', unless it is
+ * already cached. A chain that ends early (invalid FAT entry) gives a
+ * shorter list, and reading stops there.
+ * Return 0 on success, -1 if out of memory.
+ */
+static int fat_map_file(fsdata *mydata, dir_entry *dentptr,
+			const __u8 *volume_id)
+{
+	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
+	__u32 start = START(dentptr);
+	__u32 size = FAT2CPU32(dentptr->size);
+	__u32 clust, nclust, n;
+
+	if (fat_extents.dev == cur_dev &&
+	    fat_extents.change_count == cur_dev->change_count &&
+	    fat_extents.hwpart == cur_dev->hwpart &&
+	    fat_extents.part_start == cur_part_info.start &&
+	    !memcmp(fat_extents.volume_id, volume_id, 4) &&
+	    fat_extents.start == start && fat_extents.size == size)
+		return 0;
+
+	fat_extents_invalidate();
+	nclust = size ? (size - 1) / bytesperclust + 1 : 0;
+	clust = start;
+	for (n = 0; n < nclust; n++) {
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", clust);
+			debug("Invalid FAT entry\n");
+			break;
+		}
+		if (fat_extents_add(clust)) {
+			fat_extents_invalidate();
+			return -1;
+		}
+		if (n + 1 < nclust)
+			clust = get_fatent(mydata, clust);
+	}
+
+	fat_extents.dev = cur_dev;
+	fat_extents.change_count = cur_dev->change_count;
+	fat_extents.hwpart = cur_dev->hwpart;
+	fat_extents.part_start = cur_part_info.start;
+	memcpy(fat_extents.volume_id, volume_id, 4);
+	fat_extents.start = start;
+	fat_extents.size = size;
+	debug("FAT: file at cluster %u maps to %d runs\n", start,
+	      fat_extents.nr);
+
+	return 0;
+}
+
 /*
  * Read at most 'maxsize' bytes from 'pos' in the file associated with 'dentptr'
  * into 'buffer'.
@@ -330,14 +438,18 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 __u8 get_contents_vfatname_block[MAX_CLUSTSIZE]
 	__aligned(ARCH_DMA_MINALIGN);
 
-static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
-			__u8 *buffer, loff_t maxsize, loff_t *gotsize)
+static int get_contents(fsdata *mydata, dir_entry *dentptr,
+			const __u8 *volume_id, loff_t pos, __u8 *buffer,
+			loff_t maxsize, loff_t *gotsize)
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_extent *ext;
+	__u32 clust, count;
 	loff_t actsize;
+	u64 skip;
+	__u32 offset;
+	int i;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -352,92 +464,64 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
-
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize += bytesperclust;
+	if (fat_map_file(mydata, dentptr, volume_id)) {
+		printf("Error: allocating memory\n");
+		return -1;
 	}
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
-
-	/* align to beginning of next cluster if any */
-	if (pos) {
-		actsize = min(filesize, (loff_t)bytesperclust);
-		if (get_cluster(mydata, curclust, get_contents_vfatname_block,
-				(int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, get_contents_vfatname_block + pos, actsize);
-		*gotsize += actsize;
-		if (!filesize)
-			return 0;
-		buffer += actsize;
+	/* index of the cluster at pos, and offset of pos in it */
+	skip = pos;
+	offset = do_div(skip, bytesperclust);
+	filesize -= pos;
 
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
+	for (i = 0; i < fat_extents.nr && filesize; i++) {
+		ext = &fat_extents.ext[i];
+		if (skip >= ext->count) {
+			skip -= ext->count;
+			continue;
 		}
-	}
-
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				debug("Invalid FAT entry\n");
-				return 0;
+		clust = ext->clust + skip;
+		count = ext->count - skip;
+		skip = 0;
+
+		/* a partial first cluster goes through a bounce buffer */
+		if (offset) {
+			actsize = min(filesize + offset, (loff_t)bytesperclust);
+			if (get_cluster(mydata, clust,
+					get_contents_vfatname_block,
+					(int)actsize) != 0) {
+				printf("Error reading cluster\n");
+				return -1;
 			}
-			endclust = newclust;
-			actsize += bytesperclust;
+			actsize -= offset;
+			memcpy(buffer, get_contents_vfatname_block + offset,
+			       actsize);
+			*gotsize += actsize;
+			filesize -= actsize;
+			buffer += actsize;
+			offset = 0;
+			clust++;
+			if (!--count)
+				continue;
 		}
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		/* the rest of the run is contiguous, read it in one go */
+		actsize = min(filesize, (loff_t)count * bytesperclust);
+		if (!actsize)
+			break;
+		if (get_cluster(mydata, clust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	if (filesize)
+		debug("Invalid FAT entry\n");
+
+	return 0;
 }
 
 /*
@@ -876,7 +960,7 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 	}
 
 	mydata->fatbufnum = -1;
-	mydata->fatbuf = memalign(ARCH_DMA_MINALIGN, FATBUFSIZE);
+	mydata->fatbuf = memalign(ARCH_DMA_MINALIGN, FATREADBUFSIZE);
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
 		return -1;
@@ -1225,7 +1309,8 @@ rootdir_done:
 		*size = FAT2CPU32(dentptr->size);
 		ret = 0;
 	} else {
-		ret = get_contents(mydata, dentptr, pos, buffer, maxsize, size);
+		ret = get_contents(mydata, dentptr, volinfo.volume_id, pos,
+				   buffer, maxsize, size);
 	}
 	debug("Size: %u, got: %llu\n", FAT2CPU32(dentptr->size), *size);
 
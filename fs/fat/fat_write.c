@@ -973,6 +973,9 @@ static int do_fat_write(const char *filename, void *buffer, loff_t size,
 	char l_filename[VFAT_MAXLEN_BYTES];
 
 	*actwrite = size;
+
+	/* the file being written may be the one whose chain is cached */
+	fat_extents_invalidate();
 	dir_curclust = 0;
 
 	if (read_bootsectandvi(&bs, &volinfo, &mydata->fatsize)) {
@@ -79,6 +79,9 @@ typedef struct global_data {
 	struct udevice	*dm_root;	/* Root instance for Driver Model */
 	struct udevice	*dm_root_f;	/* Pre-relocation root instance */
 	struct list_head uclass_root;	/* Head of core tree */
+	struct dm_index	*dm_index;	/* Uclass/device lookup tables */
+	struct dm_bind_state *dm_bind;	/* Driver compatible string hash */
+	uint dm_probe_count;		/* Number of devices probed */
 #endif
 #ifdef CONFIG_TIMER
 	struct udevice	*timer;	/* Timer instance for Driver Model */
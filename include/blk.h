@@ -62,6 +62,8 @@ struct blk_desc {
 	char		vendor[40+1];	/* IDE model, SCSI Vendor */
 	char		product[20+1];	/* IDE Serial no, SCSI product */
 	char		revision[8+1];	/* firmware revision */
+	/* bumped by blk_invalidate() when the contents may have changed */
+	unsigned long	change_count;
 #ifdef CONFIG_BLK
 	/*
 	 * For now we have a few functions which take struct blk_desc as a
@@ -89,38 +91,34 @@ struct blk_desc {
 #define PAD_TO_BLOCKSIZE(size, blk_desc) \
 	(PAD_SIZE(size, blk_desc->blksz))
 
-#ifdef CONFIG_BLOCK_CACHE
-/**
- * blkcache_read() - attempt to read a set of blocks from cache
- *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
- * @param start - starting block number
- * @param blkcnt - number of blocks to read
- * @param blksz - size in bytes of each block
- * @param buf - buffer to contain cached data
- *
- * @return - '1' if block returned from cache, '0' otherwise.
+/*
+ * blkcache_read_fn - read blocks from the underlying device, with the same
+ * conventions as blk_dread()
  */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
+typedef unsigned long (*blkcache_read_fn)(struct blk_desc *block_dev,
+					  lbaint_t start, lbaint_t blkcnt,
+					  void *buffer);
 
+#ifdef CONFIG_BLOCK_CACHE
 /**
- * blkcache_fill() - make data read from a block device available
- * to the block cache
+ * blkcache_read() - read a set of blocks through the block cache
  *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
+ * Any leading part of the request that is in the cache is copied from
+ * there. The rest is read from the device using @read, widened to whole
+ * cache entries (plus read-ahead on sequential access) so that following
+ * nearby reads can be satisfied from the cache.
+ *
+ * @param block_dev - block device to read from
  * @param start - starting block number
- * @param blkcnt - number of blocks available
- * @param blksz - size in bytes of each block
- * @param buf - buffer containing data to cache
+ * @param blkcnt - number of blocks to read
+ * @param buffer - buffer to contain the data
+ * @param read - function used to read blocks missing from the cache
  *
+ * @return - number of blocks read, or -ve error number
  */
-void blkcache_fill(int iftype, int dev,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer);
+unsigned long blkcache_read(struct blk_desc *block_dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer,
+			    blkcache_read_fn read);
 
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
@@ -134,20 +132,35 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @param blocks - blocks per entry, rounded down to a power of two
+ * @param entries - maximum entries in cache, 0 to disable the cache
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
 
+/**
+ * blkcache_configure_budget() - configure block cache memory use
+ *
+ * @param max_bytes - maximum bytes of cached data
+ * @param readahead - blocks to read ahead when access is sequential
+ */
+void blkcache_configure_budget(unsigned long max_bytes, unsigned readahead);
+
 /*
  * statistics of the block cache
  */
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
+	unsigned partial_hits; /* reads partly satisfied from the cache */
+	unsigned readaheads; /* sequential misses which read ahead */
+	unsigned dev_reads; /* read requests issued to devices */
+	unsigned long dev_blocks; /* blocks read from devices */
 	unsigned entries; /* current entry count */
+	unsigned long bytes; /* current cached bytes */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned long max_bytes;
+	unsigned readahead; /* read-ahead in blocks */
 };
 
 /**
@@ -159,24 +172,57 @@ void blkcache_stats(struct block_cache_stats *stats);
 
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline unsigned long blkcache_read(struct blk_desc *block_dev,
+					  lbaint_t start, lbaint_t blkcnt,
+					  void *buffer, blkcache_read_fn read)
 {
-	return 0;
+	return read(block_dev, start, blkcnt, buffer);
 }
 
-static inline void blkcache_fill(int iftype, int dev,
-				 lbaint_t start, lbaint_t blkcnt,
-				 unsigned long blksz, void const *buffer) {}
-
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
 
+/**
+ * blk_invalidate() - note that the contents of a block device have changed
+ *
+ * This is called on a write, an erase or when the medium may have been
+ * changed. It discards the block cache for the device and bumps
+ * change_count, so that filesystems know that what they remember about
+ * the device is stale.
+ *
+ * @param block_dev - block device which changed
+ */
+static inline void blk_invalidate(struct blk_desc *block_dev)
+{
+	block_dev->change_count++;
+	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+}
+
 #ifdef CONFIG_BLK
+#include <linux/list.h>
+
 struct udevice;
 
+/**
+ * struct blk_req - a queued block read request
+ *
+ * @start:	Start block number to read (0=first)
+ * @blkcnt:	Number of blocks to read
+ * @buffer:	Destination buffer for data read
+ * @actual:	Number of blocks read so far
+ * @status:	-EINPROGRESS until the request completes, then 0 or -ve error
+ * @node:	For use by the device while the request is queued
+ */
+struct blk_req {
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	lbaint_t actual;
+	int status;
+	struct list_head node;
+};
+
 /* Operations on block devices */
 struct blk_ops {
 	/**
@@ -235,6 +281,30 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+	/**
+	 * submit() - queue a read request (optional)
+	 *
+	 * The device starts the request as soon as earlier ones allow and
+	 * completes it from poll(). On return req->status is -EINPROGRESS,
+	 * or the final status if the request already completed.
+	 *
+	 * @dev:	Device to read from
+	 * @req:	Request to queue, which must stay valid until complete
+	 * @return 0 if queued, -ve on error (the request is not queued)
+	 */
+	int (*submit)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * poll() - make progress on queued requests (optional)
+	 *
+	 * Completes transfers which have finished and starts the next one.
+	 * This does not wait for the hardware.
+	 *
+	 * @dev:	Device to poll
+	 * @return number of requests still outstanding, or -ve on error
+	 */
+	int (*poll)(struct udevice *dev);
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
@@ -252,6 +322,35 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_submit() - queue a read request on a block device
+ *
+ * Devices without a request queue complete the request synchronously
+ * through blk_dread().
+ *
+ * @block_dev:	Block device to read from
+ * @req:	Request, with start, blkcnt and buffer filled in
+ * @return 0 if OK, -ve on error
+ */
+int blk_submit(struct blk_desc *block_dev, struct blk_req *req);
+
+/**
+ * blk_poll() - make progress on queued requests without waiting
+ *
+ * @block_dev:	Block device to poll
+ * @return number of requests still outstanding, or -ve on error
+ */
+int blk_poll(struct blk_desc *block_dev);
+
+/**
+ * blk_wait() - wait for a queued request to complete
+ *
+ * @block_dev:	Block device the request was submitted to
+ * @req:	Request to wait for
+ * @return 0 if the request completed successfully, -ve on error
+ */
+int blk_wait(struct blk_desc *block_dev, struct blk_req *req);
+
 /**
  * blk_get_device() - Find and probe a block device ready for use
  *
@@ -375,35 +474,26 @@ int blk_select_hwpart(struct udevice *dev, int hwpart);
 static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
-	ulong blks_read;
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
-		return blkcnt;
-
 	/*
 	 * We could check if block_read is NULL and return -ENOSYS. But this
 	 * bloats the code slightly (cause some board to fail to build), and
 	 * it would be an error to try an operation that does not exist.
 	 */
-	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
-
-	return blks_read;
+	return blkcache_read(block_dev, start, blkcnt, buffer,
+			     block_dev->block_read);
 }
 
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_invalidate(block_dev);
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
 static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_invalidate(block_dev);
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
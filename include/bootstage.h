@@ -198,6 +198,8 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ACCUM_SCSI,
 	BOOTSTAGE_ID_ACCUM_SPI,
 	BOOTSTAGE_ID_ACCUM_DECOMP,
+	BOOTSTAGE_ID_ACCUM_DM_F,
+	BOOTSTAGE_ID_ACCUM_DM_R,
 	BOOTSTAGE_ID_FPGA_INIT,
 
 	/* a few spare for the user, from here */
@@ -206,6 +208,13 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ALLOC,
 };
 
+/* Sizes of the strings stored with each bootstage span */
+#define BOOTSTAGE_SPAN_CAT_LEN		16
+#define BOOTSTAGE_SPAN_NAME_LEN		32
+
+/* Number of spans which can be recorded before relocation */
+#define BOOTSTAGE_SPAN_EARLY		32
+
 /*
  * Return the time since boot in microseconds, This is needed for bootstage
  * and should be defined in CPU- or board-specific code. If undefined then
@@ -299,6 +308,54 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * Mark the start of a span of time
+ *
+ * Spans may be nested, as long as each one is ended with
+ * bootstage_span_end() before the one containing it. Nothing is recorded
+ * until the first bootstage mark, since the timer may not be running
+ * before that.
+ *
+ * @param cat	Category of the span, e.g. "initcall" or a uclass name
+ * @param name	Name of the span (copied, and truncated if too long)
+ * @return span number to pass to bootstage_span_end(), or -1 if the span
+ *		was not recorded
+ */
+int bootstage_span_begin(const char *cat, const char *name);
+
+/**
+ * Mark the start of a span of time named after an address
+ *
+ * This is bootstage_span_begin() for spans without a printable name, such
+ * as initcalls.
+ *
+ * @param cat	Category of the span
+ * @param addr	Address to use as the name
+ * @return span number to pass to bootstage_span_end(), or -1
+ */
+int bootstage_span_begin_addr(const char *cat, const void *addr);
+
+/**
+ * Mark the end of a span of time
+ *
+ * @param span	Span number returned by bootstage_span_begin(), ignored
+ *		if -1
+ */
+void bootstage_span_end(int span);
+
+/**
+ * Export the bootstage marks and spans as Chrome trace-event JSON
+ *
+ * Marks become instant events and spans complete ("X") events, with times
+ * in microseconds. Spans which have not ended yet end at the current time.
+ *
+ * @param base	Base address of memory buffer
+ * @param size	Size of memory buffer
+ * @return size of the JSON text; if larger than @size, the buffer was too
+ *		small and its contents are incomplete
+ */
+int bootstage_export(void *base, int size);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
@@ -381,6 +438,21 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline int bootstage_span_begin(const char *cat, const char *name)
+{
+	return -1;
+}
+
+static inline int bootstage_span_begin_addr(const char *cat,
+					    const void *addr)
+{
+	return -1;
+}
+
+static inline void bootstage_span_end(int span)
+{
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
@@ -814,6 +814,18 @@ int gzwrite(unsigned char *src, int len,
 
 /* lib/lz4_wrapper.c */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
+/* Decompress one independent block of an LZ4 frame */
+int ulz4_block(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+/* lib/zstd/zstd.c */
+/*
+ * Decompress all the zstd frames in src. On entry *dstn is the size of dst,
+ * on exit the number of bytes decompressed. Returns 0 if OK, -ENOSPC if dst
+ * is too small (leaving *dstn alone), else -ve error with *dstn set to 0.
+ */
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn);
+/* Convert a zstd result code into 0 or -ve errno */
+int zstd_errno(size_t code);
 
 /* lib/qsort.c */
 void qsort(void *base, size_t nmemb, size_t size,
@@ -76,6 +76,10 @@
 #define CONFIG_ENV_SIZE		8192
 #define CONFIG_ENV_IS_NOWHERE
 
+/* The DFU back end only, for 'ut dfu': there is no USB gadget */
+#define CONFIG_USB_FUNCTION_DFU
+#define CONFIG_DFU_RAM
+
 /* SPI - enable all SPI flash types for testing purposes */
 #define CONFIG_CMD_SF_TEST
 
@@ -122,6 +126,7 @@
 #define CONFIG_BOOTP_SEND_HOSTNAME
 #define CONFIG_BOOTP_SERVERIP
 #define CONFIG_IP_DEFRAG
+#define CONFIG_NET_MAXDEFRAG	32768
 
 /* Can't boot elf images */
 
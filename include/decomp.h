@@ -0,0 +1,152 @@
+/*
+ * Streaming decompression
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __DECOMP_H
+#define __DECOMP_H
+
+struct decomp_ops;
+
+/**
+ * typedef decomp_out_t - Receives decompressed data
+ *
+ * @priv:	Private pointer passed to decomp_init()
+ * @buf:	Decompressed data, only valid until this returns
+ * @len:	Number of bytes in @buf
+ * @return 0 if OK, -ve on error, which is returned by decomp_feed()
+ */
+typedef int (*decomp_out_t)(void *priv, const void *buf, size_t len);
+
+/**
+ * struct decomp_stream - An incremental decompressor
+ *
+ * Compressed data is passed in with decomp_feed() as it arrives, in pieces
+ * of any size. Decompressed data either goes to an output function, in
+ * pieces no larger than the format's window, or to a single buffer.
+ *
+ * With an output function the memory used is bounded by the format: 32KB
+ * plus a chunk buffer for gzip, the block size for bzip2 (100-900KB per
+ * level, four times that in fast mode) and lz4 frames (64KB-4MB), the
+ * dictionary size for lzma, or the uncompressed size if smaller, and the
+ * window size for zstd (up to 8MB at the standard levels) plus about 100KB.
+ * With a buffer the buffer is used as the window where possible.
+ *
+ * @comp:	Compression type (IH_COMP_...)
+ * @out:	Output function, or NULL if using @dst
+ * @priv:	Private pointer for @out
+ * @dst:	Output buffer, if @out is NULL
+ * @dst_size:	Size of @dst in bytes
+ * @total_in:	Number of compressed bytes fed so far
+ * @total_out:	Number of decompressed bytes produced so far
+ * @mem:	Bytes of memory allocated by the stream now
+ * @peak_mem:	Largest value @mem has had
+ * @done:	true once the end of the compressed stream has been seen
+ * @err:	First error seen, returned by later calls
+ * @ops:	Private: decompressor for @comp
+ * @state:	Private: decompressor state
+ * @chunk:	Private: output buffer used with @out, if needed
+ */
+struct decomp_stream {
+	int comp;
+	decomp_out_t out;
+	void *priv;
+	u8 *dst;
+	size_t dst_size;
+	u64 total_in;
+	u64 total_out;
+	size_t mem;
+	size_t peak_mem;
+	bool done;
+	int err;
+
+	const struct decomp_ops *ops;
+	void *state;
+	u8 *chunk;
+};
+
+/**
+ * decomp_detect() - Work out the compression type from the first bytes
+ *
+ * @buf:	Start of the data
+ * @len:	Number of bytes available at @buf
+ * @return compression type (IH_COMP_...) which decomp_init() supports,
+ * or IH_COMP_NONE if not recognised
+ */
+int decomp_detect(const void *buf, size_t len);
+
+/**
+ * decomp_init() - Start decompressing to an output function
+ *
+ * @dsp:	Returns the new stream, to be freed with decomp_free()
+ * @comp:	Compression type (IH_COMP_...)
+ * @out:	Function to receive the decompressed data
+ * @priv:	Private pointer for @out
+ * @return 0 if OK, -EPROTONOSUPPORT if @comp is not supported, -ENOMEM if
+ * out of memory
+ */
+int decomp_init(struct decomp_stream **dsp, int comp, decomp_out_t out,
+		void *priv);
+
+/**
+ * decomp_init_buf() - Start decompressing to a buffer
+ *
+ * @dsp:	Returns the new stream, to be freed with decomp_free()
+ * @comp:	Compression type (IH_COMP_...)
+ * @dst:	Buffer for the decompressed data
+ * @size:	Size of @dst in bytes
+ * @return 0 if OK, -EPROTONOSUPPORT if @comp is not supported, -ENOMEM if
+ * out of memory
+ */
+int decomp_init_buf(struct decomp_stream **dsp, int comp, void *dst,
+		    size_t size);
+
+/**
+ * decomp_feed() - Decompress some more data
+ *
+ * All of @buf is used. Anything after the end of the compressed stream is
+ * counted in @total_in but otherwise ignored, so padding is harmless.
+ *
+ * @ds:		Stream to feed
+ * @buf:	Next compressed data
+ * @len:	Number of bytes in @buf
+ * @return 0 if OK, -EINVAL or -EPROTONOSUPPORT if the data is corrupt or
+ * uses an unsupported feature, -ENOSPC if the output buffer is full,
+ * -ENOMEM if out of memory, or an error from the output function
+ */
+int decomp_feed(struct decomp_stream *ds, const void *buf, size_t len);
+
+/**
+ * decomp_flush() - Finish decompressing, once all the input is fed
+ *
+ * @ds:		Stream to finish
+ * @return 0 if the whole compressed stream was decompressed, -ENODATA if
+ * it was cut short, -ENOSPC if the output buffer was too small, or the
+ * error from an earlier decomp_feed()
+ */
+int decomp_flush(struct decomp_stream *ds);
+
+/**
+ * decomp_free() - Free a stream and everything it allocated
+ *
+ * @ds:		Stream to free, may be NULL
+ */
+void decomp_free(struct decomp_stream *ds);
+
+/**
+ * decomp_buf() - Decompress a buffer in one go
+ *
+ * @comp:	Compression type (IH_COMP_...)
+ * @src:	Compressed data
+ * @src_len:	Size of @src in bytes. It is fine to give a larger value if
+ *		the size is not known, since decompression stops at the end
+ *		of the compressed stream
+ * @dst:	Buffer for the decompressed data
+ * @dst_lenp:	Size of @dst on entry, number of bytes decompressed on exit
+ * @return 0 if OK, -ve error as for decomp_feed() and decomp_flush()
+ */
+int decomp_buf(int comp, const void *src, size_t src_len, void *dst,
+	       size_t *dst_lenp);
+
+#endif
@@ -95,6 +95,8 @@ struct sf_internal_data {
 #define DFU_MANIFEST_POLL_TIMEOUT	DFU_DEFAULT_POLL_TIMEOUT
 #endif
 
+struct decomp_stream;
+
 struct dfu_entity {
 	char			name[DFU_NAME_SIZE];
 	int                     alt;
@@ -137,6 +139,10 @@ struct dfu_entity {
 
 	u32 bad_skip;	/* for nand use */
 
+	/* decompression of the incoming data, see dfu_decompress */
+	struct decomp_stream *decomp;
+	long d_len;
+
 	unsigned int inited:1;
 };
 
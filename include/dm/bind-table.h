@@ -0,0 +1,69 @@
+/*
+ * Table of device tree nodes, resolved at build time for binding devices
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _DM_BIND_TABLE_H
+#define _DM_BIND_TABLE_H
+
+/*
+ * With CONFIG_OF_BIND_TABLE the build runs tools/fdtbind over the board's
+ * device tree and links in the resulting table (dts/dt-bind.c). Binding
+ * devices then walks this table instead of the device tree: the status and
+ * u-boot,dm-pre-reloc properties are already decoded, and each compatible
+ * string is replaced by its CRC32, which is looked up in a hash of the
+ * drivers' compatible strings. The table is only used if the device tree
+ * in use is the one it was built from.
+ *
+ * This file is also used by the host tool, so only uses standard types.
+ */
+
+/* Flags for struct dm_bind_node */
+#define DM_BIND_ENABLED		(1 << 0)	/* status is absent or "okay" */
+#define DM_BIND_PRE_RELOC	(1 << 1)	/* has u-boot,dm-pre-reloc */
+
+/**
+ * struct dm_bind_node - Information about a device tree node
+ *
+ * Nodes are in the order they appear in the device tree, so in order of
+ * increasing offset. Node 0 is the root node.
+ *
+ * @offset:	Offset of the node in the device tree
+ * @first_child: Index of the node's first subnode, or -1 if none
+ * @next_sibling: Index of the parent's next subnode, or -1 if none
+ * @flags:	DM_BIND_... flags
+ * @compat_start: Index of the node's first compatible string CRC in the
+ *		table's @compat array
+ * @compat_count: Number of compatible strings in the node
+ */
+struct dm_bind_node {
+	int offset;
+	int first_child;
+	int next_sibling;
+	unsigned short flags;
+	unsigned short compat_start;
+	unsigned short compat_count;
+};
+
+/**
+ * struct dm_bind_table - Binding table for a device tree
+ *
+ * @fdt_size:	Total size of the device tree this was built from
+ * @fdt_crc:	CRC32 of its structure block followed by its strings block
+ * @node_count:	Number of nodes in @node
+ * @node:	Information about each node
+ * @compat:	CRC32 of each compatible string, excluding the terminator
+ */
+struct dm_bind_table {
+	unsigned int fdt_size;
+	unsigned int fdt_crc;
+	int node_count;
+	const struct dm_bind_node *node;
+	const unsigned int *compat;
+};
+
+/* Generated by tools/fdtbind */
+extern const struct dm_bind_table dm_bind_table;
+
+#endif
@@ -85,6 +85,16 @@ struct driver_info;
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @seq_node: Used by driver model to hash the device on @seq
+ * @req_seq_node: Used by driver model to hash the device on @req_seq
+ * @of_offset_node: Used by driver model to hash the device on @of_offset
+ * @phandle_node: Used by driver model to hash the device on its phandle
+ * @index_order: Used by driver model to return the first of several matching
+ *		devices, as a walk of the uclass would
+ * @probe_order: Position of this device in the order in which probes
+ *		finished, starting at 1 (0 if not probed)
+ * @probe_us: Time taken to probe this device in microseconds, including any
+ *		devices that it caused to be probed
  */
 struct udevice {
 	const struct driver *driver;
@@ -108,6 +118,17 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct hlist_node seq_node;
+	struct hlist_node req_seq_node;
+	struct hlist_node of_offset_node;
+	struct hlist_node phandle_node;
+	ulong index_order;
+#endif
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	uint probe_order;
+	ulong probe_us;
+#endif
 };
 
 /* Maximum sequence number supported */
@@ -60,6 +60,37 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
 		   struct udevice **devp);
 
+struct dm_bind_table;
+
+/**
+ * lists_bind_table() - Get the binding table for a device tree
+ *
+ * This checks (once for each device tree address) that the device tree is
+ * the one that the build-time binding table was generated from. A device
+ * tree which is changed in place after this is not checked again.
+ *
+ * @blob: Device tree
+ * @return the binding table, or NULL if it cannot be used with @blob
+ */
+const struct dm_bind_table *lists_bind_table(const void *blob);
+
+/**
+ * lists_bind_table_node() - Bind a device for a node in the binding table
+ *
+ * This does the same as lists_bind_fdt(), but uses the information in the
+ * table instead of reading the node's compatible strings.
+ *
+ * @parent: parent device (root)
+ * @blob: device tree blob, as checked by lists_bind_table()
+ * @table: binding table
+ * @idx: index of the node in the table
+ * @devp: if non-NULL, returns a pointer to the bound device
+ * @return 0 if OK (whether or not a driver was found), -ve on error
+ */
+int lists_bind_table_node(struct udevice *parent, const void *blob,
+			  const struct dm_bind_table *table, int idx,
+			  struct udevice **devp);
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
@@ -10,6 +10,9 @@
 #ifndef _DM_UCLASS_INTERNAL_H
 #define _DM_UCLASS_INTERNAL_H
 
+#include <dm/uclass-id.h>
+#include <linux/list.h>
+
 /**
  * uclass_get_device_tail() - handle the end of a get_device call
  *
@@ -193,4 +196,93 @@ struct uclass *uclass_find(enum uclass_id key);
  */
 int uclass_destroy(struct uclass *uc);
 
+/* Number of hash buckets in each of the device indexes (as a power of 2) */
+#define DM_INDEX_HASH_BITS	6
+#define DM_INDEX_HASH_SIZE	(1 << DM_INDEX_HASH_BITS)
+
+/**
+ * struct dm_lookup_stats - Counts the work done by uclass/device lookups
+ *
+ * @uclass_finds: Number of calls to uclass_find()
+ * @uclass_steps: Number of uclasses looked at by those calls
+ * @dev_finds: Number of device lookups by seq, req_seq, offset or phandle
+ * @dev_steps: Number of devices looked at by those lookups
+ */
+struct dm_lookup_stats {
+	ulong uclass_finds;
+	ulong uclass_steps;
+	ulong dev_finds;
+	ulong dev_steps;
+};
+
+/**
+ * struct dm_index - Lookup tables for uclasses and devices
+ *
+ * This is allocated by dm_init() after relocation. Before that (and in SPL)
+ * all lookups walk the uclass and device lists.
+ *
+ * The device tables are hashed on the uclass ID and the key. The seq and
+ * req_seq tables are exact. Drivers may change of_offset after binding a
+ * device, so a lookup by offset or phandle which misses falls back to
+ * walking the uclass's devices, and rehashes any device it finds.
+ *
+ * @uclass: Uclass for each ID, or NULL if not created yet
+ * @seq: Devices hashed on dev->seq (active devices only)
+ * @req_seq: Devices hashed on dev->req_seq
+ * @of_offset: Devices hashed on dev->of_offset
+ * @phandle: Devices hashed on the phandle of their device tree node
+ * @order: Bind order given to the next device
+ * @disabled: true to ignore the tables and walk the lists (for comparison)
+ * @stats: Lookup statistics
+ */
+struct dm_index {
+	struct uclass *uclass[UCLASS_COUNT];
+	struct hlist_head seq[DM_INDEX_HASH_SIZE];
+	struct hlist_head req_seq[DM_INDEX_HASH_SIZE];
+	struct hlist_head of_offset[DM_INDEX_HASH_SIZE];
+	struct hlist_head phandle[DM_INDEX_HASH_SIZE];
+	ulong order;
+	bool disabled;
+	struct dm_lookup_stats stats;
+};
+
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/**
+ * dm_index_init() - Set up empty lookup tables
+ *
+ * This does nothing before relocation. Any existing tables are cleared.
+ *
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int dm_index_init(void);
+
+/**
+ * dm_index_free() - Free the lookup tables
+ */
+void dm_index_free(void);
+
+/**
+ * uclass_index_device() - Hash a device into the lookup tables
+ *
+ * This is called when a device is bound, probed or removed, to pick up
+ * changes to its seq, req_seq and device tree node. It is safe to call
+ * more than once.
+ *
+ * @dev:	Pointer to the device
+ */
+void uclass_index_device(struct udevice *dev);
+
+/**
+ * uclass_unindex_device() - Remove a device from the lookup tables
+ *
+ * @dev:	Pointer to the device
+ */
+void uclass_unindex_device(struct udevice *dev);
+#else
+static inline int dm_index_init(void) { return 0; }
+static inline void dm_index_free(void) {}
+static inline void uclass_index_device(struct udevice *dev) {}
+static inline void uclass_unindex_device(struct udevice *dev) {}
+#endif
+
 #endif
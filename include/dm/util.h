@@ -39,6 +39,12 @@ void dm_dump_all(void);
 /* Dump out a list of uclasses and their devices */
 void dm_dump_uclass(void);
 
+/*
+ * Dump out the probed devices in the order they were probed, with the time
+ * each took
+ */
+void dm_dump_probe_stats(void);
+
 #ifdef CONFIG_DEBUG_DEVRES
 /* Dump out a list of device resources */
 void dm_dump_devres(void);
@@ -33,6 +33,15 @@
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
 #define FAT32BUFSIZE	(FATBUFSIZE/4)
 
+/*
+ * Reading only ever follows cluster chains, so the read path uses a larger
+ * FAT window than the write path, which has to write back whole windows.
+ * Must be a multiple of 3 so that a window holds a whole number of FAT12
+ * entries.
+ */
+#define FATREADBUFBLOCKS	96
+#define FATREADBUFSIZE	(mydata->sect_size * FATREADBUFBLOCKS)
+
 
 /* Filesystem identifiers */
 #define FAT12_SIGN	"FAT12   "
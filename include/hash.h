@@ -92,6 +92,18 @@ struct hash_algo {
 int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 		 int argc, char * const argv[]);
 
+/**
+ * hash_bench() - Report the throughput of each hash algorithm
+ *
+ * Each algorithm in turn hashes a buffer of the given size repeatedly,
+ * and its throughput is printed in MB/s.
+ *
+ * @size:		Size of the buffer to hash in bytes
+ * @return CMD_RET_SUCCESS, CMD_RET_USAGE if size is 0, or CMD_RET_FAILURE
+ * if the buffer could not be allocated
+ */
+int hash_bench(ulong size);
+
 /**
  * hash_block() - Hash a block according to the requested algorithm
  *
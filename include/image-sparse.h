@@ -9,15 +9,33 @@
 
 #define ROUNDUP(x, y)	(((x) + ((y) - 1)) & ~((y) - 1))
 
+/**
+ * struct sparse_storage - Where a sparse image is stored
+ *
+ * @block_sz:	Block size in bytes
+ * @start:	First block of the partition
+ * @size:	Number of blocks in the partition
+ * @name:	Partition name
+ * @erase_sz:	Erase unit in blocks. Only whole, aligned units are erased
+ * @write:	Writes @size blocks at @offset, returning the number of blocks
+ *		used (which may be more, to skip bad blocks) or -ve error
+ * @erase:	Erases @size blocks at @offset, returning the number of blocks
+ *		erased or -ve error. Optional: set it only if erased blocks
+ *		read back as zero, and FILL chunks of zero are erased rather
+ *		than written. DONT_CARE chunks are never erased
+ */
 typedef struct sparse_storage {
 	unsigned int	block_sz;
 	unsigned int	start;
 	unsigned int	size;
 	const char	*name;
+	unsigned int	erase_sz;
 
 	int	(*write)(struct sparse_storage *storage, void *priv,
 			 unsigned int offset, unsigned int size,
 			 char *data);
+	int	(*erase)(struct sparse_storage *storage, void *priv,
+			 unsigned int offset, unsigned int size);
 } sparse_storage_t;
 
 static inline int is_sparse_image(void *buf)
@@ -31,5 +49,18 @@ static inline int is_sparse_image(void *buf)
 	return 0;
 }
 
+/**
+ * store_sparse_image() - Write an Android sparse image
+ *
+ * Adjacent RAW chunks are written together, which moves their data within
+ * the image, so the image is not valid afterwards.
+ *
+ * @storage:	Where to write the image
+ * @storage_priv: Private data for @storage's functions
+ * @session_id:	0 to start at the beginning of the partition, else carry on
+ *		from the end of the last image
+ * @data:	The image
+ * @return 0 if OK, -ve error
+ */
 int store_sparse_image(sparse_storage_t *storage, void *storage_priv,
 		       unsigned int session_id, void *data);
@@ -260,6 +260,7 @@ struct lmb;
 #define IH_COMP_LZMA		3	/* lzma  Compression Used	*/
 #define IH_COMP_LZO		4	/* lzo   Compression Used	*/
 #define IH_COMP_LZ4		5	/* lz4   Compression Used	*/
+#define IH_COMP_ZSTD		6	/* zstd  Compression Used	*/
 
 #define IH_MAGIC	0x27051956	/* Image Magic Number		*/
 #define IH_NMLEN		32	/* Image Name Length		*/
@@ -970,6 +971,12 @@ void image_set_host_blob(void *host_blob);
 #define IMAGE_ENABLE_BEST_MATCH	0
 #endif
 
+#ifdef CONFIG_FIT_VERIFY_ON_LOAD
+#define IMAGE_ENABLE_VERIFY_ON_LOAD	1
+#else
+#define IMAGE_ENABLE_VERIFY_ON_LOAD	0
+#endif
+
 /* Information passed to the signing routines */
 struct image_sign_info {
 	const char *keydir;		/* Directory conaining keys */
@@ -4,6 +4,84 @@
  * SPDX-License-Identifier:	GPL-2.0+
  */
 
+#ifndef __INITCALL_H
+#define __INITCALL_H
+
 typedef int (*init_fnc_t)(void);
 
 int initcall_run_list(const init_fnc_t init_sequence[]);
+
+/**
+ * struct initcall_task - Work started by an initcall which finishes later
+ *
+ * An initcall which mostly waits for hardware can start the hardware and
+ * then leave a task behind with initcall_task_start(). The task is polled
+ * between the following initcalls (after relocation) until it is done.
+ * Polling is cooperative, so @poll must never wait.
+ *
+ * @name:	Name of the task, for messages and bootstage
+ * @start:	Called once the tasks in @after are done, or NULL. Returns 0
+ *		to go on to @poll, 1 if the task is already done, or -ve on
+ *		error
+ * @poll:	Called repeatedly until it returns something other than
+ *		-EAGAIN: 0 when the task is done, or -ve on error. May be NULL
+ *		if @start does all the work
+ * @after:	NULL-terminated list of tasks which must be done before this
+ *		one starts, or NULL for none. A failed task counts as done.
+ * @state:	Private to the scheduler (INITCALL_TASK_...)
+ * @ret:	Private: result of the task once it is done
+ * @span:	Private: bootstage span for the task
+ * @next:	Private: next task in the list of started tasks
+ */
+struct initcall_task {
+	const char *name;
+	int (*start)(void);
+	int (*poll)(void);
+	struct initcall_task *const *after;
+
+	int state;
+	int ret;
+	int span;
+	struct initcall_task *next;
+};
+
+enum {
+	INITCALL_TASK_IDLE,	/* Not started */
+	INITCALL_TASK_WAITING,	/* Waiting for the tasks in @after */
+	INITCALL_TASK_RUNNING,	/* Being polled */
+	INITCALL_TASK_DONE,	/* Finished, with the result in @ret */
+};
+
+/**
+ * initcall_task_start() - Start a task
+ *
+ * The task runs once the tasks that it depends on are done. Without
+ * CONFIG_INITCALL_TASKS, or before relocation, it is run to completion
+ * before this returns.
+ *
+ * @task:	Task to start. It must not be running already
+ * @return 0 if OK (the task may not be done yet), -ve on error
+ */
+int initcall_task_start(struct initcall_task *task);
+
+/**
+ * initcall_task_poll() - Poll each started task once
+ *
+ * Tasks are polled in the order they were started, so the order of
+ * events does not depend on timing except through the hardware.
+ *
+ * @return number of tasks not done yet
+ */
+int initcall_task_poll(void);
+
+/**
+ * initcall_task_wait() - Wait for a task to be done
+ *
+ * Other tasks are polled too while waiting.
+ *
+ * @task:	Task to wait for, or NULL to wait for all started tasks
+ * @return result of the task (0 if OK), or 0 if @task is NULL
+ */
+int initcall_task_wait(struct initcall_task *task);
+
+#endif
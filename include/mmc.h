@@ -56,8 +56,10 @@
 #define MMC_MODE_8BIT		(1 << 3)
 #define MMC_MODE_SPI		(1 << 4)
 #define MMC_MODE_DDR_52MHz	(1 << 5)
+#define MMC_MODE_CMD23		(1 << 6) /* SET_BLOCK_COUNT before transfers */
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_SCR_CMD23	0x00000002 /* card supports SET_BLOCK_COUNT */
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -325,6 +327,16 @@ struct mmc;
 struct mmc_ops {
 	int (*send_cmd)(struct mmc *mmc,
 			struct mmc_cmd *cmd, struct mmc_data *data);
+	/*
+	 * Optional: issue a data command and return without waiting for the
+	 * data transfer to finish. send_cmd_poll() is then called until it
+	 * returns something other than -EBUSY. Hosts without these are used
+	 * synchronously through send_cmd().
+	 */
+	int (*send_cmd_start)(struct mmc *mmc,
+			      struct mmc_cmd *cmd, struct mmc_data *data);
+	int (*send_cmd_poll)(struct mmc *mmc,
+			     struct mmc_cmd *cmd, struct mmc_data *data);
 	void (*set_ios)(struct mmc *mmc);
 	int (*init)(struct mmc *mmc);
 	int (*getcd)(struct mmc *mmc);
@@ -382,12 +394,20 @@ struct mmc {
 	struct blk_desc block_dev;
 #endif
 	char op_cond_pending;	/* 1 if we are waiting on an op_cond command */
+	uint op_cond_start;	/* get_timer() when op_cond was first sent */
 	char init_in_progress;	/* 1 if we have done mmc_start_init() */
 	char preinit;		/* start init as early as possible */
 	int ddr_mode;
 #ifdef CONFIG_DM_MMC
 	struct udevice *dev;	/* Device for this MMC controller */
 #endif
+#ifdef CONFIG_BLK
+	struct list_head req_queue;	/* struct blk_req waiting or active */
+	struct mmc_cmd req_cmd;		/* command of the active transfer */
+	struct mmc_data req_data;	/* data of the active transfer */
+	lbaint_t req_cur;		/* blocks in the active transfer */
+	bool req_active;		/* a transfer is in progress */
+#endif
 };
 
 struct mmc_hwpart_conf {
@@ -491,6 +511,33 @@ int mmc_start_init(struct mmc *mmc);
  */
 void mmc_set_preinit(struct mmc *mmc, int preinit);
 
+/**
+ * mmc_poll_init() - Continue device initialization without waiting
+ *
+ * This completes an initialization started by mmc_start_init(), like
+ * mmc_init(), but returns -EAGAIN instead of waiting while the card is
+ * still busy powering up.
+ *
+ * @param mmc	Pointer to a MMC device struct
+ * @return 0 if the device is ready, -EAGAIN if it is still busy, other
+ * value on error
+ */
+int mmc_poll_init(struct mmc *mmc);
+
+/**
+ * mmc_do_preinit() - Start initializing the devices marked for preinit
+ *
+ * With MMC_PREINIT_ALL every device is marked, and probed first if needed.
+ */
+void mmc_do_preinit(void);
+
+/**
+ * mmc_poll_preinit() - Continue the initialization started by mmc_do_preinit()
+ *
+ * @return 0 if all devices are done, -EAGAIN if some are still busy
+ */
+int mmc_poll_preinit(void);
+
 #ifdef CONFIG_MMC_SPI
 #define mmc_host_is_spi(mmc)	((mmc)->cfg->host_caps & MMC_MODE_SPI)
 #else
@@ -32,12 +32,19 @@
 
 #ifdef CONFIG_SYS_RX_ETH_BUFFER
 # define PKTBUFSRX	CONFIG_SYS_RX_ETH_BUFFER
+#elif defined(CONFIG_NET_RX_BUFFERS)
+# define PKTBUFSRX	CONFIG_NET_RX_BUFFERS
 #else
 # define PKTBUFSRX	4
 #endif
 
 #define PKTALIGN	ARCH_DMA_MINALIGN
 
+/* Largest UDP payload that CONFIG_IP_DEFRAG can reassemble */
+#ifndef CONFIG_NET_MAXDEFRAG
+#define CONFIG_NET_MAXDEFRAG	16384
+#endif
+
 /* IPv4 addresses are always 32 bits in size */
 struct in_addr {
 	__be32 s_addr;
@@ -68,6 +75,37 @@ typedef void rxhand_f(uchar *pkt, unsigned dport,
 typedef void rxhand_icmp_f(unsigned type, unsigned code, unsigned dport,
 		struct in_addr sip, unsigned sport, uchar *pkt, unsigned len);
 
+/**
+ * struct net_rx_place - Where a protocol stores the data of a UDP datagram
+ *
+ * @dest:	Address at which to store the data
+ * @skip:	Number of bytes of the protocol's own header, at the start of
+ *		the UDP payload, which come before the data
+ * @max:	Most bytes of data to store at @dest; any more, such as
+ *		padding, are not stored
+ */
+struct net_rx_place {
+	uchar *dest;
+	unsigned skip;
+	unsigned max;
+};
+
+/**
+ * A handler which says where the data in a fragmented datagram should go,
+ * so that it can be stored there as each fragment arrives, rather than
+ * being reassembled first and then copied.
+ * @param pkt	pointer to the application packet, in the first fragment
+ * @param dport	destination UDP port
+ * @param sip	source IP address
+ * @param sport	source UDP port
+ * @param len	bytes of the application packet in the first fragment
+ * @param place	returns where to store the data
+ * @return true to store the data at @place, false to reassemble as usual
+ */
+typedef bool rxplace_f(uchar *pkt, unsigned dport, struct in_addr sip,
+		       unsigned sport, unsigned len,
+		       struct net_rx_place *place);
+
 /*
  *	A timeout handler.  Called after time interval has expired.
  */
@@ -112,7 +150,9 @@ enum eth_recv_flags {
  *	 packet buffer in the packetp parameter. If not, return an error or 0 to
  *	 indicate that the hardware receive FIFO is empty. If 0 is returned, the
  *	 network stack will not process the empty packet, but free_pkt() will be
- *	 called if supplied
+ *	 called if supplied. The buffer belongs to the network stack until
+ *	 free_pkt(), so the driver need not copy the packet out of its ring,
+ *	 which is normally net_rx_packets[] (PKTBUFSRX buffers)
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
  *	     when the network stack is finished processing it. This will only be
  *	     called when no error was returned from recv - optional
@@ -128,6 +168,10 @@ enum eth_recv_flags {
  *		    ROM on the board. This is how the driver should expose it
  *		    to the network stack. This function should fill in the
  *		    eth_pdata::enetaddr field - optional
+ * get_rx_dropped: Return the number of packets lost since the last call
+ *		   because no receive buffer was free, e.g. from a missed
+ *		   frame counter, and clear it. Called after each batch of
+ *		   recv() calls - optional
  */
 struct eth_ops {
 	int (*start)(struct udevice *dev);
@@ -140,10 +184,43 @@ struct eth_ops {
 #endif
 	int (*write_hwaddr)(struct udevice *dev);
 	int (*read_rom_hwaddr)(struct udevice *dev);
+	int (*get_rx_dropped)(struct udevice *dev);
 };
 
 #define eth_get_ops(dev) ((struct eth_ops *)(dev)->driver->ops)
 
+/**
+ * struct eth_stats - Counts of what an Ethernet device sent and received
+ *
+ * @rx_packets:	Packets received
+ * @rx_bytes:	Bytes in those packets, including the Ethernet header
+ * @rx_errors:	Errors reported by the driver's recv() method
+ * @rx_dropped:	Packets lost for want of a receive buffer, as reported by
+ *		the driver's get_rx_dropped() method
+ * @tx_packets:	Packets sent
+ * @tx_bytes:	Bytes in those packets, including the Ethernet header
+ * @tx_errors:	Packets the driver's send() method failed to send
+ */
+struct eth_stats {
+	ulong rx_packets;
+	ulong rx_bytes;
+	ulong rx_errors;
+	ulong rx_dropped;
+	ulong tx_packets;
+	ulong tx_bytes;
+	ulong tx_errors;
+};
+
+/**
+ * eth_get_stats() - Get the counts for an Ethernet device
+ *
+ * These are kept from when the device is probed and shown by 'net stats'.
+ *
+ * @dev:	Ethernet device
+ * @return the counts, or NULL if @dev is not probed
+ */
+const struct eth_stats *eth_get_stats(struct udevice *dev);
+
 struct udevice *eth_get_dev(void); /* get the current device */
 /*
  * The devname can be either an exact name given by the driver or device tree
@@ -341,6 +418,7 @@ struct vlan_ethernet_hdr {
 #define PROT_PPP_SES	0x8864		/* PPPoE session messages	*/
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -390,6 +468,41 @@ struct ip_udp_hdr {
 #define IP_UDP_HDR_SIZE		(sizeof(struct ip_udp_hdr))
 #define UDP_HDR_SIZE		(IP_UDP_HDR_SIZE - IP_HDR_SIZE)
 
+/*
+ *	Internet Protocol (IP) + TCP header, without TCP options.
+ *	The sequence and acknowledgement numbers may not be aligned.
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgement number	*/
+	u8		tcp_hlen;	/* Header length, in the top 4 bits */
+	u8		tcp_flags;	/* TCP_FIN etc.			*/
+	u16		tcp_win;	/* Receive window		*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_urg;	/* Urgent pointer		*/
+};
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PSH		0x08
+#define TCP_ACK		0x10
+
 /*
  *	Address Resolution Protocol (ARP) header.
  */
@@ -515,6 +628,8 @@ extern uchar		*net_tx_packet;		/* THE transmit packet */
 extern uchar		*net_rx_packets[PKTBUFSRX]; /* Receive packets */
 extern uchar		*net_rx_packet;		/* Current receive packet */
 extern int		net_rx_packet_len;	/* Current rx packet length */
+/* Where the data in the current UDP packet was placed, or NULL if not */
+extern uchar		*net_rx_placed;
 extern const u8		net_bcast_ethaddr[6];	/* Ethernet broadcast address */
 extern const u8		net_null_ethaddr[6];
 
@@ -527,7 +642,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL
+	TFTPSRV, TFTPPUT, LINKLOCAL, WGET
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -536,6 +651,82 @@ extern u32	net_boot_file_size;
 /* Boot file size in blocks as reported by the DHCP server */
 extern u32	net_boot_file_expected_size_in_blocks;
 
+/* Round-trip times below this go in the first histogram bucket */
+#define NET_RTT_MIN_US		128
+/* Each bucket is twice as wide as the one before; the last has no limit */
+#define NET_RTT_BUCKETS		12
+
+/**
+ * struct net_rtt_hist - Histogram of the time a protocol waited for replies
+ *
+ * @bucket:	Bucket 0 counts times below NET_RTT_MIN_US and bucket n
+ *		times below NET_RTT_MIN_US << n
+ * @count:	Number of times added
+ * @total_us:	Sum of the times, for the mean
+ * @max_us:	Longest time
+ */
+struct net_rtt_hist {
+	ulong bucket[NET_RTT_BUCKETS];
+	ulong count;
+	ulong total_us;
+	ulong max_us;
+};
+
+/**
+ * struct net_proto_stats - How a request/reply protocol has fared
+ *
+ * @timeouts:	Times no reply came in time
+ * @resends:	Requests sent again, on a timeout or to ask for lost data
+ * @rtt:	Time from sending a request to its reply. Requests which were
+ *		sent more than once are left out, since it is not known which
+ *		copy was answered
+ */
+struct net_proto_stats {
+	ulong timeouts;
+	ulong resends;
+	struct net_rtt_hist rtt;
+};
+
+/**
+ * struct net_stats - Counts of what the network stack received and how
+ * its protocols fared
+ *
+ * These are kept from power-on and shown by 'net stats'. Counts for each
+ * Ethernet device are in struct eth_stats.
+ *
+ * @rx_packets:		Packets passed to the network stack by drivers
+ * @rx_dropped:		Packets lost for want of a receive buffer, counted
+ *			only by drivers with a get_rx_dropped() method
+ * @rx_bad:		Packets with a bad length or checksum
+ * @rx_frag_dropped:	IP fragments which could not be reassembled
+ * @rx_placed:		Datagrams whose data went straight to its destination
+ * @rx_placed_bytes:	Bytes of data in those datagrams
+ * @arp:		ARP requests
+ * @tftp:		TFTP data blocks and acknowledgements
+ * @nfs:		NFS requests, of which only READs are timed
+ */
+struct net_stats {
+	ulong rx_packets;
+	ulong rx_dropped;
+	ulong rx_bad;
+	ulong rx_frag_dropped;
+	ulong rx_placed;
+	ulong rx_placed_bytes;
+	struct net_proto_stats arp;
+	struct net_proto_stats tftp;
+	struct net_proto_stats nfs;
+};
+
+extern struct net_stats net_stats;
+
+/**
+ * net_rtt_add() - Add a round-trip time to a histogram
+ *
+ * @hist:	Histogram to update
+ * @us:		Time from request to reply in microseconds
+ */
+void net_rtt_add(struct net_rtt_hist *hist, ulong us);
+
 #if defined(CONFIG_CMD_DNS)
 extern char *net_dns_resolve;		/* The host to resolve  */
 extern char *net_dns_env_var;		/* the env var to put the ip into */
@@ -625,6 +816,7 @@ void net_set_udp_handler(rxhand_f *);	/* Set UDP RX packet handler */
 rxhand_f *net_get_arp_handler(void);	/* Get ARP RX packet handler */
 void net_set_arp_handler(rxhand_f *);	/* Set ARP RX packet handler */
 void net_set_icmp_handler(rxhand_icmp_f *f); /* Set ICMP RX handler */
+void net_set_udp_place_handler(rxplace_f *f); /* Set UDP placement handler */
 void net_set_timeout_handler(ulong, thand_f *);/* Set timeout handler */
 
 /* Network loop state */
@@ -662,6 +854,17 @@ static inline void net_send_packet(uchar *pkt, int len)
 int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport,
 			int sport, int payload_len);
 
+/*
+ * Transmit "net_tx_packet", which already has its Ethernet and IP headers,
+ * performing ARP request if needed (ether will be populated)
+ *
+ * @param ether Raw packet buffer
+ * @param dest IP address to send the packet to
+ * @param len Length of the packet, including the Ethernet header
+ * @return 0 if transmitted, 1 if waiting for an ARP reply
+ */
+int net_send_ip_packet(uchar *ether, struct in_addr dest, int len);
+
 /* Processes a received packet */
 void net_process_received_packet(uchar *in_packet, int len);
 
@@ -75,6 +75,7 @@ int os_open(const char *pathname, int flags);
 #define OS_O_RDWR	2
 #define OS_O_MASK	3	/* Mask for read/write flags */
 #define OS_O_CREAT	0100
+#define OS_O_TRUNC	01000
 
 /**
  * Access to the OS close() system call
@@ -296,4 +297,31 @@ int os_jump_to_image(const void *dest, int size);
  */
 void os_localtime(struct rtc_time *rt);
 
+/**
+ * Set up a context for a cooperative task, using the OS's ucontext
+ *
+ * @param ctxp		Returns the new context
+ * @param stack		Stack to run on, or NULL for the calling context
+ * @param size		Size of the stack in bytes
+ * @param entry		Function to run when the context is first used
+ * @return 0 if OK, -ve on error
+ */
+int os_context_init(void **ctxp, void *stack, size_t size,
+		    void (*entry)(void));
+
+/**
+ * Save the current context in @from and switch to @to
+ *
+ * @param from		Context to save into
+ * @param to		Context to switch to
+ */
+void os_context_switch(void *from, void *to);
+
+/**
+ * Free a context set up by os_context_init()
+ *
+ * @param ctx		Context to free
+ */
+void os_context_free(void *ctx);
+
 #endif
@@ -106,6 +106,18 @@ int stdio_deregister_dev(struct stdio_dev *dev, int force);
 #endif
 struct list_head* stdio_get_list(void);
 struct stdio_dev* stdio_get_by_name(const char* name);
+
+/**
+ * stdio_probe_devices() - Probe the device behind a console name
+ *
+ * With lazy probing, keyboards and displays are bound but not probed at
+ * start-up. This probes the display for a "vidconsole" name, or else every
+ * keyboard if @name is not registered yet, so that the device registers
+ * itself with stdio.
+ *
+ * @name:	Name of the stdio device that is wanted
+ */
+void stdio_probe_devices(const char *name);
 struct stdio_dev* stdio_clone(struct stdio_dev *dev);
 
 #ifdef CONFIG_LCD
@@ -0,0 +1,181 @@
+/*
+ * Cooperative tasks
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __TASK_H
+#define __TASK_H
+
+#include <linux/list.h>
+
+/*
+ * A task is a function which runs on its own stack, so that it can stop
+ * part way through and let other tasks run. There is no preemption: a task
+ * only gives up the CPU at a yield point, i.e. when it calls task_yield(),
+ * udelay(), a block-device read or each time around net_loop(). The code
+ * which created the first task (normally the command line) runs as the
+ * 'main' task and takes part in the same round-robin.
+ *
+ * This lets a command overlap I/O with computation, e.g. hash one buffer
+ * while a task reads the next one from a block device. Very little of
+ * U-Boot can be re-entered though, so two tasks must not use the same
+ * subsystem (e.g. the network) at the same time.
+ */
+
+/**
+ * typedef task_func_t - Function run by a task
+ *
+ * @arg:	Argument passed to task_create()
+ * @return value for task_join() to return: 0 if OK, -ve on error
+ */
+typedef int (*task_func_t)(void *arg);
+
+enum task_state {
+	TASK_NEW,	/* Created but has not run yet */
+	TASK_RUNNING,	/* Running or waiting for its turn */
+	TASK_DONE,	/* Finished, with its result in @ret */
+};
+
+/**
+ * struct task - A cooperative task
+ *
+ * @name:	Name of the task, for messages
+ * @func:	Function to run
+ * @arg:	Argument to pass to @func
+ * @state:	Current state (enum task_state)
+ * @ret:	Value returned by @func, valid when TASK_DONE
+ * @stop:	true if task_stop() has been called
+ * @stack:	Stack for the task, NULL for the main task
+ * @ctx:	Saved context, owned by the architecture
+ * @list:	Link in the run queue, while the task can run
+ */
+struct task {
+	const char *name;
+	task_func_t func;
+	void *arg;
+	enum task_state state;
+	int ret;
+	bool stop;
+	void *stack;
+	void *ctx;
+	struct list_head list;
+};
+
+#if CONFIG_IS_ENABLED(TASKS)
+/**
+ * task_create() - Create a new task
+ *
+ * The task is added to the end of the run queue, but does not run until
+ * the current task reaches a yield point.
+ *
+ * @name:	Name of the task (not copied)
+ * @func:	Function to run
+ * @arg:	Argument to pass to @func
+ * @taskp:	Returns the new task, which must be freed with task_free()
+ * @return 0 if OK, -EPERM before relocation, -ENOMEM if out of memory
+ */
+int task_create(const char *name, task_func_t func, void *arg,
+		struct task **taskp);
+
+/**
+ * task_yield() - Let other tasks run
+ *
+ * This returns once every other task has had a turn. It does nothing if
+ * there are no other tasks.
+ *
+ * @return 0, or -EINTR if the calling task has been asked to stop
+ */
+int task_yield(void);
+
+/**
+ * task_pending() - Check whether there are other tasks which could run
+ *
+ * Functions which wait can use this to decide whether to yield while
+ * waiting rather than spin.
+ *
+ * @return true if any task other than the calling one can run
+ */
+bool task_pending(void);
+
+/**
+ * task_stop() - Ask a task to stop
+ *
+ * A task which has not run yet is finished straight away, with a result
+ * of -EINTR. Otherwise the task is expected to notice at its next yield
+ * point, see task_should_stop(), and return. Use task_join() to wait
+ * for that.
+ *
+ * @task:	Task to stop
+ */
+void task_stop(struct task *task);
+
+/**
+ * task_should_stop() - Check whether the calling task should stop
+ *
+ * @return true if task_stop() has been called for the calling task
+ */
+bool task_should_stop(void);
+
+/**
+ * task_join() - Wait for a task to finish
+ *
+ * Other tasks (including the one being waited for) run while waiting.
+ *
+ * @task:	Task to wait for
+ * @timeout_ms:	Maximum time to wait in milliseconds, 0 to wait forever
+ * @return value returned by the task, -ETIMEDOUT if it did not finish in
+ * time, or -EDEADLK if @task is the calling task
+ */
+int task_join(struct task *task, ulong timeout_ms);
+
+/**
+ * task_free() - Free a task
+ *
+ * @task:	Task to free, which must be finished (TASK_DONE)
+ * @return 0 if OK, -EBUSY if the task has not finished
+ */
+int task_free(struct task *task);
+#else
+static inline int task_yield(void)
+{
+	return 0;
+}
+
+static inline bool task_pending(void)
+{
+	return false;
+}
+#endif
+
+/**
+ * arch_task_init() - Set up the context for a task
+ *
+ * This is provided by architectures which select HAVE_TASKS.
+ *
+ * @ctxp:	Returns the new context
+ * @stack:	Stack for the task, or NULL to set up a context for the
+ *		caller, which is saved by the first arch_task_switch()
+ * @size:	Size of @stack in bytes
+ * @entry:	Function to run on @stack when the context is first switched
+ *		to. It must never return
+ * @return 0 if OK, -ve on error
+ */
+int arch_task_init(void **ctxp, void *stack, ulong size, void (*entry)(void));
+
+/**
+ * arch_task_switch() - Save the current context and switch to another
+ *
+ * @from:	Context to save the caller in
+ * @to:		Context to switch to
+ */
+void arch_task_switch(void *from, void *to);
+
+/**
+ * arch_task_free() - Free a context set up by arch_task_init()
+ *
+ * @ctx:	Context to free, which must not be running
+ */
+void arch_task_free(void *ctx);
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Helpers for tests which play a network server on a sandbox eth device
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __TEST_NET_SERVER_H__
+#define __TEST_NET_SERVER_H__
+
+#include <net.h>
+
+struct sandbox_eth_responder;
+struct unit_test_state;
+
+#define NET_TEST_SERVER_IP	"1.1.2.2"
+#define NET_TEST_LOAD_ADDR	0x1000000
+
+/**
+ * struct net_test_peer - Where a fake server sends its replies
+ *
+ * @client_mac:	Ethernet address of the client
+ * @server_mac:	Ethernet address the client sent to
+ * @client_ip:	IP address of the client
+ * @client_port: UDP or TCP port of the client
+ */
+struct net_test_peer {
+	uchar client_mac[ARP_HLEN];
+	uchar server_mac[ARP_HLEN];
+	struct in_addr client_ip;
+	u16 client_port;
+};
+
+/**
+ * net_test_learn_peer() - Note the addresses of a packet from the client
+ *
+ * @peer:	Updated with the addresses to reply to
+ * @packet:	UDP or TCP packet sent by the client, from the Ethernet header
+ */
+void net_test_learn_peer(struct net_test_peer *peer, const void *packet);
+
+/**
+ * net_test_eth_hdr() - Fill in the Ethernet header of a reply
+ *
+ * @peer:	Addresses to reply to
+ * @frame:	Frame whose IP packet follows the header
+ */
+void net_test_eth_hdr(const struct net_test_peer *peer, void *frame);
+
+/**
+ * net_test_tcp_checksum() - Work out the checksum of a TCP segment
+ *
+ * @ip:		IP header of the segment, with the addresses filled in
+ * @len:	Length of the TCP header and data
+ * @return the checksum to put in the segment, which is 0 if the segment
+ * already has the right one
+ */
+u16 net_test_tcp_checksum(struct ip_tcp_hdr *ip, uint len);
+
+/**
+ * net_test_file_byte() - Get a byte of the file a fake server provides
+ *
+ * @offset:	Offset of the byte in the file
+ * @return the byte, which varies so that misplaced data shows up
+ */
+u8 net_test_file_byte(ulong offset);
+
+/**
+ * net_test_download() - Download a file and check it arrives intact
+ *
+ * The file must be loaded at NET_TEST_LOAD_ADDR, with the byte after it
+ * left alone.
+ *
+ * @uts:	Test state
+ * @proto:	Protocol to use
+ * @name:	File name, which may start with a server address and ':'
+ * @size:	Size of the file, with each byte from net_test_file_byte()
+ * @return 0 if OK, -ve on failure
+ */
+int net_test_download(struct unit_test_state *uts, enum proto_t proto,
+		      const char *name, ulong size);
+
+/**
+ * net_test_run() - Run a test with a fake server on the first eth device
+ *
+ * The device and server address are set up before @test is called and
+ * put back afterwards, whether or not it passes.
+ *
+ * @uts:	Test state
+ * @resp:	Fake server
+ * @test:	Test to run
+ * @return the result of @test
+ */
+int net_test_run(struct unit_test_state *uts,
+		 const struct sandbox_eth_responder *resp,
+		 int (*test)(struct unit_test_state *uts));
+
+#endif /* __TEST_NET_SERVER_H__ */
@@ -8,8 +8,14 @@
 #ifndef __TEST_SUITES_H__
 #define __TEST_SUITES_H__
 
+int do_ut_crc32(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_dfu(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
 int do_ut_dm(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
 int do_ut_env(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_initcall(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_sparse(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_string(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_task(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
 int do_ut_time(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
 
 #endif /* __TEST_SUITES_H__ */
@@ -14,6 +14,17 @@ uint32_t crc32 (uint32_t, const unsigned char *, uint);
 uint32_t crc32_wd (uint32_t, const unsigned char *, uint, uint);
 uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
 
+/**
+ * crc32_combine - Combine the CRC32s of two consecutive blocks of data
+ *
+ * @crc1:	CRC32 of the first block
+ * @crc2:	CRC32 of the second block (for crc32_no_comp() values this
+ *		must have been computed starting from 0)
+ * @len2:	Length of the second block in bytes
+ * @return CRC32 of the first block followed by the second
+ */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint len2);
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
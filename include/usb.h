@@ -730,6 +730,17 @@ struct dm_usb_ops {
 	 * reset_root_port() - Reset usb root port
 	 */
 	int (*reset_root_port)(struct udevice *bus, struct usb_device *udev);
+
+	/**
+	 * get_max_xfer_size() - Get the largest bulk transfer supported
+	 *
+	 * A class driver such as mass storage uses this to decide how much
+	 * data to move with each command. This is optional.
+	 *
+	 * @size: Returns the largest number of bytes in one bulk transfer
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*get_max_xfer_size)(struct udevice *bus, size_t *size);
 };
 
 #define usb_get_ops(dev)	((struct dm_usb_ops *)(dev)->driver->ops)
@@ -750,6 +761,16 @@ struct dm_usb_ops {
  */
 struct usb_device *usb_get_dev_index(struct udevice *bus, int index);
 
+/**
+ * usb_get_max_xfer_size() - Get the largest bulk transfer for a device
+ *
+ * @udev:	USB device
+ * @size:	Returns the largest number of bytes its host controller can
+ *		move in one bulk transfer
+ * @return 0 if OK, -ENOSYS if the controller does not say, -ve on error
+ */
+int usb_get_max_xfer_size(struct usb_device *udev, size_t *size);
+
 /**
  * usb_setup_device() - set up a device ready for use
  *
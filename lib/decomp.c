@@ -0,0 +1,869 @@
+/*
+ * Streaming decompression
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <bzlib.h>
+#include <decomp.h>
+#include <errno.h>
+#include <image.h>
+#include <malloc.h>
+#include <watchdog.h>
+#include <asm/unaligned.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#include <u-boot/zlib.h>
+#ifdef CONFIG_ZSTD
+#define ZSTD_STATIC_LINKING_ONLY
+#include "zstd/zstd.h"
+#endif
+
+/* Size of the pieces passed to the output function by gzip and bzip2 */
+#define DECOMP_CHUNK_SIZE	0x8000
+
+/* Largest piece passed to a decompressor at once, to fit in 32 bits */
+#define DECOMP_FEED_MAX		(1 << 30)
+
+/* Magic numbers used by decomp_detect() */
+#define GZIP_MAGIC		0x8b1f
+#define LZ4F_MAGIC		0x184d2204
+#define ZSTD_MAGIC		0xfd2fb528
+
+/* Each allocation starts with its size, padded to keep the alignment */
+#define DECOMP_ALLOC_HDR	16
+
+/**
+ * struct decomp_ops - A decompressor
+ *
+ * @comp:	Compression type handled (IH_COMP_...)
+ * @init:	Set up ds->state
+ * @feed:	Decompress @len bytes from @in. Sets *@used to the number of
+ *		bytes used, which is less than @len only at the end of the
+ *		stream. Returns 0 if OK, 1 at the end of the stream, -ve on
+ *		error
+ * @free:	Free ds->state
+ */
+struct decomp_ops {
+	int comp;
+	int (*init)(struct decomp_stream *ds);
+	int (*feed)(struct decomp_stream *ds, const u8 *in, size_t len,
+		    size_t *used);
+	void (*free)(struct decomp_stream *ds);
+};
+
+static void *decomp_alloc(struct decomp_stream *ds, size_t size)
+{
+	u8 *p;
+
+	p = malloc(DECOMP_ALLOC_HDR + size);
+	if (!p)
+		return NULL;
+	*(size_t *)p = size;
+	ds->mem += size;
+	if (ds->mem > ds->peak_mem)
+		ds->peak_mem = ds->mem;
+
+	return p + DECOMP_ALLOC_HDR;
+}
+
+static void decomp_release(struct decomp_stream *ds, void *ptr)
+{
+	u8 *p;
+
+	if (!ptr)
+		return;
+	p = (u8 *)ptr - DECOMP_ALLOC_HDR;
+	ds->mem -= *(size_t *)p;
+	free(p);
+}
+
+static int decomp_alloc_chunk(struct decomp_stream *ds)
+{
+	if (!ds->out)
+		return 0;
+	ds->chunk = decomp_alloc(ds, DECOMP_CHUNK_SIZE);
+
+	return ds->chunk ? 0 : -ENOMEM;
+}
+
+/* Returns where the next output goes, and the room there */
+static u8 *decomp_out_ptr(struct decomp_stream *ds, size_t *roomp)
+{
+	if (!ds->out) {
+		*roomp = ds->dst_size - ds->total_out;
+		return ds->dst + ds->total_out;
+	}
+	*roomp = DECOMP_CHUNK_SIZE;
+
+	return ds->chunk;
+}
+
+/* Accounts for @len bytes written to @buf, passing them on if needed */
+static int decomp_out_done(struct decomp_stream *ds, const u8 *buf,
+			   size_t len)
+{
+	int ret = 0;
+
+	if (ds->out && len)
+		ret = ds->out(ds->priv, buf, len);
+	ds->total_out += len;
+
+	return ret;
+}
+
+#ifdef CONFIG_GZIP
+static void *decomp_zalloc(void *opaque, uInt items, uInt size)
+{
+	return decomp_alloc(opaque, (size_t)items * size);
+}
+
+static void decomp_zfree(void *opaque, void *addr, uInt size)
+{
+	decomp_release(opaque, addr);
+}
+
+static int gzip_init(struct decomp_stream *ds)
+{
+	z_stream *s;
+
+	s = decomp_alloc(ds, sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+	memset(s, '\0', sizeof(*s));
+	s->zalloc = decomp_zalloc;
+	s->zfree = decomp_zfree;
+	s->opaque = ds;
+	/* Expect a gzip header, and check the CRC and size in the trailer */
+	if (inflateInit2(s, 16 + MAX_WBITS) != Z_OK) {
+		decomp_release(ds, s);
+		return -ENOMEM;
+	}
+	ds->state = s;
+
+	return decomp_alloc_chunk(ds);
+}
+
+static int gzip_feed(struct decomp_stream *ds, const u8 *in, size_t len,
+		     size_t *used)
+{
+	z_stream *s = ds->state;
+	uInt avail;
+	size_t room;
+	u8 *out;
+	int r, ret;
+
+	s->next_in = (u8 *)in;
+	s->avail_in = len;
+	for (;;) {
+		out = decomp_out_ptr(ds, &room);
+		s->next_out = out;
+		s->avail_out = min_t(size_t, room, UINT_MAX);
+		avail = s->avail_in;
+		r = inflate(s, Z_NO_FLUSH);
+		ret = decomp_out_done(ds, out, s->next_out - out);
+		if (ret)
+			return ret;
+		if (r == Z_STREAM_END) {
+			*used = len - s->avail_in;
+			return 1;
+		}
+		if (r == Z_MEM_ERROR)
+			return -ENOMEM;
+		if (r != Z_OK && r != Z_BUF_ERROR)
+			return -EINVAL;
+		/* Stop when there is no input or no room left */
+		if (s->next_out == out && s->avail_in == avail)
+			break;
+		WATCHDOG_RESET();
+	}
+	*used = len - s->avail_in;
+
+	return s->avail_in ? -ENOSPC : 0;
+}
+
+static void gzip_free(struct decomp_stream *ds)
+{
+	inflateEnd(ds->state);
+	decomp_release(ds, ds->state);
+}
+#endif
+
+#ifdef CONFIG_BZIP2
+static void *decomp_bzalloc(void *opaque, int items, int size)
+{
+	return decomp_alloc(opaque, (size_t)items * size);
+}
+
+static void decomp_bzfree(void *opaque, void *addr)
+{
+	decomp_release(opaque, addr);
+}
+
+static int bzip2_init(struct decomp_stream *ds)
+{
+	bz_stream *s;
+
+	s = decomp_alloc(ds, sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+	memset(s, '\0', sizeof(*s));
+	s->bzalloc = decomp_bzalloc;
+	s->bzfree = decomp_bzfree;
+	s->opaque = ds;
+	if (BZ2_bzDecompressInit(s, 0, 0) != BZ_OK) {
+		decomp_release(ds, s);
+		return -ENOMEM;
+	}
+	ds->state = s;
+
+	return decomp_alloc_chunk(ds);
+}
+
+static int bzip2_feed(struct decomp_stream *ds, const u8 *in, size_t len,
+		      size_t *used)
+{
+	bz_stream *s = ds->state;
+	unsigned int avail;
+	size_t room;
+	u8 *out;
+	int r, ret;
+
+	s->next_in = (char *)in;
+	s->avail_in = len;
+	for (;;) {
+		out = decomp_out_ptr(ds, &room);
+		s->next_out = (char *)out;
+		s->avail_out = min_t(size_t, room, UINT_MAX);
+		avail = s->avail_in;
+		r = BZ2_bzDecompress(s);
+		ret = decomp_out_done(ds, out, (u8 *)s->next_out - out);
+		if (ret)
+			return ret;
+		if (r == BZ_STREAM_END) {
+			*used = len - s->avail_in;
+			return 1;
+		}
+		if (r == BZ_MEM_ERROR)
+			return -ENOMEM;
+		if (r != BZ_OK)
+			return -EINVAL;
+		if ((u8 *)s->next_out == out && s->avail_in == avail)
+			break;
+	}
+	*used = len - s->avail_in;
+
+	return s->avail_in ? -ENOSPC : 0;
+}
+
+static void bzip2_free(struct decomp_stream *ds)
+{
+	BZ2_bzDecompressEnd(ds->state);
+	decomp_release(ds, ds->state);
+}
+#endif
+
+#ifdef CONFIG_LZMA
+/* Properties followed by the 64-bit uncompressed size, or -1 if unknown */
+#define LZMA_HDR_SIZE		(LZMA_PROPS_SIZE + 8)
+#define LZMA_SIZE_UNKNOWN	((u64)-1)
+
+struct lzma_state {
+	CLzmaDec dec;
+	ISzAlloc alloc;
+	struct decomp_stream *ds;
+	u8 hdr[LZMA_HDR_SIZE];
+	uint hdr_len;
+	u64 size;
+	bool started;
+};
+
+static void *lzma_alloc(void *p, size_t size)
+{
+	struct lzma_state *st = container_of(p, struct lzma_state, alloc);
+
+	return decomp_alloc(st->ds, size);
+}
+
+static void lzma_free_mem(void *p, void *addr)
+{
+	struct lzma_state *st = container_of(p, struct lzma_state, alloc);
+
+	decomp_release(st->ds, addr);
+}
+
+static int lzma_init(struct decomp_stream *ds)
+{
+	struct lzma_state *st;
+
+	st = decomp_alloc(ds, sizeof(*st));
+	if (!st)
+		return -ENOMEM;
+	memset(st, '\0', sizeof(*st));
+	LzmaDec_Construct(&st->dec);
+	st->alloc.Alloc = lzma_alloc;
+	st->alloc.Free = lzma_free_mem;
+	st->ds = ds;
+	ds->state = st;
+
+	return 0;
+}
+
+/* Sets up the decoder once the header is complete */
+static int lzma_start(struct decomp_stream *ds, struct lzma_state *st)
+{
+	CLzmaDec *dec = &st->dec;
+	size_t win;
+	int i;
+
+	st->size = 0;
+	for (i = 0; i < 8; i++)
+		st->size |= (u64)st->hdr[LZMA_PROPS_SIZE + i] << (i * 8);
+	if (LzmaDec_AllocateProbs(dec, st->hdr, LZMA_PROPS_SIZE, &st->alloc))
+		return -EINVAL;
+
+	if (!ds->out) {
+		/* Decode straight into the buffer, which is the dictionary */
+		if (st->size != LZMA_SIZE_UNKNOWN && st->size > ds->dst_size)
+			return -ENOSPC;
+		dec->dic = ds->dst;
+		dec->dicBufSize = ds->dst_size;
+	} else {
+		/* Only the last dictSize bytes can be referred back to */
+		win = max_t(u32, dec->prop.dicSize, 1);
+		if (st->size < win)
+			win = max_t(size_t, st->size, 1);
+		dec->dic = decomp_alloc(ds, win);
+		if (!dec->dic)
+			return -ENOMEM;
+		dec->dicBufSize = win;
+	}
+	LzmaDec_Init(dec);
+	st->started = true;
+
+	return 0;
+}
+
+static int lzma_feed(struct decomp_stream *ds, const u8 *in, size_t len,
+		     size_t *used)
+{
+	struct lzma_state *st = ds->state;
+	CLzmaDec *dec = &st->dec;
+	ELzmaFinishMode finish;
+	ELzmaStatus status;
+	size_t pos = 0;
+	SizeT limit, in_len, start;
+	int ret;
+
+	while (st->hdr_len < LZMA_HDR_SIZE && pos < len)
+		st->hdr[st->hdr_len++] = in[pos++];
+	if (!st->started) {
+		if (st->hdr_len < LZMA_HDR_SIZE) {
+			*used = pos;
+			return 0;
+		}
+		ret = lzma_start(ds, st);
+		if (ret)
+			return ret;
+	}
+
+	for (;;) {
+		if (st->size != LZMA_SIZE_UNKNOWN && ds->total_out == st->size) {
+			*used = pos;
+			return 1;
+		}
+		if (dec->dicPos == dec->dicBufSize && ds->out)
+			dec->dicPos = 0;
+		/* A full buffer only has room for the end mark */
+		finish = LZMA_FINISH_ANY;
+		if (dec->dicPos == dec->dicBufSize)
+			finish = LZMA_FINISH_END;
+		limit = dec->dicBufSize;
+		if (st->size != LZMA_SIZE_UNKNOWN &&
+		    st->size - ds->total_out < limit - dec->dicPos)
+			limit = dec->dicPos + st->size - ds->total_out;
+		start = dec->dicPos;
+		in_len = len - pos;
+		if (LzmaDec_DecodeToDic(dec, limit, in + pos, &in_len, finish,
+					&status) != SZ_OK)
+			return finish == LZMA_FINISH_END ? -ENOSPC : -EINVAL;
+		pos += in_len;
+		ret = decomp_out_done(ds, dec->dic + start,
+				      dec->dicPos - start);
+		if (ret)
+			return ret;
+		if (status == LZMA_STATUS_FINISHED_WITH_MARK) {
+			*used = pos;
+			return 1;
+		}
+		if (status == LZMA_STATUS_NEEDS_MORE_INPUT ||
+		    (!in_len && dec->dicPos == start))
+			break;
+		WATCHDOG_RESET();
+	}
+	*used = pos;
+
+	return pos < len ? -ENOSPC : 0;
+}
+
+static void lzma_free(struct decomp_stream *ds)
+{
+	struct lzma_state *st = ds->state;
+
+	LzmaDec_FreeProbs(&st->dec, &st->alloc);
+	if (ds->out)
+		decomp_release(ds, st->dec.dic);
+	decomp_release(ds, st);
+}
+#endif
+
+#ifdef CONFIG_LZ4
+/* Frame descriptor flags (FLG) and block descriptor (BD) */
+#define LZ4F_VERSION_MASK	0xc0
+#define LZ4F_VERSION		0x40
+#define LZ4F_INDEP_BLOCKS	BIT(5)
+#define LZ4F_BLOCK_CSUM		BIT(4)
+#define LZ4F_CONTENT_SIZE	BIT(3)
+#define LZ4F_CONTENT_CSUM	BIT(2)
+#define LZ4F_FLG_RESERVED	0x03
+#define LZ4F_BD_RESERVED	0x8f
+#define LZ4F_BD_SIZE_SHIFT	4
+
+/* Largest header: magic, FLG, BD, content size, header checksum */
+#define LZ4F_HDR_MAX		(4 + 1 + 1 + 8 + 1)
+
+#define LZ4_BLOCK_RAW		BIT(31)
+
+enum lz4_stage {
+	LZ4_FRAME_START,	/* magic, FLG and BD */
+	LZ4_FRAME_REST,		/* rest of the frame header */
+	LZ4_BLOCK_HDR,		/* block size */
+	LZ4_BLOCK,		/* block data and checksum */
+	LZ4_TRAILER,		/* content checksum */
+};
+
+struct lz4_state {
+	enum lz4_stage stage;
+	u8 hdr[LZ4F_HDR_MAX];
+	u8 *buf;		/* gathers the input for the current stage */
+	size_t have;		/* bytes in @buf */
+	size_t need;		/* bytes wanted in @buf */
+	u8 flags;
+	size_t block_max;
+	u32 block;		/* size and LZ4_BLOCK_RAW */
+	u8 *in_buf;		/* for blocks split across feeds */
+	u8 *win;		/* output for each block, if using ds->out */
+};
+
+static int lz4_init(struct decomp_stream *ds)
+{
+	struct lz4_state *st;
+
+	st = decomp_alloc(ds, sizeof(*st));
+	if (!st)
+		return -ENOMEM;
+	memset(st, '\0', sizeof(*st));
+	st->stage = LZ4_FRAME_START;
+	st->buf = st->hdr;
+	st->need = 6;
+	ds->state = st;
+
+	return 0;
+}
+
+static int lz4_block(struct decomp_stream *ds, struct lz4_state *st,
+		     const u8 *data)
+{
+	size_t size = st->block & ~LZ4_BLOCK_RAW;
+	size_t room, out_len;
+	u8 *out;
+	int ret;
+
+	if (ds->out) {
+		out = st->win;
+		room = st->block_max;
+	} else {
+		/* No block is bigger than block_max, even if dst has no limit */
+		out = ds->dst + ds->total_out;
+		room = min_t(size_t, ds->dst_size - ds->total_out,
+			     st->block_max);
+	}
+	if (st->block & LZ4_BLOCK_RAW) {
+		if (!ds->out && size > room)
+			return -ENOSPC;
+		if (!ds->out)
+			memcpy(out, data, size);
+		return decomp_out_done(ds, ds->out ? data : out, size);
+	}
+
+	out_len = room;
+	ret = ulz4_block(data, size, out, &out_len);
+	if (ret)
+		return room < st->block_max ? -ENOSPC : -EINVAL;
+
+	return decomp_out_done(ds, out, out_len);
+}
+
+/* Acts on the data gathered for the current stage */
+static int lz4_stage(struct decomp_stream *ds, struct lz4_state *st,
+		     const u8 *data)
+{
+	size_t size;
+	int ret;
+
+	switch (st->stage) {
+	case LZ4_FRAME_START:
+		if (get_unaligned_le32(data) != LZ4F_MAGIC ||
+		    (data[4] & LZ4F_VERSION_MASK) != LZ4F_VERSION)
+			return -EPROTONOSUPPORT;
+		if ((data[4] & LZ4F_FLG_RESERVED) ||
+		    (data[5] & LZ4F_BD_RESERVED))
+			return -EINVAL;
+		if (!(data[4] & LZ4F_INDEP_BLOCKS))
+			return -EPROTONOSUPPORT;
+		st->flags = data[4];
+		size = data[5] >> LZ4F_BD_SIZE_SHIFT;
+		if (size < 4)
+			return -EINVAL;
+		st->block_max = 1 << (8 + 2 * size);
+		st->in_buf = decomp_alloc(ds, st->block_max + 4);
+		if (!st->in_buf)
+			return -ENOMEM;
+		if (ds->out) {
+			st->win = decomp_alloc(ds, st->block_max);
+			if (!st->win)
+				return -ENOMEM;
+		}
+		st->stage = LZ4_FRAME_REST;
+		st->need = (st->flags & LZ4F_CONTENT_SIZE ? 8 : 0) + 1;
+		break;
+	case LZ4_FRAME_REST:
+		st->stage = LZ4_BLOCK_HDR;
+		st->need = 4;
+		break;
+	case LZ4_BLOCK_HDR:
+		st->block = get_unaligned_le32(data);
+		size = st->block & ~LZ4_BLOCK_RAW;
+		if (!size) {
+			if (!(st->flags & LZ4F_CONTENT_CSUM))
+				return 1;
+			st->stage = LZ4_TRAILER;
+			st->need = 4;
+			break;
+		}
+		if (size > st->block_max)
+			return -EINVAL;
+		st->stage = LZ4_BLOCK;
+		st->need = size + (st->flags & LZ4F_BLOCK_CSUM ? 4 : 0);
+		break;
+	case LZ4_BLOCK:
+		ret = lz4_block(ds, st, data);
+		if (ret)
+			return ret;
+		st->stage = LZ4_BLOCK_HDR;
+		st->need = 4;
+		break;
+	case LZ4_TRAILER:
+		return 1;
+	}
+	st->buf = st->stage == LZ4_BLOCK ? st->in_buf : st->hdr;
+
+	return 0;
+}
+
+static int lz4_feed(struct decomp_stream *ds, const u8 *in, size_t len,
+		    size_t *used)
+{
+	struct lz4_state *st = ds->state;
+	size_t pos = 0, n;
+	const u8 *data;
+	int ret;
+
+	while (pos < len) {
+		if (!st->have && len - pos >= st->need) {
+			/* All here, so use it where it is */
+			data = in + pos;
+			pos += st->need;
+		} else {
+			n = min(st->need - st->have, len - pos);
+			memcpy(st->buf + st->have, in + pos, n);
+			st->have += n;
+			pos += n;
+			if (st->have < st->need)
+				break;
+			data = st->buf;
+		}
+		st->have = 0;
+		ret = lz4_stage(ds, st, data);
+		if (ret) {
+			*used = pos;
+			return ret;
+		}
+	}
+	*used = pos;
+
+	return 0;
+}
+
+static void lz4_free(struct decomp_stream *ds)
+{
+	struct lz4_state *st = ds->state;
+
+	decomp_release(ds, st->in_buf);
+	decomp_release(ds, st->win);
+	decomp_release(ds, st);
+}
+#endif
+
+#ifdef CONFIG_ZSTD
+static void *decomp_zstd_alloc(void *opaque, size_t size)
+{
+	return decomp_alloc(opaque, size);
+}
+
+static void decomp_zstd_free(void *opaque, void *addr)
+{
+	decomp_release(opaque, addr);
+}
+
+static int zstd_init(struct decomp_stream *ds)
+{
+	ZSTD_customMem mem = {
+		.customAlloc	= decomp_zstd_alloc,
+		.customFree	= decomp_zstd_free,
+		.opaque		= ds,
+	};
+
+	ds->state = ZSTD_createDCtx_advanced(mem);
+	if (!ds->state)
+		return -ENOMEM;
+	/* The buffer does not move, so it can be the window too */
+	if (!ds->out)
+		ZSTD_DCtx_setParameter(ds->state, ZSTD_d_stableOutBuffer, 1);
+
+	return decomp_alloc_chunk(ds);
+}
+
+static int zstd_feed(struct decomp_stream *ds, const u8 *in, size_t len,
+		     size_t *used)
+{
+	ZSTD_inBuffer src = { .src = in, .size = len };
+	ZSTD_outBuffer dst;
+	size_t r, avail;
+	u8 *out;
+	int ret;
+
+	for (;;) {
+		/* A stable buffer must be passed the same way each time */
+		if (ds->out) {
+			dst.dst = ds->chunk;
+			dst.size = DECOMP_CHUNK_SIZE;
+			dst.pos = 0;
+		} else {
+			dst.dst = ds->dst;
+			dst.size = ds->dst_size;
+			dst.pos = ds->total_out;
+		}
+		out = (u8 *)dst.dst + dst.pos;
+		avail = src.pos;
+		r = ZSTD_decompressStream(ds->state, &dst, &src);
+		ret = decomp_out_done(ds, out, (u8 *)dst.dst + dst.pos - out);
+		if (ret)
+			return ret;
+		if (ZSTD_isError(r)) {
+			debug("%s: %s\n", __func__, ZSTD_getErrorName(r));
+			return zstd_errno(r);
+		}
+		/* Only the first frame is used, as with the other formats */
+		if (!r) {
+			*used = src.pos;
+			return 1;
+		}
+		if ((u8 *)dst.dst + dst.pos == out && src.pos == avail)
+			break;
+		WATCHDOG_RESET();
+	}
+	*used = src.pos;
+
+	return src.pos < len ? -ENOSPC : 0;
+}
+
+static void zstd_free(struct decomp_stream *ds)
+{
+	ZSTD_freeDCtx(ds->state);
+}
+#endif
+
+static const struct decomp_ops decomp_ops[] = {
+#ifdef CONFIG_GZIP
+	{ IH_COMP_GZIP, gzip_init, gzip_feed, gzip_free },
+#endif
+#ifdef CONFIG_BZIP2
+	{ IH_COMP_BZIP2, bzip2_init, bzip2_feed, bzip2_free },
+#endif
+#ifdef CONFIG_LZMA
+	{ IH_COMP_LZMA, lzma_init, lzma_feed, lzma_free },
+#endif
+#ifdef CONFIG_LZ4
+	{ IH_COMP_LZ4, lz4_init, lz4_feed, lz4_free },
+#endif
+#ifdef CONFIG_ZSTD
+	{ IH_COMP_ZSTD, zstd_init, zstd_feed, zstd_free },
+#endif
+};
+
+static const struct decomp_ops *decomp_find(int comp)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(decomp_ops); i++) {
+		if (decomp_ops[i].comp == comp)
+			return &decomp_ops[i];
+	}
+
+	return NULL;
+}
+
+int decomp_detect(const void *buf, size_t len)
+{
+	const u8 *p = buf;
+	int comp = IH_COMP_NONE;
+
+	if (len >= 4 && get_unaligned_le32(p) == LZ4F_MAGIC)
+		comp = IH_COMP_LZ4;
+	else if (len >= 4 && get_unaligned_le32(p) == ZSTD_MAGIC)
+		comp = IH_COMP_ZSTD;
+	else if (len >= 3 && get_unaligned_le16(p) == GZIP_MAGIC && p[2] == 8)
+		comp = IH_COMP_GZIP;
+	else if (len >= 4 && !memcmp(p, "BZh", 3) && p[3] >= '1' &&
+		 p[3] <= '9')
+		comp = IH_COMP_BZIP2;
+	/* lzma has no magic, but this is what 'lzma' always writes */
+	else if (len >= 3 && p[0] == 0x5d && !p[1] && !p[2])
+		comp = IH_COMP_LZMA;
+
+	return decomp_find(comp) ? comp : IH_COMP_NONE;
+}
+
+static int decomp_start(struct decomp_stream **dsp, int comp,
+			struct decomp_stream *tmpl)
+{
+	const struct decomp_ops *ops;
+	struct decomp_stream *ds;
+	int ret;
+
+	ops = decomp_find(comp);
+	if (!ops)
+		return -EPROTONOSUPPORT;
+	ds = malloc(sizeof(*ds));
+	if (!ds)
+		return -ENOMEM;
+	*ds = *tmpl;
+	ds->comp = comp;
+	ds->ops = ops;
+	ds->mem = sizeof(*ds);
+	ds->peak_mem = ds->mem;
+	ret = ops->init(ds);
+	if (ret) {
+		decomp_free(ds);
+		return ret;
+	}
+	*dsp = ds;
+
+	return 0;
+}
+
+int decomp_init(struct decomp_stream **dsp, int comp, decomp_out_t out,
+		void *priv)
+{
+	struct decomp_stream tmpl = {
+		.out	= out,
+		.priv	= priv,
+	};
+
+	return decomp_start(dsp, comp, &tmpl);
+}
+
+int decomp_init_buf(struct decomp_stream **dsp, int comp, void *dst,
+		    size_t size)
+{
+	struct decomp_stream tmpl = {
+		.dst		= dst,
+		.dst_size	= size,
+	};
+
+	/* 'unzip' passes ~0 for no limit, so stop at the end of memory */
+	tmpl.dst_size = min_t(size_t, size, (uintptr_t)-1 - (uintptr_t)dst);
+
+	return decomp_start(dsp, comp, &tmpl);
+}
+
+int decomp_feed(struct decomp_stream *ds, const void *buf, size_t len)
+{
+	const u8 *in = buf;
+	size_t n, used;
+	int ret = 0;
+
+	if (ds->err)
+		return ds->err;
+	ds->total_in += len;
+	while (len && !ds->done) {
+		n = min_t(size_t, len, DECOMP_FEED_MAX);
+		ret = ds->ops->feed(ds, in, n, &used);
+		if (ret == 1) {
+			debug("%s: %s stream done, %zu bytes left over\n",
+			      __func__, genimg_get_comp_name(ds->comp),
+			      len - used);
+			ds->done = true;
+			ret = 0;
+		}
+		if (ret)
+			break;
+		in += n;
+		len -= n;
+	}
+	ds->err = ret;
+
+	return ret;
+}
+
+int decomp_flush(struct decomp_stream *ds)
+{
+	if (ds->err)
+		return ds->err;
+	if (ds->done)
+		return 0;
+	if (!ds->out && ds->total_out == ds->dst_size)
+		return -ENOSPC;
+
+	return -ENODATA;
+}
+
+void decomp_free(struct decomp_stream *ds)
+{
+	if (!ds)
+		return;
+	if (ds->state)
+		ds->ops->free(ds);
+	decomp_release(ds, ds->chunk);
+	free(ds);
+}
+
+int decomp_buf(int comp, const void *src, size_t src_len, void *dst,
+	       size_t *dst_lenp)
+{
+	struct decomp_stream *ds;
+	int ret;
+
+	ret = decomp_init_buf(&ds, comp, dst, *dst_lenp);
+	if (ret)
+		return ret;
+	ret = decomp_feed(ds, src, src_len);
+	if (!ret)
+		ret = decomp_flush(ds);
+	*dst_lenp = ds->total_out;
+	decomp_free(ds);
+
+	return ret;
+}
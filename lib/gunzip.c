@@ -24,6 +24,10 @@
 #define RESERVED		0xe0
 #define DEFLATED		8
 
+static int zinflate(void *dst, int dstlen, unsigned char *src,
+		    unsigned long *lenp, int stoponerr, int offset,
+		    int window_bits);
+
 void *gzalloc(void *x, unsigned items, unsigned size)
 {
 	void *p;
@@ -67,7 +71,11 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 		return (-1);
 	}
 
-	return zunzip(dst, dstlen, src, lenp, 1, i);
+	/*
+	 * Let inflate() read the header again, so that it also checks the
+	 * CRC and length in the trailer
+	 */
+	return zinflate(dst, dstlen, src, lenp, 1, 0, 16 + MAX_WBITS);
 }
 
 #ifdef CONFIG_CMD_UNZIP
@@ -260,11 +268,9 @@ out:
 }
 #endif
 
-/*
- * Uncompress blocks compressed with zlib without headers
- */
-int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
-						int stoponerr, int offset)
+static int zinflate(void *dst, int dstlen, unsigned char *src,
+		    unsigned long *lenp, int stoponerr, int offset,
+		    int window_bits)
 {
 	z_stream s;
 	int err = 0;
@@ -273,7 +279,7 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 	s.zalloc = gzalloc;
 	s.zfree = gzfree;
 
-	r = inflateInit2(&s, -MAX_WBITS);
+	r = inflateInit2(&s, window_bits);
 	if (r != Z_OK) {
 		printf("Error: inflateInit2() returned %d\n", r);
 		return -1;
@@ -286,7 +292,10 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 		r = inflate(&s, Z_FINISH);
 		if (stoponerr == 1 && r != Z_STREAM_END &&
 		    (s.avail_in == 0 || s.avail_out == 0 || r != Z_BUF_ERROR)) {
-			printf("Error: inflate() returned %d\n", r);
+			if (r == Z_DATA_ERROR && s.msg)
+				printf("Error: inflate(): %s\n", s.msg);
+			else
+				printf("Error: inflate() returned %d\n", r);
 			err = -1;
 			break;
 		}
@@ -296,3 +305,12 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 
 	return err;
 }
+
+/*
+ * Uncompress blocks compressed with zlib without headers
+ */
+int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+						int stoponerr, int offset)
+{
+	return zinflate(dst, dstlen, src, lenp, stoponerr, offset, -MAX_WBITS);
+}
@@ -5,17 +5,170 @@
  */
 
 #include <common.h>
+#include <errno.h>
 #include <initcall.h>
 #include <efi.h>
+#include <watchdog.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(INITCALL_TASKS)
+/* Started tasks which are not done yet, in the order they were started */
+static struct initcall_task *task_list;
+#endif
+
+static void initcall_task_done(struct initcall_task *task, int ret)
+{
+	task->state = INITCALL_TASK_DONE;
+	task->ret = ret;
+	bootstage_span_end(task->span);
+	debug("initcall task '%s' done, ret=%d\n", task->name, ret);
+	if (ret)
+		printf("initcall task '%s' failed (err=%d)\n", task->name, ret);
+}
+
+static bool initcall_task_ready(struct initcall_task *task)
+{
+	struct initcall_task *const *dep;
+
+	for (dep = task->after; dep && *dep; dep++) {
+		if ((*dep)->state != INITCALL_TASK_DONE)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * initcall_task_step() - Move a task on as far as it can go without waiting
+ *
+ * @task:	Task to step
+ * @return true if the task is done, false if not
+ */
+static bool initcall_task_step(struct initcall_task *task)
+{
+	int ret;
+
+	if (task->state == INITCALL_TASK_WAITING) {
+		if (!initcall_task_ready(task))
+			return false;
+		task->state = INITCALL_TASK_RUNNING;
+		task->span = bootstage_span_begin("task", task->name);
+		ret = task->start ? task->start() : 0;
+		if (ret || !task->poll) {
+			initcall_task_done(task, ret == 1 ? 0 : ret);
+			return true;
+		}
+	}
+	if (task->state == INITCALL_TASK_RUNNING) {
+		ret = task->poll();
+		if (ret == -EAGAIN)
+			return false;
+		initcall_task_done(task, ret);
+	}
+
+	return true;
+}
+
+int initcall_task_start(struct initcall_task *task)
+{
+	if (task->state == INITCALL_TASK_WAITING ||
+	    task->state == INITCALL_TASK_RUNNING)
+		return -EBUSY;
+	task->state = INITCALL_TASK_WAITING;
+	task->ret = 0;
+	task->span = -1;
+	task->next = NULL;
+	debug("initcall task '%s' started\n", task->name);
+
+#if CONFIG_IS_ENABLED(INITCALL_TASKS)
+	if (gd->flags & GD_FLG_RELOC) {
+		struct initcall_task **tailp;
+
+		for (tailp = &task_list; *tailp; tailp = &(*tailp)->next)
+			;
+		*tailp = task;
+		initcall_task_poll();
+
+		return 0;
+	}
+#endif
+	/* Run it to completion now, so the tasks it needs must be done */
+	if (!initcall_task_ready(task)) {
+		initcall_task_done(task, -EDEADLK);
+		return -EDEADLK;
+	}
+	while (!initcall_task_step(task))
+		WATCHDOG_RESET();
+
+	return 0;
+}
+
+int initcall_task_poll(void)
+{
+#if CONFIG_IS_ENABLED(INITCALL_TASKS)
+	struct initcall_task **taskp, *task;
+	bool running = false, ready = false;
+	int pending = 0;
+
+	/* Tasks are run to completion when started before relocation */
+	if (!(gd->flags & GD_FLG_RELOC))
+		return 0;
+	for (taskp = &task_list; (task = *taskp);) {
+		if (initcall_task_step(task)) {
+			*taskp = task->next;
+			continue;
+		}
+		if (task->state == INITCALL_TASK_RUNNING)
+			running = true;
+		pending++;
+		taskp = &task->next;
+	}
+	if (!pending || running)
+		return pending;
+
+	/*
+	 * Everything left is waiting for other tasks. If none of them can
+	 * start, they wait for each other or for tasks never started.
+	 */
+	for (task = task_list; task; task = task->next)
+		ready |= initcall_task_ready(task);
+	if (!ready) {
+		for (task = task_list; task; task = task->next)
+			initcall_task_done(task, -EDEADLK);
+		task_list = NULL;
+		pending = 0;
+	}
+
+	return pending;
+#else
+	return 0;
+#endif
+}
+
+int initcall_task_wait(struct initcall_task *task)
+{
+	if (!task) {
+		while (initcall_task_poll())
+			WATCHDOG_RESET();
+		return 0;
+	}
+	while (task->state == INITCALL_TASK_WAITING ||
+	       task->state == INITCALL_TASK_RUNNING) {
+		initcall_task_poll();
+		WATCHDOG_RESET();
+	}
+
+	return task->ret;
+}
+
 int initcall_run_list(const init_fnc_t init_sequence[])
 {
 	const init_fnc_t *init_fnc_ptr;
 
 	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
 		unsigned long reloc_ofs = 0;
+		int span;
 		int ret;
 
 		if (gd->flags & GD_FLG_RELOC)
@@ -28,13 +181,18 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 			debug(" (relocated to %p)\n", (char *)*init_fnc_ptr);
 		else
 			debug("\n");
+		span = bootstage_span_begin_addr("initcall",
+				(char *)*init_fnc_ptr - reloc_ofs);
 		ret = (*init_fnc_ptr)();
+		bootstage_span_end(span);
 		if (ret) {
 			printf("initcall sequence %p failed at call %p (err=%d)\n",
 			       init_sequence,
 			       (char *)*init_fnc_ptr - reloc_ofs, ret);
 			return -1;
 		}
+		/* Let any tasks started by initcalls make progress */
+		initcall_task_poll();
 	}
 	return 0;
 }
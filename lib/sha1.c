@@ -31,10 +31,10 @@
  */
 #ifndef GET_UINT32_BE
 #define GET_UINT32_BE(n,b,i) {				\
-	(n) = ( (unsigned long) (b)[(i)    ] << 24 )	\
-	    | ( (unsigned long) (b)[(i) + 1] << 16 )	\
-	    | ( (unsigned long) (b)[(i) + 2] <<  8 )	\
-	    | ( (unsigned long) (b)[(i) + 3]       );	\
+	(n) = ( (uint32_t) (b)[(i)    ] << 24 )	\
+	    | ( (uint32_t) (b)[(i) + 1] << 16 )	\
+	    | ( (uint32_t) (b)[(i) + 2] <<  8 )	\
+	    | ( (uint32_t) (b)[(i) + 3]       );	\
 }
 #endif
 #ifndef PUT_UINT32_BE
@@ -61,26 +61,14 @@ void sha1_starts (sha1_context * ctx)
 	ctx->state[4] = 0xC3D2E1F0;
 }
 
-static void sha1_process(sha1_context *ctx, const unsigned char data[64])
+/*
+ * Process a number of consecutive 64-byte blocks, keeping the working
+ * variables in 32-bit registers across blocks
+ */
+static void sha1_process(sha1_context *ctx, const unsigned char *data,
+			 unsigned int blocks)
 {
-	unsigned long temp, W[16], A, B, C, D, E;
-
-	GET_UINT32_BE (W[0], data, 0);
-	GET_UINT32_BE (W[1], data, 4);
-	GET_UINT32_BE (W[2], data, 8);
-	GET_UINT32_BE (W[3], data, 12);
-	GET_UINT32_BE (W[4], data, 16);
-	GET_UINT32_BE (W[5], data, 20);
-	GET_UINT32_BE (W[6], data, 24);
-	GET_UINT32_BE (W[7], data, 28);
-	GET_UINT32_BE (W[8], data, 32);
-	GET_UINT32_BE (W[9], data, 36);
-	GET_UINT32_BE (W[10], data, 40);
-	GET_UINT32_BE (W[11], data, 44);
-	GET_UINT32_BE (W[12], data, 48);
-	GET_UINT32_BE (W[13], data, 52);
-	GET_UINT32_BE (W[14], data, 56);
-	GET_UINT32_BE (W[15], data, 60);
+	uint32_t temp, W[16], A, B, C, D, E;
 
 #define S(x,n)	((x << n) | ((x & 0xFFFFFFFF) >> (32 - n)))
 
@@ -100,29 +88,47 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 	D = ctx->state[3];
 	E = ctx->state[4];
 
+	for (; blocks; blocks--, data += 64) {
+		GET_UINT32_BE (W[0], data, 0);
+		GET_UINT32_BE (W[1], data, 4);
+		GET_UINT32_BE (W[2], data, 8);
+		GET_UINT32_BE (W[3], data, 12);
+		GET_UINT32_BE (W[4], data, 16);
+		GET_UINT32_BE (W[5], data, 20);
+		GET_UINT32_BE (W[6], data, 24);
+		GET_UINT32_BE (W[7], data, 28);
+		GET_UINT32_BE (W[8], data, 32);
+		GET_UINT32_BE (W[9], data, 36);
+		GET_UINT32_BE (W[10], data, 40);
+		GET_UINT32_BE (W[11], data, 44);
+		GET_UINT32_BE (W[12], data, 48);
+		GET_UINT32_BE (W[13], data, 52);
+		GET_UINT32_BE (W[14], data, 56);
+		GET_UINT32_BE (W[15], data, 60);
+
 #define F(x,y,z) (z ^ (x & (y ^ z)))
 #define K 0x5A827999
 
-	P (A, B, C, D, E, W[0]);
-	P (E, A, B, C, D, W[1]);
-	P (D, E, A, B, C, W[2]);
-	P (C, D, E, A, B, W[3]);
-	P (B, C, D, E, A, W[4]);
-	P (A, B, C, D, E, W[5]);
-	P (E, A, B, C, D, W[6]);
-	P (D, E, A, B, C, W[7]);
-	P (C, D, E, A, B, W[8]);
-	P (B, C, D, E, A, W[9]);
-	P (A, B, C, D, E, W[10]);
-	P (E, A, B, C, D, W[11]);
-	P (D, E, A, B, C, W[12]);
-	P (C, D, E, A, B, W[13]);
-	P (B, C, D, E, A, W[14]);
-	P (A, B, C, D, E, W[15]);
-	P (E, A, B, C, D, R (16));
-	P (D, E, A, B, C, R (17));
-	P (C, D, E, A, B, R (18));
-	P (B, C, D, E, A, R (19));
+		P (A, B, C, D, E, W[0]);
+		P (E, A, B, C, D, W[1]);
+		P (D, E, A, B, C, W[2]);
+		P (C, D, E, A, B, W[3]);
+		P (B, C, D, E, A, W[4]);
+		P (A, B, C, D, E, W[5]);
+		P (E, A, B, C, D, W[6]);
+		P (D, E, A, B, C, W[7]);
+		P (C, D, E, A, B, W[8]);
+		P (B, C, D, E, A, W[9]);
+		P (A, B, C, D, E, W[10]);
+		P (E, A, B, C, D, W[11]);
+		P (D, E, A, B, C, W[12]);
+		P (C, D, E, A, B, W[13]);
+		P (B, C, D, E, A, W[14]);
+		P (A, B, C, D, E, W[15]);
+		P (E, A, B, C, D, R (16));
+		P (D, E, A, B, C, R (17));
+		P (C, D, E, A, B, R (18));
+		P (B, C, D, E, A, R (19));
 
 #undef K
 #undef F
@@ -130,26 +136,26 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 #define F(x,y,z) (x ^ y ^ z)
 #define K 0x6ED9EBA1
 
-	P (A, B, C, D, E, R (20));
-	P (E, A, B, C, D, R (21));
-	P (D, E, A, B, C, R (22));
-	P (C, D, E, A, B, R (23));
-	P (B, C, D, E, A, R (24));
-	P (A, B, C, D, E, R (25));
-	P (E, A, B, C, D, R (26));
-	P (D, E, A, B, C, R (27));
-	P (C, D, E, A, B, R (28));
-	P (B, C, D, E, A, R (29));
-	P (A, B, C, D, E, R (30));
-	P (E, A, B, C, D, R (31));
-	P (D, E, A, B, C, R (32));
-	P (C, D, E, A, B, R (33));
-	P (B, C, D, E, A, R (34));
-	P (A, B, C, D, E, R (35));
-	P (E, A, B, C, D, R (36));
-	P (D, E, A, B, C, R (37));
-	P (C, D, E, A, B, R (38));
-	P (B, C, D, E, A, R (39));
+		P (A, B, C, D, E, R (20));
+		P (E, A, B, C, D, R (21));
+		P (D, E, A, B, C, R (22));
+		P (C, D, E, A, B, R (23));
+		P (B, C, D, E, A, R (24));
+		P (A, B, C, D, E, R (25));
+		P (E, A, B, C, D, R (26));
+		P (D, E, A, B, C, R (27));
+		P (C, D, E, A, B, R (28));
+		P (B, C, D, E, A, R (29));
+		P (A, B, C, D, E, R (30));
+		P (E, A, B, C, D, R (31));
+		P (D, E, A, B, C, R (32));
+		P (C, D, E, A, B, R (33));
+		P (B, C, D, E, A, R (34));
+		P (A, B, C, D, E, R (35));
+		P (E, A, B, C, D, R (36));
+		P (D, E, A, B, C, R (37));
+		P (C, D, E, A, B, R (38));
+		P (B, C, D, E, A, R (39));
 
 #undef K
 #undef F
@@ -157,26 +163,26 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 #define F(x,y,z) ((x & y) | (z & (x | y)))
 #define K 0x8F1BBCDC
 
-	P (A, B, C, D, E, R (40));
-	P (E, A, B, C, D, R (41));
-	P (D, E, A, B, C, R (42));
-	P (C, D, E, A, B, R (43));
-	P (B, C, D, E, A, R (44));
-	P (A, B, C, D, E, R (45));
-	P (E, A, B, C, D, R (46));
-	P (D, E, A, B, C, R (47));
-	P (C, D, E, A, B, R (48));
-	P (B, C, D, E, A, R (49));
-	P (A, B, C, D, E, R (50));
-	P (E, A, B, C, D, R (51));
-	P (D, E, A, B, C, R (52));
-	P (C, D, E, A, B, R (53));
-	P (B, C, D, E, A, R (54));
-	P (A, B, C, D, E, R (55));
-	P (E, A, B, C, D, R (56));
-	P (D, E, A, B, C, R (57));
-	P (C, D, E, A, B, R (58));
-	P (B, C, D, E, A, R (59));
+		P (A, B, C, D, E, R (40));
+		P (E, A, B, C, D, R (41));
+		P (D, E, A, B, C, R (42));
+		P (C, D, E, A, B, R (43));
+		P (B, C, D, E, A, R (44));
+		P (A, B, C, D, E, R (45));
+		P (E, A, B, C, D, R (46));
+		P (D, E, A, B, C, R (47));
+		P (C, D, E, A, B, R (48));
+		P (B, C, D, E, A, R (49));
+		P (A, B, C, D, E, R (50));
+		P (E, A, B, C, D, R (51));
+		P (D, E, A, B, C, R (52));
+		P (C, D, E, A, B, R (53));
+		P (B, C, D, E, A, R (54));
+		P (A, B, C, D, E, R (55));
+		P (E, A, B, C, D, R (56));
+		P (D, E, A, B, C, R (57));
+		P (C, D, E, A, B, R (58));
+		P (B, C, D, E, A, R (59));
 
 #undef K
 #undef F
@@ -184,35 +190,36 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 #define F(x,y,z) (x ^ y ^ z)
 #define K 0xCA62C1D6
 
-	P (A, B, C, D, E, R (60));
-	P (E, A, B, C, D, R (61));
-	P (D, E, A, B, C, R (62));
-	P (C, D, E, A, B, R (63));
-	P (B, C, D, E, A, R (64));
-	P (A, B, C, D, E, R (65));
-	P (E, A, B, C, D, R (66));
-	P (D, E, A, B, C, R (67));
-	P (C, D, E, A, B, R (68));
-	P (B, C, D, E, A, R (69));
-	P (A, B, C, D, E, R (70));
-	P (E, A, B, C, D, R (71));
-	P (D, E, A, B, C, R (72));
-	P (C, D, E, A, B, R (73));
-	P (B, C, D, E, A, R (74));
-	P (A, B, C, D, E, R (75));
-	P (E, A, B, C, D, R (76));
-	P (D, E, A, B, C, R (77));
-	P (C, D, E, A, B, R (78));
-	P (B, C, D, E, A, R (79));
+		P (A, B, C, D, E, R (60));
+		P (E, A, B, C, D, R (61));
+		P (D, E, A, B, C, R (62));
+		P (C, D, E, A, B, R (63));
+		P (B, C, D, E, A, R (64));
+		P (A, B, C, D, E, R (65));
+		P (E, A, B, C, D, R (66));
+		P (D, E, A, B, C, R (67));
+		P (C, D, E, A, B, R (68));
+		P (B, C, D, E, A, R (69));
+		P (A, B, C, D, E, R (70));
+		P (E, A, B, C, D, R (71));
+		P (D, E, A, B, C, R (72));
+		P (C, D, E, A, B, R (73));
+		P (B, C, D, E, A, R (74));
+		P (A, B, C, D, E, R (75));
+		P (E, A, B, C, D, R (76));
+		P (D, E, A, B, C, R (77));
+		P (C, D, E, A, B, R (78));
+		P (B, C, D, E, A, R (79));
 
 #undef K
 #undef F
 
-	ctx->state[0] += A;
-	ctx->state[1] += B;
-	ctx->state[2] += C;
-	ctx->state[3] += D;
-	ctx->state[4] += E;
+		A = ctx->state[0] = (ctx->state[0] + A) & 0xFFFFFFFF;
+		B = ctx->state[1] = (ctx->state[1] + B) & 0xFFFFFFFF;
+		C = ctx->state[2] = (ctx->state[2] + C) & 0xFFFFFFFF;
+		D = ctx->state[3] = (ctx->state[3] + D) & 0xFFFFFFFF;
+		E = ctx->state[4] = (ctx->state[4] + E) & 0xFFFFFFFF;
+	}
 }
 
 /*
@@ -238,16 +245,16 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 
 	if (left && ilen >= fill) {
 		memcpy ((void *) (ctx->buffer + left), (void *) input, fill);
-		sha1_process (ctx, ctx->buffer);
+		sha1_process (ctx, ctx->buffer, 1);
 		input += fill;
 		ilen -= fill;
 		left = 0;
 	}
 
-	while (ilen >= 64) {
-		sha1_process (ctx, input);
-		input += 64;
-		ilen -= 64;
+	if (ilen >= 64) {
+		sha1_process (ctx, input, ilen / 64);
+		input += ilen & ~0x3F;
+		ilen &= 0x3F;
 	}
 
 	if (ilen > 0) {
@@ -425,6 +425,15 @@ char *strswab(const char *s)
 }
 #endif
 
+/*
+ * The memory functions below work a word (32 bits or 64 bits) at a time
+ * where they can. Words are only ever accessed at naturally aligned
+ * addresses, so they are safe on architectures which do not support
+ * unaligned accesses.
+ */
+#define WORD_SIZE	sizeof(unsigned long)
+#define WORD_MASK	(WORD_SIZE - 1)
+
 #ifndef __HAVE_ARCH_MEMSET
 /**
  * memset - Fill a region of memory with the given value
@@ -436,24 +445,41 @@ char *strswab(const char *s)
  */
 void * memset(void * s,int c,size_t count)
 {
-	unsigned long *sl = (unsigned long *) s;
-	unsigned long cl = 0;
-	char *s8;
-	int i;
-
-	/* do it one word at a time (32 bits or 64 bits) while possible */
-	if ( ((ulong)s & (sizeof(*sl) - 1)) == 0) {
-		for (i = 0; i < sizeof(*sl); i++) {
-			cl <<= 8;
-			cl |= c & 0xff;
+	unsigned long *sl;
+	unsigned long cl;
+	char *s8 = s;
+
+	/* short areas are not worth aligning */
+	if (count >= 2 * WORD_SIZE) {
+		/* fill 8 bits at a time up to a word boundary */
+		while ((ulong)s8 & WORD_MASK) {
+			*s8++ = c;
+			count--;
+		}
+
+		cl = (unsigned char)c;
+		cl |= cl << 8;
+		cl |= cl << 16;
+		if (WORD_SIZE > 4)
+			cl |= (cl << 16) << 16;
+
+		/* then four words per iteration, then a word at a time */
+		sl = (unsigned long *)s8;
+		while (count >= 4 * WORD_SIZE) {
+			sl[0] = cl;
+			sl[1] = cl;
+			sl[2] = cl;
+			sl[3] = cl;
+			sl += 4;
+			count -= 4 * WORD_SIZE;
 		}
-		while (count >= sizeof(*sl)) {
+		while (count >= WORD_SIZE) {
 			*sl++ = cl;
-			count -= sizeof(*sl);
+			count -= WORD_SIZE;
 		}
+		s8 = (char *)sl;
 	}
-	/* fill 8 bits at a time */
-	s8 = (char *)sl;
+	/* fill the rest 8 bits at a time */
 	while (count--)
 		*s8++ = c;
 
@@ -497,22 +523,49 @@ char * bcopy(const char * src, char * dest, int count)
  */
 void * memcpy(void *dest, const void *src, size_t count)
 {
-	unsigned long *dl = (unsigned long *)dest, *sl = (unsigned long *)src;
-	char *d8, *s8;
+	unsigned long *dl;
+	const unsigned long *sl;
+	unsigned long w0, w1, w2, w3;
+	char *d8 = dest;
+	const char *s8 = src;
 
 	if (src == dest)
 		return dest;
 
-	/* while all data is aligned (common case), copy a word at a time */
-	if ( (((ulong)dest | (ulong)src) & (sizeof(*dl) - 1)) == 0) {
-		while (count >= sizeof(*dl)) {
+	/*
+	 * When both areas can be brought to a word boundary together
+	 * (common case), copy a word at a time
+	 */
+	if (count >= 2 * WORD_SIZE &&
+	    (((ulong)d8 ^ (ulong)s8) & WORD_MASK) == 0) {
+		while ((ulong)d8 & WORD_MASK) {
+			*d8++ = *s8++;
+			count--;
+		}
+
+		dl = (unsigned long *)d8;
+		sl = (const unsigned long *)s8;
+		while (count >= 4 * WORD_SIZE) {
+			w0 = sl[0];
+			w1 = sl[1];
+			w2 = sl[2];
+			w3 = sl[3];
+			dl[0] = w0;
+			dl[1] = w1;
+			dl[2] = w2;
+			dl[3] = w3;
+			dl += 4;
+			sl += 4;
+			count -= 4 * WORD_SIZE;
+		}
+		while (count >= WORD_SIZE) {
 			*dl++ = *sl++;
-			count -= sizeof(*dl);
+			count -= WORD_SIZE;
 		}
+		d8 = (char *)dl;
+		s8 = (const char *)sl;
 	}
-	/* copy the reset one byte at a time */
-	d8 = (char *)dl;
-	s8 = (char *)sl;
+	/* copy the rest one byte at a time */
 	while (count--)
 		*d8++ = *s8++;
 
@@ -531,23 +584,65 @@ void * memcpy(void *dest, const void *src, size_t count)
  */
 void * memmove(void * dest,const void *src,size_t count)
 {
-	char *tmp, *s;
+	unsigned long *dl;
+	const unsigned long *sl;
+	char *d8;
+	const char *s8;
+	int words;
 
 	if (src == dest)
 		return dest;
 
-	if (dest <= src) {
-		tmp = (char *) dest;
-		s = (char *) src;
-		while (count--)
-			*tmp++ = *s++;
+	/* areas which do not overlap can use the faster memcpy() */
+	if ((const char *)src + count <= (char *)dest ||
+	    (char *)dest + count <= (const char *)src)
+		return memcpy(dest, src, count);
+
+	/* a word at a time if both areas share the same alignment */
+	words = count >= 2 * WORD_SIZE &&
+		(((ulong)dest ^ (ulong)src) & WORD_MASK) == 0;
+
+	if (dest < src) {
+		/* copy forwards, each word is read before it is overwritten */
+		d8 = dest;
+		s8 = src;
+		if (words) {
+			while ((ulong)d8 & WORD_MASK) {
+				*d8++ = *s8++;
+				count--;
+			}
+			dl = (unsigned long *)d8;
+			sl = (const unsigned long *)s8;
+			while (count >= WORD_SIZE) {
+				*dl++ = *sl++;
+				count -= WORD_SIZE;
+			}
+			d8 = (char *)dl;
+			s8 = (const char *)sl;
 		}
-	else {
-		tmp = (char *) dest + count;
-		s = (char *) src + count;
 		while (count--)
-			*--tmp = *--s;
+			*d8++ = *s8++;
+	} else {
+		/* copy backwards, starting from the end */
+		d8 = (char *)dest + count;
+		s8 = (const char *)src + count;
+		if (words) {
+			while ((ulong)d8 & WORD_MASK) {
+				*--d8 = *--s8;
+				count--;
+			}
+			dl = (unsigned long *)d8;
+			sl = (const unsigned long *)s8;
+			while (count >= WORD_SIZE) {
+				*--dl = *--sl;
+				count -= WORD_SIZE;
+			}
+			d8 = (char *)dl;
+			s8 = (const char *)sl;
 		}
+		while (count--)
+			*--d8 = *--s8;
+	}
 
 	return dest;
 }
@@ -562,10 +657,32 @@ void * memmove(void * dest,const void *src,size_t count)
  */
 int memcmp(const void * cs,const void * ct,size_t count)
 {
-	const unsigned char *su1, *su2;
+	const unsigned char *su1 = cs, *su2 = ct;
 	int res = 0;
 
-	for( su1 = cs, su2 = ct; 0 < count; ++su1, ++su2, count--)
+	/*
+	 * Skip over equal words while both areas can be word aligned
+	 * together, then find the differing byte (if any) one at a time
+	 */
+	if (count >= WORD_SIZE &&
+	    (((ulong)su1 ^ (ulong)su2) & WORD_MASK) == 0) {
+		while ((ulong)su1 & WORD_MASK) {
+			if ((res = *su1 - *su2) != 0)
+				return res;
+			su1++;
+			su2++;
+			count--;
+		}
+		while (count >= WORD_SIZE &&
+		       *(const unsigned long *)su1 ==
+		       *(const unsigned long *)su2) {
+			su1 += WORD_SIZE;
+			su2 += WORD_SIZE;
+			count -= WORD_SIZE;
+		}
+	}
+
+	for( ; 0 < count; ++su1, ++su2, count--)
 		if ((res = *su1 - *su2) != 0)
 			break;
 	return res;
@@ -0,0 +1,172 @@
+/*
+ * Cooperative tasks
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <malloc.h>
+#include <task.h>
+#include <watchdog.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Written at the bottom of each task stack to detect overflow */
+#define TASK_STACK_MAGIC	0x7a5c57ac
+
+/* The caller of the first task_create(), normally the command line */
+static struct task main_task = {
+	.name	= "main",
+	.state	= TASK_RUNNING,
+};
+
+/* Tasks which can run, including the current one */
+static LIST_HEAD(run_queue);
+static struct task *current;
+
+/* Number of tasks in the run queue other than the main task */
+static int task_count;
+
+static struct task *task_next(struct task *task)
+{
+	struct list_head *next = task->list.next;
+
+	if (next == &run_queue)
+		next = next->next;
+
+	return list_entry(next, struct task, list);
+}
+
+static void task_switch(struct task *from, struct task *to)
+{
+	if (from->stack && *(u32 *)from->stack != TASK_STACK_MAGIC)
+		panic("task '%s': stack overflow\n", from->name);
+	current = to;
+	to->state = TASK_RUNNING;
+	arch_task_switch(from->ctx, to->ctx);
+}
+
+static void task_entry(void)
+{
+	struct task *task = current;
+	struct task *next;
+
+	task->ret = task->func(task->arg);
+	debug("task '%s' done, ret=%d\n", task->name, task->ret);
+	next = task_next(task);
+	list_del(&task->list);
+	task_count--;
+	task->state = TASK_DONE;
+	task_switch(task, next);
+	panic("task '%s' resumed after finishing\n", task->name);
+}
+
+int task_create(const char *name, task_func_t func, void *arg,
+		struct task **taskp)
+{
+	struct task *task;
+	int ret;
+
+	if (!(gd->flags & GD_FLG_RELOC))
+		return -EPERM;
+	if (!current) {
+		ret = arch_task_init(&main_task.ctx, NULL, 0, NULL);
+		if (ret)
+			return ret;
+		list_add_tail(&main_task.list, &run_queue);
+		current = &main_task;
+	}
+
+	task = calloc(1, sizeof(*task));
+	if (!task)
+		return -ENOMEM;
+	task->stack = memalign(ARCH_DMA_MINALIGN, CONFIG_TASK_STACK_SIZE);
+	if (!task->stack) {
+		free(task);
+		return -ENOMEM;
+	}
+	*(u32 *)task->stack = TASK_STACK_MAGIC;
+	ret = arch_task_init(&task->ctx, task->stack, CONFIG_TASK_STACK_SIZE,
+			     task_entry);
+	if (ret) {
+		free(task->stack);
+		free(task);
+		return ret;
+	}
+	task->name = name;
+	task->func = func;
+	task->arg = arg;
+	task->state = TASK_NEW;
+	list_add_tail(&task->list, &run_queue);
+	task_count++;
+	debug("task '%s' created\n", name);
+	*taskp = task;
+
+	return 0;
+}
+
+bool task_pending(void)
+{
+	/* The run queue is not set up before relocation */
+	if (!(gd->flags & GD_FLG_RELOC))
+		return false;
+
+	return task_count > 0;
+}
+
+int task_yield(void)
+{
+	struct task *next;
+
+	if (!task_pending())
+		return 0;
+	next = task_next(current);
+	if (next != current)
+		task_switch(current, next);
+
+	return current->stop ? -EINTR : 0;
+}
+
+void task_stop(struct task *task)
+{
+	task->stop = true;
+	if (task->state == TASK_NEW) {
+		list_del(&task->list);
+		task_count--;
+		task->ret = -EINTR;
+		task->state = TASK_DONE;
+	}
+}
+
+bool task_should_stop(void)
+{
+	return current && current->stop;
+}
+
+int task_join(struct task *task, ulong timeout_ms)
+{
+	ulong start = get_timer(0);
+
+	if (task == current)
+		return -EDEADLK;
+	while (task->state != TASK_DONE) {
+		if (timeout_ms && get_timer(start) > timeout_ms)
+			return -ETIMEDOUT;
+		WATCHDOG_RESET();
+		task_yield();
+	}
+
+	return task->ret;
+}
+
+int task_free(struct task *task)
+{
+	if (task->state != TASK_DONE)
+		return -EBUSY;
+	arch_task_free(task->ctx);
+	free(task->stack);
+	free(task);
+
+	return 0;
+}
@@ -8,6 +8,7 @@
 #include <common.h>
 #include <dm.h>
 #include <errno.h>
+#include <task.h>
 #include <timer.h>
 #include <watchdog.h>
 #include <div64.h>
@@ -147,6 +148,17 @@ void udelay(unsigned long usec)
 {
 	ulong kv;
 
+	/* Let other tasks run rather than spin */
+	if (task_pending()) {
+		ulong start = timer_get_us();
+
+		do {
+			WATCHDOG_RESET();
+			task_yield();
+		} while (timer_get_us() - start < usec);
+		return;
+	}
+
 	do {
 		WATCHDOG_RESET();
 		kv = usec > CONFIG_WD_PERIOD ? CONFIG_WD_PERIOD : usec;
@@ -31,6 +31,85 @@
 #  define PUP(a) *++(a)
 #endif
 
+/*
+   Copy a match of len bytes (at least three) which is dist bytes back in the
+   output, two bytes at a time. This is also correct when the copy overlaps
+   itself, i.e. when dist < len.
+ */
+local unsigned char FAR *copy_match(unsigned char FAR *out,
+                                    unsigned char FAR *from,
+                                    unsigned dist, unsigned len)
+{
+    unsigned short *sout;
+    unsigned long loops;
+
+    /* Align out addr */
+    if (!((long)(out - 1 + OFF) & 1)) {
+	PUP(out) = PUP(from);
+	len--;
+    }
+    sout = (unsigned short *)(out - OFF);
+    if (dist > 2 ) {
+	unsigned short *sfrom;
+
+	sfrom = (unsigned short *)(from - OFF);
+	loops = len >> 1;
+	do
+	    PUP(sout) = get_unaligned(++sfrom);
+	while (--loops);
+	out = (unsigned char *)sout + OFF;
+	from = (unsigned char *)sfrom + OFF;
+    } else { /* dist == 1 or dist == 2 */
+	unsigned short pat16;
+
+	pat16 = *(sout-2+2*OFF);
+	if (dist == 1)
+#if defined(__BIG_ENDIAN)
+	    pat16 = (pat16 & 0xff) | ((pat16 & 0xff ) << 8);
+#elif defined(__LITTLE_ENDIAN)
+	    pat16 = (pat16 & 0xff00) | ((pat16 & 0xff00 ) >> 8);
+#else
+#error __BIG_ENDIAN nor __LITTLE_ENDIAN is defined
+#endif
+	loops = len >> 1;
+	do
+	    PUP(sout) = pat16;
+	while (--loops);
+	out = (unsigned char *)sout + OFF;
+    }
+    if (len & 1)
+	PUP(out) = PUP(from);
+
+    return out;
+}
+
+#ifdef INFLATE_FAST_WIDE
+/*
+   Copy a match which is at least eight bytes back, eight bytes at a time.
+   Each eight-byte piece is read before it is written, and comes from
+   before it, so the overlapping case works too.
+ */
+local unsigned char FAR *copy_match_wide(unsigned char FAR *out,
+                                         unsigned char FAR *from,
+                                         unsigned len)
+{
+    out += OFF;
+    from += OFF;
+    while (len >= 8) {
+        put_unaligned(get_unaligned((u64 *)from), (u64 *)out);
+        out += 8;
+        from += 8;
+        len -= 8;
+    }
+    while (len) {
+        *out++ = *from++;
+        len--;
+    }
+
+    return out - OFF;
+}
+#endif
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -61,6 +140,11 @@
       Therefore if strm->avail_in >= 6, then there is enough input to avoid
       checking for available input while decoding.
 
+    - U-Boot: with INFLATE_FAST_WIDE the bit buffer is filled to at least 56
+      bits at the top of each loop with one eight-byte load, so the other
+      refills below never trigger. That load needs strm->avail_in >= 8,
+      which is INFLATE_FAST_MIN_HAVE.
+
     - The maximum bytes that a single length/distance pair can output is 258
       bytes, which is the maximum length that can be coded.  inflate_fast()
       requires strm->avail_out >= 258 for each loop to avoid checking for
@@ -98,14 +182,14 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* copy state to local variables */
     state = (struct inflate_state FAR *)strm->state;
     in = strm->next_in - OFF;
-    last = in + (strm->avail_in - 5);
-    if (in > last && strm->avail_in > 5) {
+    last = in + (strm->avail_in - (INFLATE_FAST_MIN_HAVE - 1));
+    if (in > last && strm->avail_in > INFLATE_FAST_MIN_HAVE - 1) {
         /*
          * overflow detected, limit strm->avail_in to the
          * max. possible size and recalculate last
          */
 	strm->avail_in = 0xffffffff - (uintptr_t)in;
-        last = in + (strm->avail_in - 5);
+        last = in + (strm->avail_in - (INFLATE_FAST_MIN_HAVE - 1));
     }
     out = strm->next_out - OFF;
     beg = out - (start - strm->avail_out);
@@ -127,12 +211,19 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
+#ifdef INFLATE_FAST_WIDE
+        /* bits above bits in hold are the same input again, hence |= */
+        hold |= (unsigned long)get_unaligned_le64(in + OFF) << bits;
+        in += (63 - bits) >> 3;
+        bits |= 56;
+#else
         if (bits < 15) {
             hold += (unsigned long)(PUP(in)) << bits;
             bits += 8;
             hold += (unsigned long)(PUP(in)) << bits;
             bits += 8;
         }
+#endif
         this = lcode[hold & lmask];
       dolen:
         op = (unsigned)(this.bits);
@@ -253,47 +344,13 @@ void inflate_fast(z_streamp strm, unsigned start)
                     }
                 }
                 else {
-		    unsigned short *sout;
-		    unsigned long loops;
-
                     from = out - dist;          /* copy direct from output */
-                    /* minimum length is three */
-		    /* Align out addr */
-		    if (!((long)(out - 1 + OFF) & 1)) {
-			PUP(out) = PUP(from);
-			len--;
-		    }
-		    sout = (unsigned short *)(out - OFF);
-		    if (dist > 2 ) {
-			unsigned short *sfrom;
-
-			sfrom = (unsigned short *)(from - OFF);
-			loops = len >> 1;
-			do
-			    PUP(sout) = get_unaligned(++sfrom);
-			while (--loops);
-			out = (unsigned char *)sout + OFF;
-			from = (unsigned char *)sfrom + OFF;
-		    } else { /* dist == 1 or dist == 2 */
-			unsigned short pat16;
-
-			pat16 = *(sout-2+2*OFF);
-			if (dist == 1)
-#if defined(__BIG_ENDIAN)
-			    pat16 = (pat16 & 0xff) | ((pat16 & 0xff ) << 8);
-#elif defined(__LITTLE_ENDIAN)
-			    pat16 = (pat16 & 0xff00) | ((pat16 & 0xff00 ) >> 8);
-#else
-#error __BIG_ENDIAN nor __LITTLE_ENDIAN is defined
+#ifdef INFLATE_FAST_WIDE
+                    if (dist >= 8)
+                        out = copy_match_wide(out, from, len);
+                    else
 #endif
-			loops = len >> 1;
-			do
-			    PUP(sout) = pat16;
-			while (--loops);
-			out = (unsigned char *)sout + OFF;
-		    }
-		    if (len & 1)
-			PUP(out) = PUP(from);
+                        out = copy_match(out, from, dist, len);
                 }
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
@@ -331,7 +388,9 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* update state and return */
     strm->next_in = in + OFF;
     strm->next_out = out + OFF;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
+    strm->avail_in = (unsigned)(in < last ?
+                                (INFLATE_FAST_MIN_HAVE - 1) + (last - in) :
+                                (INFLATE_FAST_MIN_HAVE - 1) - (in - last));
     strm->avail_out = (unsigned)(out < end ?
                                  257 + (end - out) : 257 - (out - end));
     state->hold = hold;
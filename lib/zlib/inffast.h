@@ -8,4 +8,14 @@
    subject to change. Applications should only use zlib.h.
  */
 
+/* U-Boot: on 64-bit machines inflate_fast() refills its bit buffer eight
+   bytes at a time, so it needs a little more input in hand */
+#if BITS_PER_LONG == 64
+#  define INFLATE_FAST_WIDE
+#  define INFLATE_FAST_MIN_HAVE 8
+#else
+#  define INFLATE_FAST_MIN_HAVE 6
+#endif
+#define INFLATE_FAST_MIN_LEFT 258
+
 void inflate_fast OF((z_streamp strm, unsigned start));
@@ -155,6 +155,11 @@ local int updatewindow(z_streamp strm, unsigned out)
 #  define UPDATE(check, buf, len) adler32(check, buf, len)
 #endif
 
+/* U-Boot: the check value is brought up to date every this many bytes of
+   output, while the output is still in cache, rather than in one pass over
+   all of it at the end */
+#define CHECK_CHUNK 16384
+
 /* check macros for header crc */
 #ifdef GUNZIP
 #  define CRC2(check, word) \
@@ -334,6 +339,7 @@ int ZEXPORT inflate(z_streamp strm, int flush)
     unsigned long hold;         /* bit buffer */
     unsigned bits;              /* bits in bit buffer */
     unsigned in, out;           /* save starting available input and output */
+    unsigned char FAR *chk;     /* first output byte not in the check value */
     unsigned copy;              /* number of stored or match bytes to copy */
     unsigned char FAR *from;    /* where to copy match bytes from */
     code this;                  /* current decoding table entry */
@@ -353,6 +359,7 @@ int ZEXPORT inflate(z_streamp strm, int flush)
     state = (struct inflate_state FAR *)strm->state;
     if (state->mode == TYPE) state->mode = TYPEDO;      /* skip check */
     LOAD();
+    chk = put;
     in = have;
     out = left;
     ret = Z_OK;
@@ -701,7 +708,7 @@ int ZEXPORT inflate(z_streamp strm, int flush)
             /* build code tables */
             state->next = state->codes;
             state->lencode = (code const FAR *)(state->next);
-            state->lenbits = 9;
+            state->lenbits = 10;        /* U-Boot: was 9, see ENOUGH */
             ret = inflate_table(LENS, state->lens, state->nlen, &(state->next),
                                 &(state->lenbits), state->work);
             if (ret) {
@@ -722,10 +729,22 @@ int ZEXPORT inflate(z_streamp strm, int flush)
             state->mode = LEN;
         case LEN:
 	    WATCHDOG_RESET();
-            if (have >= 6 && left >= 258) {
+            if (have >= INFLATE_FAST_MIN_HAVE && left >= INFLATE_FAST_MIN_LEFT) {
                 RESTORE();
-                inflate_fast(strm, out);
+                if (state->wrap && left > CHECK_CHUNK) {
+                    /* hide the rest of the output space for now */
+                    copy = left - CHECK_CHUNK;
+                    strm->avail_out -= copy;
+                    inflate_fast(strm, out - copy);
+                    strm->avail_out += copy;
+                }
+                else
+                    inflate_fast(strm, out);
                 LOAD();
+                if (state->wrap && put - chk >= CHECK_CHUNK) {
+                    state->check = UPDATE(state->check, chk, put - chk);
+                    chk = put;
+                }
                 break;
             }
             for (;;) {
@@ -854,9 +873,10 @@ int ZEXPORT inflate(z_streamp strm, int flush)
                 out -= left;
                 strm->total_out += out;
                 state->total += out;
-                if (out)
+                if (put != chk)
                     strm->adler = state->check =
-                        UPDATE(state->check, put - out, out);
+                        UPDATE(state->check, chk, put - chk);
+                chk = put;
                 out = left;
                 if ((
 #ifdef GUNZIP
@@ -916,9 +936,9 @@ int ZEXPORT inflate(z_streamp strm, int flush)
     strm->total_in += in;
     strm->total_out += out;
     state->total += out;
-    if (state->wrap && out)
+    if (state->wrap && strm->next_out != chk)
         strm->adler = state->check =
-            UPDATE(state->check, strm->next_out - out, out);
+            UPDATE(state->check, chk, strm->next_out - chk);
     strm->data_type = state->bits + (state->last ? 64 : 0) +
                       (state->mode == TYPE ? 128 : 0);
     if (((in == 0 && out == 0) || flush == Z_FINISH) && ret == Z_OK)
@@ -39,7 +39,10 @@ typedef struct {
    exhaustive search was 1444 code structures (852 for length/literals
    and 592 for distances, the latter actually the result of an
    exhaustive search).  The true maximum is not known, but the value
-   below is more than safe. */
+   below is more than safe.
+   U-Boot: inflate() uses a 10-bit root table for lengths/literals, which
+   needs at most 1332 entries (as found by zlib's examples/enough.c), so
+   1924 in all, which still fits. */
 #define ENOUGH 2048
 #define MAXD 592
 
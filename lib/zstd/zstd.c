@@ -0,0 +1,53 @@
+/*
+ * U-Boot interface to zstd decompression
+ *
+ * SPDX-License-Identifier:	(GPL-2.0 OR BSD-3-Clause)
+ */
+
+#include <common.h>
+#include <errno.h>
+#include "zstd.h"
+#include "zstd_errors.h"
+
+int zstd_errno(size_t code)
+{
+	if (!ZSTD_isError(code))
+		return 0;
+
+	switch (ZSTD_getErrorCode(code)) {
+	case ZSTD_error_memory_allocation:
+		return -ENOMEM;
+	case ZSTD_error_dstSize_tooSmall:
+		return -ENOSPC;
+	case ZSTD_error_srcSize_wrong:
+		return -ENODATA;
+	case ZSTD_error_frameParameter_windowTooLarge:
+	case ZSTD_error_frameParameter_unsupported:
+	case ZSTD_error_dictionary_wrong:
+		return -EPROTONOSUPPORT;
+	default:
+		return -EINVAL;
+	}
+}
+
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	ZSTD_DCtx *dctx;
+	size_t ret;
+
+	dctx = ZSTD_createDCtx();
+	if (!dctx)
+		return -ENOMEM;
+	ret = ZSTD_decompressDCtx(dctx, dst, *dstn, src, srcn);
+	ZSTD_freeDCtx(dctx);
+	if (ZSTD_isError(ret)) {
+		debug("%s: %s\n", __func__, ZSTD_getErrorName(ret));
+		/* Leave *dstn as the buffer size if it was too small */
+		if (zstd_errno(ret) != -ENOSPC)
+			*dstn = 0;
+		return zstd_errno(ret);
+	}
+	*dstn = ret;
+
+	return 0;
+}
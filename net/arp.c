@@ -34,6 +34,8 @@ uchar	       *arp_wait_packet_ethaddr;
 int		arp_wait_tx_packet_size;
 ulong		arp_wait_timer_start;
 int		arp_wait_try;
+/* When the request being waited for was sent, or 0 if sent again */
+static ulong	arp_sent_us;
 
 static uchar   *arp_tx_packet;	/* THE ARP transmit packet */
 static uchar	arp_tx_packet_buf[PKTSIZE_ALIGN + PKTALIGN];
@@ -93,6 +95,7 @@ void arp_request(void)
 		net_arp_wait_reply_ip = net_arp_wait_packet_ip;
 	}
 
+	arp_sent_us = timer_get_us();
 	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
 }
 
@@ -108,6 +111,7 @@ int arp_timeout_check(void)
 	/* check for arp timeout */
 	if ((t - arp_wait_timer_start) > ARP_TIMEOUT) {
 		arp_wait_try++;
+		net_stats.arp.timeouts++;
 
 		if (arp_wait_try >= ARP_TIMEOUT_COUNT) {
 			puts("\nARP Retry count exceeded; starting again\n");
@@ -116,6 +120,8 @@ int arp_timeout_check(void)
 		} else {
 			arp_wait_timer_start = t;
 			arp_request();
+			arp_sent_us = 0;
+			net_stats.arp.resends++;
 		}
 	}
 	return 1;
@@ -209,6 +215,12 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 				   "Got ARP REPLY, set eth addr (%pM)\n",
 				   arp->ar_data);
 
+			if (arp_sent_us) {
+				net_rtt_add(&net_stats.arp.rtt,
+					    timer_get_us() - arp_sent_us);
+				arp_sent_us = 0;
+			}
+
 			/* save address for later use */
 			if (arp_wait_packet_ethaddr != NULL)
 				memcpy(arp_wait_packet_ethaddr,
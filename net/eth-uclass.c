@@ -20,9 +20,11 @@ DECLARE_GLOBAL_DATA_PTR;
  * struct eth_device_priv - private structure for each Ethernet device
  *
  * @state: The state of the Ethernet MAC driver (defined by enum eth_state_t)
+ * @stats: Counts of packets sent and received
  */
 struct eth_device_priv {
 	enum eth_state_t state;
+	struct eth_stats stats;
 };
 
 /**
@@ -328,6 +330,7 @@ int eth_is_active(struct udevice *dev)
 int eth_send(void *packet, int length)
 {
 	struct udevice *current;
+	struct eth_device_priv *priv;
 	int ret;
 
 	current = eth_get_dev();
@@ -337,10 +340,15 @@ int eth_send(void *packet, int length)
 	if (!device_active(current))
 		return -EINVAL;
 
+	priv = current->uclass_priv;
 	ret = eth_get_ops(current)->send(current, packet, length);
 	if (ret < 0) {
 		/* We cannot completely return the error at present */
 		debug("%s: send() returned error %d\n", __func__, ret);
+		priv->stats.tx_errors++;
+	} else {
+		priv->stats.tx_packets++;
+		priv->stats.tx_bytes += length;
 	}
 	return ret;
 }
@@ -348,6 +356,7 @@ int eth_send(void *packet, int length)
 int eth_rx(void)
 {
 	struct udevice *current;
+	struct eth_device_priv *priv;
 	uchar *packet;
 	int flags;
 	int ret;
@@ -360,27 +369,52 @@ int eth_rx(void)
 	if (!device_active(current))
 		return -EINVAL;
 
-	/* Process up to 32 packets at one time */
+	/* Process up to a ring of packets, and at least 32, at one time */
+	priv = current->uclass_priv;
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < 32; i++) {
+	for (i = 0; i < max(PKTBUFSRX, 32); i++) {
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
-		if (ret > 0)
+		if (ret > 0) {
+			priv->stats.rx_packets++;
+			priv->stats.rx_bytes += ret;
 			net_process_received_packet(packet, ret);
+		}
 		if (ret >= 0 && eth_get_ops(current)->free_pkt)
 			eth_get_ops(current)->free_pkt(current, packet, ret);
 		if (ret <= 0)
 			break;
 	}
+	if (eth_get_ops(current)->get_rx_dropped) {
+		int dropped = eth_get_ops(current)->get_rx_dropped(current);
+
+		if (dropped > 0) {
+			priv->stats.rx_dropped += dropped;
+			net_stats.rx_dropped += dropped;
+		}
+	}
+	/* Many drivers say -EAGAIN when they simply have nothing to give */
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
 		/* We cannot completely return the error at present */
 		debug("%s: recv() returned error %d\n", __func__, ret);
+		priv->stats.rx_errors++;
 	}
 	return ret;
 }
 
+const struct eth_stats *eth_get_stats(struct udevice *dev)
+{
+	struct eth_device_priv *priv;
+
+	if (!device_active(dev))
+		return NULL;
+	priv = dev->uclass_priv;
+
+	return &priv->stats;
+}
+
 int eth_initialize(void)
 {
 	int num_devices = 0;
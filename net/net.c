@@ -78,6 +78,15 @@
  *			- own IP address
  *	We want:	- network time
  *	Next step:	none
+ *
+ * WGET:
+ *
+ *	Prerequisites:	- own ethernet address
+ *			- own IP address
+ *			- HTTP server IP address
+ *			- name of bootfile
+ *	We want:	- load the boot file over a TCP connection
+ *	Next step:	none
  */
 
 
@@ -92,6 +101,7 @@
 #include <miiphy.h>
 #include <status_led.h>
 #endif
+#include <task.h>
 #include <watchdog.h>
 #include <linux/compiler.h>
 #include "arp.h"
@@ -107,6 +117,12 @@
 #if defined(CONFIG_CMD_SNTP)
 #include "sntp.h"
 #endif
+#ifdef CONFIG_NET_TCP
+#include "tcp.h"
+#endif
+#if defined(CONFIG_CMD_WGET)
+#include "wget.h"
+#endif
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -185,6 +201,14 @@ uchar *net_rx_packets[PKTBUFSRX];
 static rxhand_f *udp_packet_handler;
 /* Current ARP RX packet handler */
 static rxhand_f *arp_packet_handler;
+/* Current handler placing the data of fragmented UDP datagrams */
+static rxplace_f *udp_place_handler;
+/* Where the datagram being reassembled is placed, if placing */
+static struct net_rx_place rx_place;
+/* Where the data in the current UDP packet was placed */
+uchar *net_rx_placed;
+/* What has been received */
+struct net_stats net_stats;
 #ifdef CONFIG_CMD_TFTPPUT
 /* Current ICMP rx handler */
 static rxhand_icmp_f *packet_icmp_handler;
@@ -351,8 +375,12 @@ static void net_init_loop(void)
 static void net_clear_handlers(void)
 {
 	net_set_udp_handler(NULL);
+	net_set_udp_place_handler(NULL);
 	net_set_arp_handler(NULL);
 	net_set_timeout_handler(0, NULL);
+#ifdef CONFIG_NET_TCP
+	tcp_clear();
+#endif
 }
 
 static void net_cleanup_loop(void)
@@ -391,9 +419,56 @@ void net_init(void)
  *	Main network processing loop.
  */
 
+void net_rtt_add(struct net_rtt_hist *hist, ulong us)
+{
+	int i;
+
+	for (i = 0; i < NET_RTT_BUCKETS - 1; i++) {
+		if (us < (NET_RTT_MIN_US << i))
+			break;
+	}
+	hist->bucket[i]++;
+	hist->count++;
+	hist->total_us += us;
+	hist->max_us = max(hist->max_us, us);
+}
+
+#ifdef CONFIG_NET_STATS_ENV
+/* Sets environment variables with what happened since @start */
+static void net_stats_to_env(const struct net_stats *start)
+{
+	const struct net_stats *now = &net_stats;
+	ulong count, total_us;
+
+	setenv_ulong("net_rx_packets", now->rx_packets - start->rx_packets);
+	setenv_ulong("net_rx_lost", now->rx_dropped - start->rx_dropped +
+		     now->rx_bad - start->rx_bad);
+	setenv_ulong("net_timeouts", now->arp.timeouts - start->arp.timeouts +
+		     now->tftp.timeouts - start->tftp.timeouts +
+		     now->nfs.timeouts - start->nfs.timeouts);
+	setenv_ulong("net_resends", now->arp.resends - start->arp.resends +
+		     now->tftp.resends - start->tftp.resends +
+		     now->nfs.resends - start->nfs.resends);
+
+	count = now->arp.rtt.count - start->arp.rtt.count +
+		now->tftp.rtt.count - start->tftp.rtt.count +
+		now->nfs.rtt.count - start->nfs.rtt.count;
+	total_us = now->arp.rtt.total_us - start->arp.rtt.total_us +
+		now->tftp.rtt.total_us - start->tftp.rtt.total_us +
+		now->nfs.rtt.total_us - start->nfs.rtt.total_us;
+	if (count)
+		setenv_ulong("net_rtt_us", total_us / count);
+	else
+		setenv("net_rtt_us", NULL);
+}
+#endif
+
 int net_loop(enum proto_t protocol)
 {
 	int ret = -EINVAL;
+#ifdef CONFIG_NET_STATS_ENV
+	struct net_stats start = net_stats;
+#endif
 
 	net_restarted = 0;
 	net_dev_exists = 0;
@@ -508,6 +583,11 @@ restart:
 		case LINKLOCAL:
 			link_local_start();
 			break;
+#endif
+#if defined(CONFIG_CMD_WGET)
+		case WGET:
+			wget_start();
+			break;
 #endif
 		default:
 			break;
@@ -539,6 +619,7 @@ restart:
 	 */
 	for (;;) {
 		WATCHDOG_RESET();
+		task_yield();
 #ifdef CONFIG_SHOW_ACTIVITY
 		show_activity(1);
 #endif
@@ -644,6 +725,9 @@ done:
 #ifdef CONFIG_USB_KEYBOARD
 	net_busy_flag = 0;
 #endif
+#ifdef CONFIG_NET_STATS_ENV
+	net_stats_to_env(&start);
+#endif
 #ifdef CONFIG_CMD_TFTPPUT
 	/* Clear out the handlers */
 	net_set_udp_handler(NULL);
@@ -752,6 +836,13 @@ void net_set_arp_handler(rxhand_f *f)
 		arp_packet_handler = f;
 }
 
+void net_set_udp_place_handler(rxplace_f *f)
+{
+	udp_place_handler = f;
+	/* Stop placing any datagram for the previous handler */
+	rx_place.dest = NULL;
+}
+
 #ifdef CONFIG_CMD_TFTPPUT
 void net_set_icmp_handler(rxhand_icmp_f *f)
 {
@@ -801,6 +892,11 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	net_set_udp_header(pkt, dest, dport, sport, payload_len);
 	pkt_hdr_size = eth_hdr_size + IP_UDP_HDR_SIZE;
 
+	return net_send_ip_packet(ether, dest, pkt_hdr_size + payload_len);
+}
+
+int net_send_ip_packet(uchar *ether, struct in_addr dest, int len)
+{
 	/* if MAC address was not discovered yet, do an ARP request */
 	if (memcmp(ether, net_null_ethaddr, 6) == 0) {
 		debug_cond(DEBUG_DEV_PKT, "sending ARP for %pI4\n", &dest);
@@ -810,7 +906,7 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 		arp_wait_packet_ethaddr = ether;
 
 		/* size of the waiting packet */
-		arp_wait_tx_packet_size = pkt_hdr_size + payload_len;
+		arp_wait_tx_packet_size = len;
 
 		/* and do the ARP request */
 		arp_wait_try = 1;
@@ -818,9 +914,9 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 		arp_request();
 		return 1;	/* waiting */
 	} else {
-		debug_cond(DEBUG_DEV_PKT, "sending UDP to %pI4/%pM\n",
+		debug_cond(DEBUG_DEV_PKT, "sending IP to %pI4/%pM\n",
 			   &dest, ether);
-		net_send_packet(net_tx_packet, pkt_hdr_size + payload_len);
+		net_send_packet(net_tx_packet, len);
 		return 0;	/* transmitted */
 	}
 }
@@ -829,20 +925,21 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 /*
  * This function collects fragments in a single packet, according
  * to the algorithm in RFC815. It returns NULL or the pointer to
- * a complete packet, in static storage
+ * a complete packet, in static storage. If the UDP place handler took
+ * the data, it is stored straight at its destination and only the
+ * headers are in the packet; net_rx_placed then says where the data went.
  */
-#ifndef CONFIG_NET_MAXDEFRAG
-#define CONFIG_NET_MAXDEFRAG 16384
-#endif
 /*
- * MAXDEFRAG, above, is chosen in the config file and  is real data
- * so we need to add the NFS overhead, which is more than TFTP.
- * To use sizeof in the internal unnamed structures, we need a real
- * instance (can't do "sizeof(struct rpc_t.u.reply))", unfortunately).
- * The compiler doesn't complain nor allocates the actual structure
+ * MAXDEFRAG is chosen in the config file and  is real data
+ * so we need to add the IP/UDP headers and the NFS overhead, which is
+ * more than TFTP. To use sizeof in the internal unnamed structures, we
+ * need a real instance (can't do "sizeof(struct rpc_t.u.reply))",
+ * unfortunately). The compiler doesn't complain nor allocates the actual
+ * structure
  */
 static struct rpc_t rpc_specimen;
-#define IP_PKTSIZE (CONFIG_NET_MAXDEFRAG + sizeof(rpc_specimen.u.reply))
+#define IP_PKTSIZE (CONFIG_NET_MAXDEFRAG + IP_UDP_HDR_SIZE + \
+		    sizeof(rpc_specimen.u.reply))
 
 #define IP_MAXUDP (IP_PKTSIZE - IP_HDR_SIZE)
 
@@ -858,6 +955,76 @@ struct hole {
 	u16 unused;
 };
 
+/* Sum of the UDP bytes of the datagram being placed, for its checksum */
+static unsigned rx_place_sum;
+
+/* Asks the protocol whether to place the data of a new datagram */
+static void net_place_start(struct ip_udp_hdr *ip, int len)
+{
+	rx_place.dest = NULL;
+	rx_place_sum = 0xffff;
+	if (!udp_place_handler || ip->ip_p != IPPROTO_UDP ||
+	    len < IP_UDP_HDR_SIZE)
+		return;
+	if (!udp_place_handler((uchar *)ip + IP_UDP_HDR_SIZE,
+			       ntohs(ip->udp_dst), net_read_ip(&ip->ip_src),
+			       ntohs(ip->udp_src), len - IP_UDP_HDR_SIZE,
+			       &rx_place))
+		rx_place.dest = NULL;
+}
+
+/*
+ * Stores a fragment of a datagram being placed: the UDP and protocol
+ * headers go to the reassembly buffer @buf and the data to its destination,
+ * except for anything after the most the protocol allowed (e.g. padding).
+ */
+static void net_place_fragment(uchar *buf, const uchar *src, int start,
+			       int len)
+{
+	int hdr = UDP_HDR_SIZE + rx_place.skip;
+	int n;
+
+	rx_place_sum = add_ip_checksums(start, rx_place_sum,
+					compute_ip_checksum(src, len));
+	if (start < hdr) {
+		n = min(len, hdr - start);
+		memcpy(buf, src, n);
+		start += n;
+		src += n;
+		len -= n;
+	}
+	n = min(len, (int)rx_place.max - (start - hdr));
+	if (n > 0)
+		memcpy(rx_place.dest + start - hdr, src, n);
+}
+
+#ifdef CONFIG_UDP_CHECKSUM
+/* Checks the UDP checksum of a placed datagram, from the sum of its bytes */
+static bool net_place_xsum_ok(struct ip_udp_hdr *ip)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		__be16 len;
+	} pseudo;
+	unsigned sum;
+
+	if (!ip->udp_xsum)
+		return true;
+	net_copy_ip(&pseudo.src, &ip->ip_src);
+	net_copy_ip(&pseudo.dst, &ip->ip_dst);
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_UDP;
+	pseudo.len = ip->udp_len;
+	sum = add_ip_checksums(0, rx_place_sum,
+			       compute_ip_checksum(&pseudo, sizeof(pseudo)));
+
+	return sum == 0 || sum == 0xffff;
+}
+#endif
+
 static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 {
 	static uchar pkt_buff[IP_PKTSIZE] __aligned(PKTALIGN);
@@ -875,10 +1042,14 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	start = offset8 * 8;
 	len = ntohs(ip->ip_len) - IP_HDR_SIZE;
 
-	if (start + len > IP_MAXUDP) /* fragment extends too far */
+	if (start + len > IP_MAXUDP) { /* fragment extends too far */
+		net_stats.rx_frag_dropped++;
 		return NULL;
+	}
 
-	if (!total_len || localip->ip_id != ip->ip_id) {
+	if (!total_len || localip->ip_id != ip->ip_id ||
+	    net_read_ip(&localip->ip_src).s_addr !=
+	    net_read_ip(&ip->ip_src).s_addr) {
 		/* new (or different) packet, reset structs */
 		total_len = 0xffff;
 		payload[0].last_byte = ~0;
@@ -887,6 +1058,10 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 		first_hole = 0;
 		/* any IP header will work, copy the first we received */
 		memcpy(localip, ip, IP_HDR_SIZE);
+		/* the data can only be placed once its header is known */
+		rx_place.dest = NULL;
+		if (!offset8)
+			net_place_start(ip, IP_HDR_SIZE + len);
 	}
 
 	/*
@@ -900,6 +1075,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	while (h->last_byte < start) {
 		if (!h->next_hole) {
 			/* no hole that far away */
+			net_stats.rx_frag_dropped++;
 			return NULL;
 		}
 		h = payload + h->next_hole;
@@ -908,6 +1084,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	/* last fragment may be 1..7 bytes, the "+7" forces acceptance */
 	if (offset8 + ((len + 7) / 8) <= h - payload) {
 		/* no overlap with holes (dup fragment?) */
+		net_stats.rx_frag_dropped++;
 		return NULL;
 	}
 
@@ -969,12 +1146,31 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	}
 
 	/* finally copy this fragment and possibly return whole packet */
-	memcpy((uchar *)thisfrag, indata + IP_HDR_SIZE, len);
+	if (rx_place.dest)
+		net_place_fragment((uchar *)thisfrag, indata + IP_HDR_SIZE,
+				   start, len);
+	else
+		memcpy((uchar *)thisfrag, indata + IP_HDR_SIZE, len);
 	if (!done)
 		return NULL;
 
 	localip->ip_len = htons(total_len);
 	*lenp = total_len + IP_HDR_SIZE;
+	if (rx_place.dest) {
+#ifdef CONFIG_UDP_CHECKSUM
+		if (!net_place_xsum_ok(localip)) {
+			printf(" UDP wrong checksum in placed datagram\n");
+			net_stats.rx_bad++;
+			rx_place.dest = NULL;
+			return NULL;
+		}
+#endif
+		net_rx_placed = rx_place.dest;
+		net_stats.rx_placed++;
+		net_stats.rx_placed_bytes += min_t(unsigned, rx_place.max,
+				total_len - UDP_HDR_SIZE - rx_place.skip);
+		rx_place.dest = NULL;
+	}
 	return localip;
 }
 
@@ -1046,13 +1242,16 @@ void net_process_received_packet(uchar *in_packet, int len)
 
 	debug_cond(DEBUG_NET_PKT, "packet received\n");
 
+	net_stats.rx_packets++;
 	net_rx_packet = in_packet;
 	net_rx_packet_len = len;
 	et = (struct ethernet_hdr *)in_packet;
 
 	/* too small packet? */
-	if (len < ETHER_HDR_SIZE)
+	if (len < ETHER_HDR_SIZE) {
+		net_stats.rx_bad++;
 		return;
+	}
 
 #if defined(CONFIG_API) || defined(CONFIG_EFI_LOADER)
 	if (push_packet) {
@@ -1149,11 +1348,13 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (len < IP_UDP_HDR_SIZE) {
 			debug("len bad %d < %lu\n", len,
 			      (ulong)IP_UDP_HDR_SIZE);
+			net_stats.rx_bad++;
 			return;
 		}
 		/* Check the packet length */
 		if (len < ntohs(ip->ip_len)) {
 			debug("len bad %d < %d\n", len, ntohs(ip->ip_len));
+			net_stats.rx_bad++;
 			return;
 		}
 		len = ntohs(ip->ip_len);
@@ -1169,6 +1370,7 @@ void net_process_received_packet(uchar *in_packet, int len)
 		/* Check the Checksum of the header */
 		if (!ip_checksum_ok((uchar *)ip, IP_HDR_SIZE)) {
 			debug("checksum bad\n");
+			net_stats.rx_bad++;
 			return;
 		}
 		/* If it is not for us, ignore it */
@@ -1214,6 +1416,11 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			receive_icmp(ip, len, src_ip, et);
 			return;
+#ifdef CONFIG_NET_TCP
+		} else if (ip->ip_p == IPPROTO_TCP) {
+			tcp_receive((struct ip_tcp_hdr *)ip, len);
+			return;
+#endif
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
@@ -1223,7 +1430,8 @@ void net_process_received_packet(uchar *in_packet, int len)
 			   &dst_ip, &src_ip, len);
 
 #ifdef CONFIG_UDP_CHECKSUM
-		if (ip->udp_xsum != 0) {
+		/* A placed datagram's checksum was checked as it arrived */
+		if (ip->udp_xsum != 0 && !net_rx_placed) {
 			ulong   xsum;
 			ushort *sumptr;
 			ushort  sumlen;
@@ -1259,6 +1467,7 @@ void net_process_received_packet(uchar *in_packet, int len)
 			if ((xsum != 0x00000000) && (xsum != 0x0000ffff)) {
 				printf(" UDP wrong checksum %08lx %08x\n",
 				       xsum, ntohs(ip->udp_xsum));
+				net_stats.rx_bad++;
 				return;
 			}
 		}
@@ -1279,6 +1488,7 @@ void net_process_received_packet(uchar *in_packet, int len)
 				      src_ip,
 				      ntohs(ip->udp_src),
 				      ntohs(ip->udp_len) - UDP_HDR_SIZE);
+		net_rx_placed = NULL;
 		break;
 	}
 }
@@ -1315,6 +1525,9 @@ static int net_check_prereq(enum proto_t protocol)
 #endif
 #if defined(CONFIG_CMD_NFS)
 	case NFS:
+#endif
+#if defined(CONFIG_CMD_WGET)
+	case WGET:
 #endif
 		/* Fall through */
 	case TFTPGET:
@@ -1491,7 +1704,8 @@ void copy_filename(char *dst, const char *src, int size)
 
 #if	defined(CONFIG_CMD_NFS)		|| \
 	defined(CONFIG_CMD_SNTP)	|| \
-	defined(CONFIG_CMD_DNS)
+	defined(CONFIG_CMD_DNS)		|| \
+	defined(CONFIG_CMD_WGET)
 /*
  * make port a little random (1024-17407)
  * This keeps the math somewhat trivial to compute, and seems to work with
@@ -29,6 +29,9 @@
 #include <mapmem.h>
 #include "nfs.h"
 #include "bootp.h"
+#ifdef CONFIG_NFS_TCP
+#include "tcp.h"
+#endif
 
 #define HASHES_PER_LINE 65	/* Number of "loading" hashes per line	*/
 #define NFS_RETRY_COUNT 30
@@ -38,17 +41,54 @@
 # define NFS_TIMEOUT CONFIG_NFS_TIMEOUT
 #endif
 
+#define NFS_HASH_BYTES	(NFS_READ_SIZE / 2 * 10)
+
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+#if defined(CONFIG_NFS_TCP) && defined(CONFIG_SYS_DIRECT_FLASH_NFS)
+#error "CONFIG_NFS_TCP stores READ data in RAM as it arrives, not in flash"
+#endif
+
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
 static ulong nfs_timeout = NFS_TIMEOUT;
+static int nfs_version;		/* 3, or 2 if the server lacks NFSv3 */
+
+static char dirfh[NFS3_FHSIZE];	/* file handle of directory */
+static int dirfh_len;
+static char filefh[NFS3_FHSIZE]; /* file handle of kernel image */
+static int filefh_len;
+
+/**
+ * struct nfs_read - A READ request which has not been answered yet
+ *
+ * @id:		RPC id, kept when the request is sent again
+ * @offset:	Offset in the file
+ * @len:	Number of bytes to read, 0 if this slot is free
+ * @sent:	true if in flight, false if waiting to be sent (again)
+ */
+struct nfs_read {
+	ulong id;
+	ulong offset;
+	uint len;
+	bool sent;
+	bool resend;	/* Sent before, with no reply */
+	ulong sent_us;	/* When sent, or 0 if sent more than once */
+};
 
-static char dirfh[NFS_FHSIZE];	/* file handle of directory */
-static char filefh[NFS_FHSIZE]; /* file handle of kernel image */
+/*
+ * Up to CONFIG_NFS_READ_WINDOW reads are in flight at once and their replies
+ * are stored wherever they land, in any order. The window starts at one
+ * read and grows with each reply, and drops back to one after a timeout.
+ */
+static struct nfs_read nfs_reads[CONFIG_NFS_READ_WINDOW];
+static int nfs_window;
+static ulong nfs_offset;	/* next offset not yet asked for */
+static uint nfs_len;		/* bytes per READ */
+static ulong nfs_eof;		/* file size, ULONG_MAX until known */
+static ulong nfs_received;
+static ulong nfs_hashes;
 
 static enum net_loop_state nfs_download_state;
 static struct in_addr nfs_server_ip;
@@ -65,6 +105,28 @@ static int nfs_state;
 #define STATE_READ_REQ			6
 #define STATE_READLINK_REQ		7
 
+static bool nfs_tcp;		/* NFS calls go over TCP, not UDP */
+
+#ifdef CONFIG_NFS_TCP
+/*
+ * Over TCP, each call and reply is a record made of fragments which each
+ * start with a 4-byte mark. The first part of each reply is kept in
+ * nfs_tcp_rec, except that the data of a READ reply is stored where it
+ * belongs as it arrives.
+ */
+static bool nfs_tcp_open;	/* Connecting or connected */
+static bool nfs_tcp_ready;	/* Connected */
+static u32 nfs_tcp_mark;	/* Header of the current fragment */
+static int nfs_tcp_mark_len;	/* Bytes of it received */
+static u32 nfs_tcp_frag;	/* Bytes left in the current fragment */
+static unsigned nfs_tcp_len;	/* Bytes of the record received */
+static struct net_rx_place nfs_tcp_place;
+static struct rpc_t nfs_tcp_rec;
+
+static void nfs_tcp_start(void);
+static void nfs_tcp_stop(void);
+#endif
+
 static char default_filename[64];
 static char *nfs_filename;
 static char *nfs_path;
@@ -95,7 +157,9 @@ static inline int store_block(uchar *src, unsigned offset, unsigned len)
 	{
 		void *ptr = map_sysmem(load_addr + offset, len);
 
-		memcpy(ptr, src, len);
+		/* A large reply may already be there, see nfs_place() */
+		if (ptr != net_rx_placed)
+			memcpy(ptr, src, len);
 		unmap_sysmem(ptr);
 	}
 
@@ -132,7 +196,7 @@ static char *dirname(char *path)
 /**************************************************************************
 RPC_ADD_CREDENTIALS - Add RPC authentication/verifier entries
 **************************************************************************/
-static long *rpc_add_credentials(long *p)
+static uint32_t *rpc_add_credentials(uint32_t *p)
 {
 	int hl;
 	int hostnamelen;
@@ -175,30 +239,47 @@ static long *rpc_add_credentials(long *p)
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
-static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+static int rpc_send(unsigned long id, int rpc_prog, int rpc_proc,
+		    uint32_t *data, int datalen)
 {
-	struct rpc_t pkt;
-	unsigned long id;
+	struct {
+		uint32_t mark;		/* Record mark, for TCP */
+		struct rpc_t rpc;
+	} pkt;
 	uint32_t *p;
 	int pktlen;
 	int sport;
+	int vers;
+
+	if (rpc_prog == PROG_NFS)
+		vers = nfs_version;
+	else if (rpc_prog == PROG_MOUNT && nfs_version == 3)
+		vers = 3;
+	else
+		vers = 2;	/* portmapper is version 2 */
 
-	id = ++rpc_id;
-	pkt.u.call.id = htonl(id);
-	pkt.u.call.type = htonl(MSG_CALL);
-	pkt.u.call.rpcvers = htonl(2);	/* use RPC version 2 */
-	pkt.u.call.prog = htonl(rpc_prog);
-	pkt.u.call.vers = htonl(2);	/* portmapper is version 2 */
-	pkt.u.call.proc = htonl(rpc_proc);
-	p = (uint32_t *)&(pkt.u.call.data);
+	pkt.rpc.u.call.id = htonl(id);
+	pkt.rpc.u.call.type = htonl(MSG_CALL);
+	pkt.rpc.u.call.rpcvers = htonl(2);	/* use RPC version 2 */
+	pkt.rpc.u.call.prog = htonl(rpc_prog);
+	pkt.rpc.u.call.vers = htonl(vers);
+	pkt.rpc.u.call.proc = htonl(rpc_proc);
+	p = (uint32_t *)&(pkt.rpc.u.call.data);
 
 	if (datalen)
 		memcpy((char *)p, (char *)data, datalen*sizeof(uint32_t));
 
-	pktlen = (char *)p + datalen*sizeof(uint32_t) - (char *)&pkt;
+	pktlen = (char *)p + datalen*sizeof(uint32_t) - (char *)&pkt.rpc;
+
+#ifdef CONFIG_NFS_TCP
+	if (nfs_tcp && rpc_prog == PROG_NFS) {
+		pkt.mark = htonl(RPC_LAST_FRAG | pktlen);
+		return tcp_send(&pkt, sizeof(pkt.mark) + pktlen);
+	}
+#endif
 
 	memcpy((char *)net_tx_packet + net_eth_hdr_size() + IP_UDP_HDR_SIZE,
-	       (char *)&pkt, pktlen);
+	       (char *)&pkt.rpc, pktlen);
 
 	if (rpc_prog == PROG_PORTMAP)
 		sport = SUNRPC_PORT;
@@ -209,6 +290,39 @@ static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
 
 	net_send_udp_packet(net_server_ethaddr, nfs_server_ip, sport,
 			    nfs_our_port, pktlen);
+
+	return 0;
+}
+
+static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+{
+	rpc_send(++rpc_id, rpc_prog, rpc_proc, data, datalen);
+}
+
+/* Adds a file handle to a request, which NFSv3 gives a length */
+static uint32_t *nfs_add_fh(uint32_t *p, const char *fh, int fh_len)
+{
+	if (nfs_version == 3)
+		*p++ = htonl(fh_len);
+	memcpy(p, fh, fh_len);
+
+	return p + fh_len / 4;
+}
+
+/* Copies a file handle from a reply, returning -1 if it is too long */
+static int nfs_get_fh(uint32_t *data, char *fh, int *fh_lenp)
+{
+	int fh_len = NFS_FHSIZE;
+
+	if (nfs_version == 3) {
+		fh_len = ntohl(*data++);
+		if (fh_len > NFS3_FHSIZE || fh_len & 3)
+			return -1;
+	}
+	memcpy(fh, data, fh_len);
+	*fh_lenp = fh_len;
+
+	return 0;
 }
 
 /**************************************************************************
@@ -222,7 +336,8 @@ static void rpc_lookup_req(int prog, int ver)
 	data[2] = 0; data[3] = 0;	/* auth verifier */
 	data[4] = htonl(prog);
 	data[5] = htonl(ver);
-	data[6] = htonl(17);	/* IP_UDP */
+	data[6] = htonl(prog == PROG_NFS && nfs_tcp ? IPPROTO_TCP :
+			IPPROTO_UDP);
 	data[7] = 0;
 
 	rpc_req(PROG_PORTMAP, PORTMAP_GETPORT, data, 8);
@@ -241,7 +356,7 @@ static void nfs_mount_req(char *path)
 	pathlen = strlen(path);
 
 	p = &(data[0]);
-	p = (uint32_t *)rpc_add_credentials((long *)p);
+	p = rpc_add_credentials(p);
 
 	*p++ = htonl(pathlen);
 	if (pathlen & 3)
@@ -268,7 +383,7 @@ static void nfs_umountall_req(void)
 		return;
 
 	p = &(data[0]);
-	p = (uint32_t *)rpc_add_credentials((long *)p);
+	p = rpc_add_credentials(p);
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
@@ -289,10 +404,9 @@ static void nfs_readlink_req(void)
 	int len;
 
 	p = &(data[0]);
-	p = (uint32_t *)rpc_add_credentials((long *)p);
+	p = rpc_add_credentials(p);
 
-	memcpy(p, filefh, NFS_FHSIZE);
-	p += (NFS_FHSIZE / 4);
+	p = nfs_add_fh(p, filefh, filefh_len);
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
@@ -312,10 +426,9 @@ static void nfs_lookup_req(char *fname)
 	fnamelen = strlen(fname);
 
 	p = &(data[0]);
-	p = (uint32_t *)rpc_add_credentials((long *)p);
+	p = rpc_add_credentials(p);
 
-	memcpy(p, dirfh, NFS_FHSIZE);
-	p += (NFS_FHSIZE / 4);
+	p = nfs_add_fh(p, dirfh, dirfh_len);
 	*p++ = htonl(fnamelen);
 	if (fnamelen & 3)
 		*(p + fnamelen / 4) = 0;
@@ -324,30 +437,135 @@ static void nfs_lookup_req(char *fname)
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
-	rpc_req(PROG_NFS, NFS_LOOKUP, data, len);
+	rpc_req(PROG_NFS, nfs_version == 3 ? NFS3PROC_LOOKUP : NFS_LOOKUP,
+		data, len);
 }
 
 /**************************************************************************
 NFS_READ - Read File on NFS Server
 **************************************************************************/
-static void nfs_read_req(int offset, int readlen)
+static int nfs_read_req(struct nfs_read *rd)
 {
 	uint32_t data[1024];
 	uint32_t *p;
 	int len;
 
 	p = &(data[0]);
-	p = (uint32_t *)rpc_add_credentials((long *)p);
+	p = rpc_add_credentials(p);
 
-	memcpy(p, filefh, NFS_FHSIZE);
-	p += (NFS_FHSIZE / 4);
-	*p++ = htonl(offset);
-	*p++ = htonl(readlen);
-	*p++ = 0;
+	p = nfs_add_fh(p, filefh, filefh_len);
+	if (nfs_version == 3) {
+		*p++ = htonl((u64)rd->offset >> 32);
+		*p++ = htonl(rd->offset);
+		*p++ = htonl(rd->len);
+	} else {
+		*p++ = htonl(rd->offset);
+		*p++ = htonl(rd->len);
+		*p++ = 0;
+	}
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
-	rpc_req(PROG_NFS, NFS_READ, data, len);
+	return rpc_send(rd->id, PROG_NFS, NFS_READ, data, len);
+}
+
+/* Returns the read slot for an RPC id, or NULL if it is not ours (any more) */
+static struct nfs_read *nfs_find_read(ulong id)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		if (nfs_reads[i].len && nfs_reads[i].id == id)
+			return &nfs_reads[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Sends reads until the window is full, those waiting to be sent again
+ * first, lowest offset first. Returns false once the whole file is read.
+ */
+static bool nfs_read_fill(void)
+{
+	struct nfs_read *rd, *free_rd;
+	int i, busy, in_flight;
+
+	for (;;) {
+		busy = 0;
+		in_flight = 0;
+		rd = NULL;
+		free_rd = NULL;
+		for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+			struct nfs_read *r = &nfs_reads[i];
+
+			/* Anything past the end of the file is not needed */
+			if (r->len && r->offset >= nfs_eof)
+				r->len = 0;
+			if (!r->len) {
+				free_rd = r;
+				continue;
+			}
+			busy++;
+			if (r->sent)
+				in_flight++;
+			else if (!rd || r->offset < rd->offset)
+				rd = r;
+		}
+		if (in_flight >= nfs_window)
+			break;
+		if (!rd) {
+			if (!free_rd || nfs_offset >= nfs_eof)
+				break;
+			rd = free_rd;
+			rd->id = ++rpc_id;
+			rd->offset = nfs_offset;
+			rd->len = min_t(ulong, nfs_len, nfs_eof - nfs_offset);
+			nfs_offset += rd->len;
+			busy++;
+		}
+		/* Over TCP, wait for earlier calls to be acknowledged */
+		if (nfs_read_req(rd))
+			break;
+		rd->sent = true;
+		if (rd->resend) {
+			net_stats.nfs.resends++;
+			rd->resend = false;
+			rd->sent_us = 0;
+		} else {
+			rd->sent_us = timer_get_us();
+		}
+	}
+
+	return busy != 0;
+}
+
+static void nfs_read_start(void)
+{
+	memset(nfs_reads, '\0', sizeof(nfs_reads));
+	nfs_window = 1;
+	nfs_offset = 0;
+	nfs_len = nfs_version == 3 ? NFS3_READ_SIZE : NFS_READ_SIZE;
+	if (nfs_tcp && nfs_version == 3)
+		nfs_len = NFS3_TCP_READ_SIZE;
+	nfs_eof = ULONG_MAX;
+	nfs_received = 0;
+	nfs_hashes = 0;
+	nfs_read_fill();
+}
+
+/* After a timeout, sends the lowest outstanding read again on its own */
+static void nfs_read_retry(void)
+{
+	int i;
+
+	nfs_window = 1;
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		if (nfs_reads[i].sent)
+			nfs_reads[i].resend = true;
+		nfs_reads[i].sent = false;
+	}
+	nfs_read_fill();
 }
 
 /**************************************************************************
@@ -357,12 +575,29 @@ static void nfs_send(void)
 {
 	debug("%s\n", __func__);
 
+#ifdef CONFIG_NFS_TCP
+	if (nfs_tcp) {
+		bool nfs_call = nfs_state == STATE_LOOKUP_REQ ||
+				nfs_state == STATE_READ_REQ ||
+				nfs_state == STATE_READLINK_REQ;
+
+		/* Only NFS calls go over TCP, sent once it is connected */
+		if (nfs_call && !nfs_tcp_ready) {
+			if (!nfs_tcp_open)
+				nfs_tcp_start();
+			return;
+		}
+		if (!nfs_call && nfs_tcp_open)
+			nfs_tcp_stop();
+	}
+#endif
+
 	switch (nfs_state) {
 	case STATE_PRCLOOKUP_PROG_MOUNT_REQ:
-		rpc_lookup_req(PROG_MOUNT, 1);
+		rpc_lookup_req(PROG_MOUNT, nfs_version == 3 ? 3 : 1);
 		break;
 	case STATE_PRCLOOKUP_PROG_NFS_REQ:
-		rpc_lookup_req(PROG_NFS, 2);
+		rpc_lookup_req(PROG_NFS, nfs_version);
 		break;
 	case STATE_MOUNT_REQ:
 		nfs_mount_req(nfs_path);
@@ -374,7 +609,7 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_retry();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -390,6 +625,9 @@ static int rpc_lookup_reply(int prog, uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
 
+	if (len > sizeof(rpc_pkt))
+		return -NFS_RPC_DROP;
+
 	memcpy((unsigned char *)&rpc_pkt, pkt, len);
 
 	debug("%s\n", __func__);
@@ -422,6 +660,9 @@ static int nfs_mount_reply(uchar *pkt, unsigned len)
 
 	debug("%s\n", __func__);
 
+	if (len > sizeof(rpc_pkt))
+		return -NFS_RPC_DROP;
+
 	memcpy((unsigned char *)&rpc_pkt, pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
@@ -435,8 +676,9 @@ static int nfs_mount_reply(uchar *pkt, unsigned len)
 	    rpc_pkt.u.reply.data[0])
 		return -1;
 
+	if (nfs_get_fh(rpc_pkt.u.reply.data + 1, dirfh, &dirfh_len))
+		return -1;
 	fs_mounted = 1;
-	memcpy(dirfh, rpc_pkt.u.reply.data + 1, NFS_FHSIZE);
 
 	return 0;
 }
@@ -447,6 +689,9 @@ static int nfs_umountall_reply(uchar *pkt, unsigned len)
 
 	debug("%s\n", __func__);
 
+	if (len > sizeof(rpc_pkt))
+		return -NFS_RPC_DROP;
+
 	memcpy((unsigned char *)&rpc_pkt, pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
@@ -471,6 +716,9 @@ static int nfs_lookup_reply(uchar *pkt, unsigned len)
 
 	debug("%s\n", __func__);
 
+	if (len > sizeof(rpc_pkt))
+		return -NFS_RPC_DROP;
+
 	memcpy((unsigned char *)&rpc_pkt, pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
@@ -484,7 +732,8 @@ static int nfs_lookup_reply(uchar *pkt, unsigned len)
 	    rpc_pkt.u.reply.data[0])
 		return -1;
 
-	memcpy(filefh, rpc_pkt.u.reply.data + 1, NFS_FHSIZE);
+	if (nfs_get_fh(rpc_pkt.u.reply.data + 1, filefh, &filefh_len))
+		return -1;
 
 	return 0;
 }
@@ -492,10 +741,14 @@ static int nfs_lookup_reply(uchar *pkt, unsigned len)
 static int nfs_readlink_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
+	uint32_t *data;
 	int rlen;
 
 	debug("%s\n", __func__);
 
+	if (len > sizeof(rpc_pkt))
+		return -NFS_RPC_DROP;
+
 	memcpy((unsigned char *)&rpc_pkt, pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
@@ -509,34 +762,67 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	    rpc_pkt.u.reply.data[0])
 		return -1;
 
-	rlen = ntohl(rpc_pkt.u.reply.data[1]); /* new path length */
+	/* NFSv3 puts the symlink's attributes before the path */
+	data = rpc_pkt.u.reply.data + 1;
+	if (nfs_version == 3)
+		data += *data ? 22 : 1;
+	rlen = ntohl(*data++); /* new path length */
 
-	if (*((char *)&(rpc_pkt.u.reply.data[2])) != '/') {
+	if (*((char *)data) != '/') {
 		int pathlen;
 		strcat(nfs_path, "/");
 		pathlen = strlen(nfs_path);
-		memcpy(nfs_path + pathlen, (uchar *)&(rpc_pkt.u.reply.data[2]),
-		       rlen);
+		memcpy(nfs_path + pathlen, (uchar *)data, rlen);
 		nfs_path[pathlen + rlen] = 0;
 	} else {
-		memcpy(nfs_path, (uchar *)&(rpc_pkt.u.reply.data[2]), rlen);
+		memcpy(nfs_path, (uchar *)data, rlen);
 		nfs_path[rlen] = 0;
 	}
 	return 0;
 }
 
+/*
+ * Finds the data in a successful READ reply, returning its length and
+ * setting *hdrp to its offset in the reply and *eofp if the file ends there
+ */
+static int nfs_read_data(struct rpc_t *rpc_pkt, struct nfs_read *rd,
+			 unsigned *hdrp, bool *eofp)
+{
+	uint32_t *data = rpc_pkt->u.reply.data;
+	int rlen;
+
+	if (nfs_version == 3) {
+		/* Skip the attributes if present, then count, eof and length */
+		data += data[1] ? 23 : 2;
+		rlen = ntohl(data[0]);
+		*eofp = data[1] != 0;
+		data += 3;
+	} else {
+		/* Only a short read ends the file */
+		rlen = ntohl(data[18]);
+		data += 19;
+		*eofp = rlen < rd->len;
+	}
+	*hdrp = (uchar *)data - (uchar *)rpc_pkt;
+
+	return rlen;
+}
+
 static int nfs_read_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
+	struct nfs_read *rd;
+	unsigned hdr;
 	int rlen;
+	bool eof;
 
 	debug("%s\n", __func__);
 
-	memcpy((uchar *)&rpc_pkt, pkt, sizeof(rpc_pkt.u.reply));
+	memcpy((uchar *)&rpc_pkt, pkt,
+	       min_t(unsigned, len, sizeof(rpc_pkt.u.reply)));
 
-	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
-		return -NFS_RPC_ERR;
-	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
+	rd = nfs_find_read(ntohl(rpc_pkt.u.reply.id));
+	if (!rd)
 		return -NFS_RPC_DROP;
 
 	if (rpc_pkt.u.reply.rstatus  ||
@@ -550,25 +836,102 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
+	rlen = nfs_read_data(&rpc_pkt, rd, &hdr, &eof);
+	if (rlen < 0 || rlen > rd->len || hdr + rlen > len)
+		return -NFS_RPC_DROP;
+
+	if (rd->sent_us) {
+		net_rtt_add(&net_stats.nfs.rtt, timer_get_us() - rd->sent_us);
+		rd->sent_us = 0;
+	}
 
-	rlen = ntohl(rpc_pkt.u.reply.data[18]);
-	if (store_block((uchar *)pkt + sizeof(rpc_pkt.u.reply),
-			nfs_offset, rlen))
+	/* An empty read past the end must not grow the file */
+	if (rlen && store_block((uchar *)pkt + hdr, rd->offset, rlen))
 		return -9999;
 
+	nfs_received += rlen;
+	while (nfs_hashes * NFS_HASH_BYTES < nfs_received) {
+		if (nfs_hashes && !(nfs_hashes % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+		nfs_hashes++;
+	}
+
+	if (eof || !rlen) {
+		nfs_eof = min(nfs_eof, rd->offset + rlen);
+		rd->len = 0;
+	} else if (rlen < rd->len) {
+		/* The server reads less at a time, so ask for that from now */
+		if (rlen < nfs_len)
+			nfs_len = rlen;
+		rd->id = ++rpc_id;
+		rd->offset += rlen;
+		rd->len -= rlen;
+		rd->sent = false;
+	} else {
+		rd->len = 0;
+	}
+	if (nfs_window < CONFIG_NFS_READ_WINDOW)
+		nfs_window++;
+
 	return rlen;
 }
 
+#if defined(CONFIG_IP_DEFRAG) && !defined(CONFIG_SYS_DIRECT_FLASH_NFS) || \
+	defined(CONFIG_NFS_TCP)
+/*
+ * Checks whether a reply, of which @len bytes are at @pkt, answers a READ
+ * in flight. If so, sets @place to say where its data belongs.
+ */
+static bool nfs_read_place(uchar *pkt, unsigned len,
+			   struct net_rx_place *place)
+{
+	struct rpc_t rpc_pkt;
+	struct nfs_read *rd;
+	unsigned hdr;
+	bool eof;
+	int rlen;
+
+	if (nfs_state != STATE_READ_REQ || len < sizeof(rpc_pkt.u.reply))
+		return false;
+
+	memcpy((uchar *)&rpc_pkt, pkt, sizeof(rpc_pkt.u.reply));
+	rd = nfs_find_read(ntohl(rpc_pkt.u.reply.id));
+	if (!rd || rpc_pkt.u.reply.rstatus || rpc_pkt.u.reply.verifier ||
+	    rpc_pkt.u.reply.astatus || rpc_pkt.u.reply.data[0])
+		return false;
+	rlen = nfs_read_data(&rpc_pkt, rd, &hdr, &eof);
+	if (rlen <= 0 || rlen > rd->len || hdr > len)
+		return false;
+
+	place->dest = map_sysmem(load_addr + rd->offset, rlen);
+	place->skip = hdr;
+	/* The data is padded to 4 bytes, which must not be stored */
+	place->max = rlen;
+
+	return true;
+}
+#endif
+
+#if defined(CONFIG_IP_DEFRAG) && !defined(CONFIG_SYS_DIRECT_FLASH_NFS)
+/*
+ * A large READ reply arrives in several IP fragments. If it answers a READ
+ * in flight, its data is stored in place as each fragment arrives, and
+ * store_block() then has nothing to copy.
+ */
+static bool nfs_place(uchar *pkt, unsigned dest, struct in_addr sip,
+		      unsigned src, unsigned len, struct net_rx_place *place)
+{
+	return dest == nfs_our_port && nfs_read_place(pkt, len, place);
+}
+#endif
+
 /**************************************************************************
 Interfaces of U-BOOT
 **************************************************************************/
 static void nfs_timeout_handler(void)
 {
+	net_stats.nfs.timeouts++;
 	if (++nfs_timeout_count > NFS_RETRY_COUNT) {
 		puts("\nRetry count exceeded; starting again\n");
 		net_start_again();
@@ -577,21 +940,19 @@ static void nfs_timeout_handler(void)
 		net_set_timeout_handler(nfs_timeout +
 					NFS_TIMEOUT * nfs_timeout_count,
 					nfs_timeout_handler);
+		/* Reads sent again are counted as they go */
+		if (nfs_state != STATE_READ_REQ)
+			net_stats.nfs.resends++;
 		nfs_send();
 	}
 }
 
-static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
-			unsigned src, unsigned len)
+/* Deals with a reply, over UDP or TCP */
+static void nfs_reply(uchar *pkt, unsigned len)
 {
 	int rlen;
 	int reply;
 
-	debug("%s\n", __func__);
-
-	if (dest != nfs_our_port)
-		return;
-
 	switch (nfs_state) {
 	case STATE_PRCLOOKUP_PROG_MOUNT_REQ:
 		if (rpc_lookup_reply(PROG_MOUNT, pkt, len) == -NFS_RPC_DROP)
@@ -603,7 +964,22 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	case STATE_PRCLOOKUP_PROG_NFS_REQ:
 		if (rpc_lookup_reply(PROG_NFS, pkt, len) == -NFS_RPC_DROP)
 			break;
-		nfs_state = STATE_MOUNT_REQ;
+		if (nfs_tcp && !nfs_server_port) {
+			/* Ask again for the UDP port */
+			debug("NFS over TCP not available, using UDP\n");
+			nfs_tcp = false;
+			nfs_send();
+			break;
+		}
+		if (nfs_version == 3 &&
+		    (!nfs_server_mount_port || !nfs_server_port)) {
+			/* No NFSv3 on this server, so start again with v2 */
+			debug("NFSv3 not available, using NFSv2\n");
+			nfs_version = 2;
+			nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
+		} else {
+			nfs_state = STATE_MOUNT_REQ;
+		}
 		nfs_send();
 		break;
 
@@ -645,9 +1021,7 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_send();
 		} else {
 			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_read_start();
 		}
 		break;
 
@@ -671,17 +1045,23 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 	case STATE_READ_REQ:
 		rlen = nfs_read_reply(pkt, len);
-		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
+		if (rlen == -NFS_RPC_DROP)
+			break;
+		/* TCP has its own timeouts, and sends calls again itself */
+		if (!nfs_tcp)
+			net_set_timeout_handler(nfs_timeout,
+						nfs_timeout_handler);
+		if (rlen >= 0) {
+			if (nfs_read_fill())
+				break;
+			nfs_download_state = NETLOOP_SUCCESS;
+			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
@@ -689,6 +1069,144 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	}
 }
 
+static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
+			unsigned src, unsigned len)
+{
+	debug("%s\n", __func__);
+
+	if (dest != nfs_our_port)
+		return;
+
+	nfs_reply(pkt, len);
+}
+
+#ifdef CONFIG_NFS_TCP
+/* Stores @len bytes of a reply, which follow those received already */
+static void nfs_tcp_store(const uchar *data, unsigned len)
+{
+	struct net_rx_place *place = &nfs_tcp_place;
+	const unsigned hdr_max = sizeof(nfs_tcp_rec.u.reply);
+	unsigned pos = nfs_tcp_len;
+	unsigned n;
+
+	nfs_tcp_len += len;
+	if (!place->dest) {
+		if (pos < sizeof(nfs_tcp_rec))
+			memcpy((uchar *)&nfs_tcp_rec + pos, data,
+			       min_t(unsigned, len, sizeof(nfs_tcp_rec) - pos));
+		/* Once a READ reply's header is here, its data can be placed */
+		if (pos >= hdr_max || nfs_tcp_len < hdr_max ||
+		    !nfs_read_place((uchar *)&nfs_tcp_rec, hdr_max, place))
+			return;
+		/* Some data may have come before this part */
+		if (pos > place->skip)
+			memcpy(place->dest, (uchar *)&nfs_tcp_rec + place->skip,
+			       min(pos - place->skip, place->max));
+	}
+
+	/* Store the data, but not the header or the padding after it */
+	if (pos < place->skip) {
+		n = min(place->skip - pos, len);
+		data += n;
+		pos += n;
+		len -= n;
+	}
+	if (len && pos - place->skip < place->max)
+		memcpy(place->dest + pos - place->skip, data,
+		       min(len, place->max - (pos - place->skip)));
+}
+
+static void nfs_tcp_recv(const uchar *data, unsigned len)
+{
+	uchar *placed;
+	unsigned n;
+
+	while (len) {
+		if (nfs_tcp_mark_len < 4) {
+			nfs_tcp_mark = nfs_tcp_mark << 8 | *data++;
+			len--;
+			if (++nfs_tcp_mark_len < 4)
+				continue;
+			nfs_tcp_frag = nfs_tcp_mark & ~RPC_LAST_FRAG;
+		}
+
+		n = min(len, nfs_tcp_frag);
+		nfs_tcp_store(data, n);
+		data += n;
+		len -= n;
+		nfs_tcp_frag -= n;
+		if (nfs_tcp_frag)
+			break;
+
+		/* The fragment is complete, and perhaps the reply too */
+		nfs_tcp_mark_len = 0;
+		if (!(nfs_tcp_mark & RPC_LAST_FRAG))
+			continue;
+		n = nfs_tcp_len;
+		placed = nfs_tcp_place.dest;
+		nfs_tcp_len = 0;
+		nfs_tcp_place.dest = NULL;
+
+		/* store_block() has nothing to copy for a placed reply */
+		net_rx_placed = placed;
+		nfs_reply((uchar *)&nfs_tcp_rec, n);
+		net_rx_placed = NULL;
+		if (!nfs_tcp_ready)
+			break;
+	}
+}
+
+static void nfs_tcp_connected(void)
+{
+	nfs_tcp_ready = true;
+	nfs_send();
+}
+
+static void nfs_tcp_closed(int err)
+{
+	bool ready = nfs_tcp_ready;
+
+	nfs_tcp_open = false;
+	nfs_tcp_ready = false;
+	net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
+	if (ready) {
+		printf("\n*** ERROR: NFS connection lost (%d)\n", err);
+		nfs_state = STATE_UMOUNT_REQ;
+	} else {
+		/* Ask for the UDP port, then carry on as before */
+		puts("NFS over TCP failed; using UDP\n");
+		nfs_tcp = false;
+		nfs_state = STATE_PRCLOOKUP_PROG_NFS_REQ;
+	}
+	nfs_send();
+}
+
+static const struct tcp_ops nfs_tcp_ops = {
+	.connected	= nfs_tcp_connected,
+	.recv		= nfs_tcp_recv,
+	.closed		= nfs_tcp_closed,
+};
+
+static void nfs_tcp_start(void)
+{
+	nfs_tcp_open = true;
+	nfs_tcp_ready = false;
+	nfs_tcp_mark_len = 0;
+	nfs_tcp_len = 0;
+	nfs_tcp_place.dest = NULL;
+	tcp_connect(nfs_server_ip, nfs_server_port, &nfs_tcp_ops);
+}
+
+/* Closes the connection, so that calls over UDP time out as usual */
+static void nfs_tcp_stop(void)
+{
+	tcp_close();
+	nfs_tcp_open = false;
+	nfs_tcp_ready = false;
+	net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
+}
+#endif
+
 
 void nfs_start(void)
 {
@@ -759,9 +1277,20 @@ void nfs_start(void)
 
 	net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
 	net_set_udp_handler(nfs_handler);
+#if defined(CONFIG_IP_DEFRAG) && !defined(CONFIG_SYS_DIRECT_FLASH_NFS)
+	net_set_udp_place_handler(nfs_place);
+#endif
 
 	nfs_timeout_count = 0;
 	nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
+	nfs_version = 3;
+	nfs_tcp = IS_ENABLED(CONFIG_NFS_TCP);
+#ifdef CONFIG_NFS_TCP
+	nfs_tcp_open = false;
+	nfs_tcp_ready = false;
+#endif
+	nfs_server_mount_port = 0;
+	nfs_server_port = 0;
 
 	/*nfs_our_port = 4096 + (get_ticks() % 3072);*/
 	/*FIX ME !!!*/
@@ -25,7 +25,10 @@
 #define NFS_READLINK    5
 #define NFS_READ        6
 
+#define NFS3PROC_LOOKUP 3
+
 #define NFS_FHSIZE      32
+#define NFS3_FHSIZE     64
 
 #define NFSERR_PERM     1
 #define NFSERR_NOENT    2
@@ -44,6 +47,26 @@
 #define NFS_READ_SIZE 1024 /* biggest power of two that fits Ether frame */
 #endif
 
+/*
+ * NFSv3 servers allow reads of up to 32KB over UDP. Replies that large are
+ * fragmented, so with CONFIG_IP_DEFRAG use as much of that as the reassembly
+ * buffer holds, and otherwise the same size as NFSv2.
+ */
+#if defined(CONFIG_IP_DEFRAG) && CONFIG_NET_MAXDEFRAG > NFS_READ_SIZE
+#define NFS3_READ_SIZE	min(CONFIG_NET_MAXDEFRAG, 32768)
+#else
+#define NFS3_READ_SIZE	NFS_READ_SIZE
+#endif
+
+/*
+ * Over TCP a reply is never fragmented, so reads are as large as servers
+ * commonly allow. A server which allows less just returns less.
+ */
+#define NFS3_TCP_READ_SIZE	65536
+
+/* Over TCP each RPC message is sent as a record (RFC 5531 section 11) */
+#define RPC_LAST_FRAG	0x80000000	/* In a fragment's 4-byte header */
+
 #define NFS_MAXLINKDEPTH 16
 
 struct rpc_t {
@@ -65,7 +88,7 @@ struct rpc_t {
 			uint32_t verifier;
 			uint32_t v2;
 			uint32_t astatus;
-			uint32_t data[19];
+			uint32_t data[26];	/* largest READ header (v3) */
 		} reply;
 	} u;
 };
@@ -0,0 +1,422 @@
+/*
+ * Minimal TCP client, enough to download a file over one connection
+ *
+ * Data is only accepted in order. A segment which arrives after a lost
+ * one is dropped and acknowledged at once, so the sender sees duplicate
+ * ACKs and sends the rest again. There is no SACK. Since received data is
+ * stored as it arrives the receive window stays fully open; it is larger
+ * than 64KB if the peer agrees to window scaling (RFC 7323). Every second
+ * segment is acknowledged at once and others after TCP_DELACK_MS, as in
+ * RFC 1122.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <net.h>
+#include <asm/unaligned.h>
+#include "tcp.h"
+
+/* Largest segment that fits in an Ethernet frame */
+#define TCP_MSS			(1500 - IP_TCP_HDR_SIZE)
+/* Segment size to use if the peer does not say (RFC 1122) */
+#define TCP_DEFAULT_MSS		536
+
+#define TCP_RTO_MS		1000	/* Initial retransmission timeout */
+#define TCP_RTO_MAX_MS		8000
+#define TCP_RETRIES		10	/* Timeouts in a row before giving up */
+#define TCP_DELACK_MS		40	/* Longest an ACK is held back */
+#define TCP_TX_SIZE		2048	/* Most data waiting to be acked */
+
+#define TCP_OPT_END		0
+#define TCP_OPT_NOP		1
+#define TCP_OPT_MSS		2
+#define TCP_OPT_WSCALE		3
+#define TCP_WSCALE_MAX		14
+
+/* Sequence number comparison, allowing for wrap-around */
+#define SEQ_LT(a, b)		((s32)((a) - (b)) < 0)
+#define SEQ_LE(a, b)		((s32)((a) - (b)) <= 0)
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+};
+
+static enum tcp_state tcp_state;
+static const struct tcp_ops *tcp_ops;
+static struct in_addr tcp_dest;
+static u16 tcp_dport;
+static u16 tcp_sport;
+
+/* Sending: data from tcp_tx_seq is in tcp_tx_buf until acknowledged */
+static u32 tcp_iss;
+static u32 tcp_tx_seq;
+static u32 snd_una;
+static u32 snd_nxt;
+static ulong snd_wnd;
+static int snd_wscale;
+static uint snd_mss;
+static uchar tcp_tx_buf[TCP_TX_SIZE];
+static uint tcp_tx_len;
+
+/* Receiving */
+static u32 rcv_nxt;
+static int rcv_wscale;
+static int tcp_ack_pending;	/* Segments received but not acked */
+
+static ulong tcp_rto;
+static int tcp_retries;
+
+static void tcp_timeout_handler(void);
+
+/* Window scale we offer, so that the window fits in 16 bits */
+static int tcp_wscale(void)
+{
+	int shift = 0;
+
+	while ((CONFIG_TCP_WINDOW_SIZE >> shift) > 0xffff)
+		shift++;
+
+	return shift;
+}
+
+static u16 tcp_window(void)
+{
+	return min_t(ulong, CONFIG_TCP_WINDOW_SIZE >> rcv_wscale, 0xffff);
+}
+
+/* Checksum of the segment and the pseudo header, 0 if @ip has it right */
+static u16 tcp_checksum(struct ip_tcp_hdr *ip, unsigned len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} pseudo;
+
+	net_copy_ip(&pseudo.src, &ip->ip_src);
+	net_copy_ip(&pseudo.dst, &ip->ip_dst);
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(len);
+
+	return add_ip_checksums(sizeof(pseudo),
+				compute_ip_checksum(&pseudo, sizeof(pseudo)),
+				compute_ip_checksum(&ip->tcp_src, len));
+}
+
+static void tcp_send_segment(u8 flags, u32 seq, const uchar *data,
+			     unsigned len)
+{
+	uchar *pkt = net_tx_packet;
+	struct ip_tcp_hdr *ip;
+	unsigned hlen = TCP_HDR_SIZE;
+	uchar *opt;
+	int eth_hdr_size;
+
+	eth_hdr_size = net_set_ether(pkt, net_server_ethaddr, PROT_IP);
+	ip = (struct ip_tcp_hdr *)(pkt + eth_hdr_size);
+	opt = (uchar *)(ip + 1);
+	if (flags & TCP_SYN) {
+		opt[0] = TCP_OPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		opt[4] = TCP_OPT_NOP;
+		opt[5] = TCP_OPT_WSCALE;
+		opt[6] = 3;
+		opt[7] = tcp_wscale();
+		hlen += 8;
+	}
+	if (len)
+		memcpy((uchar *)ip + IP_HDR_SIZE + hlen, data, len);
+
+	net_set_ip_header((uchar *)ip, tcp_dest, net_ip);
+	ip->ip_len = htons(IP_HDR_SIZE + hlen + len);
+	ip->ip_p = IPPROTO_TCP;
+	ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
+
+	ip->tcp_src = htons(tcp_sport);
+	ip->tcp_dst = htons(tcp_dport);
+	put_unaligned_be32(seq, &ip->tcp_seq);
+	put_unaligned_be32(flags & TCP_ACK ? rcv_nxt : 0, &ip->tcp_ack);
+	ip->tcp_hlen = hlen << 2;
+	ip->tcp_flags = flags;
+	ip->tcp_win = htons(tcp_window());
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = tcp_checksum(ip, hlen + len);
+
+	if (flags & TCP_ACK)
+		tcp_ack_pending = 0;
+	net_send_ip_packet(net_server_ethaddr, tcp_dest,
+			   eth_hdr_size + IP_HDR_SIZE + hlen + len);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, snd_nxt, NULL, 0);
+}
+
+/* Sends whatever the peer's window allows, returning the segment count */
+static int tcp_output(void)
+{
+	u32 end = tcp_tx_seq + tcp_tx_len;
+	unsigned len;
+	int count = 0;
+
+	while (SEQ_LT(snd_nxt, end)) {
+		len = min(end - snd_nxt, snd_mss);
+		if (snd_nxt + len - snd_una > snd_wnd)
+			break;
+		tcp_send_segment(TCP_ACK | TCP_PSH, snd_nxt,
+				 tcp_tx_buf + (snd_nxt - tcp_tx_seq), len);
+		snd_nxt += len;
+		count++;
+	}
+
+	return count;
+}
+
+static void tcp_set_timer(void)
+{
+	net_set_timeout_handler(tcp_ack_pending ? TCP_DELACK_MS : tcp_rto,
+				tcp_timeout_handler);
+}
+
+static void tcp_finish(int err)
+{
+	tcp_state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+	tcp_ops->closed(err);
+}
+
+static void tcp_timeout_handler(void)
+{
+	if (tcp_ack_pending) {
+		tcp_send_ack();
+		tcp_set_timer();
+		return;
+	}
+	if (++tcp_retries > TCP_RETRIES) {
+		tcp_finish(-ETIMEDOUT);
+		return;
+	}
+	puts("T ");
+	tcp_rto = min_t(ulong, tcp_rto * 2, TCP_RTO_MAX_MS);
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_send_segment(TCP_SYN, tcp_iss, NULL, 0);
+	} else {
+		/* Send everything unacknowledged again, or nudge the peer */
+		snd_nxt = snd_una;
+		if (!tcp_output())
+			tcp_send_ack();
+	}
+	tcp_set_timer();
+}
+
+static void tcp_parse_options(const uchar *opt, int len)
+{
+	while (len > 0 && opt[0] != TCP_OPT_END) {
+		if (opt[0] == TCP_OPT_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		if (opt[0] == TCP_OPT_MSS && opt[1] == 4) {
+			snd_mss = min_t(uint, get_unaligned_be16(opt + 2),
+					TCP_MSS);
+		} else if (opt[0] == TCP_OPT_WSCALE && opt[1] == 3) {
+			snd_wscale = min_t(int, opt[2], TCP_WSCALE_MAX);
+			rcv_wscale = tcp_wscale();
+		}
+		len -= opt[1];
+		opt += opt[1];
+	}
+}
+
+static void tcp_receive_syn_ack(struct ip_tcp_hdr *ip, unsigned hlen)
+{
+	u32 ack = get_unaligned_be32(&ip->tcp_ack);
+
+	if ((ip->tcp_flags & (TCP_SYN | TCP_ACK)) != (TCP_SYN | TCP_ACK) ||
+	    ack != tcp_iss + 1)
+		return;
+
+	rcv_nxt = get_unaligned_be32(&ip->tcp_seq) + 1;
+	snd_una = ack;
+	tcp_parse_options((uchar *)(ip + 1), hlen - TCP_HDR_SIZE);
+	/* The window in a SYN is never scaled */
+	snd_wnd = ntohs(ip->tcp_win);
+	tcp_state = TCP_ESTABLISHED;
+	tcp_retries = 0;
+	tcp_rto = TCP_RTO_MS;
+
+	/* Acknowledge the SYN, with the first data if there is any */
+	tcp_ops->connected();
+	if (tcp_state == TCP_ESTABLISHED && snd_nxt == snd_una)
+		tcp_send_ack();
+}
+
+static void tcp_receive_data(u32 seq, const uchar *data, unsigned len,
+			     bool fin)
+{
+	u32 skip;
+
+	if (SEQ_LT(rcv_nxt, seq)) {
+		/* Something before this was lost, so ask for it again */
+		tcp_send_ack();
+		return;
+	}
+	skip = rcv_nxt - seq;
+	if (skip >= len && !(fin && skip == len)) {
+		/* Nothing new, perhaps because our ACK was lost */
+		tcp_send_ack();
+		return;
+	}
+
+	if (skip < len) {
+		rcv_nxt += len - skip;
+		tcp_retries = 0;
+		tcp_rto = TCP_RTO_MS;
+		tcp_ops->recv(data + skip, len - skip);
+		if (tcp_state != TCP_ESTABLISHED)
+			return;
+	}
+
+	if (fin) {
+		/* Acknowledge the FIN and close our side too */
+		rcv_nxt++;
+		tcp_send_segment(TCP_FIN | TCP_ACK, snd_nxt, NULL, 0);
+		tcp_finish(0);
+	} else if (skip || ++tcp_ack_pending >= 2) {
+		tcp_send_ack();
+	}
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, int len)
+{
+	unsigned hlen;
+	u32 seq, ack;
+	u8 flags;
+
+	if (tcp_state == TCP_CLOSED || len < IP_TCP_HDR_SIZE)
+		return;
+	if (net_read_ip(&ip->ip_src).s_addr != tcp_dest.s_addr ||
+	    ntohs(ip->tcp_src) != tcp_dport || ntohs(ip->tcp_dst) != tcp_sport)
+		return;
+	hlen = (ip->tcp_hlen >> 4) * 4;
+	if (hlen < TCP_HDR_SIZE || IP_HDR_SIZE + hlen > len)
+		return;
+	if (tcp_checksum(ip, len - IP_HDR_SIZE)) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	seq = get_unaligned_be32(&ip->tcp_seq);
+	ack = get_unaligned_be32(&ip->tcp_ack);
+	flags = ip->tcp_flags;
+	if (flags & TCP_RST) {
+		/* Only believe a reset which fits the connection */
+		if (tcp_state == TCP_SYN_SENT ?
+		    flags & TCP_ACK && ack == tcp_iss + 1 : seq == rcv_nxt)
+			tcp_finish(tcp_state == TCP_SYN_SENT ? -ECONNREFUSED :
+				   -ECONNRESET);
+		return;
+	}
+
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_receive_syn_ack(ip, hlen);
+	} else if (flags & TCP_ACK) {
+		if (SEQ_LT(snd_una, ack) && SEQ_LE(ack, snd_nxt)) {
+			snd_una = ack;
+			tcp_retries = 0;
+			tcp_rto = TCP_RTO_MS;
+		}
+		snd_wnd = (ulong)ntohs(ip->tcp_win) << snd_wscale;
+		if (len > IP_HDR_SIZE + hlen || flags & TCP_FIN)
+			tcp_receive_data(seq, (uchar *)ip + IP_HDR_SIZE + hlen,
+					 len - IP_HDR_SIZE - hlen,
+					 flags & TCP_FIN);
+		if (tcp_state == TCP_ESTABLISHED)
+			tcp_output();
+	}
+
+	if (tcp_state != TCP_CLOSED)
+		tcp_set_timer();
+}
+
+void tcp_connect(struct in_addr dest, u16 port, const struct tcp_ops *ops)
+{
+	tcp_ops = ops;
+	tcp_dest = dest;
+	tcp_dport = port;
+	tcp_sport = random_port();
+	tcp_iss = get_ticks();
+
+	tcp_tx_seq = tcp_iss + 1;
+	snd_una = tcp_iss;
+	snd_nxt = tcp_iss + 1;
+	snd_wnd = 0;
+	snd_wscale = 0;
+	snd_mss = TCP_DEFAULT_MSS;
+	tcp_tx_len = 0;
+	rcv_nxt = 0;
+	rcv_wscale = 0;
+	tcp_ack_pending = 0;
+	tcp_rto = TCP_RTO_MS;
+	tcp_retries = 0;
+
+	tcp_state = TCP_SYN_SENT;
+	tcp_send_segment(TCP_SYN, tcp_iss, NULL, 0);
+	tcp_set_timer();
+}
+
+int tcp_send(const void *data, unsigned len)
+{
+	if (tcp_state != TCP_ESTABLISHED)
+		return -ENOTCONN;
+	/* Drop whatever has been acknowledged to make room */
+	if (SEQ_LT(tcp_tx_seq, snd_una)) {
+		uint acked = snd_una - tcp_tx_seq;
+
+		memmove(tcp_tx_buf, tcp_tx_buf + acked, tcp_tx_len - acked);
+		tcp_tx_len -= acked;
+		tcp_tx_seq = snd_una;
+	}
+	if (tcp_tx_len + len > TCP_TX_SIZE)
+		return -ENOSPC;
+	memcpy(tcp_tx_buf + tcp_tx_len, data, len);
+	tcp_tx_len += len;
+	tcp_output();
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	if (tcp_state != TCP_ESTABLISHED)
+		return;
+	tcp_send_segment(TCP_FIN | TCP_ACK, tcp_tx_seq + tcp_tx_len, NULL, 0);
+	tcp_clear();
+}
+
+void tcp_abort(void)
+{
+	if (tcp_state == TCP_ESTABLISHED)
+		tcp_send_segment(TCP_RST, snd_nxt, NULL, 0);
+	tcp_clear();
+}
+
+void tcp_clear(void)
+{
+	if (tcp_state != TCP_CLOSED)
+		net_set_timeout_handler(0, NULL);
+	tcp_state = TCP_CLOSED;
+}
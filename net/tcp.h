@@ -0,0 +1,79 @@
+/*
+ * Minimal TCP client
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+#include <common.h>
+#include <net.h>
+
+/**
+ * struct tcp_ops - Callbacks from the TCP connection to its user
+ *
+ * @connected:	The connection is open, so tcp_send() may be called
+ * @recv:	In-order data has arrived. @data is only valid until this
+ *		returns. This may call tcp_close() or tcp_abort()
+ * @closed:	The connection is gone, with 0 if the peer closed it after
+ *		sending all its data, else -ECONNREFUSED, -ECONNRESET or
+ *		-ETIMEDOUT
+ */
+struct tcp_ops {
+	void (*connected)(void);
+	void (*recv)(const uchar *data, unsigned len);
+	void (*closed)(int err);
+};
+
+/**
+ * tcp_connect() - Open a connection, from a random local port
+ *
+ * @dest:	IP address to connect to. Its Ethernet address is kept in
+ *		net_server_ethaddr, which must be zero if @dest has changed
+ * @port:	TCP port to connect to
+ * @ops:	Callbacks for the connection
+ */
+void tcp_connect(struct in_addr dest, u16 port, const struct tcp_ops *ops);
+
+/**
+ * tcp_send() - Send data on the open connection
+ *
+ * The data is copied, and sent again until the peer acknowledges it.
+ *
+ * @data:	Data to send
+ * @len:	Number of bytes at @data
+ * @return 0 if OK, -ENOTCONN if not connected, -ENOSPC if too much data
+ * is waiting to be acknowledged
+ */
+int tcp_send(const void *data, unsigned len);
+
+/**
+ * tcp_close() - Send a FIN and forget the connection
+ *
+ * This does not wait for the peer to acknowledge the FIN, so is only
+ * suitable once all the data the user needs has been received.
+ */
+void tcp_close(void);
+
+/**
+ * tcp_abort() - Send a RST and forget the connection
+ */
+void tcp_abort(void);
+
+/**
+ * tcp_clear() - Forget the connection without sending anything
+ *
+ * This is called when net_loop() finishes.
+ */
+void tcp_clear(void);
+
+/**
+ * tcp_receive() - Deal with a received TCP segment
+ *
+ * @ip:		IP header of the segment, with a valid checksum
+ * @len:	Length of the IP packet
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, int len);
+
+#endif /* __TCP_H__ */
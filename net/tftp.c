@@ -8,6 +8,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <div64.h>
 #include <efi_loader.h>
 #include <mapmem.h>
 #include <net.h>
@@ -21,6 +22,8 @@
 #define WELL_KNOWN_PORT	69
 /* Millisecs to timeout for lost pkt */
 #define TIMEOUT		5000UL
+/* Lower bound for the timeout derived from the measured round trip time */
+#define TIMEOUT_MIN	1000UL
 #ifndef	CONFIG_NET_RETRY_COUNT
 /* # of timeouts before giving up */
 # define TIMEOUT_COUNT	10
@@ -44,6 +47,17 @@ static ulong timeout_ms = TIMEOUT;
 static int timeout_count_max = TIMEOUT_COUNT;
 static ulong time_start;   /* Record time we started tftp */
 
+/*
+ * Retransmission timeout, adapted to the round trip time measured between
+ * sending a request or ACK and receiving the next data block (RFC 6298).
+ * It stays between TIMEOUT_MIN and timeout_ms.
+ */
+static ulong tftp_rto_ms;
+static ulong tftp_srtt_us;
+static ulong tftp_rttvar_us;
+/* timer_get_us() when the packet being timed was sent, 0 if none */
+static ulong tftp_rtt_start_us;
+
 /*
  * These globals govern the timeout behavior when attempting a connection to a
  * TFTP server. tftp_timeout_ms specifies the number of milliseconds to
@@ -134,6 +148,25 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 window: the server sends up to tftp_windowsize blocks before
+ * waiting for an ACK. Blocks arriving ahead of a missing one are stored
+ * straight away and noted in tftp_window_pending, where bit n stands for
+ * block tftp_prev_block + 2 + n, so a reordered window needs no resend.
+ */
+#define TFTP_WINDOW_MAX		64
+
+static unsigned short tftp_windowsize = 1;
+static unsigned short tftp_windowsize_option = CONFIG_TFTP_WINDOWSIZE;
+/* last block we acknowledged */
+static ulong	tftp_last_ack;
+static u64	tftp_window_pending;
+/* the short, final block arrived out of order */
+static int	tftp_window_final_seen;
+static ushort	tftp_window_final;
+/* blocks received in order in this transfer, for the summary */
+static ulong	tftp_blocks;
+
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
 #define MTFTP_BITMAPSIZE	0x1000
@@ -193,7 +226,9 @@ static inline void store_block(int block, uchar *src, unsigned len)
 	{
 		void *ptr = map_sysmem(load_addr + offset, len);
 
-		memcpy(ptr, src, len);
+		/* A large block may already be there, see tftp_place() */
+		if (ptr != net_rx_placed)
+			memcpy(ptr, src, len);
 		unmap_sysmem(ptr);
 	}
 #ifdef CONFIG_MCAST_TFTP
@@ -211,6 +246,10 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	tftp_last_ack = 0;
+	tftp_window_pending = 0;
+	tftp_window_final_seen = 0;
+	tftp_blocks = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -303,6 +342,84 @@ static void update_block_number(void)
 	}
 }
 
+/* Update the retransmission timeout from a round trip time sample */
+static void tftp_rtt_sample(void)
+{
+	ulong rtt_us, delta;
+
+	if (!tftp_rtt_start_us)
+		return;
+	rtt_us = timer_get_us() - tftp_rtt_start_us;
+	tftp_rtt_start_us = 0;
+	net_rtt_add(&net_stats.tftp.rtt, rtt_us);
+
+	if (!tftp_srtt_us) {
+		tftp_srtt_us = rtt_us;
+		tftp_rttvar_us = rtt_us / 2;
+	} else {
+		delta = tftp_srtt_us > rtt_us ? tftp_srtt_us - rtt_us :
+			rtt_us - tftp_srtt_us;
+		tftp_rttvar_us = (3 * tftp_rttvar_us + delta) / 4;
+		tftp_srtt_us = (7 * tftp_srtt_us + rtt_us) / 8;
+	}
+
+	tftp_rto_ms = (tftp_srtt_us + 4 * tftp_rttvar_us) / 1000;
+	tftp_rto_ms = clamp(tftp_rto_ms, TIMEOUT_MIN, timeout_ms);
+}
+
+/*
+ * Note a block received ahead of the next expected one within the window,
+ * @delta blocks further on. If it ends the server's window, the server now
+ * waits for us, so acknowledge the last in-order block at once to have
+ * the missing ones resent.
+ */
+static void tftp_window_receive(ushort delta, uchar *pkt, unsigned len)
+{
+	ushort block = tftp_prev_block + 1 + delta;
+
+	/* Stale repeats and blocks beyond the window are dropped */
+	if (delta >= tftp_windowsize)
+		return;
+
+	store_block(tftp_prev_block + delta, pkt, len);
+	tftp_window_pending |= 1ULL << (delta - 1);
+	if (len < tftp_block_size) {
+		tftp_window_final_seen = 1;
+		tftp_window_final = block;
+	}
+
+	if (block == (ushort)(tftp_last_ack + tftp_windowsize) ||
+	    len < tftp_block_size) {
+		net_stats.tftp.resends++;
+		tftp_send();
+	}
+}
+
+/*
+ * After an in-order block, consume any following blocks which already
+ * arrived out of order.
+ *
+ * @return true if the final block has now been received
+ */
+static bool tftp_window_advance(void)
+{
+	bool have;
+
+	for (;;) {
+		have = tftp_window_pending & 1;
+		tftp_window_pending >>= 1;
+		if (!have)
+			return false;
+
+		tftp_cur_block = (ushort)(tftp_cur_block + 1);
+		update_block_number();
+		tftp_prev_block = tftp_cur_block;
+		tftp_blocks++;
+		if (tftp_window_final_seen && tftp_cur_block == tftp_window_final)
+			return true;
+	}
+}
+
 /* The TFTP get or put is complete */
 static void tftp_complete(void)
 {
@@ -320,6 +437,11 @@ static void tftp_complete(void)
 		puts("\n\t ");	/* Line up with "Loading: " */
 		print_size(net_boot_file_size /
 			time_start * 1000, "/s");
+		if (tftp_blocks)
+			printf(", %llu blocks/s",
+			       lldiv((u64)tftp_blocks * 1000, time_start));
+		if (tftp_windowsize > 1)
+			printf(", window %d", tftp_windowsize);
 	}
 	puts("\ndone\n");
 	net_set_state(NETLOOP_SUCCESS);
@@ -372,6 +494,10 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/* and for several blocks per ACK (RFC 7440) */
+		if (tftp_state == STATE_SEND_RRQ && tftp_windowsize_option > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_windowsize_option, 0);
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
 		if (!tftp_mcast_disabled) {
@@ -404,6 +530,7 @@ static void tftp_send(void)
 		s[0] = htons(TFTP_ACK);
 		s[1] = htons(tftp_cur_block);
 		pkt = (uchar *)(s + 2);
+		tftp_last_ack = tftp_cur_block;
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active) {
 			int toload = tftp_block_size;
@@ -441,6 +568,8 @@ static void tftp_send(void)
 		break;
 	}
 
+	if (!tftp_put_active)
+		tftp_rtt_start_us = timer_get_us();
 	net_send_udp_packet(net_server_ethaddr, tftp_remote_ip,
 			    tftp_remote_port, tftp_our_port, len);
 }
@@ -462,6 +591,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 {
 	__be16 proto;
 	__be16 *s;
+	bool last_block;
 	int i;
 
 	if (dest != tftp_our_port) {
@@ -540,6 +670,13 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_windowsize = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_windowsize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -549,8 +686,13 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			}
 #endif
 		}
+		/* The server may only lower the window size we asked for */
+		tftp_windowsize = clamp_t(unsigned short, tftp_windowsize, 1,
+					  tftp_windowsize_option);
 #ifdef CONFIG_MCAST_TFTP
 		parse_multicast_oack((char *)pkt, len - 1);
+		if (tftp_mcast_active)
+			tftp_windowsize = 1;
 		if ((tftp_mcast_active) && (!tftp_mcast_master_client))
 			tftp_state = STATE_DATA;	/* passive.. */
 		else
@@ -568,6 +710,17 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (len < 2)
 			return;
 		len -= 2;
+
+		if (tftp_windowsize > 1 && tftp_state == STATE_DATA) {
+			ushort delta = ntohs(*(__be16 *)pkt) -
+				       (ushort)(tftp_prev_block + 1);
+
+			if (delta) {
+				tftp_window_receive(delta, pkt + 2, len);
+				break;
+			}
+		}
+
 		tftp_cur_block = ntohs(*(__be16 *)pkt);
 
 		update_block_number();
@@ -603,10 +756,15 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		}
 
 		tftp_prev_block = tftp_cur_block;
+		tftp_rtt_sample();
 		timeout_count_max = tftp_timeout_count_max;
-		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		net_set_timeout_handler(tftp_rto_ms, tftp_timeout_handler);
 
 		store_block(tftp_cur_block - 1, pkt + 2, len);
+		tftp_blocks++;
+		last_block = len < tftp_block_size;
+		if (tftp_window_pending)
+			last_block |= tftp_window_advance();
 
 		/*
 		 *	Acknowledge the block just received, which will prompt
@@ -638,7 +796,13 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			}
 		}
 #endif
-		tftp_send();
+		/*
+		 * With a window, only the block which completes it is
+		 * acknowledged, as the server waits for nothing else.
+		 */
+		if (tftp_windowsize == 1 || last_block ||
+		    (ushort)(tftp_cur_block - tftp_last_ack) >= tftp_windowsize)
+			tftp_send();
 
 #ifdef CONFIG_MCAST_TFTP
 		if (tftp_mcast_active) {
@@ -650,7 +814,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			}
 		} else
 #endif
-		if (len < tftp_block_size)
+		if (last_block)
 			tftp_complete();
 		break;
 
@@ -682,22 +846,63 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	}
 }
 
+#if defined(CONFIG_IP_DEFRAG) && !defined(CONFIG_SYS_DIRECT_FLASH_TFTP)
+/*
+ * A block larger than the MTU arrives in several IP fragments. If it is
+ * one we are waiting for, its data is stored in place as each fragment
+ * arrives, and store_block() then has nothing to copy.
+ */
+static bool tftp_place(uchar *pkt, unsigned dest, struct in_addr sip,
+		       unsigned src, unsigned len, struct net_rx_place *place)
+{
+	ushort delta;
+	ulong offset;
+
+	if (tftp_state != STATE_DATA || dest != tftp_our_port ||
+	    src != tftp_remote_port || len < 4 ||
+	    ntohs(*(__be16 *)pkt) != TFTP_DATA)
+		return false;
+#ifdef CONFIG_MCAST_TFTP
+	if (tftp_mcast_active)
+		return false;
+#endif
+
+	delta = ntohs(*(__be16 *)(pkt + 2)) - (ushort)(tftp_prev_block + 1);
+	if (delta >= tftp_windowsize)
+		return false;
+
+	offset = (tftp_prev_block + delta) * tftp_block_size +
+		tftp_block_wrap_offset;
+	place->dest = map_sysmem(load_addr + offset, tftp_block_size);
+	place->skip = 4;
+	place->max = tftp_block_size;
+
+	return true;
+}
+#endif
 
 static void tftp_timeout_handler(void)
 {
+	net_stats.tftp.timeouts++;
 	if (++timeout_count > timeout_count_max) {
 		restart("Retry count exceeded");
 	} else {
 		puts("T ");
-		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
-		if (tftp_state != STATE_RECV_WRQ)
+		/* back off, and don't time the retransmission (Karn) */
+		tftp_rto_ms = min(tftp_rto_ms * 2, timeout_ms);
+		net_set_timeout_handler(tftp_rto_ms, tftp_timeout_handler);
+		if (tftp_state != STATE_RECV_WRQ) {
+			net_stats.tftp.resends++;
 			tftp_send();
+		}
+		tftp_rtt_start_us = 0;
 	}
 }
 
 
 void tftp_start(enum proto_t protocol)
 {
+	long windowsize = CONFIG_TFTP_WINDOWSIZE;
 #if CONFIG_NET_TFTP_VARS
 	char *ep;             /* Environment pointer */
 
@@ -729,10 +934,22 @@ void tftp_start(enum proto_t protocol)
 		       tftp_timeout_count_max);
 		tftp_timeout_count_max = 0;
 	}
+
+	ep = getenv("tftpwindowsize");
+	if (ep != NULL)
+		windowsize = simple_strtol(ep, NULL, 10);
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	/* 0 or a value which does not parse means no windowing */
+	if (windowsize < 1 || windowsize > TFTP_WINDOW_MAX) {
+		printf("TFTP window size (%ld) out of range, set to %d\n",
+		       windowsize, windowsize < 1 ? 1 : TFTP_WINDOW_MAX);
+		windowsize = clamp_t(long, windowsize, 1, TFTP_WINDOW_MAX);
+	}
+	tftp_windowsize_option = windowsize;
+
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_windowsize_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (net_boot_file_name[0] == '\0') {
@@ -813,6 +1030,9 @@ void tftp_start(enum proto_t protocol)
 
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 	net_set_udp_handler(tftp_handler);
+#if defined(CONFIG_IP_DEFRAG) && !defined(CONFIG_SYS_DIRECT_FLASH_TFTP)
+	net_set_udp_place_handler(tftp_place);
+#endif
 #ifdef CONFIG_CMD_TFTPPUT
 	net_set_icmp_handler(icmp_handler);
 #endif
@@ -835,6 +1055,10 @@ void tftp_start(enum proto_t protocol)
 	memset(net_server_ethaddr, 0, 6);
 	/* Revert tftp_block_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
+	tftp_rto_ms = timeout_ms;
+	tftp_srtt_us = 0;
+	tftp_rtt_start_us = 0;
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -864,6 +1088,10 @@ void tftp_start_server(void)
 
 	/* Revert tftp_block_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
+	tftp_rto_ms = timeout_ms;
+	tftp_srtt_us = 0;
+	tftp_rtt_start_us = 0;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
@@ -874,6 +1102,9 @@ void tftp_start_server(void)
 
 	tftp_state = STATE_RECV_WRQ;
 	net_set_udp_handler(tftp_handler);
+#if defined(CONFIG_IP_DEFRAG) && !defined(CONFIG_SYS_DIRECT_FLASH_TFTP)
+	net_set_udp_place_handler(tftp_place);
+#endif
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
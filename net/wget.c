@@ -0,0 +1,344 @@
+/*
+ * HTTP/1.1 client which downloads a file straight to the load address
+ *
+ * The response body may have a Content-Length, use chunked transfer
+ * coding, or end when the server closes the connection.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <div64.h>
+#include <errno.h>
+#include <mapmem.h>
+#include <net.h>
+#include "tcp.h"
+#include "wget.h"
+
+#define HASHES_PER_LINE		65	/* "loading" hashes per line */
+#define WGET_HASH_BYTES		(64 << 10)	/* without Content-Length */
+#define WGET_HEADER_SIZE	2048	/* Largest response header */
+#define WGET_LINE_SIZE		128	/* Largest chunk size or trailer line */
+
+enum wget_state {
+	WGET_HEADER,		/* Reading the response header */
+	WGET_BODY,		/* Reading a body which is not chunked */
+	WGET_CHUNK_SIZE,	/* Reading the line before a chunk */
+	WGET_CHUNK_DATA,	/* Reading the data in a chunk */
+	WGET_CHUNK_END,		/* Reading the line ending a chunk */
+	WGET_TRAILER,		/* Reading the trailer after the last chunk */
+	WGET_DONE,		/* Finished, whether or not successfully */
+};
+
+static enum wget_state wget_state;
+static struct in_addr wget_server_ip;
+/* Path part of net_boot_file_name, which is left as given */
+static char wget_path[sizeof(net_boot_file_name)];
+static char wget_header[WGET_HEADER_SIZE + 1];
+static unsigned wget_header_len;
+static char wget_line[WGET_LINE_SIZE + 1];
+static unsigned wget_line_len;
+static bool wget_has_length;
+static ulong wget_length;	/* Content-Length, if wget_has_length */
+static ulong wget_chunk_left;	/* Bytes still to come in this chunk */
+static ulong wget_received;	/* Bytes of body stored so far */
+static int wget_hashes;
+static ulong wget_time_start;
+
+static void wget_fail(const char *msg)
+{
+	printf("\n%s\n", msg);
+	wget_state = WGET_DONE;
+	tcp_abort();
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_done(void)
+{
+	ulong ms;
+
+	wget_state = WGET_DONE;
+	tcp_close();
+
+	if (wget_has_length) {
+		/* Print hash marks for the last packet received */
+		while (wget_hashes < 50) {
+			putc('#');
+			wget_hashes++;
+		}
+		puts("  ");
+		print_size(wget_length, "");
+	}
+	ms = get_timer(wget_time_start);
+	if (ms > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(lldiv((u64)wget_received * 1000, ms), "/s");
+	}
+	puts("\ndone\n");
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static void wget_show_progress(void)
+{
+	if (wget_has_length) {
+		while (wget_length &&
+		       wget_hashes < (u64)wget_received * 50 / wget_length) {
+			putc('#');
+			wget_hashes++;
+		}
+		return;
+	}
+	while (wget_hashes < wget_received / WGET_HASH_BYTES) {
+		if (wget_hashes && !(wget_hashes % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+		wget_hashes++;
+	}
+}
+
+static void wget_store(const uchar *data, unsigned len)
+{
+	void *ptr = map_sysmem(load_addr + wget_received, len);
+
+	memcpy(ptr, data, len);
+	unmap_sysmem(ptr);
+	wget_received += len;
+	net_boot_file_size = wget_received;
+	wget_show_progress();
+}
+
+/*
+ * Collects a line of up to WGET_LINE_SIZE characters in wget_line,
+ * returning the number of bytes used. *donep is set once the whole line
+ * is there, without its CR LF.
+ */
+static unsigned wget_get_line(const uchar *data, unsigned len, bool *donep)
+{
+	unsigned i;
+
+	*donep = false;
+	for (i = 0; i < len; i++) {
+		if (data[i] == '\n') {
+			if (wget_line_len &&
+			    wget_line[wget_line_len - 1] == '\r')
+				wget_line_len--;
+			wget_line[wget_line_len] = '\0';
+			wget_line_len = 0;
+			*donep = true;
+			return i + 1;
+		}
+		if (wget_line_len < WGET_LINE_SIZE)
+			wget_line[wget_line_len++] = data[i];
+	}
+
+	return len;
+}
+
+/* Looks up a header field, returning its value or NULL if absent */
+static const char *wget_field(const char *name)
+{
+	int len = strlen(name);
+	const char *p;
+
+	for (p = strchr(wget_header, '\n'); p; p = strchr(p, '\n')) {
+		p++;
+		if (!strncasecmp(p, name, len) && p[len] == ':') {
+			p += len + 1;
+			while (*p == ' ' || *p == '\t')
+				p++;
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+/* Checks the header once it is complete, returning 0 if OK */
+static int wget_parse_header(void)
+{
+	const char *val;
+	char msg[80];
+	int status;
+
+	if (strncmp(wget_header, "HTTP/1.", 7) || wget_header[8] != ' ') {
+		wget_fail("Not an HTTP response");
+		return -EINVAL;
+	}
+	status = simple_strtoul(wget_header + 9, NULL, 10);
+	if (status != 200) {
+		/* Report the status line */
+		*strchr(wget_header, '\r') = '\0';
+		snprintf(msg, sizeof(msg), "HTTP error: %s", wget_header + 9);
+		wget_fail(msg);
+		return -ENOENT;
+	}
+
+	val = wget_field("Transfer-Encoding");
+	if (val && !strncasecmp(val, "chunked", 7)) {
+		wget_state = WGET_CHUNK_SIZE;
+		return 0;
+	}
+	wget_state = WGET_BODY;
+	val = wget_field("Content-Length");
+	if (val) {
+		wget_has_length = true;
+		wget_length = simple_strtoul(val, NULL, 10);
+	}
+
+	return 0;
+}
+
+/* Adds data to the header, returning the number of bytes used */
+static unsigned wget_add_header(const uchar *data, unsigned len)
+{
+	char *end;
+	unsigned used;
+
+	used = min(len, WGET_HEADER_SIZE - wget_header_len);
+	memcpy(wget_header + wget_header_len, data, used);
+	wget_header[wget_header_len + used] = '\0';
+	end = strstr(wget_header, "\r\n\r\n");
+	if (!end) {
+		wget_header_len += used;
+		if (wget_header_len == WGET_HEADER_SIZE)
+			wget_fail("HTTP header too long");
+		return used;
+	}
+
+	/* Leave the rest for the body */
+	used = end + 4 - (wget_header + wget_header_len);
+	end[2] = '\0';
+	wget_parse_header();
+
+	return used;
+}
+
+static void wget_recv(const uchar *data, unsigned len)
+{
+	unsigned used;
+	bool done;
+
+	while (len && wget_state != WGET_DONE) {
+		switch (wget_state) {
+		case WGET_HEADER:
+			used = wget_add_header(data, len);
+			break;
+		case WGET_BODY:
+			used = len;
+			if (wget_has_length)
+				used = min_t(ulong, len,
+					     wget_length - wget_received);
+			wget_store(data, used);
+			break;
+		case WGET_CHUNK_SIZE:
+			used = wget_get_line(data, len, &done);
+			if (!done)
+				break;
+			wget_chunk_left = simple_strtoul(wget_line, NULL, 16);
+			wget_state = wget_chunk_left ? WGET_CHUNK_DATA :
+				WGET_TRAILER;
+			break;
+		case WGET_CHUNK_DATA:
+			used = min_t(ulong, len, wget_chunk_left);
+			wget_store(data, used);
+			wget_chunk_left -= used;
+			if (!wget_chunk_left)
+				wget_state = WGET_CHUNK_END;
+			break;
+		case WGET_CHUNK_END:
+			used = wget_get_line(data, len, &done);
+			if (done)
+				wget_state = WGET_CHUNK_SIZE;
+			break;
+		case WGET_TRAILER:
+			used = wget_get_line(data, len, &done);
+			if (done && !*wget_line)
+				wget_done();
+			break;
+		default:
+			used = len;
+			break;
+		}
+		data += used;
+		len -= used;
+
+		if (wget_state == WGET_BODY && wget_has_length &&
+		    wget_received == wget_length)
+			wget_done();
+	}
+}
+
+static void wget_connected(void)
+{
+	char req[sizeof(net_boot_file_name) + 128];
+	const char *name = wget_path;
+	int len;
+
+	len = snprintf(req, sizeof(req),
+		       "GET %s%s HTTP/1.1\r\n"
+		       "Host: %pI4\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Connection: close\r\n\r\n",
+		       *name == '/' ? "" : "/", name, &wget_server_ip);
+	if (tcp_send(req, len))
+		wget_fail("HTTP request too long");
+}
+
+static void wget_closed(int err)
+{
+	if (wget_state == WGET_DONE)
+		return;
+	if (!err && wget_state == WGET_BODY && !wget_has_length)
+		wget_done();
+	else if (err == -ECONNREFUSED)
+		wget_fail("Connection refused");
+	else if (err == -ETIMEDOUT)
+		wget_fail("Retry count exceeded");
+	else
+		wget_fail("Connection closed before the end of the file");
+}
+
+static const struct tcp_ops wget_tcp_ops = {
+	.connected	= wget_connected,
+	.recv		= wget_recv,
+	.closed		= wget_closed,
+};
+
+void wget_start(void)
+{
+	char *p;
+
+	/* The net loop may start again, so the name must still parse */
+	p = strchr(net_boot_file_name, ':');
+	if (p) {
+		wget_server_ip = string_to_ip(net_boot_file_name);
+		strlcpy(wget_path, p + 1, sizeof(wget_path));
+	} else {
+		wget_server_ip = net_server_ip;
+		strlcpy(wget_path, net_boot_file_name, sizeof(wget_path));
+	}
+	if (!wget_path[0]) {
+		puts("*** ERROR: no file name given\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4; our IP address is %pI4\n",
+	       &wget_server_ip, &net_ip);
+	printf("Filename '%s'.\n", wget_path);
+	printf("Load address: 0x%lx\n", load_addr);
+	puts("Loading: *\b");
+
+	wget_state = WGET_HEADER;
+	wget_header_len = 0;
+	wget_line_len = 0;
+	wget_has_length = false;
+	wget_received = 0;
+	wget_hashes = 0;
+	wget_time_start = get_timer(0);
+
+	/* zero out server ether in case the server ip has changed */
+	memset(net_server_ethaddr, 0, 6);
+	tcp_connect(wget_server_ip, HTTP_SERVICE_PORT, &wget_tcp_ops);
+}
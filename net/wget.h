@@ -0,0 +1,14 @@
+/*
+ * HTTP download over TCP
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+#define HTTP_SERVICE_PORT	80
+
+void wget_start(void);	/* Begin HTTP GET */
+
+#endif /* __WGET_H__ */
@@ -13,12 +13,31 @@ static int do_ut_all(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
 
 static cmd_tbl_t cmd_ut_sub[] = {
 	U_BOOT_CMD_MKENT(all, CONFIG_SYS_MAXARGS, 1, do_ut_all, "", ""),
+#ifdef CONFIG_UT_CRC32
+	U_BOOT_CMD_MKENT(crc32, CONFIG_SYS_MAXARGS, 1, do_ut_crc32, "", ""),
+#endif
+#ifdef CONFIG_UT_DFU
+	U_BOOT_CMD_MKENT(dfu, CONFIG_SYS_MAXARGS, 1, do_ut_dfu, "", ""),
+#endif
 #if defined(CONFIG_UT_DM)
 	U_BOOT_CMD_MKENT(dm, CONFIG_SYS_MAXARGS, 1, do_ut_dm, "", ""),
 #endif
 #if defined(CONFIG_UT_ENV)
 	U_BOOT_CMD_MKENT(env, CONFIG_SYS_MAXARGS, 1, do_ut_env, "", ""),
 #endif
+#ifdef CONFIG_UT_INITCALL
+	U_BOOT_CMD_MKENT(initcall, CONFIG_SYS_MAXARGS, 1, do_ut_initcall, "",
+			 ""),
+#endif
+#ifdef CONFIG_UT_SPARSE
+	U_BOOT_CMD_MKENT(sparse, CONFIG_SYS_MAXARGS, 1, do_ut_sparse, "", ""),
+#endif
+#ifdef CONFIG_UT_STRING
+	U_BOOT_CMD_MKENT(string, CONFIG_SYS_MAXARGS, 1, do_ut_string, "", ""),
+#endif
+#ifdef CONFIG_UT_TASK
+	U_BOOT_CMD_MKENT(task, CONFIG_SYS_MAXARGS, 1, do_ut_task, "", ""),
+#endif
 #ifdef CONFIG_UT_TIME
 	U_BOOT_CMD_MKENT(time, CONFIG_SYS_MAXARGS, 1, do_ut_time, "", ""),
 #endif
@@ -62,12 +81,30 @@ static int do_ut(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 #ifdef CONFIG_SYS_LONGHELP
 static char ut_help_text[] =
 	"all - execute all enabled tests\n"
+#ifdef CONFIG_UT_CRC32
+	"ut crc32 - Test CRC32 functions and report their throughput\n"
+#endif
+#ifdef CONFIG_UT_DFU
+	"ut dfu - Test DFU writes to an emulated medium and report throughput\n"
+#endif
 #ifdef CONFIG_UT_DM
 	"ut dm [test-name]\n"
 #endif
 #ifdef CONFIG_UT_ENV
 	"ut env [test-name]\n"
 #endif
+#ifdef CONFIG_UT_INITCALL
+	"ut initcall - Test initcall tasks and report how much they overlap\n"
+#endif
+#ifdef CONFIG_UT_SPARSE
+	"ut sparse - Test writing sparse images and count the device commands\n"
+#endif
+#ifdef CONFIG_UT_STRING
+	"ut string [bench] - Test memory functions, optionally benchmark them\n"
+#endif
+#ifdef CONFIG_UT_TASK
+	"ut task - Test task switching, timeouts and cancellation\n"
+#endif
 #ifdef CONFIG_UT_TIME
 	"ut time - Very basic test of time functions\n"
 #endif
@@ -7,11 +7,15 @@
 #define DEBUG
 
 #include <common.h>
+#include <errno.h>
 #include <bootm.h>
 #include <command.h>
+#include <decomp.h>
+#include <div64.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -117,6 +121,23 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/* zstd -19 /tmp/plain.txt -o /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -282,6 +303,38 @@ static int uncompress_using_lz4(void *in, unsigned long in_size,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	assert(in_size == strlen(plain));
+	assert(memcmp(plain, in, in_size) == 0);
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	int ret;
+	size_t output_size = out_max;
+
+	ret = zstd_decompress(in, in_size, out, &output_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return (ret != 0);
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -371,6 +424,350 @@ out:
 	return ret;
 }
 
+#define BENCH_SIZE	(4 << 20)
+
+/* Text which compresses, but not too well */
+static void bench_fill_text(u8 *buf, ulong size)
+{
+	char line[80];
+	ulong pos;
+	int len;
+
+	for (pos = 0; pos < size; pos += len) {
+		len = snprintf(line, sizeof(line), "%08lx: %lu %s\n", pos,
+			       pos * 2654435761UL % 1000003,
+			       plain + pos % 64 * 4);
+		len = min_t(ulong, len, size - pos);
+		memcpy(buf + pos, line, len);
+	}
+}
+
+/*
+ * Something like a kernel image: mostly machine code, built from a small
+ * set of instruction patterns with varying register and offset fields, then
+ * read-only strings and some zero padding. It compresses about as well as a
+ * real kernel (to around a third) so inflate sees a similar mix of literals
+ * and short matches.
+ */
+static void bench_fill_kernel(u8 *buf, ulong size)
+{
+	static const u32 ops[] = {
+		0xe5900000, 0xe5800000, 0xe1a00000, 0xe2800000, 0xe3500000,
+		0x1a000000, 0x0a000000, 0xeb000000, 0xe8bd8000, 0xe92d4000,
+	};
+	ulong code = size * 6 / 10, text = size * 25 / 100;
+	u32 seed = 1, insn;
+	ulong pos;
+
+	for (pos = 0; pos + 4 <= code; pos += 4) {
+		seed = seed * 1103515245 + 12345;
+		insn = ops[(seed >> 16) % ARRAY_SIZE(ops)];
+		/* Registers and small offsets repeat a lot */
+		insn |= (seed >> 8) & 0x3300ff;
+		if ((seed >> 28) == 0)
+			insn |= (seed >> 4) & 0xfff00;
+		put_unaligned_le32(insn, buf + pos);
+	}
+	bench_fill_text(buf + pos, text);
+	memset(buf + pos + text, '\0', size - pos - text);
+}
+
+#define BENCH_ITER	4
+
+/* Times gunzip() on one image, and raw inflate without the trailer check */
+static int bench_gunzip(const char *name, u8 *orig, u8 *comp_buf, u8 *out)
+{
+	ulong size, start, us, raw_us;
+	unsigned long comp_size;
+	int i, ret;
+
+	comp_size = BENCH_SIZE;
+	ret = gzip(comp_buf, &comp_size, orig, BENCH_SIZE);
+	if (ret)
+		return ret;
+
+	start = timer_get_us();
+	for (i = 0; i < BENCH_ITER; i++) {
+		size = comp_size;
+		ret = gunzip(out, BENCH_SIZE, comp_buf, &size);
+		if (ret || size != BENCH_SIZE ||
+		    memcmp(orig, out, BENCH_SIZE)) {
+			printf("%s: %s gunzip failed\n", __func__, name);
+			return -EINVAL;
+		}
+	}
+	us = timer_get_us() - start;
+
+	/* gzip() writes a plain 10-byte header */
+	start = timer_get_us();
+	for (i = 0; i < BENCH_ITER; i++) {
+		size = comp_size;
+		ret = zunzip(out, BENCH_SIZE, comp_buf, &size, 1, 10);
+		if (ret || size != BENCH_SIZE)
+			return -EINVAL;
+	}
+	raw_us = timer_get_us() - start;
+
+	/* gunzip() checks the CRC in the trailer */
+	comp_buf[comp_size - 8] ^= 1;
+	size = comp_size;
+	if (!gunzip(out, BENCH_SIZE, comp_buf, &size)) {
+		printf("%s: %s bad CRC not detected\n", __func__, name);
+		return -EINVAL;
+	}
+
+	printf("%8s: %lu%% of original, %lu MB/s (%lu MB/s without CRC)\n",
+	       name, comp_size * 100 / BENCH_SIZE,
+	       us ? BENCH_SIZE * BENCH_ITER / us : 0,
+	       raw_us ? BENCH_SIZE * BENCH_ITER / raw_us : 0);
+
+	return 0;
+}
+
+static int run_gunzip_bench(void)
+{
+	u8 *orig, *comp_buf, *out;
+	int ret = -ENOMEM;
+
+	printf(" gunzip throughput, %d MB images\n", BENCH_SIZE >> 20);
+	orig = malloc(BENCH_SIZE);
+	comp_buf = malloc(BENCH_SIZE);
+	out = malloc(BENCH_SIZE);
+	if (!orig || !comp_buf || !out)
+		goto out;
+
+	bench_fill_kernel(orig, BENCH_SIZE);
+	ret = bench_gunzip("kernel", orig, comp_buf, out);
+	if (ret)
+		goto out;
+	bench_fill_text(orig, BENCH_SIZE);
+	ret = bench_gunzip("text", orig, comp_buf, out);
+	if (ret)
+		goto out;
+	memset(orig, '\0', BENCH_SIZE);
+	ret = bench_gunzip("zeroes", orig, comp_buf, out);
+out:
+	printf(" gunzip benchmark: %s\n", ret == 0 ? "ok" : "FAILED");
+	free(out);
+	free(comp_buf);
+	free(orig);
+
+	return ret ? 1 : 0;
+}
+
+#ifdef CONFIG_DECOMP_STREAM
+/* Output buffer for a stream, which fails if it would overflow */
+struct stream_out {
+	u8 *buf;
+	size_t size;
+	size_t len;
+};
+
+static int stream_to_buf(void *priv, const void *buf, size_t len)
+{
+	struct stream_out *so = priv;
+
+	if (so->len + len > so->size)
+		return -ENOSPC;
+	memcpy(so->buf + so->len, buf, len);
+	so->len += len;
+
+	return 0;
+}
+
+/* Feeds @len bytes in pieces of @piece bytes, then flushes */
+static int stream_feed(struct decomp_stream *ds, const void *in, size_t len,
+		       size_t piece)
+{
+	size_t pos, n;
+	int ret;
+
+	for (pos = 0; pos < len; pos += n) {
+		n = min(piece, len - pos);
+		ret = decomp_feed(ds, in + pos, n);
+		if (ret)
+			return ret;
+	}
+
+	return decomp_flush(ds);
+}
+
+/* Room for the output and a maximum-sized block after it */
+#define STREAM_UNLIMITED_SIZE	(256 << 10)
+
+static int run_stream_test(char *name, int comp, mutate_func compress)
+{
+	static const size_t pieces[] = { 1, 3, 64, TEST_BUFFER_SIZE };
+	ulong orig_size, compressed_size;
+	struct decomp_stream *ds = NULL;
+	void *compressed_buf = NULL;
+	struct stream_out so;
+	void *big = NULL;
+	size_t out_size;
+	int i, ret;
+
+	printf(" testing %s stream ...\n", name);
+	orig_size = strlen(plain);
+	compressed_size = TEST_BUFFER_SIZE;
+	compressed_buf = malloc(compressed_size);
+	so.size = TEST_BUFFER_SIZE;
+	so.buf = malloc(so.size);
+	errcheck(compressed_buf != NULL && so.buf != NULL);
+	errcheck(compress((void *)plain, orig_size, compressed_buf,
+			  compressed_size, &compressed_size) == 0);
+	errcheck(decomp_detect(compressed_buf, compressed_size) == comp);
+
+	/* Any split of the input gives the same output */
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		so.len = 0;
+		errcheck(decomp_init(&ds, comp, stream_to_buf, &so) == 0);
+		errcheck(stream_feed(ds, compressed_buf, compressed_size,
+				     pieces[i]) == 0);
+		errcheck(so.len == orig_size && ds->total_out == orig_size);
+		errcheck(memcmp(plain, so.buf, orig_size) == 0);
+		decomp_free(ds);
+		ds = NULL;
+	}
+
+	/* Trailing data is ignored, a cut-off stream is an error */
+	so.len = 0;
+	errcheck(decomp_init(&ds, comp, stream_to_buf, &so) == 0);
+	errcheck(decomp_feed(ds, compressed_buf, compressed_size) == 0);
+	errcheck(decomp_feed(ds, plain, 16) == 0);
+	errcheck(decomp_flush(ds) == 0 && so.len == orig_size);
+	decomp_free(ds);
+	so.len = 0;
+	errcheck(decomp_init(&ds, comp, stream_to_buf, &so) == 0);
+	errcheck(stream_feed(ds, compressed_buf, compressed_size - 1, 64) ==
+		 -ENODATA);
+	decomp_free(ds);
+	ds = NULL;
+
+	/* Into a buffer of exactly the right size, then one too small */
+	memset(so.buf, 'A', TEST_BUFFER_SIZE);
+	out_size = orig_size;
+	errcheck(decomp_buf(comp, compressed_buf, compressed_size, so.buf,
+			    &out_size) == 0);
+	errcheck(out_size == orig_size);
+	errcheck(memcmp(plain, so.buf, orig_size) == 0);
+	errcheck(so.buf[orig_size] == 'A');
+	memset(so.buf, 'A', TEST_BUFFER_SIZE);
+	out_size = orig_size - 1;
+	errcheck(decomp_buf(comp, compressed_buf, compressed_size, so.buf,
+			    &out_size) == -ENOSPC);
+	errcheck(so.buf[orig_size - 1] == 'A');
+
+	/*
+	 * With no size limit, as 'unzip' does when not given one. zstd uses
+	 * the space after the output as scratch, so give it a block's worth.
+	 */
+	big = malloc(STREAM_UNLIMITED_SIZE);
+	errcheck(big != NULL);
+	out_size = ~0UL;
+	errcheck(decomp_buf(comp, compressed_buf, compressed_size, big,
+			    &out_size) == 0);
+	errcheck(out_size == orig_size);
+	errcheck(memcmp(plain, big, orig_size) == 0);
+
+	ret = 0;
+out:
+	printf(" %s stream: %s\n", name, ret == 0 ? "ok" : "FAILED");
+	decomp_free(ds);
+	free(big);
+	free(so.buf);
+	free(compressed_buf);
+
+	return ret;
+}
+
+static int stream_discard(void *priv, const void *buf, size_t len)
+{
+	return 0;
+}
+
+#define BENCH_PIECE	4096
+
+/* Reports decompression throughput in MB/s and the memory used */
+static int bench_stream(char *name, int comp, const void *in, size_t in_len,
+			size_t out_len, int iter)
+{
+	struct decomp_stream *ds;
+	ulong start, us;
+	size_t peak = 0;
+	int i, ret;
+
+	start = timer_get_us();
+	for (i = 0; i < iter; i++) {
+		ret = decomp_init(&ds, comp, stream_discard, NULL);
+		if (ret)
+			return ret;
+		ret = stream_feed(ds, in, in_len, BENCH_PIECE);
+		peak = ds->peak_mem;
+		decomp_free(ds);
+		if (ret)
+			return ret;
+	}
+	us = timer_get_us() - start;
+	printf("%8s: %8lu MB/s, peak memory %6zu KB for %zu bytes out\n",
+	       name, us ? (ulong)lldiv((u64)out_len * iter, us) : 0,
+	       peak >> 10, out_len);
+
+	return 0;
+}
+
+static int run_stream_bench(void)
+{
+	ulong orig_size = strlen(plain), size, start, us;
+	u8 *orig, *comp_buf, *out;
+	unsigned long comp_size;
+	int ret = -ENOMEM;
+
+	printf(" stream throughput and memory\n");
+	orig = malloc(BENCH_SIZE);
+	comp_buf = malloc(BENCH_SIZE);
+	out = malloc(BENCH_SIZE);
+	if (!orig || !comp_buf || !out)
+		goto out;
+
+	bench_fill_text(orig, BENCH_SIZE);
+	comp_size = BENCH_SIZE;
+	ret = gzip(comp_buf, &comp_size, orig, BENCH_SIZE);
+	if (ret)
+		goto out;
+
+	/* For comparison: gunzip() needs all of the input and output */
+	start = timer_get_us();
+	size = comp_size;
+	ret = gunzip(out, BENCH_SIZE, comp_buf, &size);
+	us = timer_get_us() - start;
+	if (ret || size != BENCH_SIZE)
+		goto out;
+	printf("%8s: %8lu MB/s, %lu KB in and out buffers\n", "gunzip",
+	       us ? BENCH_SIZE / us : 0, (comp_size + BENCH_SIZE) >> 10);
+	ret = bench_stream("gzip", IH_COMP_GZIP, comp_buf, comp_size,
+			   BENCH_SIZE, 1);
+	if (ret)
+		goto out;
+
+	/* Only small samples of the others are available */
+	ret = bench_stream("bzip2", IH_COMP_BZIP2, bzip2_compressed,
+			   bzip2_compressed_size, orig_size, 20);
+	ret |= bench_stream("lzma", IH_COMP_LZMA, lzma_compressed,
+			    lzma_compressed_size, orig_size, 20);
+	ret |= bench_stream("lz4", IH_COMP_LZ4, lz4_compressed,
+			    lz4_compressed_size, orig_size, 20);
+	ret |= bench_stream("zstd", IH_COMP_ZSTD, zstd_compressed,
+			    zstd_compressed_size, orig_size, 20);
+out:
+	printf(" stream benchmark: %s\n", ret == 0 ? "ok" : "FAILED");
+	free(out);
+	free(comp_buf);
+	free(orig);
+
+	return ret ? 1 : 0;
+}
+#endif
+
 static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 			     char *const argv[])
 {
@@ -381,6 +778,16 @@ static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 	err += run_test("lzma", compress_using_lzma, uncompress_using_lzma);
 	err += run_test("lzo", compress_using_lzo, uncompress_using_lzo);
 	err += run_test("lz4", compress_using_lz4, uncompress_using_lz4);
+	err += run_test("zstd", compress_using_zstd, uncompress_using_zstd);
+	err += run_gunzip_bench();
+#ifdef CONFIG_DECOMP_STREAM
+	err += run_stream_test("gzip", IH_COMP_GZIP, compress_using_gzip);
+	err += run_stream_test("bzip2", IH_COMP_BZIP2, compress_using_bzip2);
+	err += run_stream_test("lzma", IH_COMP_LZMA, compress_using_lzma);
+	err += run_stream_test("lz4", IH_COMP_LZ4, compress_using_lz4);
+	err += run_stream_test("zstd", IH_COMP_ZSTD, compress_using_zstd);
+	err += run_stream_bench();
+#endif
 
 	printf("ut_compression %s\n", err == 0 ? "ok" : "FAILED");
 
@@ -458,6 +865,7 @@ static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 	err |= run_bootm_test(IH_COMP_LZMA, compress_using_lzma);
 	err |= run_bootm_test(IH_COMP_LZO, compress_using_lzo);
 	err |= run_bootm_test(IH_COMP_LZ4, compress_using_lz4);
+	err |= run_bootm_test(IH_COMP_ZSTD, compress_using_zstd);
 	err |= run_bootm_test(IH_COMP_NONE, compress_using_none);
 
 	printf("ut_image_decomp %s\n", err == 0 ? "ok" : "FAILED");
@@ -467,7 +875,7 @@ static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 
 U_BOOT_CMD(
 	ut_compression,	5,	1,	do_ut_compression,
-	"Basic test of compressors: gzip bzip2 lzma lzo", ""
+	"Basic test of compressors: gzip bzip2 lzma lzo lz4 zstd, and streams", ""
 );
 
 U_BOOT_CMD(
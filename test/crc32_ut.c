@@ -0,0 +1,167 @@
+/*
+ * Tests for the CRC32 functions in lib/crc32.c
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <errno.h>
+#include <malloc.h>
+#include <test/suites.h>
+#include <u-boot/crc.h>
+
+#define TEST_BUF_SIZE	1024
+#define BENCH_BUF_SIZE	(1 << 20)
+/* Amount of data checksummed for each benchmark size */
+#define BENCH_BYTES	(64 << 20)
+
+/* Reference CRC32 computed one bit at a time */
+static uint32_t crc32_bitwise(uint32_t crc, const unsigned char *buf,
+			      uint len)
+{
+	int k;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		for (k = 0; k < 8; k++)
+			crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+	}
+
+	return ~crc;
+}
+
+static void fill_pattern(unsigned char *buf, int size)
+{
+	uint32_t x = 0x12345678;
+	int i;
+
+	/* xorshift, so that the data is not periodic */
+	for (i = 0; i < size; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		buf[i] = x;
+	}
+}
+
+static int test_crc32_vector(void)
+{
+	const unsigned char *check = (const unsigned char *)"123456789";
+	uint32_t crc;
+
+	crc = crc32(0, check, 9);
+	if (crc != 0xcbf43926) {
+		printf("%s: crc32(\"123456789\") = %08x, expected cbf43926\n",
+		       __func__, crc);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_crc32_align(const unsigned char *buf)
+{
+	uint32_t crc, expect;
+	int off, len;
+
+	/* every alignment, and lengths around the 8-byte loop boundaries */
+	for (off = 0; off < 8; off++) {
+		for (len = 0; len < 80; len++) {
+			expect = crc32_bitwise(off, buf + off, len);
+			crc = crc32(off, buf + off, len);
+			if (crc != expect) {
+				printf("%s: off=%d, len=%d: got %08x, expected %08x\n",
+				       __func__, off, len, crc, expect);
+				return -EINVAL;
+			}
+		}
+	}
+
+	expect = crc32_bitwise(0, buf, TEST_BUF_SIZE);
+	crc = crc32(0, buf, TEST_BUF_SIZE);
+	if (crc != expect) {
+		printf("%s: len=%d: got %08x, expected %08x\n", __func__,
+		       TEST_BUF_SIZE, crc, expect);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_crc32_combine(const unsigned char *buf)
+{
+	uint32_t crc, expect;
+	int split;
+
+	expect = crc32(0, buf, TEST_BUF_SIZE);
+	for (split = 0; split <= TEST_BUF_SIZE; split += 37) {
+		crc = crc32_combine(crc32(0, buf, split),
+				    crc32(0, buf + split,
+					  TEST_BUF_SIZE - split),
+				    TEST_BUF_SIZE - split);
+		if (crc != expect) {
+			printf("%s: split=%d: got %08x, expected %08x\n",
+			       __func__, split, crc, expect);
+			return -EINVAL;
+		}
+	}
+
+	/* crc32_no_comp() values combine too if the second starts at 0 */
+	expect = crc32_no_comp(0x5a5a5a5a, buf, TEST_BUF_SIZE);
+	split = TEST_BUF_SIZE / 3;
+	crc = crc32_combine(crc32_no_comp(0x5a5a5a5a, buf, split),
+			    crc32_no_comp(0, buf + split,
+					  TEST_BUF_SIZE - split),
+			    TEST_BUF_SIZE - split);
+	if (crc != expect) {
+		printf("%s: no_comp: got %08x, expected %08x\n", __func__,
+		       crc, expect);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void bench_crc32(const unsigned char *buf)
+{
+	ulong size, iter, i, start, us;
+	uint32_t crc = 0;
+
+	printf("%s: throughput in MB/s\n", __func__);
+	for (size = 64; size <= BENCH_BUF_SIZE; size <<= 4) {
+		iter = BENCH_BYTES / size;
+		start = timer_get_us();
+		for (i = 0; i < iter; i++)
+			crc = crc32(crc, buf, size);
+		us = timer_get_us() - start;
+		printf("%9lu bytes: %lu MB/s\n", size,
+		       us ? (ulong)lldiv((u64)iter * size, us) : 0);
+	}
+}
+
+int do_ut_crc32(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	unsigned char *buf;
+	int ret = 0;
+
+	buf = malloc(BENCH_BUF_SIZE);
+	if (!buf) {
+		printf("%s: out of memory\n", __func__);
+		return CMD_RET_FAILURE;
+	}
+	fill_pattern(buf, BENCH_BUF_SIZE);
+
+	ret |= test_crc32_vector();
+	ret |= test_crc32_align(buf);
+	ret |= test_crc32_combine(buf);
+	if (!ret)
+		bench_crc32(buf);
+	free(buf);
+
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
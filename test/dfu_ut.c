@@ -0,0 +1,142 @@
+/*
+ * Tests for DFU writes, using a RAM entity with an emulated slow medium
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <dfu.h>
+#include <errno.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <u-boot/crc.h>
+#include <test/suites.h>
+
+#define TEST_ADDR	0x1000000
+#define TEST_SIZE	(2 << 20)
+#define TEST_BUFSIZ	"0x10000"
+#define USB_PACKET	4096
+
+/* Emulated time for the host to send a packet, and to write 1KB */
+#define USB_PACKET_US	100
+#define MEDIUM_KB_US	25
+
+static int (*ram_write_medium)(struct dfu_entity *dfu, u64 offset, void *buf,
+			       long *len);
+
+/* Packets sent so far, writes to the medium and those which packets overlap */
+static uint packets, writes, overlapped;
+
+/*
+ * Busy for as long as a 40MB/s medium would be. Whether packets arrive
+ * meanwhile does not depend on how fast the host is: udelay() yields at
+ * least once, so a background write always lets the next packet in.
+ */
+static int slow_write_medium(struct dfu_entity *dfu, u64 offset, void *buf,
+			     long *len)
+{
+	uint first = packets;
+
+	udelay(*len / 1024 * MEDIUM_KB_US);
+	writes++;
+	if (packets != first)
+		overlapped++;
+
+	return ram_write_medium(dfu, offset, buf, len);
+}
+
+static int test_dfu_write(void)
+{
+	char alt_info[] = "img ram 1000000 200000";
+	ulong start, elapsed, serial;
+	struct dfu_entity *dfu;
+	u8 *src;
+	int i, ret;
+
+	src = malloc(TEST_SIZE);
+	if (!src)
+		return -ENOMEM;
+	for (i = 0; i < TEST_SIZE; i++)
+		src[i] = i * 7 + (i >> 12);
+	memset(map_sysmem(TEST_ADDR, TEST_SIZE), '\0', TEST_SIZE);
+
+	setenv("dfu_bufsiz", TEST_BUFSIZ);
+	setenv("dfu_hash_algo", "crc32");
+	ret = dfu_config_entities(alt_info, "ram", "0");
+	if (ret)
+		goto out;
+	dfu = dfu_get_entity(0);
+	ram_write_medium = dfu->write_medium;
+	dfu->write_medium = slow_write_medium;
+	writes = 0;
+	overlapped = 0;
+
+	start = timer_get_us();
+	for (i = 0; i < TEST_SIZE / USB_PACKET; i++) {
+		udelay(USB_PACKET_US);
+		packets++;
+		ret = dfu_write(dfu, src + i * USB_PACKET, USB_PACKET, i);
+		if (ret) {
+			printf("%s: write of packet %d failed %d\n", __func__,
+			       i, ret);
+			goto out;
+		}
+	}
+	if (dfu->crc != crc32(0, src, TEST_SIZE)) {
+		printf("%s: crc32 %08x is wrong\n", __func__, dfu->crc);
+		ret = -EINVAL;
+		goto out;
+	}
+	ret = dfu_flush(dfu, NULL, 0, i);
+	elapsed = timer_get_us() - start;
+	if (ret) {
+		printf("%s: flush failed %d\n", __func__, ret);
+		goto out;
+	}
+	if (memcmp(map_sysmem(TEST_ADDR, TEST_SIZE), src, TEST_SIZE)) {
+		printf("%s: image is wrong\n", __func__);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* The times depend on the host, so are only reported */
+	serial = TEST_SIZE / USB_PACKET * USB_PACKET_US +
+		 TEST_SIZE / 1024 * MEDIUM_KB_US;
+	printf("%s: %lu KB/s (%lu ms), serial %lu KB/s (%lu ms)\n", __func__,
+	       TEST_SIZE / 1024 * 1000 / (elapsed / 1000 ? : 1),
+	       elapsed / 1000, TEST_SIZE / 1024 * 1000 / (serial / 1000),
+	       serial / 1000);
+	printf("%s: %u of %u writes overlapped the transfer\n", __func__,
+	       overlapped, writes);
+#ifdef CONFIG_DFU_WRITE_ASYNC
+	/* Only the write made by dfu_flush() has no packets to overlap */
+	if (overlapped + 1 < writes) {
+		printf("%s: writes did not overlap the transfer\n", __func__);
+		ret = -EINVAL;
+	}
+#else
+	if (overlapped) {
+		printf("%s: writes overlapped the transfer\n", __func__);
+		ret = -EINVAL;
+	}
+#endif
+out:
+	dfu_free_entities();
+	setenv("dfu_hash_algo", NULL);
+	setenv("dfu_bufsiz", NULL);
+	free(src);
+
+	return ret;
+}
+
+int do_ut_dfu(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret;
+
+	ret = test_dfu_write();
+
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
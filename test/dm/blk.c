@@ -94,3 +94,98 @@ static int dm_test_blk_usb(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_usb, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_BLOCK_CACHE
+static char *blkcache_test_data;
+static int blkcache_test_reads;
+
+static unsigned long blkcache_test_read(struct blk_desc *desc, lbaint_t start,
+					lbaint_t blkcnt, void *buffer)
+{
+	blkcache_test_reads++;
+	if (start + blkcnt > desc->lba)
+		return 0;
+	memcpy(buffer, blkcache_test_data + start * desc->blksz,
+	       blkcnt * desc->blksz);
+
+	return blkcnt;
+}
+
+/* Test that the block cache returns correct data with few device reads */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats;
+	struct blk_desc desc = {
+		.if_type = IF_TYPE_HOST,
+		.devnum = 7,
+		.blksz = 512,
+		.lba = 252,
+	};
+	char buf[20 * 512];
+	int i;
+
+	blkcache_test_data = malloc(desc.lba * desc.blksz);
+	ut_assertnonnull(blkcache_test_data);
+	for (i = 0; i < desc.lba * desc.blksz; i++)
+		blkcache_test_data[i] = i / desc.blksz + i;
+
+	blkcache_configure(8, 32);
+	blkcache_configure_budget(16 * 1024, 16);
+	blkcache_stats(&stats);
+
+	/* A one-block miss fills the whole surrounding entry */
+	blkcache_test_reads = 0;
+	ut_asserteq(1, blkcache_read(&desc, 3, 1, buf, blkcache_test_read));
+	ut_assertok(memcmp(buf, blkcache_test_data + 3 * 512, 512));
+	ut_asserteq(2, blkcache_read(&desc, 5, 2, buf, blkcache_test_read));
+	ut_assertok(memcmp(buf, blkcache_test_data + 5 * 512, 2 * 512));
+	ut_asserteq(1, blkcache_test_reads);
+
+	/* Reads spanning a cached and an uncached entry are partial hits */
+	ut_asserteq(6, blkcache_read(&desc, 6, 6, buf, blkcache_test_read));
+	ut_assertok(memcmp(buf, blkcache_test_data + 6 * 512, 6 * 512));
+	ut_asserteq(2, blkcache_test_reads);
+
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(1, stats.partial_hits);
+	ut_asserteq(2, stats.dev_reads);
+
+	/* Sequential single-block reads trigger read-ahead */
+	blkcache_test_reads = 0;
+	for (i = 64; i < 128; i++) {
+		ut_asserteq(1, blkcache_read(&desc, i, 1, buf,
+					     blkcache_test_read));
+		ut_assertok(memcmp(buf, blkcache_test_data + i * 512, 512));
+	}
+	ut_assert(blkcache_test_reads <= 4);
+	blkcache_stats(&stats);
+	ut_assert(stats.readaheads > 0);
+	ut_assert(stats.bytes <= 16 * 1024);
+
+	/* The short last entry of the device can be cached */
+	ut_asserteq(1, blkcache_read(&desc, 251, 1, buf, blkcache_test_read));
+	ut_assertok(memcmp(buf, blkcache_test_data + 251 * 512, 512));
+
+	/* Large reads bypass the cache */
+	blkcache_test_reads = 0;
+	ut_asserteq(20, blkcache_read(&desc, 200, 20, buf,
+				      blkcache_test_read));
+	ut_assertok(memcmp(buf, blkcache_test_data + 200 * 512, 20 * 512));
+	ut_asserteq(1, blkcache_test_reads);
+
+	blkcache_invalidate(desc.if_type, desc.devnum);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(0, stats.bytes);
+
+	blkcache_configure_budget(CONFIG_BLOCK_CACHE_SIZE,
+				  CONFIG_BLOCK_CACHE_READAHEAD);
+	blkcache_configure(8, 256);
+	free(blkcache_test_data);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, 0);
+#endif
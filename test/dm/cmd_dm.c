@@ -41,10 +41,23 @@ static int do_dm_dump_devres(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+static int do_dm_dump_probe_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+				  char * const argv[])
+{
+	dm_dump_probe_stats();
+
+	return 0;
+}
+#endif
+
 static cmd_tbl_t test_commands[] = {
 	U_BOOT_CMD_MKENT(tree, 0, 1, do_dm_dump_all, "", ""),
 	U_BOOT_CMD_MKENT(uclass, 1, 1, do_dm_dump_uclass, "", ""),
 	U_BOOT_CMD_MKENT(devres, 1, 1, do_dm_dump_devres, "", ""),
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	U_BOOT_CMD_MKENT(probe-stats, 1, 1, do_dm_dump_probe_stats, "", ""),
+#endif
 };
 
 static __maybe_unused void dm_reloc(void)
@@ -86,4 +99,7 @@ U_BOOT_CMD(
 	"tree         Dump driver model tree ('*' = activated)\n"
 	"dm uclass        Dump list of instances for each uclass\n"
 	"dm devres        Dump list of device resources for each device"
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	"\ndm probe-stats   Dump probed devices in order, with probe times"
+#endif
 );
@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <asm/state.h>
 #include <dm/device-internal.h>
 #include <dm/root.h>
 #include <dm/util.h>
@@ -796,3 +797,187 @@ static int dm_test_device_get_uclass_id(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_device_get_uclass_id, DM_TESTF_SCAN_PDATA);
+
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/* Check that a device is found by each of its keys, returning a count */
+static int dm_check_index_lookups(struct unit_test_state *uts,
+				  struct udevice *dev)
+{
+	enum uclass_id id = device_get_uclass_id(dev);
+	struct udevice *found, *first;
+	int count = 0;
+
+	if (dev->seq != -1) {
+		ut_assertok(uclass_find_device_by_seq(id, dev->seq, false,
+						      &found));
+		ut_asserteq_ptr(dev, found);
+		count++;
+	}
+	if (dev->req_seq != -1) {
+		ut_assertok(uclass_find_device_by_seq(id, dev->req_seq, true,
+						      &found));
+		ut_asserteq(dev->req_seq, found->req_seq);
+		count++;
+	}
+	if (dev->of_offset >= 0) {
+		/* Several devices can share a node: we want the first */
+		ut_assertok(uclass_find_device_by_of_offset(id, dev->of_offset,
+							    &found));
+		uclass_foreach_dev(first, dev->uclass) {
+			if (first->of_offset == dev->of_offset)
+				break;
+		}
+		ut_asserteq_ptr(first, found);
+		count++;
+	}
+
+	return count;
+}
+
+/* Uclasses whose devices are probed by the lookup tests */
+static const enum uclass_id dm_index_probe_ids[] = {
+	UCLASS_TEST_FDT, UCLASS_TEST_BUS, UCLASS_GPIO, UCLASS_I2C,
+};
+
+/*
+ * Probe the devices of a few uclasses (and so their parents), then look up
+ * every device by all of its keys. Probing everything would bring up
+ * emulated USB storage, the console and the like, which the other tests
+ * are careful to avoid.
+ */
+static int dm_index_probe_and_find(struct unit_test_state *uts, int *countp)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	int count = 0;
+	int id, i;
+
+	for (i = 0; i < ARRAY_SIZE(dm_index_probe_ids); i++) {
+		uc = uclass_find(dm_index_probe_ids[i]);
+		if (!uc)
+			continue;
+		uclass_foreach_dev(dev, uc)
+			device_probe(dev);
+	}
+	for (id = 0; id < UCLASS_COUNT; id++) {
+		uc = uclass_find(id);
+		if (!uc)
+			continue;
+		uclass_foreach_dev(dev, uc)
+			count += dm_check_index_lookups(uts, dev);
+	}
+	*countp = count;
+
+	return 0;
+}
+
+/* Test that the lookup tables give the same results as walking the lists */
+static int dm_test_uclass_index(struct unit_test_state *uts)
+{
+	struct dm_index *idx = gd->dm_index;
+	struct udevice *dev;
+	int count, seq, node;
+
+	ut_assertnonnull(idx);
+	ut_assertok(dm_index_probe_and_find(uts, &count));
+	ut_assert(count > 0);
+	ut_asserteq_ptr(dm_root()->uclass, uclass_find(UCLASS_ROOT));
+
+	idx->disabled = true;
+	ut_assertok(dm_index_probe_and_find(uts, &count));
+	idx->disabled = false;
+
+	/* Removed and unbound devices must drop out of the tables */
+	ut_assertok(uclass_get_device(UCLASS_TEST_FDT, 0, &dev));
+	seq = dev->seq;
+	node = dev->of_offset;
+	ut_assertok(device_remove(dev));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST_FDT, seq,
+						       false, &dev));
+	ut_assertok(uclass_find_device_by_of_offset(UCLASS_TEST_FDT, node,
+						    &dev));
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(-ENODEV, uclass_find_device_by_of_offset(UCLASS_TEST_FDT,
+							     node, &dev));
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_index, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/*
+ * Compare the cost of probing devices and looking up every device with and
+ * without the lookup tables. Run sandbox with -v to see the numbers, e.g.
+ * 'u-boot -v -d test.dtb -c "ut dm uclass_index_bench"'.
+ */
+static int dm_test_uclass_index_bench(struct unit_test_state *uts)
+{
+	struct dm_index *idx = gd->dm_index;
+	struct dm_lookup_stats stats[2];
+	ulong us[2], start;
+	int mode, count;
+
+	/* Some devices bind others when probed, so start with everything */
+	ut_assertok(dm_index_probe_and_find(uts, &count));
+	for (mode = 0; mode < 2; mode++) {
+		ut_assertok(device_remove(dm_root()));
+		idx->disabled = !mode;
+		memset(&idx->stats, '\0', sizeof(idx->stats));
+		start = timer_get_us();
+		ut_assertok(dm_index_probe_and_find(uts, &count));
+		us[mode] = timer_get_us() - start;
+		stats[mode] = idx->stats;
+		if (!state_get_current()->show_test_output)
+			continue;
+		printf("%-7s: %d lookups, uclass_find() %lu calls/%lu steps, devices %lu lookups/%lu steps, %lu us\n",
+		       mode ? "indexed" : "linear", count,
+		       stats[mode].uclass_finds, stats[mode].uclass_steps,
+		       stats[mode].dev_finds, stats[mode].dev_steps, us[mode]);
+	}
+	idx->disabled = false;
+
+	/*
+	 * Removing a device can unbind its children, so the two passes may
+	 * not see quite the same devices. Compare the steps per lookup.
+	 */
+	ut_asserteq(stats[1].uclass_finds, stats[1].uclass_steps);
+	ut_assert(stats[0].uclass_steps > stats[0].uclass_finds);
+	ut_assert(stats[1].dev_steps * stats[0].dev_finds <
+		  stats[0].dev_steps * stats[1].dev_finds);
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_index_bench, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
+#if CONFIG_IS_ENABLED(DM_LAZY_PROBE)
+/* Test that probing a device first probes the clocks and regulators it uses */
+static int dm_test_lazy_probe_deps(struct unit_test_state *uts)
+{
+	struct udevice *ram, *clk, *reg;
+
+	ut_assertok(uclass_find_first_device(UCLASS_RAM, &ram));
+	ut_assertnonnull(ram);
+	ut_assertok(uclass_find_first_device(UCLASS_CLK, &clk));
+	ut_assertnonnull(clk);
+	ut_assertok(uclass_find_device_by_name(UCLASS_REGULATOR, "buck2",
+					       &reg));
+	ut_assert(!device_active(ram));
+	ut_assert(!device_active(clk));
+	ut_assert(!device_active(reg));
+
+	ut_assertok(device_probe(ram));
+	ut_assert(device_active(clk));
+	ut_assert(device_active(reg));
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	ut_assert(clk->probe_order && clk->probe_order < ram->probe_order);
+	ut_assert(reg->probe_order && reg->probe_order < ram->probe_order);
+	ut_assert(ram->probe_us >= clk->probe_us);
+
+	ut_assertok(device_remove(ram));
+	ut_asserteq(0, ram->probe_order);
+#endif
+
+	return 0;
+}
+DM_TEST(dm_test_lazy_probe_deps, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
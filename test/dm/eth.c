@@ -16,6 +16,7 @@
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
 #include <asm/eth.h>
+#include <asm/test.h>
 #include <test/ut.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -259,3 +260,101 @@ static int dm_test_net_retry(struct unit_test_state *uts)
 	return retval;
 }
 DM_TEST(dm_test_net_retry, DM_TESTF_SCAN_FDT);
+
+/* Lets the ARP timeout expire each time the device is polled */
+static void eth_stats_poll(struct udevice *dev)
+{
+	sandbox_timer_add_offset(6000);
+}
+
+static const struct sandbox_eth_responder eth_stats_responder = {
+	.poll	= eth_stats_poll,
+};
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_stats(struct unit_test_state *uts)
+{
+	struct net_stats start = net_stats;
+	const struct eth_stats *stats;
+	struct eth_stats before;
+	uchar pkt[64];
+	struct udevice *dev;
+	int i;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	stats = eth_get_stats(dev);
+	ut_assertnonnull(stats);
+	before = *stats;
+
+	/* An ARP request and reply, then a ping and its reply */
+	setenv("ethact", "eth@10002000");
+	ut_assertok(net_loop(PING));
+	ut_asserteq(before.tx_packets + 2, stats->tx_packets);
+	ut_asserteq(before.rx_packets + 2, stats->rx_packets);
+	ut_assert(stats->tx_bytes > before.tx_bytes);
+	ut_assert(stats->rx_bytes > before.rx_bytes);
+	ut_asserteq(before.tx_errors, stats->tx_errors);
+	ut_asserteq(before.rx_errors, stats->rx_errors);
+	ut_asserteq(start.arp.rtt.count + 1, net_stats.arp.rtt.count);
+	ut_asserteq(start.arp.timeouts, net_stats.arp.timeouts);
+	ut_asserteq(2, getenv_ulong("net_rx_packets", 10, 0));
+	ut_asserteq(0, getenv_ulong("net_rx_lost", 10, 1));
+	ut_asserteq(0, getenv_ulong("net_timeouts", 10, 1));
+	ut_asserteq(0, getenv_ulong("net_resends", 10, 1));
+	ut_assertnonnull(getenv("net_rtt_us"));
+
+	/* Polling an empty receive queue, which gives -EAGAIN, is no error */
+	before = *stats;
+	ut_assertok(eth_rx());
+	ut_assertok(eth_rx());
+	ut_asserteq(before.rx_packets, stats->rx_packets);
+	ut_asserteq(before.rx_errors, stats->rx_errors);
+
+	/* Packets which find the receive queue full are counted as lost */
+	start = net_stats;
+	before = *stats;
+	memset(pkt, '\0', sizeof(pkt));
+	((struct ethernet_hdr *)pkt)->et_protlen = htons(0x88b5);
+	for (i = 0; i < PKTBUFSRX; i++)
+		ut_assertok(sandbox_eth_recv_packet(dev, pkt, sizeof(pkt)));
+	ut_asserteq(-ENOSPC, sandbox_eth_recv_packet(dev, pkt, sizeof(pkt)));
+	ut_asserteq(-ENOSPC, sandbox_eth_recv_packet(dev, pkt, sizeof(pkt)));
+	ut_assertok(eth_rx());
+	ut_asserteq(before.rx_packets + PKTBUFSRX, stats->rx_packets);
+	ut_asserteq(before.rx_dropped + 2, stats->rx_dropped);
+	ut_asserteq(start.rx_dropped + 2, net_stats.rx_dropped);
+
+	/* With no replies the ARP request is sent until it is given up */
+	start = net_stats;
+	before = *stats;
+	sandbox_eth_disable_response(0, true);
+	sandbox_eth_set_responder(0, &eth_stats_responder);
+	ut_assert(net_loop(PING) < 0);
+	ut_asserteq(before.rx_packets, stats->rx_packets);
+	ut_asserteq(before.tx_packets + 4, stats->tx_packets);
+	ut_asserteq(start.arp.timeouts + 4, net_stats.arp.timeouts);
+	ut_asserteq(start.arp.resends + 3, net_stats.arp.resends);
+	ut_asserteq(start.arp.rtt.count, net_stats.arp.rtt.count);
+	ut_asserteq(0, getenv_ulong("net_rx_packets", 10, 1));
+	ut_asserteq(4, getenv_ulong("net_timeouts", 10, 0));
+	ut_asserteq(3, getenv_ulong("net_resends", 10, 0));
+	ut_assert(!getenv("net_rtt_us"));
+
+	return 0;
+}
+
+static int dm_test_eth_stats(struct unit_test_state *uts)
+{
+	int retval;
+
+	net_ping_ip = string_to_ip("1.1.2.2");
+
+	retval = _dm_test_eth_stats(uts);
+
+	sandbox_eth_set_responder(0, NULL);
+	sandbox_eth_disable_response(0, false);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_stats, DM_TESTF_SCAN_FDT);
@@ -7,6 +7,7 @@
 #include <common.h>
 #include <dm.h>
 #include <mmc.h>
+#include <asm/test.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -44,3 +45,125 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that a card marked for preinit is brought up by the init task */
+static int dm_test_mmc_preinit(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char cmp[1024];
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertnonnull(mmc);
+	ut_assert(mmc->has_init);
+
+	/* Start again with a fresh card, as 'mmc rescan' does */
+	mmc->has_init = 0;
+	mmc_set_preinit(mmc, 1);
+	mmc_do_preinit();
+	ut_assert(mmc->init_in_progress);
+	ut_assert(!mmc->has_init);
+
+	/* The init task polls with this until the card is ready */
+	ut_assertok(mmc_poll_preinit());
+	ut_assert(!mmc->init_in_progress);
+	ut_assert(mmc->has_init);
+
+	/* The same for one card on its own */
+	mmc->has_init = 0;
+	ut_assertok(mmc_start_init(mmc));
+	ut_assert(mmc->init_in_progress);
+	ut_assertok(mmc_poll_init(mmc));
+	ut_assert(!mmc->init_in_progress);
+	ut_assert(mmc->has_init);
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	memset(cmp, '\0', sizeof(cmp));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
+	ut_assertok(strcmp(cmp, "this is a test"));
+	mmc_set_preinit(mmc, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_preinit, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test queued reads and that SET_BLOCK_COUNT saves the stop commands */
+static int dm_test_mmc_queue(struct unit_test_state *uts)
+{
+	struct sandbox_mmc_stats stats;
+	struct blk_req req[4];
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	ulong stop_us, cmd23_us;
+	char *buf;
+	int i, polls;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = find_mmc_device(dev_desc->devnum);
+	ut_assertnonnull(mmc);
+	ut_assert(mmc->card_caps & MMC_MODE_CMD23);
+	buf = malloc(ARRAY_SIZE(req) * 64 * 512);
+	ut_assertnonnull(buf);
+
+	/* Without SET_BLOCK_COUNT each multi-block read needs a stop */
+	sandbox_mmc_set_latency(dev, 20, 2);
+	mmc->card_caps &= ~MMC_MODE_CMD23;
+	sandbox_mmc_get_stats(dev, &stats);
+	for (i = 0; i < 16; i++) {
+		req[0].start = i * 16;
+		req[0].blkcnt = 16;
+		req[0].buffer = buf;
+		ut_assertok(blk_submit(dev_desc, &req[0]));
+		ut_assertok(blk_wait(dev_desc, &req[0]));
+	}
+	sandbox_mmc_get_stats(dev, &stats);
+	ut_asserteq(16, stats.stops);
+	ut_asserteq(16 * 16, stats.blocks);
+	stop_us = stats.busy_us;
+
+	mmc->card_caps |= MMC_MODE_CMD23;
+	for (i = 0; i < 16; i++) {
+		ut_assertok(blk_submit(dev_desc, &req[0]));
+		ut_assertok(blk_wait(dev_desc, &req[0]));
+	}
+	sandbox_mmc_get_stats(dev, &stats);
+	ut_asserteq(0, stats.stops);
+	ut_asserteq(16 * 16, stats.blocks);
+	cmd23_us = stats.busy_us;
+	/* A 20us SET_BLOCK_COUNT replaces each 40us busy-response stop */
+	ut_asserteq(stop_us - 16 * 20, cmd23_us);
+
+	/* Queue several requests and let them complete in the background */
+	for (i = 0; i < ARRAY_SIZE(req); i++) {
+		req[i].start = i * 64;
+		req[i].blkcnt = 64;
+		req[i].buffer = buf + i * 64 * 512;
+		memset(req[i].buffer, '\0', 64 * 512);
+		ut_assertok(blk_submit(dev_desc, &req[i]));
+	}
+	for (polls = 0; blk_poll(dev_desc) > 0; polls++)
+		;
+	ut_assert(polls > 0);
+	for (i = 0; i < ARRAY_SIZE(req); i++) {
+		ut_assertok(blk_wait(dev_desc, &req[i]));
+		ut_asserteq(64, req[i].actual);
+		ut_assertok(strcmp(req[i].buffer, "this is a test"));
+	}
+	sandbox_mmc_get_stats(dev, &stats);
+	ut_asserteq(ARRAY_SIZE(req) * 64, stats.blocks);
+
+	/* Requests past the end of the device are rejected */
+	req[0].start = dev_desc->lba;
+	req[0].blkcnt = 1;
+	ut_asserteq(-EINVAL, blk_submit(dev_desc, &req[0]));
+
+	sandbox_mmc_set_latency(dev, 0, 0);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_queue, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -0,0 +1,102 @@
+/*
+ * Helpers for tests which play a network server on a sandbox eth device
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/eth.h>
+#include <test/net-server.h>
+#include <test/ut.h>
+
+void net_test_learn_peer(struct net_test_peer *peer, const void *packet)
+{
+	const struct ethernet_hdr *eth = packet;
+	const struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+
+	memcpy(peer->client_mac, eth->et_src, ARP_HLEN);
+	memcpy(peer->server_mac, eth->et_dest, ARP_HLEN);
+	peer->client_ip = net_read_ip((void *)&ip->ip_src);
+	/* The source port comes first in both UDP and TCP headers */
+	peer->client_port = ntohs(ip->udp_src);
+}
+
+void net_test_eth_hdr(const struct net_test_peer *peer, void *frame)
+{
+	struct ethernet_hdr *eth = frame;
+
+	memcpy(eth->et_dest, peer->client_mac, ARP_HLEN);
+	memcpy(eth->et_src, peer->server_mac, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+}
+
+u16 net_test_tcp_checksum(struct ip_tcp_hdr *ip, uint len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} pseudo;
+
+	net_copy_ip(&pseudo.src, &ip->ip_src);
+	net_copy_ip(&pseudo.dst, &ip->ip_dst);
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(len);
+
+	return add_ip_checksums(sizeof(pseudo),
+				compute_ip_checksum(&pseudo, sizeof(pseudo)),
+				compute_ip_checksum(&ip->tcp_src, len));
+}
+
+u8 net_test_file_byte(ulong offset)
+{
+	return offset * 13 + (offset >> 10);
+}
+
+int net_test_download(struct unit_test_state *uts, enum proto_t proto,
+		      const char *name, ulong size)
+{
+	u8 *buf = map_sysmem(NET_TEST_LOAD_ADDR, size + 1);
+	ulong i;
+
+	memset(buf, '\0', size + 1);
+	load_addr = NET_TEST_LOAD_ADDR;
+	copy_filename(net_boot_file_name, name, sizeof(net_boot_file_name));
+	ut_asserteq(size, net_loop(proto));
+
+	for (i = 0; i < size; i++) {
+		if (buf[i] != net_test_file_byte(i)) {
+			printf("byte %lx is %02x, expected %02x\n", i, buf[i],
+			       net_test_file_byte(i));
+			ut_assert(false);
+		}
+	}
+	ut_asserteq(0, buf[size]);
+
+	return 0;
+}
+
+int net_test_run(struct unit_test_state *uts,
+		 const struct sandbox_eth_responder *resp,
+		 int (*test)(struct unit_test_state *uts))
+{
+	int retval;
+
+	setenv("ethact", "eth@10002000");
+	net_server_ip = string_to_ip(NET_TEST_SERVER_IP);
+	sandbox_eth_set_responder(0, resp);
+
+	retval = test(uts);
+
+	/* Restore the env */
+	sandbox_eth_set_responder(0, NULL);
+	net_server_ip.s_addr = 0;
+	setenv("ethact", NULL);
+
+	return retval;
+}
@@ -0,0 +1,653 @@
+/*
+ * Tests for NFS downloads, against a server emulated on a sandbox eth device
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <net.h>
+#include <dm/test.h>
+#include <asm/eth.h>
+#include <asm/test.h>
+#include <asm/unaligned.h>
+#include <test/net-server.h>
+#include <test/ut.h>
+
+#define EXPORT_PATH	"/export"
+#define FILE_NAME	"vmlinux"
+#define MTU		1500
+
+#define PORTMAP_PORT	111
+#define MOUNT_PORT	635
+#define NFS_PORT	2049
+
+#define PROG_PORTMAP	100000
+#define PROG_NFS	100003
+#define PROG_MOUNT	100005
+#define PROC_GETPORT	3
+#define PROC_MNT	1
+#define PROC_UMNTALL	4
+#define PROC_LOOKUP2	4
+#define PROC_LOOKUP3	3
+#define PROC_READ	6
+#define NFSERR_NOENT	2
+
+#define MAX_PENDING	16
+#define MAX_REPLY	(65536 + 256)
+
+#define SERVER_ISS	0x7ffff000
+#define SERVER_MSS	1460
+/* Most bytes in flight, to fit in the sandbox eth receive queue */
+#define SERVER_CWND	(64 * SERVER_MSS)
+/* Room for a reply to every READ the client may have in flight */
+#define SERVER_TX_SIZE	(MAX_PENDING * (4 + MAX_REPLY))
+
+static const u32 dir_fh[] = { 0x64697230, 0x64697231 };
+static const u32 file_fh[] = { 0x66696c30, 0x66696c31 };
+
+/**
+ * struct fake_server - An NFS server which answers READs in batches
+ *
+ * READ requests are held until the client has nothing left to receive,
+ * then answered last first, so the client sees replies out of order.
+ *
+ * @v3:		true to offer NFSv3 as well as NFSv2
+ * @size:	Size of the file
+ * @rsize:	Most bytes the server reads at a time
+ * @drop:	Number of the READ reply to lose, counting from 1, 0 for none
+ * @xsum:	true to send UDP checksums
+ * @damage:	Number of the READ reply to damage after its checksum is
+ *		worked out, counting from 1, 0 for none
+ * @late:	Number of full-sized duplicate READ replies to send when the
+ *		client unmounts, after it has stopped reading
+ * @tcp:	true to offer NFS over TCP, with @tx_buf to send from
+ * @nfs_vers:	NFS version used by the client
+ * @replies:	Number of READ replies sent
+ * @resends:	Number of READ requests sent again
+ * @max_batch:	Most READs the client had in flight
+ * @max_count:	Largest READ asked for
+ * @max_xid:	Highest READ RPC id seen
+ * @ip_id:	IP id of the last reply
+ * @tcp_calls:	Number of NFS calls received over TCP
+ * @tcp_fin:	true if the client closed the TCP connection
+ * @peer:	Addresses to reply to, from the last request
+ */
+struct fake_server {
+	bool v3;
+	ulong size;
+	uint rsize;
+	int drop;
+	bool xsum;
+	int damage;
+	int late;
+	bool tcp;
+	u8 *tx_buf;
+
+	int nfs_vers;
+	int replies;
+	int resends;
+	int max_batch;
+	uint max_count;
+	u32 max_xid;
+	u16 ip_id;
+	int tcp_calls;
+	bool tcp_fin;
+
+	struct {
+		u32 xid;
+		u64 offset;
+		uint count;
+	} pending[MAX_PENDING];
+	int num_pending;
+
+	struct net_test_peer peer;
+
+	/* TCP connection, with unacknowledged data from tx_seq in tx_buf */
+	bool tcp_conn;
+	struct net_test_peer tcp_peer;
+	u32 rcv_nxt;
+	u32 snd_una;
+	u32 snd_nxt;
+	u32 tx_seq;
+	uint tx_len;
+	u8 rx_buf[2048];
+	uint rx_len;
+};
+
+static struct fake_server srv;
+static u32 dgram[(UDP_HDR_SIZE + MAX_REPLY) / 4];
+static u8 *tx_buf;
+
+/* Works out the UDP checksum of the datagram in dgram */
+static u16 srv_xsum(uint total)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		__be16 len;
+	} pseudo;
+	unsigned sum;
+
+	pseudo.src = string_to_ip(NET_TEST_SERVER_IP);
+	pseudo.dst = srv.peer.client_ip;
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_UDP;
+	pseudo.len = htons(total);
+	sum = add_ip_checksums(0, compute_ip_checksum(&pseudo, sizeof(pseudo)),
+			       compute_ip_checksum(dgram, total));
+
+	return sum ? sum : 0xffff;
+}
+
+static void srv_tcp_send(struct udevice *dev, u8 flags, u32 seq,
+			 const void *data, uint len)
+{
+	uchar frame[PKTSIZE];
+	struct ip_tcp_hdr *ip = (void *)(frame + ETHER_HDR_SIZE);
+
+	memcpy((uchar *)ip + IP_TCP_HDR_SIZE, data, len);
+	net_test_eth_hdr(&srv.tcp_peer, frame);
+	net_set_ip_header((uchar *)ip, srv.tcp_peer.client_ip,
+			  string_to_ip(NET_TEST_SERVER_IP));
+	ip->ip_len = htons(IP_TCP_HDR_SIZE + len);
+	ip->ip_p = IPPROTO_TCP;
+	ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
+	ip->tcp_src = htons(NFS_PORT);
+	ip->tcp_dst = htons(srv.tcp_peer.client_port);
+	put_unaligned_be32(seq, &ip->tcp_seq);
+	put_unaligned_be32(srv.rcv_nxt, &ip->tcp_ack);
+	ip->tcp_hlen = TCP_HDR_SIZE << 2;
+	ip->tcp_flags = flags | TCP_ACK;
+	ip->tcp_win = htons(8192);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = net_test_tcp_checksum(ip, TCP_HDR_SIZE + len);
+
+	sandbox_eth_recv_packet(dev, frame,
+				ETHER_HDR_SIZE + IP_TCP_HDR_SIZE + len);
+}
+
+/* Sends as much of what is waiting as the congestion window allows */
+static void srv_tcp_output(struct udevice *dev)
+{
+	uint sent, len;
+
+	while (srv.snd_nxt - srv.snd_una < SERVER_CWND) {
+		sent = srv.snd_nxt - srv.tx_seq;
+		if (sent == srv.tx_len)
+			break;
+		len = min_t(uint, srv.tx_len - sent, SERVER_MSS);
+		srv_tcp_send(dev, TCP_PSH, srv.snd_nxt, srv.tx_buf + sent, len);
+		srv.snd_nxt += len;
+	}
+}
+
+/* Sends the RPC reply in dgram over TCP, as a single-fragment record */
+static void srv_tcp_reply(struct udevice *dev, uint len)
+{
+	uint acked = srv.snd_una - srv.tx_seq;
+
+	memmove(srv.tx_buf, srv.tx_buf + acked, srv.tx_len - acked);
+	srv.tx_len -= acked;
+	srv.tx_seq = srv.snd_una;
+
+	put_unaligned_be32(0x80000000 | len, srv.tx_buf + srv.tx_len);
+	memcpy(srv.tx_buf + srv.tx_len + 4, dgram + UDP_HDR_SIZE / 4, len);
+	srv.tx_len += 4 + len;
+	srv_tcp_output(dev);
+}
+
+/*
+ * Sends the UDP datagram in dgram, in IP fragments no larger than MTU.
+ * If @damage, a byte in the middle is changed after the checksum is set.
+ * NFS replies go over TCP instead while the client is connected.
+ */
+static void srv_send(struct udevice *dev, u16 sport, uint len, bool damage)
+{
+	uchar frame[PKTSIZE];
+	struct ip_udp_hdr *ip = (void *)(frame + ETHER_HDR_SIZE);
+	u16 *udp = (u16 *)dgram;
+	uint total = UDP_HDR_SIZE + len;
+	uint offset, flen;
+
+	if (sport == NFS_PORT && srv.tcp_conn) {
+		srv_tcp_reply(dev, len);
+		return;
+	}
+
+	udp[0] = htons(sport);
+	udp[1] = htons(srv.peer.client_port);
+	udp[2] = htons(total);
+	udp[3] = 0;
+	if (srv.xsum)
+		udp[3] = srv_xsum(total);
+	if (damage)
+		((u8 *)dgram)[total / 2] ^= 0xff;
+
+	net_test_eth_hdr(&srv.peer, frame);
+	srv.ip_id++;
+	for (offset = 0; offset < total; offset += flen) {
+		flen = min(total - offset, (uint)(MTU - IP_HDR_SIZE) & ~7);
+		ip->ip_hl_v = 0x45;
+		ip->ip_tos = 0;
+		ip->ip_len = htons(IP_HDR_SIZE + flen);
+		ip->ip_id = htons(srv.ip_id);
+		ip->ip_off = htons(offset / 8 |
+				   (offset + flen < total ? IP_FLAGS_MFRAG : 0));
+		ip->ip_ttl = 255;
+		ip->ip_p = IPPROTO_UDP;
+		ip->ip_sum = 0;
+		net_write_ip(&ip->ip_src, string_to_ip(NET_TEST_SERVER_IP));
+		net_write_ip(&ip->ip_dst, srv.peer.client_ip);
+		ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
+		memcpy(frame + ETHER_HDR_SIZE + IP_HDR_SIZE,
+		       (uchar *)dgram + offset, flen);
+		sandbox_eth_recv_packet(dev, frame,
+					ETHER_HDR_SIZE + IP_HDR_SIZE + flen);
+	}
+}
+
+/* Starts a successful RPC reply in dgram, returning where the result goes */
+static u32 *srv_reply(u32 xid)
+{
+	u32 *p = dgram + UDP_HDR_SIZE / 4;
+
+	*p++ = htonl(xid);
+	*p++ = htonl(1);	/* reply */
+	*p++ = 0;		/* accepted */
+	*p++ = 0;		/* AUTH_NONE verifier */
+	*p++ = 0;
+	*p++ = 0;		/* success */
+
+	return p;
+}
+
+static uint srv_len(u32 *end)
+{
+	return (end - dgram) * 4 - UDP_HDR_SIZE;
+}
+
+/* Adds file attributes of the given NFS version */
+static u32 *srv_attr(u32 *p, int vers)
+{
+	int words = vers == 3 ? 21 : 17;
+
+	memset(p, '\0', words * 4);
+	p[0] = htonl(1);	/* regular file */
+	if (vers == 3)
+		p[6] = htonl(srv.size);
+	else
+		p[5] = htonl(srv.size);
+
+	return p + words;
+}
+
+static u32 *srv_fh(u32 *p, const u32 *fh, int vers)
+{
+	if (vers == 3) {
+		*p++ = htonl(sizeof(dir_fh));
+		memcpy(p, fh, sizeof(dir_fh));
+		return p + sizeof(dir_fh) / 4;
+	}
+	memset(p, '\0', 32);
+	memcpy(p, fh, sizeof(dir_fh));
+
+	return p + 8;
+}
+
+/* Checks the file handle in a request, returning the word after it */
+static u32 *srv_check_fh(u32 *p, const u32 *fh, int vers)
+{
+	if (vers == 3) {
+		if (ntohl(*p++) != sizeof(dir_fh))
+			return NULL;
+		return memcmp(p, fh, sizeof(dir_fh)) ? NULL : p + 2;
+	}
+
+	return memcmp(p, fh, sizeof(dir_fh)) ? NULL : p + 8;
+}
+
+static void srv_read_reply(struct udevice *dev, int i)
+{
+	u64 offset = srv.pending[i].offset;
+	uint count = 0;
+	u32 *p;
+	u8 *data;
+	uint j;
+
+	if (offset < srv.size)
+		count = min_t(u64, srv.size - offset,
+			      min(srv.pending[i].count, srv.rsize));
+
+	p = srv_reply(srv.pending[i].xid);
+	*p++ = 0;
+	if (srv.nfs_vers == 3) {
+		*p++ = htonl(1);	/* attributes follow */
+		p = srv_attr(p, 3);
+		*p++ = htonl(count);
+		*p++ = htonl(offset + count >= srv.size);
+	} else {
+		p = srv_attr(p, 2);
+	}
+	*p++ = htonl(count);
+	data = (u8 *)p;
+	for (j = 0; j < count; j++)
+		data[j] = net_test_file_byte(offset + j);
+	/* Padding which the client must not store */
+	for (; j & 3; j++)
+		data[j] = 0xff;
+	p += j / 4;
+
+	if (++srv.replies == srv.drop)
+		return;
+	srv_send(dev, NFS_PORT, srv_len(p), srv.replies == srv.damage);
+}
+
+static void srv_read(u32 xid, u32 *p)
+{
+	int i;
+
+	if (srv.num_pending == MAX_PENDING)
+		return;
+	i = srv.num_pending++;
+	if (xid <= srv.max_xid)
+		srv.resends++;
+	else
+		srv.max_xid = xid;
+	srv.pending[i].xid = xid;
+	if (srv.nfs_vers == 3) {
+		srv.pending[i].offset = (u64)ntohl(p[0]) << 32 | ntohl(p[1]);
+		srv.pending[i].count = ntohl(p[2]);
+	} else {
+		srv.pending[i].offset = ntohl(p[0]);
+		srv.pending[i].count = ntohl(p[1]);
+	}
+	srv.max_count = max(srv.max_count, srv.pending[i].count);
+}
+
+static void srv_call(struct udevice *dev, u16 port, u32 *call, uint len)
+{
+	u32 xid = ntohl(call[0]);
+	int prog = ntohl(call[3]);
+	int vers = ntohl(call[4]);
+	int proc = ntohl(call[5]);
+	u32 *args = call + 6;
+	u32 *p;
+	uint plen;
+
+	/* Skip the credential and verifier */
+	args += 2 + (ntohl(args[1]) + 3) / 4;
+	args += 2 + (ntohl(args[1]) + 3) / 4;
+
+	if (port == PORTMAP_PORT && prog == PROG_PORTMAP &&
+	    proc == PROC_GETPORT) {
+		int port = 0;
+
+		if (ntohl(args[0]) == PROG_MOUNT)
+			port = MOUNT_PORT;
+		else if (ntohl(args[0]) == PROG_NFS &&
+			 (ntohl(args[1]) == 2 || srv.v3) &&
+			 (ntohl(args[2]) == IPPROTO_UDP || srv.tcp))
+			port = NFS_PORT;
+		p = srv_reply(xid);
+		*p++ = htonl(port);
+		srv_send(dev, PORTMAP_PORT, srv_len(p), false);
+	} else if (port == MOUNT_PORT && prog == PROG_MOUNT) {
+		if (proc == PROC_UMNTALL && srv.late) {
+			/* Far larger than any reply the client expects now */
+			srv.pending[0].xid = srv.max_xid;
+			srv.pending[0].offset = 0;
+			srv.pending[0].count = srv.rsize;
+			srv_read_reply(dev, 0);
+			srv.late--;
+		}
+		p = srv_reply(xid);
+		if (proc == PROC_MNT) {
+			plen = ntohl(args[0]);
+			if (plen != strlen(EXPORT_PATH) ||
+			    memcmp(args + 1, EXPORT_PATH, plen)) {
+				*p++ = htonl(NFSERR_NOENT);
+			} else {
+				*p++ = 0;
+				p = srv_fh(p, dir_fh, vers);
+				if (vers == 3) {
+					*p++ = htonl(1);
+					*p++ = htonl(1);	/* AUTH_UNIX */
+				}
+			}
+		}
+		srv_send(dev, MOUNT_PORT, srv_len(p), false);
+	} else if (port == NFS_PORT && prog == PROG_NFS) {
+		srv.nfs_vers = vers;
+		if (proc == PROC_READ) {
+			args = srv_check_fh(args, file_fh, vers);
+			if (args)
+				srv_read(xid, args);
+			return;
+		}
+		if (proc != (vers == 3 ? PROC_LOOKUP3 : PROC_LOOKUP2))
+			return;
+		args = srv_check_fh(args, dir_fh, vers);
+		p = srv_reply(xid);
+		if (!args || ntohl(args[0]) != strlen(FILE_NAME) ||
+		    memcmp(args + 1, FILE_NAME, strlen(FILE_NAME))) {
+			*p++ = htonl(NFSERR_NOENT);
+			if (vers == 3)
+				*p++ = 0;
+		} else {
+			*p++ = 0;
+			p = srv_fh(p, file_fh, vers);
+			if (vers == 3) {
+				*p++ = 0;	/* no attributes */
+				*p++ = 0;
+			} else {
+				p = srv_attr(p, 2);
+			}
+		}
+		srv_send(dev, NFS_PORT, srv_len(p), false);
+	}
+}
+
+/* Answers each complete record, which the client sends as one fragment */
+static void srv_tcp_calls(struct udevice *dev)
+{
+	u32 call[256];
+	uint len;
+
+	while (srv.rx_len >= 4) {
+		len = get_unaligned_be32(srv.rx_buf) & ~0x80000000;
+		if (srv.rx_len < 4 + len)
+			break;
+		memcpy(call, srv.rx_buf + 4, min_t(uint, len, sizeof(call)));
+		srv.tcp_calls++;
+		srv_call(dev, NFS_PORT, call, len);
+		srv.rx_len -= 4 + len;
+		memmove(srv.rx_buf, srv.rx_buf + 4 + len, srv.rx_len);
+	}
+}
+
+static void srv_tcp_recv(struct udevice *dev, void *packet)
+{
+	struct ip_tcp_hdr *ip = packet + ETHER_HDR_SIZE;
+	uint hlen = (ip->tcp_hlen >> 4) * 4;
+	uint len = ntohs(ip->ip_len) - IP_HDR_SIZE - hlen;
+	u32 seq = get_unaligned_be32(&ip->tcp_seq);
+	u32 ack = get_unaligned_be32(&ip->tcp_ack);
+
+	if (!srv.tcp || ntohs(ip->tcp_dst) != NFS_PORT ||
+	    net_test_tcp_checksum(ip, ntohs(ip->ip_len) - IP_HDR_SIZE))
+		return;
+	net_test_learn_peer(&srv.tcp_peer, packet);
+
+	if (ip->tcp_flags & TCP_SYN) {
+		srv.tcp_conn = true;
+		srv.rcv_nxt = seq + 1;
+		srv.snd_una = SERVER_ISS + 1;
+		srv.snd_nxt = SERVER_ISS + 1;
+		srv.tx_seq = SERVER_ISS + 1;
+		srv.tx_len = 0;
+		srv.rx_len = 0;
+		srv_tcp_send(dev, TCP_SYN, SERVER_ISS, NULL, 0);
+		return;
+	}
+	if (ip->tcp_flags & (TCP_FIN | TCP_RST)) {
+		srv.tcp_fin = true;
+		srv.tcp_conn = false;
+		return;
+	}
+
+	if ((s32)(ack - srv.snd_una) > 0 && (s32)(ack - srv.snd_nxt) <= 0)
+		srv.snd_una = ack;
+	if (len && seq == srv.rcv_nxt &&
+	    srv.rx_len + len <= sizeof(srv.rx_buf)) {
+		memcpy(srv.rx_buf + srv.rx_len,
+		       (uchar *)ip + IP_HDR_SIZE + hlen, len);
+		srv.rx_len += len;
+		srv.rcv_nxt += len;
+		srv_tcp_calls(dev);
+		srv_tcp_send(dev, 0, srv.snd_nxt, NULL, 0);
+	}
+	srv_tcp_output(dev);
+}
+
+static void srv_recv(struct udevice *dev, void *packet, int length)
+{
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	u32 call[256];
+	uint len;
+
+	if (ip->ip_p == IPPROTO_TCP) {
+		srv_tcp_recv(dev, packet);
+		return;
+	}
+	if (ip->ip_p != IPPROTO_UDP)
+		return;
+	net_test_learn_peer(&srv.peer, packet);
+
+	len = min_t(uint, ntohs(ip->udp_len) - UDP_HDR_SIZE, sizeof(call));
+	memcpy(call, ip + 1, len);
+	srv_call(dev, ntohs(ip->udp_dst), call, len);
+}
+
+static void srv_poll(struct udevice *dev)
+{
+	int i;
+
+	/* Let the client's delayed ACK go, so that more can be sent */
+	if (!srv.num_pending && srv.snd_nxt != srv.tx_seq + srv.tx_len) {
+		sandbox_timer_add_offset(50);
+		return;
+	}
+	/* With nothing in flight the client is waiting for a lost reply */
+	if (!srv.num_pending) {
+		sandbox_timer_add_offset(1000);
+		return;
+	}
+
+	srv.max_batch = max(srv.max_batch, srv.num_pending);
+	for (i = srv.num_pending - 1; i >= 0; i--)
+		srv_read_reply(dev, i);
+	srv.num_pending = 0;
+}
+
+static const struct sandbox_eth_responder srv_responder = {
+	.send	= srv_recv,
+	.poll	= srv_poll,
+};
+
+static int nfs_download(struct unit_test_state *uts)
+{
+	return net_test_download(uts, NFS, EXPORT_PATH "/" FILE_NAME,
+				 srv.size);
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_nfs(struct unit_test_state *uts)
+{
+	/*
+	 * NFSv3 with large reads in flight together, one reply lost and one
+	 * damaged. The data in each reply goes straight to the load address
+	 * as its fragments arrive. A duplicate READ reply which turns up
+	 * while unmounting must be dropped, not copied.
+	 */
+	memset(&srv, '\0', sizeof(srv));
+	memset(&net_stats, '\0', sizeof(net_stats));
+	srv.v3 = true;
+	srv.size = (1 << 20) + 1234;
+	srv.rsize = 32768;
+	srv.drop = 5;
+	srv.xsum = true;
+	srv.damage = 9;
+	srv.late = 1;
+	ut_assertok(nfs_download(uts));
+	ut_asserteq(0, srv.late);
+	ut_asserteq(3, srv.nfs_vers);
+	ut_asserteq(32768, srv.max_count);
+	ut_assert(srv.max_batch > 1);
+	ut_assert(srv.resends > 0);
+	/* All but the short, unfragmented last reply */
+	ut_asserteq(srv.size / 32768, net_stats.rx_placed);
+	ut_asserteq(srv.size & ~32767, net_stats.rx_placed_bytes);
+	ut_asserteq(1, net_stats.rx_bad);
+	ut_asserteq(0, net_stats.rx_dropped);
+
+	/* A server which reads less at a time than asked, with padding */
+	memset(&srv, '\0', sizeof(srv));
+	srv.v3 = true;
+	srv.size = 200000;
+	srv.rsize = 4999;
+	ut_assertok(nfs_download(uts));
+	ut_assert(srv.max_batch > 1);
+
+	/* Falling back to NFSv2, whose small reads are not fragmented */
+	memset(&srv, '\0', sizeof(srv));
+	memset(&net_stats, '\0', sizeof(net_stats));
+	srv.size = 20000;
+	srv.rsize = 8192;
+	ut_assertok(nfs_download(uts));
+	ut_asserteq(2, srv.nfs_vers);
+	ut_asserteq(1024, srv.max_count);
+	ut_assert(srv.max_batch > 1);
+	ut_asserteq(0, net_stats.rx_placed);
+
+#ifdef CONFIG_NFS_TCP
+	/*
+	 * NFSv3 over TCP, where 64KB reads arrive in segments rather than
+	 * fragments. The connection is closed before unmounting over UDP.
+	 */
+	memset(&srv, '\0', sizeof(srv));
+	memset(&net_stats, '\0', sizeof(net_stats));
+	srv.v3 = true;
+	srv.tcp = true;
+	srv.tx_buf = tx_buf;
+	srv.size = (1 << 20) + 4321;
+	srv.rsize = 65536;
+	ut_assertok(nfs_download(uts));
+	ut_asserteq(3, srv.nfs_vers);
+	ut_asserteq(65536, srv.max_count);
+	ut_assert(srv.max_batch > 1);
+	/* The LOOKUP and every READ */
+	ut_assert(srv.tcp_calls > DIV_ROUND_UP(srv.size, 65536));
+	ut_assert(srv.tcp_fin);
+	ut_asserteq(0, net_stats.rx_placed);
+#endif
+
+	return 0;
+}
+
+static int dm_test_eth_nfs(struct unit_test_state *uts)
+{
+	int retval;
+
+	tx_buf = malloc(SERVER_TX_SIZE);
+	ut_assertnonnull(tx_buf);
+	retval = net_test_run(uts, &srv_responder, _dm_test_eth_nfs);
+	free(tx_buf);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_nfs, DM_TESTF_SCAN_FDT);
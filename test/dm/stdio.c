@@ -0,0 +1,82 @@
+/*
+ * Tests for probing console devices on demand
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <iomux.h>
+#include <keyboard.h>
+#include <stdio_dev.h>
+#include <dm/lists.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <dm/uclass-internal.h>
+#include <test/ut.h>
+
+/* A keyboard which registers with stdio under its device name */
+struct test_keyb_priv {
+	struct stdio_dev *sdev;
+};
+
+static int test_keyb_probe(struct udevice *dev)
+{
+	struct keyboard_priv *uc_priv = dev_get_uclass_priv(dev);
+	struct test_keyb_priv *priv = dev_get_priv(dev);
+
+	return stdio_register_dev(&uc_priv->sdev, &priv->sdev);
+}
+
+static int test_keyb_remove(struct udevice *dev)
+{
+	struct test_keyb_priv *priv = dev_get_priv(dev);
+
+	return stdio_deregister_dev(priv->sdev, 0);
+}
+
+static const struct keyboard_ops test_keyb_ops = {
+};
+
+U_BOOT_DRIVER(test_keyb) = {
+	.name	= "test_keyb",
+	.id	= UCLASS_KEYBOARD,
+	.probe	= test_keyb_probe,
+	.remove	= test_keyb_remove,
+	.ops	= &test_keyb_ops,
+	.priv_auto_alloc_size = sizeof(struct test_keyb_priv),
+};
+
+/* Test that consoles probe keyboards and displays only when named */
+static int dm_test_stdio_lazy_probe(struct unit_test_state *uts)
+{
+	struct udevice *kbd, *vid;
+	struct stdio_dev *sdev;
+
+	ut_assertok(device_bind_driver(dm_root(), "test_keyb", "test-keyb",
+				       &kbd));
+	ut_assertok(uclass_find_first_device(UCLASS_VIDEO, &vid));
+	ut_assertnonnull(vid);
+	ut_assert(!device_active(kbd));
+	ut_assert(!device_active(vid));
+
+	/* A device which is registered already needs nothing probed */
+	ut_assertnonnull(search_device(DEV_FLAGS_INPUT, "serial"));
+	ut_assertnonnull(search_device(DEV_FLAGS_OUTPUT, "serial"));
+	ut_assert(!device_active(kbd));
+	ut_assert(!device_active(vid));
+
+	/* A keyboard is probed when stdin is set to it */
+	sdev = search_device(DEV_FLAGS_INPUT, "test-keyb");
+	ut_assertnonnull(sdev);
+	ut_asserteq_ptr(kbd, sdev->priv);
+	ut_assert(device_active(kbd));
+	ut_assert(!device_active(vid));
+
+	/* The display is probed when stdout is set to vidconsole */
+	ut_assertnonnull(search_device(DEV_FLAGS_OUTPUT, "vidconsole"));
+	ut_assert(device_active(vid));
+
+	return 0;
+}
+DM_TEST(dm_test_stdio_lazy_probe, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
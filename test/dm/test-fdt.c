@@ -10,6 +10,8 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <asm/io.h>
+#include <dm/bind-table.h>
+#include <dm/lists.h>
 #include <dm/test.h>
 #include <dm/root.h>
 #include <dm/uclass-internal.h>
@@ -266,3 +268,49 @@ static int dm_test_fdt_offset(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_fdt_offset, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+/* Test that the binding table is only used with its own device tree */
+static int dm_test_fdt_bind_table(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	const struct dm_bind_table *table;
+	const struct dm_bind_node *node;
+	int size = fdt_totalsize(blob);
+	int offset, depth, idx;
+	char *copy;
+
+	table = lists_bind_table(blob);
+	if (table) {
+		/* Nodes must be in device tree order, with the same flags */
+		depth = 0;
+		for (offset = 0, idx = 0; offset >= 0 && depth >= 0;
+		     offset = fdt_next_node(blob, offset, &depth), idx++) {
+			ut_assert(idx < table->node_count);
+			node = &table->node[idx];
+			ut_asserteq(offset, node->offset);
+			ut_asserteq(fdtdec_get_is_enabled(blob, offset),
+				    !!(node->flags & DM_BIND_ENABLED));
+		}
+		ut_asserteq(table->node_count, idx);
+	}
+
+	/* A copy of the device tree can use the same table */
+	copy = malloc(size * 2);
+	ut_assertnonnull(copy);
+	memcpy(copy, blob, size);
+	ut_asserteq_ptr(table, lists_bind_table(copy));
+
+	/* ...but a changed one cannot */
+	memcpy(copy + size, blob, size);
+	copy[size + fdt_off_dt_strings(blob)] ^= 1;
+	ut_asserteq_ptr(NULL, lists_bind_table(copy + size));
+	free(copy);
+
+	/* Put back the state for the real device tree */
+	ut_asserteq_ptr(table, lists_bind_table(blob));
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_bind_table, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
@@ -58,6 +58,92 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/*
+ * Read from the flash stick with the host reporting @max_xfer_size, returning
+ * the number of commands used and the modelled time taken
+ */
+static int usb_flash_read_with(struct unit_test_state *uts, struct udevice *bus,
+			       size_t max_xfer_size, char *buf, int blocks,
+			       struct sandbox_flash_stats *stats)
+{
+	struct blk_desc *dev_desc;
+	struct udevice *emul;
+
+	sandbox_usb_set_max_xfer_size(bus, max_xfer_size);
+	ut_assertok(usb_init());
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	/* Drop what the partition scan cached so that it is all read */
+	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	ut_assertok(uclass_get_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					      &emul));
+
+	/* Each command needs three bulk transfers; reading a block is quick */
+	sandbox_flash_set_latency(emul, 375, 8);
+	sandbox_flash_get_stats(emul, stats);
+	memset(buf, '\0', blocks * 512);
+	ut_asserteq(blocks, blk_dread(dev_desc, 0, blocks, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+	sandbox_flash_get_stats(emul, stats);
+	ut_asserteq(blocks, stats->blocks);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_usb_flash_xfer(struct unit_test_state *uts,
+				   struct udevice *bus, char *buf, int blocks)
+{
+	struct sandbox_flash_stats small, xhci, any;
+
+	/* The old limit of 20 blocks for each command */
+	ut_assertok(usb_flash_read_with(uts, bus, 20 * 512, buf, blocks,
+					&small));
+	ut_asserteq(DIV_ROUND_UP(blocks, 20), small.cmds);
+
+	/* What an xHCI transfer ring holds */
+	ut_assertok(usb_flash_read_with(uts, bus, 62 * 65536, buf, blocks,
+					&xhci));
+	ut_asserteq(DIV_ROUND_UP(blocks, 62 * 128), xhci.cmds);
+
+	/* No limit from the host, so just the 16-bit SCSI block count */
+	ut_assertok(usb_flash_read_with(uts, bus, 0, buf, blocks, &any));
+	ut_asserteq(1, any.cmds);
+
+	ut_assert(xhci.busy_us < small.busy_us);
+	if (state_get_current()->show_test_output) {
+		printf("%dKB read: %llu KB/s with 20 blocks per command, ",
+		       blocks / 2, blocks * 500000ULL / small.busy_us);
+		printf("%llu KB/s with 62 TRBs\n",
+		       blocks * 500000ULL / xhci.busy_us);
+	}
+
+	return 0;
+}
+
+/* Test that reads use transfers as large as the host controller allows */
+static int dm_test_usb_flash_xfer(struct unit_test_state *uts)
+{
+	const int blocks = 8192;
+	struct udevice *bus;
+	char *buf;
+	int retval;
+
+	state_set_skip_delays(true);
+	ut_assertok(uclass_find_device_by_name(UCLASS_USB, "usb@1", &bus));
+	buf = malloc(blocks * 512);
+	ut_assertnonnull(buf);
+
+	retval = _dm_test_usb_flash_xfer(uts, bus, buf, blocks);
+
+	usb_stop();
+	sandbox_usb_set_max_xfer_size(bus, 0);
+	free(buf);
+
+	return retval;
+}
+DM_TEST(dm_test_usb_flash_xfer, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* test that we can handle multiple storage devices */
 static int dm_test_usb_multi(struct unit_test_state *uts)
 {
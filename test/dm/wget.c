@@ -0,0 +1,347 @@
+/*
+ * Tests for HTTP downloads, against a server emulated on a sandbox eth device
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <net.h>
+#include <dm/test.h>
+#include <asm/eth.h>
+#include <asm/test.h>
+#include <asm/unaligned.h>
+#include <test/net-server.h>
+#include <test/ut.h>
+
+#define FILE_PATH	"/images/vmlinux"
+#define HTTP_PORT	80
+
+/* Close to wrapping, so that sequence numbers wrap during the download */
+#define SERVER_ISS	0xfff80000
+#define SERVER_WSCALE	7
+
+/* Polls with data unacknowledged before the server sends it again */
+#define SERVER_RTO_POLLS	10
+/* Most segments in flight, to fit in the sandbox eth receive queue */
+#define SERVER_CWND		64
+#define MAX_REQUEST	512
+
+/**
+ * struct fake_server - An HTTP server on a minimal TCP stack
+ *
+ * The whole response is built before the request arrives. The server
+ * sends as much as the client's window allows, and on three duplicate
+ * ACKs or a timeout sends everything unacknowledged again.
+ *
+ * @size:	Size of the file
+ * @chunk:	Size of chunks for chunked transfer coding, 0 to send a
+ *		Content-Length, -1 to end the body by closing the connection
+ * @mss:	Largest segment the server sends
+ * @drop:	Number of the data segment to lose, counting from 1, 0 for none
+ * @wscale:	Window scale the client offered, -1 if none
+ * @segments:	Number of data segments sent
+ * @acks:	Number of ACKs without data received
+ * @resends:	Number of times the server went back to resend data
+ * @max_flight:	Most bytes sent but not acknowledged
+ * @client_fin:	true if the client sent a FIN
+ * @client_rst:	true if the client sent a RST
+ * @peer:	Addresses to reply to, from the last segment
+ */
+struct fake_server {
+	ulong size;
+	int chunk;
+	uint mss;
+	int drop;
+
+	int wscale;
+	int segments;
+	int acks;
+	int resends;
+	ulong max_flight;
+	bool client_fin;
+	bool client_rst;
+
+	char request[MAX_REQUEST + 1];
+	uint request_len;
+	char *resp;
+	uint resp_len;
+
+	u32 snd_una;
+	u32 snd_nxt;
+	u32 rcv_nxt;
+	ulong client_wnd;
+	int client_wscale;
+	uint client_mss;
+	int dupacks;
+	int idle;
+
+	struct net_test_peer peer;
+};
+
+static struct fake_server srv;
+
+static void srv_send(struct udevice *dev, u8 flags, u32 seq, const void *data,
+		     uint len)
+{
+	uchar frame[PKTSIZE];
+	struct ip_tcp_hdr *ip = (void *)(frame + ETHER_HDR_SIZE);
+	uchar *opt = (uchar *)(ip + 1);
+	uint hlen = TCP_HDR_SIZE;
+
+	if (flags & TCP_SYN) {
+		opt[0] = 2;		/* MSS */
+		opt[1] = 4;
+		put_unaligned_be16(srv.mss, opt + 2);
+		hlen += 4;
+		if (srv.wscale >= 0) {
+			opt[4] = 1;	/* NOP */
+			opt[5] = 3;	/* window scale */
+			opt[6] = 3;
+			opt[7] = SERVER_WSCALE;
+			hlen += 4;
+		}
+	}
+	memcpy((uchar *)ip + IP_HDR_SIZE + hlen, data, len);
+
+	net_test_eth_hdr(&srv.peer, frame);
+	net_set_ip_header((uchar *)ip, srv.peer.client_ip,
+			  string_to_ip(NET_TEST_SERVER_IP));
+	ip->ip_len = htons(IP_HDR_SIZE + hlen + len);
+	ip->ip_p = IPPROTO_TCP;
+	ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
+	ip->tcp_src = htons(HTTP_PORT);
+	ip->tcp_dst = htons(srv.peer.client_port);
+	put_unaligned_be32(seq, &ip->tcp_seq);
+	put_unaligned_be32(srv.rcv_nxt, &ip->tcp_ack);
+	ip->tcp_hlen = hlen << 2;
+	ip->tcp_flags = flags | TCP_ACK;
+	ip->tcp_win = htons(8192);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = net_test_tcp_checksum(ip, hlen + len);
+
+	sandbox_eth_recv_packet(dev, frame,
+				ETHER_HDR_SIZE + IP_HDR_SIZE + hlen + len);
+}
+
+/* Sends whatever the client's window allows, then a FIN if needed */
+static void srv_output(struct udevice *dev)
+{
+	u32 start = SERVER_ISS + 1;
+	u32 end = start + srv.resp_len;
+	uint len;
+
+	if (!srv.resp)
+		return;
+	while ((s32)(srv.snd_nxt - end) < 0) {
+		len = min(end - srv.snd_nxt, min(srv.mss, srv.client_mss));
+		if (srv.snd_nxt + len - srv.snd_una >
+		    min_t(ulong, srv.client_wnd, SERVER_CWND * len))
+			break;
+		if (++srv.segments != srv.drop)
+			srv_send(dev, TCP_PSH, srv.snd_nxt,
+				 srv.resp + (srv.snd_nxt - start), len);
+		srv.snd_nxt += len;
+		srv.max_flight = max(srv.max_flight,
+				     (ulong)(srv.snd_nxt - srv.snd_una));
+	}
+	if (srv.chunk == -1 && srv.snd_nxt == end) {
+		srv_send(dev, TCP_FIN, srv.snd_nxt, NULL, 0);
+		srv.snd_nxt++;
+	}
+}
+
+/* Builds the response once the request is complete */
+static void srv_respond(void)
+{
+	char *p;
+	ulong i, j, n;
+
+	srv.resp = malloc(srv.size + srv.size / 8 + 256);
+	p = srv.resp;
+	if (strncmp(srv.request, "GET " FILE_PATH " HTTP/1.1\r\n",
+		    strlen("GET " FILE_PATH " HTTP/1.1\r\n")) ||
+	    !strstr(srv.request, "\r\nHost: " NET_TEST_SERVER_IP "\r\n")) {
+		p += sprintf(p, "HTTP/1.1 404 Not Found\r\n"
+			     "Content-Length: 0\r\n\r\n");
+		srv.resp_len = p - srv.resp;
+		return;
+	}
+
+	p += sprintf(p, "HTTP/1.1 200 OK\r\nServer: fake\r\n");
+	if (srv.chunk > 0)
+		p += sprintf(p, "Transfer-Encoding: chunked\r\n");
+	else if (!srv.chunk)
+		p += sprintf(p, "content-length: %lu\r\n", srv.size);
+	p += sprintf(p, "\r\n");
+	for (i = 0; i < srv.size; i += n) {
+		n = srv.size - i;
+		if (srv.chunk > 0) {
+			n = min_t(ulong, n, srv.chunk);
+			p += sprintf(p, "%lx;ext=1\r\n", n);
+		}
+		for (j = 0; j < n; j++)
+			*p++ = net_test_file_byte(i + j);
+		if (srv.chunk > 0)
+			p += sprintf(p, "\r\n");
+	}
+	if (srv.chunk > 0)
+		p += sprintf(p, "0\r\nX-Trailer: 1\r\n\r\n");
+	srv.resp_len = p - srv.resp;
+}
+
+static void srv_parse_syn(struct ip_tcp_hdr *ip)
+{
+	uchar *opt = (uchar *)(ip + 1);
+	int len = (ip->tcp_hlen >> 4) * 4 - TCP_HDR_SIZE;
+
+	srv.client_mss = 536;
+	srv.wscale = -1;
+	while (len > 0 && opt[0]) {
+		if (opt[0] == 1) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (opt[0] == 2)
+			srv.client_mss = get_unaligned_be16(opt + 2);
+		else if (opt[0] == 3)
+			srv.wscale = opt[2];
+		len -= opt[1];
+		opt += opt[1];
+	}
+	srv.client_wscale = srv.wscale >= 0 ? srv.wscale : 0;
+}
+
+static void srv_recv(struct udevice *dev, void *packet, int length)
+{
+	struct ip_tcp_hdr *ip = packet + ETHER_HDR_SIZE;
+	uint hlen = (ip->tcp_hlen >> 4) * 4;
+	uint len = ntohs(ip->ip_len) - IP_HDR_SIZE - hlen;
+	uchar *data = (uchar *)ip + IP_HDR_SIZE + hlen;
+	u32 seq = get_unaligned_be32(&ip->tcp_seq);
+	u32 ack = get_unaligned_be32(&ip->tcp_ack);
+
+	if (ip->ip_p != IPPROTO_TCP || ntohs(ip->tcp_dst) != HTTP_PORT ||
+	    net_test_tcp_checksum(ip, ntohs(ip->ip_len) - IP_HDR_SIZE))
+		return;
+	net_test_learn_peer(&srv.peer, packet);
+
+	if (ip->tcp_flags & TCP_RST) {
+		srv.client_rst = true;
+		return;
+	}
+	if (ip->tcp_flags & TCP_SYN) {
+		srv_parse_syn(ip);
+		srv.rcv_nxt = seq + 1;
+		srv.snd_una = SERVER_ISS;
+		srv.snd_nxt = SERVER_ISS + 1;
+		srv_send(dev, TCP_SYN, SERVER_ISS, NULL, 0);
+		return;
+	}
+
+	srv.client_wnd = (ulong)ntohs(ip->tcp_win) << srv.client_wscale;
+	if ((s32)(ack - srv.snd_una) > 0) {
+		srv.snd_una = ack;
+		srv.dupacks = 0;
+		srv.idle = 0;
+	} else if (!len && srv.snd_nxt != srv.snd_una && ++srv.dupacks == 3) {
+		srv.snd_nxt = srv.snd_una;
+		srv.resends++;
+	}
+	if (!len && !(ip->tcp_flags & TCP_FIN))
+		srv.acks++;
+
+	if (len && seq == srv.rcv_nxt && srv.request_len + len <= MAX_REQUEST) {
+		memcpy(srv.request + srv.request_len, data, len);
+		srv.request_len += len;
+		srv.request[srv.request_len] = '\0';
+		srv.rcv_nxt += len;
+		if (!srv.resp && strstr(srv.request, "\r\n\r\n"))
+			srv_respond();
+	}
+	if (ip->tcp_flags & TCP_FIN) {
+		srv.client_fin = true;
+		srv.rcv_nxt++;
+		return;
+	}
+	srv_output(dev);
+}
+
+static void srv_poll(struct udevice *dev)
+{
+	/* Let the client's delayed ACK go, then send everything again */
+	sandbox_timer_add_offset(srv.snd_nxt != srv.snd_una ? 50 : 1000);
+	if (srv.snd_nxt != srv.snd_una && ++srv.idle == SERVER_RTO_POLLS) {
+		srv.idle = 0;
+		srv.snd_nxt = srv.snd_una;
+		srv.resends++;
+		srv_output(dev);
+	}
+}
+
+static const struct sandbox_eth_responder srv_responder = {
+	.send	= srv_recv,
+	.poll	= srv_poll,
+};
+
+static void srv_reset(ulong size, int chunk, uint mss, int drop)
+{
+	free(srv.resp);
+	memset(&srv, '\0', sizeof(srv));
+	srv.size = size;
+	srv.chunk = chunk;
+	srv.mss = mss;
+	srv.drop = drop;
+}
+
+static int wget_download(struct unit_test_state *uts, const char *path)
+{
+	return net_test_download(uts, WGET, path, srv.size);
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_wget(struct unit_test_state *uts)
+{
+	/* A scaled window, wrapping sequence numbers and a lost segment */
+	srv_reset((1 << 20) + 123, 0, 1460, 20);
+	ut_assertok(wget_download(uts, FILE_PATH));
+	ut_assert(srv.wscale > 0);
+	ut_assert(srv.max_flight > 65535);
+	ut_assert(srv.resends > 0);
+	ut_assert(srv.client_fin);
+
+	/* Chunked, in small segments, with every other segment acked */
+	srv_reset(100000, 1000, 100, 0);
+	ut_assertok(wget_download(uts, NET_TEST_SERVER_IP ":" FILE_PATH));
+	ut_asserteq_str(NET_TEST_SERVER_IP ":" FILE_PATH, net_boot_file_name);
+	ut_assert(srv.acks <= srv.segments / 2 + 2);
+	ut_asserteq(0, srv.resends);
+
+	/* A body which ends when the server closes the connection */
+	srv_reset(5000, -1, 1460, 0);
+	ut_assertok(wget_download(uts, FILE_PATH + 1));
+	ut_assert(srv.client_fin);
+
+	/* A missing file */
+	srv_reset(0, 0, 1460, 0);
+	copy_filename(net_boot_file_name, "/missing",
+		      sizeof(net_boot_file_name));
+	ut_assert(net_loop(WGET) < 0);
+	ut_assert(srv.client_rst);
+
+	return 0;
+}
+
+static int dm_test_eth_wget(struct unit_test_state *uts)
+{
+	int retval;
+
+	retval = net_test_run(uts, &srv_responder, _dm_test_eth_wget);
+	srv_reset(0, 0, 0, 0);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_wget, DM_TESTF_SCAN_FDT);
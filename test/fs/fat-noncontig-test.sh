@@ -21,8 +21,8 @@
 # The test will create a FAT filesystem image, record the CRC of a randomly
 # generated file in the image, build U-Boot sandbox, invoke U-Boot sandbox to
 # read the file and validate that the CRCs match. Expected output is shown
-# below. The important part of the log is the penultimate line that contains
-# either "PASS" or "FAILURE".
+# below. The important parts of the log are the lines that contain either
+# "PASS" or "FAILURE".
 #
 #    mkfs.fat 3.0.26 (2014-03-07)
 #
@@ -43,8 +43,20 @@
 #    crc32 for 00001000 ... 02008743 ==> 6a080523
 #    => if itest.l *0 != 2305086a; then echo FAILURE; else echo PASS; fi
 #    PASS
+#    => blkcache show
+#    ...
+#    => setexpr srcaddr 1000 + 12345
+#    => load host 0:0 4000000 noncontig.img 100000 12345
+#    1048576 bytes read in 0 ms
+#    => if cmp.b ${srcaddr} 4000000 100000; then echo PASS; else echo FAILURE; fi
+#    Total of 1048576 byte(s) were the same
+#    PASS
 #    => reset
 #
+# The second load reads part of the file from an offset that is not cluster
+# aligned, using the cluster chain cached by the first one. "blkcache show"
+# reports how many device reads the first load needed.
+#
 # All temporary files used by this script are created in ./sandbox to avoid
 # polluting the source tree. test/fs/fs-test.sh also uses this directory for
 # the same purpose.
@@ -61,6 +73,9 @@ testfn=noncontig.img
 mnttestfn=${mnt}/${testfn}
 crcaddr=0
 loadaddr=1000
+partaddr=4000000
+partsize=100000
+partpos=12345
 
 for prereq in fallocate mkfs.fat dd crc32; do
     if [ ! -x "`which $prereq`" ]; then
@@ -137,6 +152,10 @@ host bind 0 ${img}
 load host 0:0 ${loadaddr} ${testfn}
 crc32 ${loadaddr} \$filesize ${crcaddr}
 if itest.l *${crcaddr} != ${crc}; then echo FAILURE; else echo PASS; fi
+blkcache show
+setexpr srcaddr ${loadaddr} + ${partpos}
+load host 0:0 ${partaddr} ${testfn} ${partsize} ${partpos}
+if cmp.b \${srcaddr} ${partaddr} ${partsize}; then echo PASS; else echo FAILURE; fi
 reset
 EOF
 if [ $? -ne 0 ]; then
@@ -11,6 +11,10 @@
 # make O=sandbox sandbox_config
 # make O=sandbox
 # ./test/image/test-fit.py -u sandbox/u-boot
+#
+# With -b it instead times the loading of a large ramdisk. Run it against
+# builds with and without CONFIG_FIT_VERIFY_ON_LOAD to compare the two ways
+# of verifying images.
 
 import doctest
 from optparse import OptionParser
@@ -77,6 +81,12 @@ base_its = '''
                         os = "linux";
                         %(ramdisk_load)s
                         compression = "none";
+                        hash@1 {
+                                algo = "crc32";
+                        };
+                        hash@2 {
+                                algo = "sha1";
+                        };
                 };
                 ramdisk@2 {
                         description = "snow";
@@ -422,6 +432,8 @@ def run_fit_test(mkimage, u_boot):
     debug_stdout(stdout)
     if read_file(ramdisk) != read_file(ramdisk_out):
         fail('Ramdisk not loaded', stdout)
+    if 'crc32+ sha1+ OK' not in stdout:
+        fail('Ramdisk hashes not verified', stdout)
 
     # Configuration with some Loadables
     set_test('Kernel + FDT + Ramdisk load + Loadables')
@@ -436,6 +448,64 @@ def run_fit_test(mkimage, u_boot):
     if read_file(loadables2) != read_file(loadables2_out):
         fail('Loadables2 (ramdisk) not loaded', stdout)
 
+# Script to time loading the FIT, with image verification set by 'verify'
+bench_script = '''
+sb load hostfs 0 %(fit_addr)x %(fit)s
+setenv verify %(verify)s
+time bootm start %(fit_addr)x
+sb save hostfs 0 %(ramdisk_addr)x %(ramdisk_out)s %(ramdisk_size)x
+reset
+'''
+
+def run_fit_bench(mkimage, u_boot):
+    """Time the loading of a large ramdisk from a FIT
+
+    The ramdisk is verified (crc32 and sha1) and copied to its load address,
+    then only copied, for comparison. Neither way of verifying allocates a
+    buffer for the image: it is hashed where it lies in the FIT or as it is
+    copied, so memory use is the FIT and the load address in every case and
+    only the time is shown.
+
+    Args:
+        mkimage: Filename of 'mkimage' utility
+        u_boot: Filename of U-Boot sandbox binary
+    """
+    global test_name
+
+    control_dtb = make_dtb()
+    kernel = make_kernel('test-kernel.bin', 'kernel')
+    ramdisk = make_fname('test-ramdisk.bin')
+    with open(ramdisk, 'wb') as fd:
+        fd.write(os.urandom(24 << 20))
+    ramdisk_out = make_fname('ramdisk-out.bin')
+    params = {
+        'fit_addr' : 0x1000,
+        'kernel' : kernel,
+        'fdt_load' : '',
+        'ramdisk' : ramdisk,
+        'ramdisk_out' : ramdisk_out,
+        'ramdisk_addr' : 0x2000000,
+        'ramdisk_size' : filesize(ramdisk),
+        'ramdisk_load' : 'load = <0x2000000>;',
+        'ramdisk_config' : 'ramdisk = "ramdisk@1";',
+        'loadables1' : kernel,
+        'loadables1_load' : '',
+        'loadables2' : kernel,
+        'loadables2_load' : '',
+        'loadables_config' : '',
+    }
+    params['fit'] = make_fit(mkimage, params)
+
+    for verify, what in (('y', 'verify and copy'), ('n', 'copy only')):
+        set_test('Ramdisk load, %s' % what)
+        params['verify'] = verify
+        stdout = command.Output(u_boot, '-d', control_dtb, '-c',
+                                bench_script % params)
+        if read_file(ramdisk) != read_file(ramdisk_out):
+            fail('Ramdisk not loaded', stdout)
+        print '  %d MB in%s' % (params['ramdisk_size'] >> 20,
+                                find_matching(stdout, 'time:'))
+
 def run_tests():
     """Parse options, run the FIT tests and print the result"""
     global base_path, base_dir
@@ -450,6 +520,8 @@ def run_tests():
             help="Don't delete temporary directory even when tests pass")
     parser.add_option('-t', '--selftest', action='store_true',
             help='Run internal self tests')
+    parser.add_option('-b', '--bench', action='store_true',
+            help='Time loading a large ramdisk instead of running the tests')
     (options, args) = parser.parse_args()
 
     # Find the path to U-Boot, and assume mkimage is in its tools/mkimage dir
@@ -461,13 +533,18 @@ def run_tests():
         doctest.testmod()
         return
 
-    title = 'FIT Tests'
-    print title, '\n', '=' * len(title)
+    if options.bench:
+        title = 'FIT Load Times'
+        print title, '\n', '=' * len(title)
+        run_fit_bench(mkimage, options.u_boot)
+    else:
+        title = 'FIT Tests'
+        print title, '\n', '=' * len(title)
 
-    run_fit_test(mkimage, options.u_boot)
+        run_fit_test(mkimage, options.u_boot)
 
-    print '\nTests passed'
-    print 'Caveat: this is only a sanity check - test coverage is poor'
+        print '\nTests passed'
+        print 'Caveat: this is only a sanity check - test coverage is poor'
 
     # Remove the tempoerary directory unless we are asked to keep it
     if options.keep:
@@ -0,0 +1,199 @@
+/*
+ * Tests for the initcall tasks in lib/initcall.c
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <initcall.h>
+#include <test/suites.h>
+
+/* A device which is ready some time after it is started */
+struct emul_dev {
+	uint latency;		/* Time to become ready, in ms */
+	int result;		/* Result once ready */
+	ulong start;		/* get_timer() when started */
+	ulong ready;		/* get_timer() when seen to be ready */
+};
+
+enum {
+	EMUL_FLASH,
+	EMUL_PHY,
+	EMUL_FS,
+	EMUL_USB,
+	EMUL_COUNT,
+};
+
+static struct emul_dev emul[EMUL_COUNT] = {
+	[EMUL_FLASH] = { 40, 0 },
+	[EMUL_PHY] = { 30, 0 },
+	[EMUL_FS] = { 20, 0 },
+	[EMUL_USB] = { 10, -EIO },
+};
+
+static int emul_start(int i)
+{
+	emul[i].start = get_timer(0);
+	emul[i].ready = 0;
+
+	return 0;
+}
+
+static int emul_poll(int i)
+{
+	if (get_timer(emul[i].start) < emul[i].latency)
+		return -EAGAIN;
+	emul[i].ready = get_timer(0);
+
+	return emul[i].result;
+}
+
+#define EMUL_TASK_FUNCS(_id) \
+	static int emul_start_##_id(void) { return emul_start(_id); } \
+	static int emul_poll_##_id(void) { return emul_poll(_id); }
+
+EMUL_TASK_FUNCS(EMUL_FLASH)
+EMUL_TASK_FUNCS(EMUL_PHY)
+EMUL_TASK_FUNCS(EMUL_FS)
+EMUL_TASK_FUNCS(EMUL_USB)
+
+static struct initcall_task flash_task = {
+	.name	= "flash",
+	.start	= emul_start_EMUL_FLASH,
+	.poll	= emul_poll_EMUL_FLASH,
+};
+
+static struct initcall_task phy_task = {
+	.name	= "phy",
+	.start	= emul_start_EMUL_PHY,
+	.poll	= emul_poll_EMUL_PHY,
+};
+
+static struct initcall_task *const fs_after[] = { &flash_task, NULL };
+
+static struct initcall_task fs_task = {
+	.name	= "fs",
+	.start	= emul_start_EMUL_FS,
+	.poll	= emul_poll_EMUL_FS,
+	.after	= fs_after,
+};
+
+static struct initcall_task usb_task = {
+	.name	= "usb",
+	.start	= emul_start_EMUL_USB,
+	.poll	= emul_poll_EMUL_USB,
+};
+
+/* A task which waits for one which is never started */
+static struct initcall_task never_task = {
+	.name	= "never",
+};
+
+static struct initcall_task *const orphan_after[] = { &never_task, NULL };
+
+static struct initcall_task orphan_task = {
+	.name	= "orphan",
+	.after	= orphan_after,
+};
+
+static int test_initcall_tasks(void)
+{
+	struct initcall_task *const tasks[] = {
+		&flash_task, &phy_task, &fs_task, &usb_task,
+	};
+	ulong start, elapsed;
+	uint serial = 0;
+	int i, ret;
+
+	start = get_timer(0);
+	/* fs is started while flash is still running, so must wait for it */
+	for (i = 0; i < ARRAY_SIZE(tasks); i++) {
+		ret = initcall_task_start(tasks[i]);
+		if (ret) {
+			printf("%s: start '%s': err=%d\n", __func__,
+			       tasks[i]->name, ret);
+			return ret;
+		}
+	}
+	if (initcall_task_start(&fs_task) != -EBUSY) {
+		printf("%s: started 'fs' twice\n", __func__);
+		return -EINVAL;
+	}
+	if (!initcall_task_poll()) {
+		printf("%s: tasks done too soon\n", __func__);
+		return -EINVAL;
+	}
+
+	ret = initcall_task_wait(&fs_task);
+	if (ret) {
+		printf("%s: wait 'fs': err=%d\n", __func__, ret);
+		return -EINVAL;
+	}
+	if (emul[EMUL_FS].start < emul[EMUL_FLASH].ready) {
+		printf("%s: 'fs' started at %lu, before 'flash' at %lu\n",
+		       __func__, emul[EMUL_FS].start - start,
+		       emul[EMUL_FLASH].ready - start);
+		return -EINVAL;
+	}
+	initcall_task_wait(NULL);
+	elapsed = get_timer(start);
+
+	for (i = 0; i < ARRAY_SIZE(tasks); i++) {
+		if (tasks[i]->state != INITCALL_TASK_DONE ||
+		    tasks[i]->ret != emul[i].result) {
+			printf("%s: '%s': state %d, ret %d, expected %d\n",
+			       __func__, tasks[i]->name, tasks[i]->state,
+			       tasks[i]->ret, emul[i].result);
+			return -EINVAL;
+		}
+		serial += emul[i].latency;
+	}
+
+	printf("%s: serial %u ms, overlapped %lu ms\n", __func__, serial,
+	       elapsed);
+	if (elapsed >= serial) {
+		printf("%s: tasks did not overlap\n", __func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_initcall_deadlock(void)
+{
+	int ret;
+
+	ret = initcall_task_start(&orphan_task);
+	if (ret) {
+		printf("%s: start: err=%d\n", __func__, ret);
+		return ret;
+	}
+	if (initcall_task_poll()) {
+		printf("%s: tasks still pending\n", __func__);
+		return -EINVAL;
+	}
+	ret = initcall_task_wait(&orphan_task);
+	if (ret != -EDEADLK) {
+		printf("%s: got %d, expected %d\n", __func__, ret, -EDEADLK);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int do_ut_initcall(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret = 0;
+
+	/* Tasks left by the board would confuse the timings */
+	initcall_task_wait(NULL);
+
+	ret |= test_initcall_tasks();
+	ret |= test_initcall_deadlock();
+
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
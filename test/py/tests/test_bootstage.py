@@ -0,0 +1,51 @@
+# SPDX-License-Identifier: GPL-2.0
+
+import json
+import os
+import pytest
+import u_boot_utils
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+def test_bootstage_export_mem(u_boot_console):
+    """Test that "bootstage export" writes trace JSON to memory and sets
+    filesize."""
+
+    ram_base = u_boot_utils.find_ram_base(u_boot_console)
+    addr = '%08x' % ram_base
+    u_boot_console.run_command('setenv filesize')
+    response = u_boot_console.run_command('bootstage export ' + addr)
+    assert('bytes written to' in response)
+    response = u_boot_console.run_command('printenv filesize')
+    assert('filesize=' in response)
+
+    # Too small a buffer must be refused
+    response = u_boot_console.run_command('bootstage export %s 10' % addr)
+    assert('Export needs' in response)
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+@pytest.mark.boardspec('sandbox')
+def test_bootstage_export_file(u_boot_console):
+    """Test that the exported trace is valid JSON holding nested spans for
+    initcalls and driver probes."""
+
+    fname = u_boot_console.config.result_dir + '/bootstage_trace.json'
+    try:
+        os.unlink(fname)
+    except:
+        pass
+
+    response = u_boot_console.run_command('bootstage export -f ' + fname)
+    assert('bytes written to' in response)
+    with open(fname) as f:
+        trace = json.load(f)
+    os.unlink(fname)
+
+    events = trace['traceEvents']
+    spans = [e for e in events if e['ph'] == 'X']
+    marks = [e for e in events if e['ph'] == 'i']
+    assert(any(e['name'] == 'reset' for e in marks))
+    assert(any(e['name'] == 'board_init_r' for e in marks))
+    assert(any(e['cat'] == 'initcall' for e in spans))
+    assert(any(e['cat'] == 'root' for e in spans))
+    for span in spans:
+        assert(span['dur'] > 0)
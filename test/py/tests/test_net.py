@@ -47,6 +47,26 @@ env__net_tftp_readable_file = {
     "size": 5058624,
     "crc32": "c2244b26",
 }
+
+# Details regarding a file that may be read from an HTTP server on port 80,
+# such as "python3 -m http.server 80". This variable may be omitted or set to
+# None if HTTP testing is not possible or desired.
+env__net_http_readable_file = {
+    "fn": "ubtest-readable.bin",
+    "addr": 0x10000000,
+    "size": 5058624,
+    "crc32": "c2244b26",
+}
+
+# Details regarding a file that may be read from an NFS server. The "fn" is
+# the exported path. This variable may be omitted or set to None if NFS
+# testing is not possible or desired.
+env__net_nfs_readable_file = {
+    "fn": "/export/ubtest-readable.bin",
+    "addr": 0x10000000,
+    "size": 5058624,
+    "crc32": "c2244b26",
+}
 """
 
 net_set_up = False
@@ -118,30 +138,39 @@ def test_net_ping(u_boot_console):
     output = u_boot_console.run_command('ping $serverip')
     assert 'is alive' in output
 
-@pytest.mark.buildconfigspec('cmd_net')
-def test_net_tftpboot(u_boot_console):
-    """Test the tftpboot command.
+def download_readable_file(u_boot_console, cmd='tftpboot',
+                           env_key='env__net_tftp_readable_file', window=None):
+    """Download a file named by the boardenv and check its size and CRC32.
 
-    A file is downloaded from the TFTP server, its size and optionally its
-    CRC32 are validated.
+    Args:
+        u_boot_console: A U-Boot console connection.
+        cmd: The command to download the file with.
+        env_key: The boardenv_* entry describing the file.
+        window: If not None, the tftpwindowsize to use for the download.
 
-    The details of the file to download are provided by the boardenv_* file;
-    see the comment at the beginning of this file.
+    Returns:
+        The output of the download command.
     """
 
     if not net_set_up:
         pytest.skip('Network not initialized')
 
-    f = u_boot_console.config.env.get('env__net_tftp_readable_file', None)
+    f = u_boot_console.config.env.get(env_key, None)
     if not f:
-        pytest.skip('No TFTP readable file to read')
+        pytest.skip('No %s readable file to read' % cmd)
 
     addr = f.get('addr', None)
     if not addr:
         addr = u_boot_utils.find_ram_base(u_boot_console)
 
     fn = f['fn']
-    output = u_boot_console.run_command('tftpboot %x %s' % (addr, fn))
+    if window is not None:
+        u_boot_console.run_command('setenv tftpwindowsize %d' % window)
+    try:
+        output = u_boot_console.run_command('%s %x %s' % (cmd, addr, fn))
+    finally:
+        if window is not None:
+            u_boot_console.run_command('setenv tftpwindowsize')
     expected_text = 'Bytes transferred = '
     sz = f.get('size', None)
     if sz:
@@ -150,10 +179,75 @@ def test_net_tftpboot(u_boot_console):
 
     expected_crc = f.get('crc32', None)
     if not expected_crc:
-        return
+        return output
 
     if u_boot_console.config.buildconfig.get('config_cmd_crc32', 'n') != 'y':
-        return
+        return output
+
+    crc_output = u_boot_console.run_command('crc32 %x $filesize' % addr)
+    assert expected_crc in crc_output
+    return output
+
+@pytest.mark.buildconfigspec('cmd_net')
+def test_net_tftpboot(u_boot_console):
+    """Test the tftpboot command.
+
+    A file is downloaded from the TFTP server, its size and optionally its
+    CRC32 are validated.
+
+    The details of the file to download are provided by the boardenv_* file;
+    see the comment at the beginning of this file.
+    """
+
+    download_readable_file(u_boot_console)
+
+@pytest.mark.buildconfigspec('cmd_net')
+@pytest.mark.buildconfigspec('net_tftp_vars')
+def test_net_tftpboot_windowsize(u_boot_console):
+    """Test the tftpboot command with an RFC 7440 window.
+
+    The same file as in test_net_tftpboot is downloaded with a window of
+    several blocks per acknowledgement. Servers without windowsize support
+    fall back to one block per acknowledgement, so this must always work.
+    Clearing tftpwindowsize afterwards must restore the default.
+    """
+
+    output = download_readable_file(u_boot_console, window=16)
+    assert 'blocks/s' in output
+
+    default = int(u_boot_console.config.buildconfig.get(
+        'config_tftp_windowsize', '1'))
+    output = download_readable_file(u_boot_console)
+    if default < 16:
+        assert ', window 16' not in output
+
+@pytest.mark.buildconfigspec('cmd_nfs')
+def test_net_nfs(u_boot_console):
+    """Test the nfs command.
+
+    A file is downloaded from the NFS server, its size and optionally its
+    CRC32 are validated. NFSv3 is used if the server offers it, with several
+    READs in flight; otherwise NFSv2.
+
+    The details of the file to download are provided by the boardenv_* file;
+    see the comment at the beginning of this file.
+    """
+
+    download_readable_file(u_boot_console, 'nfs',
+                           'env__net_nfs_readable_file')
+
+@pytest.mark.buildconfigspec('cmd_wget')
+def test_net_wget(u_boot_console):
+    """Test the wget command.
+
+    A file is downloaded from the HTTP server, its size and optionally its
+    CRC32 are validated. The download rate is printed, so it can be compared
+    with that of test_net_tftpboot.
+
+    The details of the file to download are provided by the boardenv_* file;
+    see the comment at the beginning of this file.
+    """
 
-    output = u_boot_console.run_command('crc32 %x $filesize' % addr)
-    assert expected_crc in output
+    output = download_readable_file(u_boot_console, 'wget',
+                                    'env__net_http_readable_file')
+    assert '/s' in output
@@ -0,0 +1,333 @@
+/*
+ * Tests for writing Android sparse images (common/image-sparse.c)
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <image-sparse.h>
+#include <malloc.h>
+#include <sparse_format.h>
+#include <test/suites.h>
+
+/* The emulated device, with the partition not aligned to an erase unit */
+#define DEV_BLK_SZ		512
+#define DEV_BLKS		16384
+#define DEV_ERASE_SZ		256
+#define PART_START		1000
+#define PART_SIZE		12000
+#define DEV_FRESH		0xa5
+
+/*
+ * The emulated cost of each command, and the write speed in MB/s. Like
+ * mmc_berase(), each erase unit takes its own start, end, erase and status
+ * commands.
+ */
+#define DEV_CMD_US		200
+#define DEV_WRITE_MBS		20
+#define DEV_ERASE_CMDS		4
+
+#define SPARSE_BLK_SZ		4096
+#define WORDS_PER_BLK		(SPARSE_BLK_SZ / 4)
+#define IMAGE_SIZE		(16 * SPARSE_BLK_SZ)
+#define SPARSE_FILL_VAL		0xdeadbeef
+
+struct test_chunk {
+	u16 type;
+	u32 blks;
+	u32 val;
+};
+
+/*
+ * Three adjacent RAW chunks with a CRC32 chunk among them, FILL chunks of
+ * a pattern and of zero, a large DONT_CARE chunk and a lone RAW chunk
+ */
+static const struct test_chunk test_chunks[] = {
+	{ CHUNK_TYPE_RAW, 3 },
+	{ CHUNK_TYPE_RAW, 5 },
+	{ CHUNK_TYPE_CRC32, 0 },
+	{ CHUNK_TYPE_RAW, 2 },
+	{ CHUNK_TYPE_FILL, 300, SPARSE_FILL_VAL },
+	{ CHUNK_TYPE_FILL, 200, 0 },
+	{ CHUNK_TYPE_DONT_CARE, 600 },
+	{ CHUNK_TYPE_RAW, 1 },
+	{ CHUNK_TYPE_FILL, 289, 0 },
+};
+
+struct test_dev {
+	u8 *mem;
+	bool bad_erase;
+	unsigned int writes;
+	unsigned int erases;
+	ulong us;
+};
+
+static u32 raw_word(uint blk, uint i)
+{
+	return (blk << 16 | i) ^ 0x5a5a5a5a;
+}
+
+/* Builds the image in @buf, returning the number of sparse blocks */
+static uint build_image(void *buf)
+{
+	sparse_header_t *hdr = buf;
+	chunk_header_t *chunk;
+	u32 *data;
+	uint blk = 0;
+	int i, j;
+
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->magic = SPARSE_HEADER_MAGIC;
+	hdr->major_version = 1;
+	hdr->file_hdr_sz = sizeof(sparse_header_t);
+	hdr->chunk_hdr_sz = sizeof(chunk_header_t);
+	hdr->blk_sz = SPARSE_BLK_SZ;
+	hdr->total_chunks = ARRAY_SIZE(test_chunks);
+
+	chunk = buf + sizeof(*hdr);
+	for (i = 0; i < ARRAY_SIZE(test_chunks); i++) {
+		const struct test_chunk *tc = &test_chunks[i];
+
+		chunk->chunk_type = tc->type;
+		chunk->chunk_sz = tc->blks;
+		data = (u32 *)(chunk + 1);
+		switch (tc->type) {
+		case CHUNK_TYPE_RAW:
+			for (j = 0; j < tc->blks * WORDS_PER_BLK; j++)
+				data[j] = raw_word(blk + j / WORDS_PER_BLK,
+						   j % WORDS_PER_BLK);
+			chunk->total_sz = tc->blks * SPARSE_BLK_SZ;
+			break;
+		case CHUNK_TYPE_FILL:
+		case CHUNK_TYPE_CRC32:
+			*data = tc->val;
+			chunk->total_sz = sizeof(u32);
+			break;
+		default:
+			chunk->total_sz = 0;
+			break;
+		}
+		chunk->total_sz += sizeof(*chunk);
+		chunk = (void *)chunk + chunk->total_sz;
+		blk += tc->blks;
+	}
+	hdr->total_blks = blk;
+
+	return blk;
+}
+
+static ulong write_us(ulong blks)
+{
+	return DEV_CMD_US + blks * DEV_BLK_SZ / DEV_WRITE_MBS;
+}
+
+static int test_write(struct sparse_storage *storage, void *priv,
+		      unsigned int offset, unsigned int size, char *data)
+{
+	struct test_dev *dev = priv;
+
+	if (offset + size > DEV_BLKS)
+		return -EINVAL;
+	memcpy(dev->mem + offset * DEV_BLK_SZ, data, size * DEV_BLK_SZ);
+	dev->writes++;
+	dev->us += write_us(size);
+
+	return size;
+}
+
+static int test_erase(struct sparse_storage *storage, void *priv,
+		      unsigned int offset, unsigned int size)
+{
+	struct test_dev *dev = priv;
+
+	if (offset % DEV_ERASE_SZ || size % DEV_ERASE_SZ ||
+	    offset + size > DEV_BLKS) {
+		dev->bad_erase = true;
+		return -EINVAL;
+	}
+	memset(dev->mem + offset * DEV_BLK_SZ, '\0', size * DEV_BLK_SZ);
+	dev->erases += size / DEV_ERASE_SZ;
+	dev->us += size / DEV_ERASE_SZ * DEV_ERASE_CMDS * DEV_CMD_US;
+
+	return size;
+}
+
+/* Checks the device holds the image, with DONT_CARE blocks untouched */
+static int check_dev(struct test_dev *dev)
+{
+	const u32 *mem = (u32 *)(dev->mem + PART_START * DEV_BLK_SZ);
+	uint blk = 0, b, j;
+	const struct test_chunk *tc;
+	u32 expect;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(test_chunks); i++) {
+		tc = &test_chunks[i];
+		for (b = blk; b < blk + tc->blks; b++) {
+			for (j = 0; j < WORDS_PER_BLK; j++) {
+				if (tc->type == CHUNK_TYPE_RAW)
+					expect = raw_word(b, j);
+				else if (tc->type == CHUNK_TYPE_FILL)
+					expect = tc->val;
+				else
+					expect = DEV_FRESH * 0x01010101U;
+				if (mem[b * WORDS_PER_BLK + j] != expect) {
+					printf("%s: block %u word %u is %08x, expected %08x\n",
+					       __func__, b, j,
+					       mem[b * WORDS_PER_BLK + j], expect);
+					return -EINVAL;
+				}
+			}
+		}
+		blk += tc->blks;
+	}
+
+	/* Nothing outside the partition is touched */
+	for (j = 0; j < PART_START * DEV_BLK_SZ; j++) {
+		if (dev->mem[j] != DEV_FRESH) {
+			printf("%s: byte %u before the partition changed\n",
+			       __func__, j);
+			return -EINVAL;
+		}
+	}
+	for (j = (PART_START + blk * SPARSE_BLK_SZ / DEV_BLK_SZ) * DEV_BLK_SZ;
+	     j < DEV_BLKS * DEV_BLK_SZ; j++) {
+		if (dev->mem[j] != DEV_FRESH) {
+			printf("%s: byte %u after the image changed\n",
+			       __func__, j);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/* What writing one block of each FILL chunk at a time used to cost */
+static ulong block_by_block_us(uint *cmdsp)
+{
+	uint per_blk = SPARSE_BLK_SZ / DEV_BLK_SZ;
+	const struct test_chunk *tc;
+	ulong us = 0;
+	uint cmds = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(test_chunks); i++) {
+		tc = &test_chunks[i];
+		if (tc->type == CHUNK_TYPE_RAW) {
+			us += write_us(tc->blks * per_blk);
+			cmds++;
+		} else if (tc->type == CHUNK_TYPE_FILL) {
+			us += tc->blks * per_blk * write_us(1);
+			cmds += tc->blks * per_blk;
+		}
+	}
+	*cmdsp = cmds;
+
+	return us;
+}
+
+/**
+ * run_sparse_test() - Write the test image and check the result
+ *
+ * @name:	Name of the test
+ * @erase:	true to let the device erase, which gives zeroes
+ * @max_writes:	Most write commands expected
+ * @return 0 if OK, -ve on error
+ */
+static int run_sparse_test(const char *name, bool erase, uint max_writes)
+{
+	struct sparse_storage storage;
+	struct test_dev dev;
+	void *image;
+	uint blks, cmds;
+	ulong old_us;
+	int ret;
+
+	memset(&dev, '\0', sizeof(dev));
+	dev.mem = malloc(DEV_BLKS * DEV_BLK_SZ);
+	image = malloc(IMAGE_SIZE);
+	if (!dev.mem || !image) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	memset(dev.mem, DEV_FRESH, DEV_BLKS * DEV_BLK_SZ);
+	blks = build_image(image);
+
+	memset(&storage, '\0', sizeof(storage));
+	storage.block_sz = DEV_BLK_SZ;
+	storage.start = PART_START;
+	storage.size = PART_SIZE;
+	storage.name = name;
+	storage.write = test_write;
+	if (erase) {
+		storage.erase = test_erase;
+		storage.erase_sz = DEV_ERASE_SZ;
+	}
+
+	ret = store_sparse_image(&storage, &dev, 0, image);
+	if (ret) {
+		printf("%s: %s: store failed %d\n", __func__, name, ret);
+		goto out;
+	}
+	ret = check_dev(&dev);
+	if (ret)
+		goto out;
+
+	old_us = block_by_block_us(&cmds);
+	printf("%s: %u writes, %u erases, %lu ms (block by block %u writes, %lu ms)\n",
+	       name, dev.writes, dev.erases, dev.us / 1000, cmds,
+	       old_us / 1000);
+	ret = -EINVAL;
+	if (dev.bad_erase) {
+		printf("%s: %s: unaligned erase\n", __func__, name);
+		goto out;
+	}
+	if (dev.writes > max_writes) {
+		printf("%s: %s: expected at most %u writes\n", __func__, name,
+		       max_writes);
+		goto out;
+	}
+	if (erase && !dev.erases) {
+		printf("%s: %s: nothing was erased\n", __func__, name);
+		goto out;
+	}
+	if (dev.us * 4 > old_us) {
+		printf("%s: %s: not much quicker than block by block\n",
+		       __func__, name);
+		goto out;
+	}
+
+	/* The image is the wrong size for the partition */
+	storage.size = blks * SPARSE_BLK_SZ / DEV_BLK_SZ - 1;
+	build_image(image);
+	if (store_sparse_image(&storage, &dev, 0, image) != -EINVAL) {
+		printf("%s: %s: overflowing image accepted\n", __func__,
+		       name);
+		goto out;
+	}
+	ret = 0;
+out:
+	free(image);
+	free(dev.mem);
+
+	return ret;
+}
+
+int do_ut_sparse(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret = 0;
+
+	/*
+	 * One write for the adjacent RAW chunks, one for the last RAW chunk
+	 * and one per 1MB of FILL. With erase, zero FILL chunks are erased
+	 * apart from a write each side.
+	 */
+	ret |= run_sparse_test("no erase", false, 7);
+	ret |= run_sparse_test("erase", true, 8);
+
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
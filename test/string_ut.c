@@ -0,0 +1,287 @@
+/*
+ * Tests and benchmark for the memory functions in lib/string.c
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <errno.h>
+#include <malloc.h>
+#include <test/suites.h>
+#ifdef CONFIG_SANDBOX
+#include <os.h>
+#endif
+
+/* Large enough for every alignment and length combination we try */
+#define TEST_BUF_SIZE	256
+#define TEST_MAX_OFFSET	(2 * sizeof(long))
+#define TEST_MAX_LEN	100
+#define TEST_GUARD	0xa5
+
+/* Benchmark sizes go from 16 bytes to 64MB, multiplying by 4 each time */
+#define BENCH_MIN_SIZE	16
+#define BENCH_MAX_SIZE	(64 << 20)
+/* Amount of data processed per function and size */
+#define BENCH_BYTES	(64 << 20)
+
+static void fill_pattern(char *buf, int size, int seed)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = seed + i * 7;
+}
+
+static int check_guard(const char *buf, int start, int end, const char *func,
+		       int off, int len)
+{
+	int i;
+
+	for (i = start; i < end; i++) {
+		if ((unsigned char)buf[i] != TEST_GUARD) {
+			printf("%s: off=%d, len=%d: byte %d outside the area was changed\n",
+			       func, off, len, i);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int test_memset(void)
+{
+	char buf[TEST_BUF_SIZE];
+	int off, len, i;
+
+	for (off = 0; off < TEST_MAX_OFFSET; off++) {
+		for (len = 0; len < TEST_MAX_LEN; len++) {
+			memset(buf, TEST_GUARD, sizeof(buf));
+			if (memset(buf + off, 0x3c, len) != buf + off) {
+				printf("%s: wrong return value\n", __func__);
+				return -EINVAL;
+			}
+			for (i = off; i < off + len; i++) {
+				if (buf[i] != 0x3c) {
+					printf("%s: off=%d, len=%d: byte %d not set\n",
+					       __func__, off, len, i);
+					return -EINVAL;
+				}
+			}
+			if (check_guard(buf, 0, off, __func__, off, len) ||
+			    check_guard(buf, off + len, sizeof(buf), __func__,
+					off, len))
+				return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int test_memcpy(void)
+{
+	char src[TEST_BUF_SIZE], dst[TEST_BUF_SIZE];
+	int soff, doff, len;
+
+	fill_pattern(src, sizeof(src), 1);
+	for (soff = 0; soff < TEST_MAX_OFFSET; soff++) {
+		for (doff = 0; doff < TEST_MAX_OFFSET; doff++) {
+			for (len = 0; len < TEST_MAX_LEN; len++) {
+				memset(dst, TEST_GUARD, sizeof(dst));
+				if (memcpy(dst + doff, src + soff, len) !=
+				    dst + doff) {
+					printf("%s: wrong return value\n",
+					       __func__);
+					return -EINVAL;
+				}
+				if (memcmp(dst + doff, src + soff, len)) {
+					printf("%s: soff=%d, doff=%d, len=%d: bad copy\n",
+					       __func__, soff, doff, len);
+					return -EINVAL;
+				}
+				if (check_guard(dst, 0, doff, __func__, doff,
+						len) ||
+				    check_guard(dst, doff + len, sizeof(dst),
+						__func__, doff, len))
+					return -EINVAL;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int test_memmove(void)
+{
+	char buf[TEST_BUF_SIZE], ref[TEST_BUF_SIZE];
+	int soff, doff, len, i;
+
+	/* all overlapping (and some disjoint) moves within one buffer */
+	for (soff = 0; soff < 3 * TEST_MAX_OFFSET; soff++) {
+		for (doff = 0; doff < 3 * TEST_MAX_OFFSET; doff++) {
+			for (len = 0; len < TEST_MAX_LEN; len++) {
+				fill_pattern(buf, sizeof(buf), 3);
+				fill_pattern(ref, sizeof(ref), 3);
+				for (i = 0; i < len; i++)
+					ref[doff + i] = buf[soff + i];
+				memmove(buf + doff, buf + soff, len);
+				if (memcmp(buf, ref, sizeof(buf))) {
+					printf("%s: soff=%d, doff=%d, len=%d: bad move\n",
+					       __func__, soff, doff, len);
+					return -EINVAL;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int test_memcmp(void)
+{
+	char a[TEST_BUF_SIZE], b[TEST_BUF_SIZE];
+	int aoff, boff, len, pos;
+
+	fill_pattern(a, sizeof(a), 5);
+	for (aoff = 0; aoff < TEST_MAX_OFFSET; aoff++) {
+		for (boff = 0; boff < TEST_MAX_OFFSET; boff++) {
+			for (len = 0; len < TEST_MAX_LEN; len++) {
+				memcpy(b + boff, a + aoff, len);
+				if (memcmp(a + aoff, b + boff, len)) {
+					printf("%s: aoff=%d, boff=%d, len=%d: equal areas differ\n",
+					       __func__, aoff, boff, len);
+					return -EINVAL;
+				}
+				/* a difference at each position, both ways */
+				for (pos = 0; pos < len; pos++) {
+					b[boff + pos] = a[aoff + pos] + 1;
+					if (memcmp(a + aoff, b + boff, len) >=
+					    0 ||
+					    memcmp(b + boff, a + aoff, len) <=
+					    0) {
+						printf("%s: aoff=%d, boff=%d, len=%d: difference at %d not seen\n",
+						       __func__, aoff, boff,
+						       len, pos);
+						return -EINVAL;
+					}
+					b[boff + pos] = a[aoff + pos];
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void *bench_alloc(size_t size)
+{
+#ifdef CONFIG_SANDBOX
+	/* the malloc() pool is too small for the largest sizes */
+	return os_malloc(size);
+#else
+	return malloc(size);
+#endif
+}
+
+static void bench_free(void *ptr)
+{
+#ifdef CONFIG_SANDBOX
+	os_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+static unsigned long bench_rate(u64 bytes, ulong us)
+{
+	/* bytes per microsecond is MB/s */
+	return us ? lldiv(bytes, us) : 0;
+}
+
+static void bench_size(char *src, char *dst, ulong size)
+{
+	ulong iter = BENCH_BYTES / size;
+	ulong start, us[4];
+	ulong i;
+	int res = 0;
+
+	start = timer_get_us();
+	for (i = 0; i < iter; i++)
+		memcpy(dst, src, size);
+	us[0] = timer_get_us() - start;
+
+	start = timer_get_us();
+	for (i = 0; i < iter; i++)
+		memmove(dst + 1, dst, size - 1);
+	us[1] = timer_get_us() - start;
+
+	start = timer_get_us();
+	for (i = 0; i < iter; i++)
+		memset(dst, i, size);
+	us[2] = timer_get_us() - start;
+
+	memcpy(dst, src, size);
+	start = timer_get_us();
+	for (i = 0; i < iter; i++)
+		res |= memcmp(dst, src, size);
+	us[3] = timer_get_us() - start;
+
+	printf("%9lu %9lu %9lu %9lu %9lu%s\n", size,
+	       bench_rate((u64)iter * size, us[0]),
+	       bench_rate((u64)iter * size, us[1]),
+	       bench_rate((u64)iter * size, us[2]),
+	       bench_rate((u64)iter * size, us[3]),
+	       res ? " (memcmp mismatch!)" : "");
+}
+
+static int bench_string(void)
+{
+	ulong max = BENCH_MAX_SIZE;
+	char *src, *dst;
+	ulong size;
+
+	/* use smaller sizes if memory is short */
+	do {
+		src = bench_alloc(max);
+		dst = src ? bench_alloc(max) : NULL;
+		if (dst)
+			break;
+		if (src)
+			bench_free(src);
+		max >>= 1;
+	} while (max >= BENCH_MIN_SIZE);
+	if (!dst) {
+		printf("%s: out of memory\n", __func__);
+		return -ENOMEM;
+	}
+
+	fill_pattern(src, max, 9);
+	printf("Throughput in MB/s\n");
+	printf("%9s %9s %9s %9s %9s\n", "size", "memcpy", "memmove",
+	       "memset", "memcmp");
+	for (size = BENCH_MIN_SIZE; size <= max; size <<= 2)
+		bench_size(src, dst, size);
+
+	bench_free(dst);
+	bench_free(src);
+
+	return 0;
+}
+
+int do_ut_string(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret = 0;
+
+	ret |= test_memset();
+	ret |= test_memcpy();
+	ret |= test_memmove();
+	ret |= test_memcmp();
+
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	if (!ret && argc > 1 && !strcmp(argv[1], "bench"))
+		ret = bench_string();
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
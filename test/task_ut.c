@@ -0,0 +1,221 @@
+/*
+ * Tests for the cooperative tasks in lib/task.c
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <task.h>
+#include <test/suites.h>
+
+#define LOG_SIZE	16
+
+/* Record of which task ran when, e.g. "a0b0a1" */
+static char task_log[LOG_SIZE];
+static int task_log_len;
+
+static int log_task(void *arg)
+{
+	const char *id = arg;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		if (task_log_len < LOG_SIZE - 2) {
+			task_log[task_log_len++] = *id;
+			task_log[task_log_len++] = '0' + i;
+		}
+		task_yield();
+	}
+
+	return *id;
+}
+
+static int test_task_switch(void)
+{
+	struct task *a, *b;
+	int ret;
+
+	task_log_len = 0;
+	memset(task_log, '\0', sizeof(task_log));
+	ret = task_create("a", log_task, "a", &a);
+	if (ret)
+		return ret;
+	ret = task_create("b", log_task, "b", &b);
+	if (ret)
+		return ret;
+
+	ret = task_join(a, 0);
+	if (ret != 'a') {
+		printf("%s: task 'a' returned %d\n", __func__, ret);
+		return -EINVAL;
+	}
+	ret = task_join(b, 0);
+	if (ret != 'b') {
+		printf("%s: task 'b' returned %d\n", __func__, ret);
+		return -EINVAL;
+	}
+	task_free(a);
+	task_free(b);
+
+	if (strcmp(task_log, "a0b0a1b1a2b2")) {
+		printf("%s: tasks ran in order '%s'\n", __func__, task_log);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Runs until asked to stop */
+static int spin_task(void *arg)
+{
+	ulong *count = arg;
+
+	do {
+		(*count)++;
+	} while (task_yield() != -EINTR);
+
+	return -EINTR;
+}
+
+static int test_task_timeout(void)
+{
+	struct task *task;
+	ulong count = 0;
+	int ret;
+
+	ret = task_create("spin", spin_task, &count, &task);
+	if (ret)
+		return ret;
+	ret = task_join(task, 20);
+	if (ret != -ETIMEDOUT || !count) {
+		printf("%s: join returned %d after %lu turns\n", __func__,
+		       ret, count);
+		return -EINVAL;
+	}
+	if (task_free(task) != -EBUSY) {
+		printf("%s: freed a running task\n", __func__);
+		return -EINVAL;
+	}
+
+	/* A delay in the main task lets the other one run */
+	count = 0;
+	udelay(5000);
+	if (!count) {
+		printf("%s: task did not run during udelay()\n", __func__);
+		return -EINVAL;
+	}
+
+	task_stop(task);
+	ret = task_join(task, 1000);
+	if (ret != -EINTR) {
+		printf("%s: stopped task returned %d\n", __func__, ret);
+		return -EINVAL;
+	}
+
+	return task_free(task);
+}
+
+static int never_task(void *arg)
+{
+	bool *ran = arg;
+
+	*ran = true;
+
+	return 0;
+}
+
+static int self_join_task(void *arg)
+{
+	struct task **taskp = arg;
+
+	return task_join(*taskp, 0);
+}
+
+static int test_task_cancel(void)
+{
+	struct task *task;
+	bool ran = false;
+	int ret;
+
+	/* A task stopped before it runs never runs */
+	ret = task_create("never", never_task, &ran, &task);
+	if (ret)
+		return ret;
+	task_stop(task);
+	ret = task_join(task, 1000);
+	if (ret != -EINTR || ran) {
+		printf("%s: stopped new task returned %d, ran=%d\n", __func__,
+		       ret, ran);
+		return -EINVAL;
+	}
+	task_free(task);
+
+	ret = task_create("self", self_join_task, &task, &task);
+	if (ret)
+		return ret;
+	ret = task_join(task, 1000);
+	if (ret != -EDEADLK) {
+		printf("%s: task joining itself returned %d\n", __func__, ret);
+		return -EINVAL;
+	}
+
+	return task_free(task);
+}
+
+#define IO_DELAY_MS	20
+
+/* Waits for some emulated I/O */
+static int io_task(void *arg)
+{
+	udelay(IO_DELAY_MS * 1000);
+
+	return 0;
+}
+
+static int test_task_overlap(void)
+{
+	struct task *a, *b;
+	ulong start, elapsed;
+	int ret;
+
+	start = get_timer(0);
+	ret = task_create("io_a", io_task, NULL, &a);
+	if (ret)
+		return ret;
+	ret = task_create("io_b", io_task, NULL, &b);
+	if (ret)
+		return ret;
+	ret = task_join(a, 1000) | task_join(b, 1000);
+	elapsed = get_timer(start);
+	task_free(a);
+	task_free(b);
+	if (ret) {
+		printf("%s: join failed\n", __func__);
+		return -EINVAL;
+	}
+
+	printf("%s: serial %u ms, overlapped %lu ms\n", __func__,
+	       2 * IO_DELAY_MS, elapsed);
+	if (elapsed >= 2 * IO_DELAY_MS) {
+		printf("%s: tasks did not overlap\n", __func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int do_ut_task(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret = 0;
+
+	ret |= test_task_switch();
+	ret |= test_task_timeout();
+	ret |= test_task_cancel();
+	ret |= test_task_overlap();
+
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
@@ -0,0 +1,282 @@
+/*
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Resolve a .dtb into a C table which driver model can walk to bind devices
+ * without parsing the device tree. See include/dm/bind-table.h
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <../include/libfdt.h>
+#include <../include/dm/bind-table.h>
+#include <u-boot/crc.h>
+
+/* Deepest node nesting we handle */
+#define MAX_DEPTH	32
+
+struct bind_node {
+	int offset;
+	int first_child;
+	int next_sibling;
+	unsigned int flags;
+	int compat_start;
+	int compat_count;
+};
+
+struct bind_info {
+	struct bind_node *node;
+	int node_count;
+	uint32_t *compat;
+	const char **compat_str;
+	int compat_count;
+};
+
+static void usage(const char *msg)
+{
+	if (msg)
+		fprintf(stderr, "Error: %s\n\n", msg);
+	fprintf(stderr, "fdtbind - build a driver model binding table from a .dtb\n\n"
+		"Usage: fdtbind [-o <output.c>] <input.dtb>\n"
+		"\t-o <file>\tWrite C source to <file> (default stdout)\n");
+	exit(1);
+}
+
+static char *read_fdt(const char *fname)
+{
+	FILE *f;
+	char *buf;
+	long size;
+
+	f = fopen(fname, "rb");
+	if (!f)
+		return NULL;
+	if (fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET))
+		goto err;
+	buf = malloc(size);
+	if (!buf)
+		goto err;
+	if (fread(buf, 1, size, f) != size) {
+		free(buf);
+		goto err;
+	}
+	fclose(f);
+	if (fdt_check_header(buf) || fdt_totalsize(buf) > size) {
+		free(buf);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return buf;
+err:
+	fclose(f);
+	return NULL;
+}
+
+static int add_compat(struct bind_info *info, const char *str)
+{
+	void *ptr;
+
+	ptr = realloc(info->compat, (info->compat_count + 1) *
+		      sizeof(*info->compat));
+	if (!ptr)
+		return -ENOMEM;
+	info->compat = ptr;
+	ptr = realloc(info->compat_str, (info->compat_count + 1) *
+		      sizeof(*info->compat_str));
+	if (!ptr)
+		return -ENOMEM;
+	info->compat_str = ptr;
+	info->compat[info->compat_count] = crc32(0, (const void *)str,
+						 strlen(str));
+	info->compat_str[info->compat_count++] = str;
+
+	return 0;
+}
+
+static int add_node(struct bind_info *info, const void *blob, int offset)
+{
+	struct bind_node *node;
+	const char *prop, *end;
+	int len;
+
+	node = realloc(info->node, (info->node_count + 1) * sizeof(*node));
+	if (!node)
+		return -ENOMEM;
+	info->node = node;
+	node += info->node_count++;
+	memset(node, '\0', sizeof(*node));
+	node->offset = offset;
+	node->first_child = -1;
+	node->next_sibling = -1;
+
+	/* This follows fdtdec_get_is_enabled() */
+	prop = fdt_getprop(blob, offset, "status", NULL);
+	if (!prop || !strcmp(prop, "okay"))
+		node->flags |= DM_BIND_ENABLED;
+	if (fdt_getprop(blob, offset, "u-boot,dm-pre-reloc", NULL))
+		node->flags |= DM_BIND_PRE_RELOC;
+
+	node->compat_start = info->compat_count;
+	prop = fdt_getprop(blob, offset, "compatible", &len);
+	if (!prop)
+		return 0;
+	for (end = prop + len; prop < end; prop += strlen(prop) + 1) {
+		if (add_compat(info, prop))
+			return -ENOMEM;
+		node->compat_count++;
+	}
+
+	return 0;
+}
+
+/* Build the table of nodes in offset order, linking children to parents */
+static int scan_fdt(struct bind_info *info, const void *blob)
+{
+	int last[MAX_DEPTH];	/* Last node added at each depth */
+	int offset, depth, idx, parent;
+
+	depth = 0;
+	for (offset = 0; offset >= 0;
+	     offset = fdt_next_node(blob, offset, &depth)) {
+		if (depth < 0)
+			break;
+		if (depth >= MAX_DEPTH) {
+			fprintf(stderr, "Nodes are nested too deeply\n");
+			return -E2BIG;
+		}
+		idx = info->node_count;
+		if (add_node(info, blob, offset))
+			return -ENOMEM;
+		if (depth) {
+			parent = last[depth - 1];
+			if (info->node[parent].first_child == -1)
+				info->node[parent].first_child = idx;
+			else if (last[depth] != -1)
+				info->node[last[depth]].next_sibling = idx;
+		}
+		last[depth] = idx;
+		if (depth + 1 < MAX_DEPTH)
+			last[depth + 1] = -1;
+	}
+	if (offset < 0 && offset != -FDT_ERR_NOTFOUND) {
+		fprintf(stderr, "Device tree error: %s\n",
+			fdt_strerror(offset));
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void write_table(FILE *out, struct bind_info *info, const void *blob,
+			const char *fname)
+{
+	char path[256];
+	uint32_t crc;
+	int i;
+
+	crc = crc32(0, (const void *)blob + fdt_off_dt_struct(blob),
+		    fdt_size_dt_struct(blob));
+	crc = crc32(crc, (const void *)blob + fdt_off_dt_strings(blob),
+		    fdt_size_dt_strings(blob));
+
+	fprintf(out, "/*\n * DO NOT MODIFY\n *\n"
+		" * This file was generated by fdtbind from %s\n */\n\n",
+		fname);
+	fprintf(out, "#include <common.h>\n#include <dm/bind-table.h>\n\n");
+
+	fprintf(out, "static const struct dm_bind_node dm_bind_nodes[] = {\n");
+	for (i = 0; i < info->node_count; i++) {
+		struct bind_node *node = &info->node[i];
+
+		if (fdt_get_path(blob, node->offset, path, sizeof(path)))
+			strcpy(path, "?");
+		fprintf(out, "\t/* %d: %s */\n", i, path);
+		fprintf(out, "\t{ %#x, %d, %d, %s, %d, %d },\n", node->offset,
+			node->first_child, node->next_sibling,
+			node->flags == (DM_BIND_ENABLED | DM_BIND_PRE_RELOC) ?
+			"DM_BIND_ENABLED | DM_BIND_PRE_RELOC" :
+			node->flags == DM_BIND_ENABLED ? "DM_BIND_ENABLED" :
+			node->flags == DM_BIND_PRE_RELOC ?
+			"DM_BIND_PRE_RELOC" : "0",
+			node->compat_start, node->compat_count);
+	}
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "static const unsigned int dm_bind_compat[] = {\n");
+	for (i = 0; i < info->compat_count; i++) {
+		fprintf(out, "\t%#010x,\t/* %s */\n", info->compat[i],
+			info->compat_str[i]);
+	}
+	/* Avoid an empty array */
+	if (!info->compat_count)
+		fprintf(out, "\t0\n");
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "const struct dm_bind_table dm_bind_table = {\n"
+		"\t.fdt_size\t= %#x,\n"
+		"\t.fdt_crc\t= %#010x,\n"
+		"\t.node_count\t= ARRAY_SIZE(dm_bind_nodes),\n"
+		"\t.node\t\t= dm_bind_nodes,\n"
+		"\t.compat\t\t= dm_bind_compat,\n"
+		"};\n", fdt_totalsize(blob), crc);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *out_fname = NULL;
+	struct bind_info info;
+	char *blob;
+	FILE *out;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "ho:")) != -1) {
+		switch (opt) {
+		case 'o':
+			out_fname = optarg;
+			break;
+		case 'h':
+			usage(NULL);
+		default:
+			usage("Invalid option");
+		}
+	}
+	if (optind != argc - 1)
+		usage("Missing filename");
+
+	blob = read_fdt(argv[optind]);
+	if (!blob) {
+		fprintf(stderr, "Cannot read device tree '%s': %s\n",
+			argv[optind], strerror(errno));
+		return 1;
+	}
+
+	memset(&info, '\0', sizeof(info));
+	if (scan_fdt(&info, blob))
+		return 1;
+
+	if (out_fname) {
+		out = fopen(out_fname, "w");
+		if (!out) {
+			fprintf(stderr, "Cannot open output file '%s'\n",
+				out_fname);
+			return 1;
+		}
+	} else {
+		out = stdout;
+	}
+	write_table(out, &info, blob, argv[optind]);
+	if (out_fname && fclose(out)) {
+		fprintf(stderr, "Cannot write output file '%s'\n", out_fname);
+		unlink(out_fname);
+		return 1;
+	}
+
+	return 0;
+}